@@ -62,6 +62,10 @@ CAF_BEGIN_C_EXTERNS
 #define CAF_BUFF_SZ              (sizeof(cbuffer_t))
 #endif /* !CAF_BUFFER_SZ */
 
+#ifndef CAF_BUFF_STORE_SZ
+#define CAF_BUFF_STORE_SZ        (sizeof(cbuf_store_t))
+#endif /* !CAF_BUFF_STORE_SZ */
+
 #ifndef CAF_BUFF_DELETE_CB
 #define CAF_BUFF_DELETE_CB(cb)   int (*cb)(void *ptr, size_t sz)
 #endif /* !CAF_BUFF_DELETE_CB */
@@ -74,6 +78,31 @@ CAF_BEGIN_C_EXTERNS
  */
 typedef struct caf_buffer_s cbuffer_t;
 
+/**
+ *
+ * @brief    Caffeine shared buffer store type.
+ * @see      caf_buffer_store_s
+ */
+typedef struct caf_buffer_store_s cbuf_store_t;
+
+/**
+ *
+ * @brief    Caffeine shared buffer store structure.
+ *
+ * Reference counted data shared by a buffer and its slices. The
+ * data is released with the last buffer referencing it.
+ *
+ * @see      cbuf_slice
+ */
+struct caf_buffer_store_s {
+	/** Buffers referencing the data */
+	int refs;
+	/** Data size */
+	size_t sz;
+	/** Data storage pointer */
+	void *data;
+};
+
 /**
  *
  * @brief    Caffeine buffer structure.
@@ -87,6 +116,10 @@ struct caf_buffer_s {
 	ssize_t iosz;
 	/** Data storage pointer */
 	void *data;
+	/** Arena holding the buffer, NULL for heap buffers */
+	caf_arena_t *arena;
+	/** Shared store the data points into, NULL if the buffer owns it */
+	cbuf_store_t *store;
 };
 
 /**
@@ -119,6 +152,38 @@ cbuffer_t *cbuf_new (void);
  */
 cbuffer_t *cbuf_create (size_t sz);
 
+/**
+ *
+ * @brief    Empty Buffer allocator in an arena.
+ *
+ * Like cbuf_new, but the buffer structure and its data are allocated
+ * from the given arena. Resizing operations keep using the arena,
+ * buffers extracted from it are placed in the same arena, and
+ * cbuf_delete does not free memory: everything is released by
+ * caf_arena_reset.
+ *
+ * @param[in]    arena              the arena.
+ * @return   cbuffer_t *            a new allocated buffer.
+ *
+ * @see      caf_arena_new
+ */
+cbuffer_t *cbuf_new_arena (caf_arena_t *arena);
+
+/**
+ *
+ * @brief    Buffer allocator in an arena.
+ *
+ * Like cbuf_create, with the buffer and its sz bytes of data
+ * allocated from the given arena.
+ *
+ * @param[in]    arena              the arena.
+ * @param[in]    sz                 buffer size.
+ * @return   cbuffer_t *            a new allocated buffer.
+ *
+ * @see      cbuf_new_arena
+ */
+cbuffer_t *cbuf_create_arena (caf_arena_t *arena, size_t sz);
+
 /**
  *
  * @brief    Buffer destructor.
@@ -371,6 +436,56 @@ cbuffer_t *cbuf_head_cut (cbuffer_t *src, size_t sz);
  */
 cbuffer_t *cbuf_tail_cut (cbuffer_t *src, size_t sz);
 
+/**
+ *
+ * @brief    Creates a view of a piece of the buffer.
+ *
+ * Like cbuf_extract, but nothing is copied: the returned buffer
+ * points to the bytes between from and to of the source data, which
+ * becomes a reference counted store shared by the source and its
+ * slices. Slices are deleted with cbuf_delete and accepted by every
+ * cbuf_* function; the ones modifying a buffer give it its own copy
+ * first, so writes never reach the other views.
+ *
+ * @param[in]        src            the source buffer.
+ * @param[in]        from           from the position.
+ * @param[in]        to             to the position.
+ * @return           the slice, NULL on failure or empty range.
+ *
+ * @see cbuf_own
+ */
+cbuffer_t *cbuf_slice (cbuffer_t *src, const size_t from, const size_t to);
+
+/**
+ *
+ * @brief    Splits a Caffeine Buffer into slices.
+ *
+ * Same as cbuf_split, but the pieces are slices of the source
+ * buffer instead of copies.
+ *
+ * @param[in]        src            the source buffer.
+ * @param[in]        pattern        the divisor pattern.
+ * @param[in]        patsz          pattern size.
+ * @return           a DLL with the slices.
+ *
+ * @see cbuf_slice
+ */
+deque_t *cbuf_split_slice (cbuffer_t *src, const void *pattern,
+						   size_t patsz);
+
+/**
+ *
+ * @brief    Gives a buffer its own data.
+ *
+ * A slice, or a buffer with slices, shares its data. This copies the
+ * bytes of the buffer into its own allocation, and must be called
+ * before writing through the data pointer directly.
+ *
+ * @param[in]        buf            the buffer.
+ * @return           CAF_OK on success, CAF_ERROR on failure.
+ */
+int cbuf_own (cbuffer_t *buf);
+
 #ifdef __cplusplus
 CAF_END_C_EXTERNS
 #endif /* !__cplusplus */
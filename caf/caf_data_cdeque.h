@@ -26,6 +26,8 @@
 #define CAF_DATA_CDEQUE_H 1
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <caf/caf_data_mem.h>
 
 /**
  * @defgroup      caf_dlnkc_list    Double Linked Circular List
@@ -100,7 +102,8 @@ typedef struct caf_cdeque_s cdeque_t;
  *
  * The double linked list node structure stores a pointer to the
  * first list node, a pointer to de second list node and an integer
- * with the list size.
+ * with the list size. When <b>pool</b> is set, nodes are taken from
+ * and returned to that node pool instead of the heap.
  *
  * @see      caf_cdequen_t
  * @see      cdeque_t
@@ -109,6 +112,7 @@ struct caf_cdeque_s {
 	caf_cdequen_t *head;
 	caf_cdequen_t *tail;
 	int size;
+	caf_npool_t *pool;
 };
 
 /**
@@ -141,6 +145,37 @@ cdeque_t *cdeque_new (void *data);
  */
 cdeque_t *cdeque_create (void);
 
+/**
+ *
+ * @brief    Creates a new list using a node pool.
+ *
+ * Creates an empty list which takes its nodes from the given node
+ * pool and releases them back to it. The pool can be shared between
+ * lists used from the same thread, and must outlive them.
+ *
+ * @param[in]    pool            node pool, created with CAF_LSTDLCNODE_SZ.
+ * @return       cdeque_t *      the allocated list.
+ *
+ * @see      caf_npool_new
+ * @see      cdeque_node_release
+ */
+cdeque_t *cdeque_create_pool (caf_npool_t *pool);
+
+/**
+ *
+ * @brief    Releases a node removed from the list.
+ *
+ * Releases a node returned by cdeque_pop or cdeque_first, giving it
+ * back to the list node pool, or freeing it if the list has no pool.
+ *
+ * @param[in]    lst            the list the node was removed from.
+ * @param[in]    n              the node to release.
+ *
+ * @see      cdeque_pop
+ * @see      cdeque_first
+ */
+void cdeque_node_release (cdeque_t *lst, caf_cdequen_t *n);
+
 /**
  *
  * @brief    Deletes a Caffeine Double Linked List.
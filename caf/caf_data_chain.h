@@ -0,0 +1,228 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_DATA_CHAIN_H
+#define CAF_DATA_CHAIN_H 1
+
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <caf/caf_data_buffer.h>
+
+/**
+ * @defgroup      caf_data_chain    Buffer Chains
+ * @ingroup       caf_data_string
+ * @addtogroup    caf_data_chain
+ * @{
+ *
+ * @brief     Caffeine Buffer Chains
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * A buffer chain is a sequence of cbuffer_t segments exposed as a
+ * struct iovec array, so a message made of several buffers -- a
+ * header, a body and a trailer -- is written with a single writev
+ * or sendmsg call, without joining them. Segments are added to both
+ * ends and consumed from the front without copying.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Computes the buffer chain structure size */
+#define CAF_CHAIN_SZ             (sizeof (cbuf_chain_t))
+/** Initial number of segments of a chain */
+#define CAF_CHAIN_SEGS           8
+
+/** Most segments passed to one vectored I/O call */
+#ifdef IOV_MAX
+#define CAF_CHAIN_IOV_MAX        IOV_MAX
+#else /* !IOV_MAX */
+#define CAF_CHAIN_IOV_MAX        1024
+#endif /* !IOV_MAX */
+
+/**
+ *
+ * @brief    Caffeine buffer chain type.
+ * @see      cbuf_chain_s
+ */
+typedef struct cbuf_chain_s cbuf_chain_t;
+
+/**
+ *
+ * @brief    Caffeine buffer chain structure.
+ *
+ * The segments live between <b>first</b> and <b>first + count</b>
+ * of both arrays, each iovec entry describing the unconsumed bytes
+ * of its segment. A segment holds its iosz bytes when iosz is
+ * positive and its sz bytes otherwise, as io_write does.
+ *
+ * @see      cbuf_chain_new
+ */
+struct cbuf_chain_s {
+	/** Segment buffers, owned by the chain */
+	cbuffer_t **segs;
+	/** Unconsumed bytes of each segment */
+	struct iovec *iov;
+	/** Index of the first segment */
+	int first;
+	/** Number of segments */
+	int count;
+	/** Allocated entries of both arrays */
+	int cap;
+	/** Bytes in the chain */
+	size_t len;
+};
+
+/**
+ *
+ * @brief    Creates an empty buffer chain.
+ *
+ * @return   cbuf_chain_t *         a new chain, NULL on failure.
+ *
+ * @see      cbuf_chain_delete
+ */
+cbuf_chain_t *cbuf_chain_new (void);
+
+/**
+ *
+ * @brief    Deletes a buffer chain.
+ *
+ * The remaining segments are deleted with cbuf_delete.
+ *
+ * @param[in]    ch                 the chain.
+ */
+void cbuf_chain_delete (cbuf_chain_t *ch);
+
+/**
+ *
+ * @brief    Adds a segment at the end of the chain.
+ *
+ * The chain takes the buffer, which is deleted once consumed. Use a
+ * slice to add data that stays owned by someone else.
+ *
+ * @param[in]    ch                 the chain.
+ * @param[in]    b                  the segment.
+ * @return       int                CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      cbuf_slice
+ */
+int cbuf_chain_append (cbuf_chain_t *ch, cbuffer_t *b);
+
+/**
+ *
+ * @brief    Adds a segment at the front of the chain.
+ *
+ * @param[in]    ch                 the chain.
+ * @param[in]    b                  the segment.
+ * @return       int                CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      cbuf_chain_append
+ */
+int cbuf_chain_prepend (cbuf_chain_t *ch, cbuffer_t *b);
+
+/**
+ *
+ * @brief    Consumes bytes from the front of the chain.
+ *
+ * Segments fully consumed are deleted, a partially consumed one is
+ * kept with its iovec entry advanced.
+ *
+ * @param[in]    ch                 the chain.
+ * @param[in]    n                  number of bytes.
+ * @return       size_t             the bytes consumed.
+ */
+size_t cbuf_chain_consume (cbuf_chain_t *ch, size_t n);
+
+/**
+ *
+ * @brief    Gets the iovec array of the chain.
+ *
+ * The array stays valid until the chain is modified.
+ *
+ * @param[in]    ch                 the chain.
+ * @param[out]   cnt                receives the number of entries.
+ * @return       struct iovec *     the entries, NULL on empty chains.
+ */
+struct iovec *cbuf_chain_iov (cbuf_chain_t *ch, int *cnt);
+
+/**
+ *
+ * @brief    Gets the iovec array to receive into the chain.
+ *
+ * Describes the whole sz bytes of every segment, giving shared
+ * segments their own data first, for readv and recvmsg.
+ *
+ * @param[in]    ch                 the chain.
+ * @param[out]   cnt                receives the number of entries,
+ *                                  -1 when a segment cannot get its
+ *                                  own data.
+ * @return       struct iovec *     the entries, NULL on empty chains
+ *                                  or failure.
+ *
+ * @see      cbuf_chain_received
+ */
+struct iovec *cbuf_chain_iov_in (cbuf_chain_t *ch, int *cnt);
+
+/**
+ *
+ * @brief    Records received bytes.
+ *
+ * After a read into cbuf_chain_iov_in, sets the iosz of every segment
+ * to the bytes it received, and the chain to hold those bytes.
+ *
+ * @param[in]    ch                 the chain.
+ * @param[in]    n                  the bytes received.
+ */
+void cbuf_chain_received (cbuf_chain_t *ch, size_t n);
+
+/**
+ *
+ * @brief    Gets the bytes in the chain.
+ *
+ * @param[in]    ch                 the chain.
+ * @return       size_t             the unconsumed bytes.
+ */
+size_t cbuf_chain_length (const cbuf_chain_t *ch);
+
+/**
+ *
+ * @brief    Copies the chain into one buffer.
+ *
+ * @param[in]    ch                 the chain.
+ * @return       cbuffer_t *        a new buffer, NULL on failure or
+ *                                  empty chains.
+ */
+cbuffer_t *cbuf_chain_flatten (const cbuf_chain_t *ch);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_DATA_CHAIN_H */
+/* caf_data_chain.h ends here */
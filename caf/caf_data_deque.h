@@ -26,6 +26,8 @@
 #define CAF_DATA_DEQUE_H 1
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <caf/caf_data_mem.h>
 
 /**
  * @defgroup      caf_dlnk_list    Double Linked List
@@ -100,7 +102,10 @@ typedef struct caf_deque_s deque_t;
  *
  * The double linked list node structure stores a pointer to the
  * first list node, a pointer to de second list node and an integer
- * with the list size.
+ * with the list size. When <b>pool</b> is set, nodes are taken from
+ * and returned to that node pool instead of the heap. When
+ * <b>arena</b> is set, the list and its nodes live in that arena and
+ * are released with it.
  *
  * @see      caf_dequen_t
  * @see      deque_t
@@ -109,6 +114,8 @@ struct caf_deque_s {
 	caf_dequen_t *head;
 	caf_dequen_t *tail;
 	int size;
+	caf_npool_t *pool;
+	caf_arena_t *arena;
 };
 
 /**
@@ -141,6 +148,52 @@ deque_t *deque_new (void *data);
  */
 deque_t *deque_create (void);
 
+/**
+ *
+ * @brief    Creates a new list using a node pool.
+ *
+ * Creates an empty list which takes its nodes from the given node
+ * pool and releases them back to it. The pool can be shared between
+ * lists used from the same thread, and must outlive them.
+ *
+ * @param[in]    pool            node pool, created with CAF_CAF_DEQUENODE_SZ.
+ * @return       deque_t *       the allocated list.
+ *
+ * @see      caf_npool_new
+ * @see      deque_node_release
+ */
+deque_t *deque_create_pool (caf_npool_t *pool);
+
+/**
+ *
+ * @brief    Creates a new list in an arena.
+ *
+ * Creates an empty list whose structure and nodes are allocated from
+ * the given arena. Removing nodes or deleting the list does not free
+ * memory, everything is released by caf_arena_reset.
+ *
+ * @param[in]    arena           the arena.
+ * @return       deque_t *       the allocated list.
+ *
+ * @see      caf_arena_new
+ */
+deque_t *deque_create_arena (caf_arena_t *arena);
+
+/**
+ *
+ * @brief    Releases a node removed from the list.
+ *
+ * Releases a node returned by deque_pop or deque_first, giving it
+ * back to the list node pool, or freeing it if the list has no pool.
+ *
+ * @param[in]    lst            the list the node was removed from.
+ * @param[in]    n              the node to release.
+ *
+ * @see      deque_pop
+ * @see      deque_first
+ */
+void deque_node_release (deque_t *lst, caf_dequen_t *n);
+
 /**
  *
  * @brief    Deletes a Caffeine Double Linked List.
@@ -24,6 +24,10 @@
 */
 #ifndef CAF_DATA_LSTC_H
 #define CAF_DATA_LSTC_H 1
+
+#include <stdlib.h>
+#include <caf/caf_data_mem.h>
+
 /**
  * @defgroup      caf_circular_list    Circular List
  * @ingroup       caf_data_struct
@@ -235,6 +239,37 @@ lstcn_t *lstc_push (lstcn_t *lst, void *data);
  */
 lstcn_t *lstc_pop (lstcn_t *lst);
 
+/**
+ *
+ * @brief    Sets the calling thread node pool.
+ *
+ * Circular lists have no list structure to hold a pool, so the pool
+ * is kept per thread: every node allocated or released by the calling
+ * thread goes through the given pool, created with CAF_LSTC_SZ. A NULL
+ * pool restores plain heap allocation. The pool must outlive the nodes
+ * the thread releases through it.
+ *
+ * @param[in]    pool           the node pool, or NULL.
+ * @return       caf_npool_t *  the previous thread pool.
+ *
+ * @see    lstc_node_release
+ */
+caf_npool_t *lstc_pool_set (caf_npool_t *pool);
+
+/**
+ *
+ * @brief    Releases a node removed from the list.
+ *
+ * Releases a node returned by lstc_pop, giving it back to the
+ * calling thread node pool, or freeing it if the thread has no pool.
+ *
+ * @param[in]    n              the node to release.
+ *
+ * @see    lstc_pop
+ * @see    lstc_pool_set
+ */
+void lstc_node_release (lstcn_t *n);
+
 /**
  *
  * @brief    Sets a data node in the list.
@@ -24,6 +24,12 @@
 */
 #ifndef CAF_DATA_MEM_H
 #define CAF_DATA_MEM_H 1
+
+#include <pthread.h>
+#ifdef CAFFEINE_MEMTRACE
+#include <string.h>
+#endif /* !CAFFEINE_MEMTRACE */
+
 /**
  * @defgroup      caf_memory    Memory Routines
  * @ingroup       caf_mem
@@ -37,7 +43,8 @@
  *
  * Common memory routines, as defines the GNU Coding Standards, these
  * are wrapper routines to common memory allocation and deallocation
- * functions.
+ * functions. CAFFEINE_MEMTRACE builds account every block to the
+ * xmalloc call site that allocated it.
  *
  */
 
@@ -50,7 +57,24 @@ CAF_BEGIN_C_EXTERNS
 #define STRSZ(ptr)          (size_t)((strlen (ptr)))
 #define PRTINIT(ptr)        (void *)ptr == (void *)NULL
 
-#ifndef CAFFEINE_DEBUG
+#if defined(CAFFEINE_MEMTRACE) /* use allocation tracing */
+
+#define xmalloc(mem) \
+        caf_mtrace_malloc (mem, __FILE__, __LINE__)
+#define xempty(ptr,sz) \
+        memset (ptr, 0, sz)
+#define xfree(ptr) \
+        caf_mtrace_free (ptr)
+#define xdestroy(ptr,sz) \
+        caf_mtrace_destroy (ptr, sz)
+#define xrealloc(ptr,sz) \
+        caf_mtrace_realloc (ptr, sz, __FILE__, __LINE__)
+#define xstrdestroy(ptr) \
+        caf_mtrace_strdestroy (ptr)
+#define xmemcpy(dst,src,sz) \
+        memcpy (dst, src, sz)
+
+#elif !defined(CAFFEINE_DEBUG)
 
 /**
  *
@@ -172,6 +196,551 @@ void *xmemcpy (void *dst, void *src, size_t sz);
 
 #endif /* !CAFFEINE_DEBUG */
 
+#ifdef CAFFEINE_MEMTRACE
+
+/** Allocation site hash buckets */
+#define CAF_MTRACE_SITES    1024
+/** Live allocation hash buckets */
+#define CAF_MTRACE_BUCKETS  65536
+/** Locks striping the live allocation buckets */
+#define CAF_MTRACE_LOCKS    64
+/** Largest number of sites in a report */
+#define CAF_MTRACE_TOP      64
+
+/**
+ *
+ * @brief    Caffeine allocation site type.
+ * @see      caf_mtrace_site_s
+ */
+typedef struct caf_mtrace_site_s caf_mtrace_site_t;
+
+/**
+ *
+ * @brief    Caffeine allocation site structure.
+ *
+ * Counters of the allocations made by one xmalloc or xrealloc call,
+ * identified by its __FILE__ and __LINE__. Sites are never released,
+ * and their counters are updated atomically, so a report can be
+ * taken at any moment without locking.
+ *
+ * @see      caf_mtrace_dump
+ */
+struct caf_mtrace_site_s {
+	/** Next site in the bucket */
+	caf_mtrace_site_t *next;
+	/** Source file of the call */
+	const char *file;
+	/** Source line of the call */
+	int line;
+	/** Live bytes */
+	size_t bytes;
+	/** Live blocks */
+	size_t live;
+	/** Highest live bytes seen */
+	size_t peak;
+	/** Allocations made */
+	size_t allocs;
+	/** Allocations released */
+	size_t frees;
+};
+
+/**
+ *
+ * @brief    Allocates traced memory.
+ *
+ * Used through xmalloc in CAFFEINE_MEMTRACE builds. The block is
+ * accounted to the calling site until it is released.
+ *
+ * @param[in]    sz              ammount of memory to allocate.
+ * @param[in]    file            calling source file.
+ * @param[in]    line            calling source line.
+ * @return       void *          the allocated pointer, NULL on failure.
+ *
+ * @see      caf_mtrace_free
+ */
+void *caf_mtrace_malloc (size_t sz, const char *file, int line);
+
+/**
+ *
+ * @brief    Reallocates traced memory.
+ *
+ * Used through xrealloc. The block moves its accounting to the
+ * calling site.
+ *
+ * @param[in]    ptr             the pointer to realloc, or NULL.
+ * @param[in]    sz              the ammount of memory to reallocate.
+ * @param[in]    file            calling source file.
+ * @param[in]    line            calling source line.
+ * @return       void *          the reallocated pointer, NULL on failure.
+ */
+void *caf_mtrace_realloc (void *ptr, size_t sz, const char *file, int line);
+
+/**
+ *
+ * @brief    Releases traced memory.
+ *
+ * Used through xfree. Pointers that were not allocated with tracing
+ * are released without accounting.
+ *
+ * @param[in]    ptr             the pointer to free.
+ */
+void caf_mtrace_free (void *ptr);
+
+/**
+ *
+ * @brief    Zeroes and releases traced memory.
+ *
+ * @param[in]    ptr             the pointer to free.
+ * @param[in]    sz              the ammount of memory to set to zero.
+ */
+void caf_mtrace_destroy (void *ptr, size_t sz);
+
+/**
+ *
+ * @brief    Zeroes and releases a traced string.
+ *
+ * @param[in]    ptr             the string to free.
+ */
+void caf_mtrace_strdestroy (void *ptr);
+
+/**
+ *
+ * @brief    Gets the totals of all the sites.
+ *
+ * @param[out]   total           receives the totals, file and line are
+ *                               left empty.
+ * @return       int             the number of sites.
+ */
+int caf_mtrace_stats (caf_mtrace_site_t *total);
+
+/**
+ *
+ * @brief    Finds an allocation site.
+ *
+ * @param[in]    file            source file, compared as a string.
+ * @param[in]    line            source line.
+ * @return       caf_mtrace_site_t *  the site, NULL if it did not
+ *                                    allocate yet.
+ */
+caf_mtrace_site_t *caf_mtrace_find (const char *file, int line);
+
+/**
+ *
+ * @brief    Writes the top allocation sites.
+ *
+ * Writes the totals and the <b>top</b> sites holding the most live
+ * bytes to the <b>fd</b> descriptor. It takes no locks and does not
+ * allocate, so it may be called from a signal handler.
+ *
+ * @param[in]    fd              the output descriptor.
+ * @param[in]    top             number of sites, up to CAF_MTRACE_TOP.
+ * @return       int             the number of sites written.
+ */
+int caf_mtrace_dump (int fd, int top);
+
+/**
+ *
+ * @brief    Schedules allocation reports.
+ *
+ * Writes caf_mtrace_dump to <b>fd</b> when the process exits and,
+ * when <b>sig</b> is positive, every time the process receives
+ * <b>sig</b>, so a running daemon can be inspected with kill.
+ *
+ * @param[in]    fd              the output descriptor.
+ * @param[in]    top             number of sites in each report.
+ * @param[in]    sig             report signal, zero for none.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int caf_mtrace_report (int fd, int top, int sig);
+
+#endif /* !CAFFEINE_MEMTRACE */
+
+/** Computes the node pool structure size */
+#define CAF_NPOOL_SZ        (sizeof (caf_npool_t))
+/** Default cap of cached nodes in a node pool */
+#define CAF_NPOOL_CAP       1024
+
+/**
+ *
+ * @brief    Caffeine node pool type.
+ * @see      caf_npool_s
+ */
+typedef struct caf_npool_s caf_npool_t;
+
+/**
+ *
+ * @brief    Caffeine node pool structure.
+ *
+ * A free list of fixed size nodes. Released nodes are kept in the
+ * free list, up to <b>cap</b> nodes, and handed back on the next
+ * allocation, so a list with steady push and pop churn stops calling
+ * malloc. The pool has no locking: use one pool per list or one pool
+ * per thread. Nodes are allocated one by one with xmalloc, so a pooled
+ * node can also be released with xfree.
+ *
+ * @see      caf_npool_t
+ */
+struct caf_npool_s {
+	/** Free list head, linked through the first node word */
+	void *free;
+	/** Node size */
+	size_t node_sz;
+	/** Maximum number of cached nodes */
+	size_t cap;
+	/** Currently cached nodes */
+	size_t cached;
+	/** Nodes allocated with xmalloc */
+	size_t allocs;
+	/** Nodes released with xfree */
+	size_t frees;
+	/** Allocations served from the free list */
+	size_t hits;
+};
+
+/**
+ *
+ * @brief    Creates a node pool.
+ *
+ * @param[in]    node_sz         node size in bytes.
+ * @param[in]    cap             maximum number of cached nodes.
+ * @return       caf_npool_t *   the new pool, NULL on failure.
+ *
+ * @see      caf_npool_delete
+ */
+caf_npool_t *caf_npool_new (size_t node_sz, size_t cap);
+
+/**
+ *
+ * @brief    Deletes a node pool.
+ *
+ * Frees the pool and its cached nodes. Nodes in use are not
+ * tracked by the pool and stay valid.
+ *
+ * @param[in]    pool            the pool to delete.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      caf_npool_new
+ */
+int caf_npool_delete (caf_npool_t *pool);
+
+/**
+ *
+ * @brief    Gets a node from the pool.
+ *
+ * @param[in]    pool            the pool.
+ * @return       void *          the node, NULL on failure.
+ *
+ * @see      caf_npool_put
+ */
+void *caf_npool_get (caf_npool_t *pool);
+
+/**
+ *
+ * @brief    Returns a node to the pool.
+ *
+ * The node is cached if the pool is below its cap, and freed
+ * otherwise.
+ *
+ * @param[in]    pool            the pool.
+ * @param[in]    ptr             the node to release.
+ *
+ * @see      caf_npool_get
+ */
+void caf_npool_put (caf_npool_t *pool, void *ptr);
+
+/**
+ *
+ * @brief    Sets the pool cap.
+ *
+ * Frees cached nodes above the new cap.
+ *
+ * @param[in]    pool            the pool.
+ * @param[in]    cap             maximum number of cached nodes.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      caf_npool_new
+ */
+int caf_npool_set_cap (caf_npool_t *pool, size_t cap);
+
+/** Computes the arena structure size */
+#define CAF_ARENA_SZ        (sizeof (caf_arena_t))
+/** Default arena block size */
+#define CAF_ARENA_BLK       16384
+/** Alignment of arena allocations */
+#define CAF_ARENA_ALIGN     16
+
+/**
+ *
+ * @brief    Caffeine arena block type.
+ * @see      caf_arena_blk_s
+ */
+typedef struct caf_arena_blk_s caf_arena_blk_t;
+
+/**
+ *
+ * @brief    Caffeine arena block structure.
+ *
+ * Header of a block of arena memory, the allocations follow it.
+ *
+ * @see      caf_arena_t
+ */
+struct caf_arena_blk_s {
+	/** Next block in the chain */
+	caf_arena_blk_t *next;
+	/** Usable bytes after the header */
+	size_t sz;
+	/** Bytes handed out */
+	size_t used;
+};
+
+/**
+ *
+ * @brief    Caffeine arena type.
+ * @see      caf_arena_s
+ */
+typedef struct caf_arena_s caf_arena_t;
+
+/**
+ *
+ * @brief    Caffeine arena structure.
+ *
+ * A region allocator: allocations bump a pointer in the current
+ * block and are never released one by one, the whole region is
+ * released at once with caf_arena_reset or caf_arena_delete. Blocks
+ * are allocated with xmalloc; blocks of the default size are kept
+ * across resets, so a region reused per request stops calling
+ * malloc. Allocations larger than a block get a block of their own,
+ * released on reset. The arena has no locking: use one arena per
+ * request or per thread.
+ *
+ * @see      caf_arena_t
+ */
+struct caf_arena_s {
+	/** Blocks in use, the head is the current one */
+	caf_arena_blk_t *blk;
+	/** Blocks kept by the last reset */
+	caf_arena_blk_t *spare;
+	/** Block size */
+	size_t blk_sz;
+	/** Blocks allocated with xmalloc */
+	size_t blocks;
+	/** Allocations served since the arena was created */
+	size_t allocs;
+	/** Bytes handed out since the last reset */
+	size_t used;
+};
+
+/**
+ *
+ * @brief    Creates an arena.
+ *
+ * @param[in]    blk_sz          block size in bytes, zero for CAF_ARENA_BLK.
+ * @return       caf_arena_t *   the new arena, NULL on failure.
+ *
+ * @see      caf_arena_delete
+ */
+caf_arena_t *caf_arena_new (size_t blk_sz);
+
+/**
+ *
+ * @brief    Deletes an arena.
+ *
+ * Frees every block, all the memory handed out by the arena becomes
+ * invalid.
+ *
+ * @param[in]    a               the arena to delete.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      caf_arena_new
+ */
+int caf_arena_delete (caf_arena_t *a);
+
+/**
+ *
+ * @brief    Allocates memory from an arena.
+ *
+ * The memory is aligned to CAF_ARENA_ALIGN bytes and lives until
+ * the next caf_arena_reset or caf_arena_delete.
+ *
+ * @param[in]    a               the arena.
+ * @param[in]    sz              bytes to allocate.
+ * @return       void *          the allocated pointer, NULL on failure.
+ *
+ * @see      caf_arena_reset
+ */
+void *caf_arena_alloc (caf_arena_t *a, size_t sz);
+
+/**
+ *
+ * @brief    Resizes memory allocated from an arena.
+ *
+ * The last allocation grows or shrinks in place when its block has
+ * room, any other allocation is copied to a new one.
+ *
+ * @param[in]    a               the arena.
+ * @param[in]    ptr             the allocated pointer, or NULL.
+ * @param[in]    old_sz          its current size.
+ * @param[in]    sz              the new size.
+ * @return       void *          the resized pointer, NULL on failure.
+ *
+ * @see      caf_arena_alloc
+ */
+void *caf_arena_realloc (caf_arena_t *a, void *ptr, size_t old_sz,
+						 size_t sz);
+
+/**
+ *
+ * @brief    Releases every allocation of an arena.
+ *
+ * @param[in]    a               the arena.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      caf_arena_alloc
+ */
+int caf_arena_reset (caf_arena_t *a);
+
+/** Number of slab size classes */
+#define CAF_SLAB_CLASSES    12
+/** Largest object served by the slab, bigger ones go to xmalloc */
+#define CAF_SLAB_MAX        512
+/** Objects held by a magazine */
+#define CAF_SLAB_MAG        32
+/** Size of the chunks carved into objects */
+#define CAF_SLAB_CHUNK      65536
+/** Byte written over released objects in debug mode */
+#define CAF_SLAB_POISON     0xa5
+
+/**
+ *
+ * @brief    Caffeine slab magazine type.
+ * @see      caf_slab_mag_s
+ */
+typedef struct caf_slab_mag_s caf_slab_mag_t;
+
+/**
+ *
+ * @brief    Caffeine slab magazine structure.
+ *
+ * A stack of free objects of one size class, owned by a thread or
+ * parked in the class depot.
+ *
+ * @see      caf_slab_class_t
+ */
+struct caf_slab_mag_s {
+	/** Next magazine in the depot */
+	caf_slab_mag_t *next;
+	/** Objects in the magazine */
+	int rounds;
+	/** The objects */
+	void *obj[CAF_SLAB_MAG];
+};
+
+/**
+ *
+ * @brief    Caffeine slab size class type.
+ * @see      caf_slab_class_s
+ */
+typedef struct caf_slab_class_s caf_slab_class_t;
+
+/**
+ *
+ * @brief    Caffeine slab size class structure.
+ *
+ * Fixed size objects are carved from CAF_SLAB_CHUNK chunks and cached
+ * in magazines. Every thread keeps two magazines per class, so
+ * allocations and releases only take the class lock to trade a full
+ * or empty magazine with the depot, once every CAF_SLAB_MAG
+ * operations. Chunks are never returned to the system. The thread
+ * magazines need CAF_USE_SLAB, set by the CAFFEINE_SLAB build option,
+ * and GNU C; otherwise every operation takes the class lock.
+ *
+ * @see      caf_slab_alloc
+ */
+struct caf_slab_class_s {
+	/** Object size */
+	size_t sz;
+	/** Protects the depot and the chunk */
+	pthread_mutex_t lock;
+	/** Depot of full magazines */
+	caf_slab_mag_t *full;
+	/** Depot of empty magazines */
+	caf_slab_mag_t *empty;
+	/** Objects flushed from exiting threads, linked by the first word */
+	void *free;
+	/** Unused part of the current chunk */
+	char *cur;
+	/** End of the current chunk */
+	char *end;
+	/** Chunks allocated with xmalloc */
+	size_t chunks;
+	/** Magazine trades with the depot */
+	size_t trades;
+	/** Released objects found modified in debug mode */
+	size_t corrupt;
+};
+
+/**
+ *
+ * @brief    Allocates a fixed size object.
+ *
+ * Objects up to CAF_SLAB_MAX bytes come from the slab size class
+ * that fits them, bigger ones from xmalloc.
+ *
+ * @param[in]    sz              object size.
+ * @return       void *          the object, NULL on failure.
+ *
+ * @see      caf_slab_free
+ */
+void *caf_slab_alloc (size_t sz);
+
+/**
+ *
+ * @brief    Releases a fixed size object.
+ *
+ * @param[in]    ptr             an object from caf_slab_alloc.
+ * @param[in]    sz              the size given to caf_slab_alloc.
+ *
+ * @see      caf_slab_alloc
+ */
+void caf_slab_free (void *ptr, size_t sz);
+
+/**
+ *
+ * @brief    Gets the size class serving a size.
+ *
+ * @param[in]    sz              object size.
+ * @return       caf_slab_class_t *  the class, NULL above CAF_SLAB_MAX.
+ */
+caf_slab_class_t *caf_slab_class (size_t sz);
+
+/**
+ *
+ * @brief    Enables object poisoning.
+ *
+ * In debug mode released objects are filled with CAF_SLAB_POISON
+ * and checked when handed out again, writes after release are
+ * reported on stderr and counted in the class. Set it before the
+ * first allocation; it is on by default in CAFFEINE_DEBUG builds.
+ *
+ * @param[in]    on              non zero to enable.
+ */
+void caf_slab_debug (int on);
+
+/*
+ * Fixed size framework objects (list nodes, buffers, hashes,
+ * connections, packer values) are allocated with xobjalloc and
+ * released with xobjfree, served by the slab when built with
+ * CAF_USE_SLAB, which the CAFFEINE_SLAB build option sets for the
+ * library and the tests alike.
+ */
+#ifdef CAF_USE_SLAB
+#define xobjalloc(sz)       caf_slab_alloc (sz)
+#define xobjfree(ptr,sz)    caf_slab_free (ptr, sz)
+#else /* !CAF_USE_SLAB */
+#define xobjalloc(sz)       xmalloc (sz)
+#define xobjfree(ptr,sz)    xfree (ptr)
+#endif /* !CAF_USE_SLAB */
+
 #ifdef __cplusplus
 CAF_END_C_EXTERNS
 #endif /* !__cplusplus */
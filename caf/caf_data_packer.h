@@ -151,6 +151,8 @@ struct caf_unit_value_s {
 	size_t sz;
 	/** Unit data */
 	void *data;
+	/** Arena holding the value, NULL for heap values */
+	caf_arena_t *arena;
 };
 
 
@@ -254,6 +256,24 @@ int caf_unit_delete(caf_unit_t *r);
 caf_unit_value_t *caf_unit_value_new(caf_unit_type_t type, size_t sz,
 									 void *data);
 
+/**
+ * @brief		Allocates a value in an arena.
+ *
+ * Like caf_unit_value_new, with the value and a copy of the data
+ * allocated from the given arena. caf_unit_value_delete does not
+ * free such values, they are released by caf_arena_reset.
+ *
+ * @param arena			the arena.
+ * @param type			unit type.
+ * @param sz			data size.
+ * @param data			data pointer.
+ *
+ * @return		A new allocated value pointer.
+ */
+caf_unit_value_t *caf_unit_value_new_arena(caf_arena_t *arena,
+										   caf_unit_type_t type, size_t sz,
+										   void *data);
+
 /**
  * @brief		Deallocates the memory of a given unit value.
  *
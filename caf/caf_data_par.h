@@ -0,0 +1,271 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more denexts.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_DATA_PAR_H
+#define CAF_DATA_PAR_H 1
+
+#include <stdio.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_cdeque.h>
+#include <caf/caf_data_lstc.h>
+#include <caf/caf_thread_exec.h>
+
+/**
+ * @defgroup      caf_data_par    Parallel List Operations
+ * @ingroup       caf_data_struct
+ * @addtogroup    caf_data_par
+ * @{
+ *
+ * @brief     Parallel map, search and reduce over lists.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Parallel variants of the deque_t, cdeque_t and lstcn_t walkers. The
+ * caller walks the list once to split it in chunks of consecutive
+ * nodes, and every chunk runs as a task on a pth_exec_t thread pool.
+ * The list must not be modified while an operation runs, and the
+ * callbacks must be safe to call from several threads at once. These
+ * functions wait for the pool, so they must not be called from a task
+ * running on the same pool.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Computes the parallel context structure size */
+#define CAF_PAR_SZ                     (sizeof(caf_par_t))
+/** Default chunks per pool worker, to balance uneven callbacks */
+#define CAF_PAR_CHUNKS_PER_WORKER      4
+/** Declares a reduce callback, folds data into the accumulator */
+#define CAF_PAR_CBREDUCE(red)          void *(*red)(void *acc, void *data)
+/** Declares a combine callback, merges two chunk accumulators */
+#define CAF_PAR_CBCOMB(comb)           void *(*comb)(void *acc1, void *acc2)
+
+/**
+ *
+ * @brief    Caffeine parallel chunk statistics type.
+ * @see      caf_par_chunk_s
+ */
+typedef struct caf_par_chunk_s caf_par_chunk_t;
+
+/**
+ *
+ * @brief    Caffeine parallel chunk statistics structure.
+ */
+struct caf_par_chunk_s {
+	/** Elements in the chunk */
+	int count;
+	/** Elements visited, less than count if the chunk stopped early */
+	int visited;
+	/** Chunk run time in nanoseconds */
+	long ns;
+};
+
+/**
+ *
+ * @brief    Caffeine parallel context type.
+ * @see      caf_par_s
+ */
+typedef struct caf_par_s caf_par_t;
+
+/**
+ *
+ * @brief    Caffeine parallel context structure.
+ *
+ * Holds the pool to run on, the chunk count, and the statistics of the
+ * last operation run with the context. A context must not be used by
+ * two operations at once.
+ */
+struct caf_par_s {
+	/** Executor running the chunks */
+	pth_exec_t *exec;
+	/** Chunks per operation */
+	int chunks;
+	/** Chunks used by the last operation */
+	int used;
+	/** Statistics of the last operation, chunks entries */
+	caf_par_chunk_t *stats;
+	/** Wall time of the last operation in nanoseconds */
+	long ns;
+};
+
+/**
+ *
+ * @brief    Creates a parallel context.
+ *
+ * @param[in]    exec           the executor running the chunks.
+ * @param[in]    chunks         chunks per operation, zero for
+ *                              CAF_PAR_CHUNKS_PER_WORKER per worker.
+ * @return       caf_par_t *    the new context, NULL on failure.
+ *
+ * @see      caf_par_delete
+ */
+caf_par_t *caf_par_new (pth_exec_t *exec, int chunks);
+
+/**
+ *
+ * @brief    Deletes a parallel context.
+ *
+ * The executor is not deleted.
+ *
+ * @param[in]    p              the context.
+ * @return       int            CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      caf_par_new
+ */
+int caf_par_delete (caf_par_t *p);
+
+/**
+ *
+ * @brief    Dumps the chunk timings of the last operation.
+ *
+ * @param[in]    out            FILE output stream.
+ * @param[in]    p              the context.
+ * @return       int            the number of written bytes.
+ */
+int caf_par_dump (FILE *out, caf_par_t *p);
+
+/**
+ *
+ * @brief    Parallel deque_map.
+ *
+ * @param[in]    p          the parallel context.
+ * @param[in]    lst        the list to walk.
+ * @param[in]    step       the function to apply.
+ * @return       int        the number of afected elements.
+ *
+ * @see      deque_map
+ */
+int deque_pmap (caf_par_t *p, deque_t *lst, CAF_CAF_DEQUENODE_CBMAP(step));
+
+/**
+ *
+ * @brief    Parallel deque_search.
+ *
+ * Returns the first match in list order. Chunks after a chunk with
+ * a match stop early.
+ *
+ * @param[in]    p          the parallel context.
+ * @param[in]    lst        the list to search.
+ * @param[in]    data       the data to compare with.
+ * @param[in]    srch       the comparision callback.
+ * @return       void *     the found data, NULL if not found.
+ *
+ * @see      deque_search
+ */
+void *deque_psearch (caf_par_t *p, deque_t *lst, void *data,
+					 CAF_CAF_DEQUENODE_CBSRCH(srch));
+
+/**
+ *
+ * @brief    Parallel search for all matches.
+ *
+ * @param[in]    p          the parallel context.
+ * @param[in]    lst        the list to search.
+ * @param[in]    data       the data to compare with.
+ * @param[in]    srch       the comparision callback.
+ * @return       deque_t *  new list with the matches in list order,
+ *                          NULL on failure.
+ *
+ * @see      deque_psearch
+ */
+deque_t *deque_psearch_all (caf_par_t *p, deque_t *lst, void *data,
+							CAF_CAF_DEQUENODE_CBSRCH(srch));
+
+/**
+ *
+ * @brief    Parallel reduce.
+ *
+ * Every chunk folds its elements with <b>red</b> starting from
+ * <b>init</b>, then the chunk results are merged in list order with
+ * <b>comb</b>. The result matches a serial fold when <b>init</b> is an
+ * identity for <b>comb</b> and <b>comb</b> is associative.
+ *
+ * @param[in]    p          the parallel context.
+ * @param[in]    lst        the list to reduce.
+ * @param[in]    init       the initial accumulator of every chunk.
+ * @param[in]    red        the fold callback.
+ * @param[in]    comb       the combine callback.
+ * @return       void *     the reduced value, init for an empty list.
+ */
+void *deque_preduce (caf_par_t *p, deque_t *lst, void *init,
+					 CAF_PAR_CBREDUCE(red), CAF_PAR_CBCOMB(comb));
+
+/**
+ * @brief    Parallel cdeque_map, see deque_pmap.
+ */
+int cdeque_pmap (caf_par_t *p, cdeque_t *lst, CAF_LSTDLCNODE_CBMAP(step));
+
+/**
+ * @brief    Parallel cdeque_search, see deque_psearch.
+ */
+void *cdeque_psearch (caf_par_t *p, cdeque_t *lst, void *data,
+					  CAF_LSTDLCNODE_CBSRCH(srch));
+
+/**
+ * @brief    Parallel search for all matches, see deque_psearch_all.
+ */
+deque_t *cdeque_psearch_all (caf_par_t *p, cdeque_t *lst, void *data,
+							 CAF_LSTDLCNODE_CBSRCH(srch));
+
+/**
+ * @brief    Parallel reduce, see deque_preduce.
+ */
+void *cdeque_preduce (caf_par_t *p, cdeque_t *lst, void *init,
+					  CAF_PAR_CBREDUCE(red), CAF_PAR_CBCOMB(comb));
+
+/**
+ * @brief    Parallel lstc_map, see deque_pmap.
+ */
+int lstc_pmap (caf_par_t *p, lstcn_t *lst, CAF_LSTCNODE_CBMAP(step));
+
+/**
+ * @brief    Parallel lstc_search, see deque_psearch.
+ */
+void *lstc_psearch (caf_par_t *p, lstcn_t *lst, void *data,
+					CAF_LSTCNODE_CBSRCH(srch));
+
+/**
+ * @brief    Parallel search for all matches, see deque_psearch_all.
+ */
+deque_t *lstc_psearch_all (caf_par_t *p, lstcn_t *lst, void *data,
+						   CAF_LSTCNODE_CBSRCH(srch));
+
+/**
+ * @brief    Parallel reduce, see deque_preduce.
+ */
+void *lstc_preduce (caf_par_t *p, lstcn_t *lst, void *init,
+					CAF_PAR_CBREDUCE(red), CAF_PAR_CBCOMB(comb));
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_DATA_PAR_H */
+/* caf_data_par.h ends here */
+
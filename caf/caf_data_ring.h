@@ -0,0 +1,290 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more denexts.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_DATA_RING_H
+#define CAF_DATA_RING_H 1
+
+#include <stdio.h>
+#include <caf/caf_data_deque.h>
+
+/**
+ * @defgroup      caf_ring    Ring Buffer Queue
+ * @ingroup       caf_data_struct
+ * @addtogroup    caf_ring
+ * @{
+ *
+ * @brief     Caffeine Ring Buffer Queue Functions.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Growable ring buffer of data pointers. The elements live in one
+ * contiguous power of two sized array, so both ends are O(1) without
+ * per element allocation and any position is reached in O(1). The
+ * buffer doubles when full. Callbacks are the deque_t ones.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Computes the ring structure size */
+#define CAF_RING_SZ                    (sizeof(ring_t))
+/** Minimum ring capacity */
+#define CAF_RING_MIN                   16
+
+/**
+ *
+ * @brief    Caffeine ring buffer type.
+ * @see      caf_ring_s
+ */
+typedef struct caf_ring_s ring_t;
+
+/**
+ *
+ * @brief    Caffeine ring buffer structure.
+ *
+ * Element <b>i</b> is stored at slots[(head + i) & mask].
+ *
+ * @see      ring_t
+ */
+struct caf_ring_s {
+	/** Element storage, mask + 1 slots */
+	void **slots;
+	/** Capacity minus one, the capacity is a power of two */
+	unsigned int mask;
+	/** Slot of the first element */
+	unsigned int head;
+	/** Number of elements */
+	int size;
+};
+
+/**
+ *
+ * @brief    Creates a new empty ring.
+ *
+ * @param[in]    cap            initial capacity, rounded up to a power
+ *                              of two and at least CAF_RING_MIN.
+ * @return       ring_t *       the allocated ring, NULL on failure.
+ *
+ * @see      ring_t
+ */
+ring_t *ring_create (int cap);
+
+/**
+ *
+ * @brief    Deletes a ring.
+ *
+ * Frees the ring, calling <b>del</b> on every element from the
+ * front. The callback must return zero on success; on failure the
+ * operation stops and the remaining elements stay in the ring.
+ *
+ * @param[in]    r      the ring.
+ * @param[in]    del    the callback function to free the elements.
+ * @return       int    CAF_OK on success, the deleted count on failure.
+ *
+ * @see      ring_t
+ */
+int ring_delete (ring_t *r, CAF_CAF_DEQUENODE_CBDEL(del));
+
+/**
+ *
+ * @brief    Deletes a ring.
+ *
+ * Frees the ring without touching the elements.
+ *
+ * @param[in]    r      the ring.
+ * @return       int    CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      ring_t
+ */
+int ring_delete_nocb (ring_t *r);
+
+/**
+ *
+ * @brief    Verifies if the ring is empty or not
+ *
+ * @param[in]    r      The ring to check
+ * @return       CAF_OK if is empty, CAF_ERROR if not.
+ *
+ * @see    ring_t
+ */
+int ring_empty_list (ring_t *r);
+
+/**
+ *
+ * @brief    Returns the number of elements in the ring.
+ *
+ * @param[in]    r      The ring to get length
+ *
+ * @see    ring_t
+ */
+int ring_length (ring_t *r);
+
+/**
+ *
+ * @brief    Makes room for at least <b>cap</b> elements.
+ *
+ * @param[in]    r      the ring.
+ * @param[in]    cap    the wanted capacity.
+ * @return       int    CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see    ring_t
+ */
+int ring_reserve (ring_t *r, int cap);
+
+/**
+ *
+ * @brief    Pushes an element at the end of the ring.
+ *
+ * @param[in]    r              the ring.
+ * @param[in]    data           the data to store.
+ * @return       ring_t *       the ring, NULL on failure.
+ *
+ * @see    ring_pop_front
+ */
+ring_t *ring_push_back (ring_t *r, void *data);
+
+/**
+ *
+ * @brief    Pushes an element at the start of the ring.
+ *
+ * @param[in]    r              the ring.
+ * @param[in]    data           the data to store.
+ * @return       ring_t *       the ring, NULL on failure.
+ *
+ * @see    ring_pop_back
+ */
+ring_t *ring_push_front (ring_t *r, void *data);
+
+/**
+ *
+ * @brief    Gets and removes the first element in the ring.
+ *
+ * @param[in]    r              the ring.
+ * @return       void *         the element data, NULL if empty.
+ *
+ * @see    ring_push_back
+ */
+void *ring_pop_front (ring_t *r);
+
+/**
+ *
+ * @brief    Gets and removes the last element in the ring.
+ *
+ * @param[in]    r              the ring.
+ * @return       void *         the element data, NULL if empty.
+ *
+ * @see    ring_push_front
+ */
+void *ring_pop_back (ring_t *r);
+
+/**
+ *
+ * @brief    Gets the data in the given position.
+ *
+ * @param[in]    r              the ring.
+ * @param[in]    pos            the position, zero is the front.
+ * @return       void *         the element data, NULL if out of range.
+ *
+ * @see    ring_set
+ */
+void *ring_get (ring_t *r, int pos);
+
+/**
+ *
+ * @brief    Sets the data in the given position.
+ *
+ * @param[in]    r              the ring.
+ * @param[in]    pos            the position, zero is the front.
+ * @param[in]    data           the data to store.
+ * @return       int            the position, CAF_ERROR_SUB if out of range.
+ *
+ * @see    ring_get
+ */
+int ring_set (ring_t *r, int pos, void *data);
+
+/**
+ *
+ * @brief    Apply a function to the ring elements, front to back.
+ *
+ * @param[in]    r          the ring to walk.
+ * @param[in]    step       the function to apply.
+ * @return       int        the number of afected elements.
+ *
+ * @see      ring_t
+ */
+int ring_map (ring_t *r, CAF_CAF_DEQUENODE_CBMAP(step));
+
+/**
+ *
+ * @brief    Apply a function to the ring elements, front to back.
+ *
+ * Like ring_map, but stops on the first step that does not
+ * return CAF_OK.
+ *
+ * @param[in]    r          the ring to walk.
+ * @param[in]    step       the function to apply.
+ * @return       int        the number of afected elements.
+ *
+ * @see      ring_t
+ */
+int ring_map_checked (ring_t *r, CAF_CAF_DEQUENODE_CBMAP(step));
+
+/**
+ *
+ * @brief    Searches for an element using a callback function.
+ *
+ * The comparision callback must return zero on success.
+ *
+ * @param[in]    r          the ring to search.
+ * @param[in]    data       the data to compare with.
+ * @param[in]    srch       the comparision callback.
+ * @return       void *     the found data, NULL if not found.
+ *
+ * @see      ring_t
+ */
+void *ring_search (ring_t *r, void *data, CAF_CAF_DEQUENODE_CBSRCH(srch));
+
+/**
+ *
+ * @brief    Dumps the ring elements.
+ *
+ * @param[in]    out        FILE output stream.
+ * @param[in]    r          the ring to dump.
+ * @param[in]    dmp        element dumper callback.
+ *
+ * @see      ring_t
+ */
+void ring_dump (FILE *out, ring_t *r, CAF_CAF_DEQUENODE_CBDUMP(dmp));
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_DATA_RING_H */
+/* caf_data_ring.h ends here */
+
@@ -0,0 +1,326 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more denexts.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_DATA_UDEQUE_H
+#define CAF_DATA_UDEQUE_H 1
+
+#include <stdio.h>
+#include <caf/caf_data_deque.h>
+
+/**
+ * @defgroup      caf_udeque    Unrolled Double Ended Queue
+ * @ingroup       caf_data_struct
+ * @addtogroup    caf_udeque
+ * @{
+ *
+ * @brief     Caffeine Unrolled Double Ended Queue Functions.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Unrolled double ended queue. Stores many data pointers per cache
+ * line aligned block, so pushing and popping only allocate once every
+ * CAF_UDEQUE_SLOTS elements and walking the queue touches contiguous
+ * memory. The API follows the deque_t one and uses the same callbacks.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Computes the unrolled deque structure size */
+#define CAF_UDEQUE_SZ                  (sizeof(udeque_t))
+/** Block size in bytes, a multiple of the cache line size */
+#define CAF_UDEQUE_BLOCK_SZ            512
+/** Block alignment, the cache line size */
+#define CAF_UDEQUE_ALIGN               64
+/** Data pointers stored in every block */
+#define CAF_UDEQUE_SLOTS               ((CAF_UDEQUE_BLOCK_SZ \
+                                         - 2 * sizeof (void *) \
+                                         - 2 * sizeof (int)) \
+                                        / sizeof (void *))
+
+/**
+ *
+ * @brief    Caffeine unrolled deque block type.
+ * @see      caf_udeque_block_s
+ */
+typedef struct caf_udeque_block_s caf_udequeb_t;
+
+/**
+ *
+ * @brief    Caffeine unrolled deque block structure.
+ * A block stores the data pointers in the slots from start to
+ * start + count - 1. Only the head and tail blocks can be partially
+ * filled.
+ * @see      caf_udequeb_t
+ */
+struct caf_udeque_block_s {
+	/** Pointer to the previous block */
+	caf_udequeb_t *prev;
+	/** Pointer to the next block */
+	caf_udequeb_t *next;
+	/** First used slot */
+	int start;
+	/** Used slots */
+	int count;
+	/** Data pointers */
+	void *slots[CAF_UDEQUE_SLOTS];
+};
+
+/**
+ *
+ * @brief    Caffeine unrolled deque type.
+ * @see      caf_udeque_s
+ */
+typedef struct caf_udeque_s udeque_t;
+
+/**
+ *
+ * @brief    Caffeine unrolled deque structure.
+ *
+ * Stores the first and last blocks, a spare block kept to avoid
+ * allocating and releasing a block when the queue size oscillates
+ * around a block boundary, and the element count.
+ *
+ * @see      caf_udequeb_t
+ */
+struct caf_udeque_s {
+	caf_udequeb_t *head;
+	caf_udequeb_t *tail;
+	caf_udequeb_t *spare;
+	int size;
+};
+
+/**
+ *
+ * @brief    Creates a new empty unrolled deque.
+ *
+ * @return       udeque_t *     the allocated queue.
+ *
+ * @see      udeque_t
+ */
+udeque_t *udeque_create (void);
+
+/**
+ *
+ * @brief    Creates a new unrolled deque.
+ *
+ * Creates a new unrolled deque storing <b>data</b> as first element.
+ *
+ * @param[in]    data            first element data.
+ * @return       udeque_t *     the allocated queue.
+ *
+ * @see      udeque_t
+ */
+udeque_t *udeque_new (void *data);
+
+/**
+ *
+ * @brief    Deletes an unrolled deque.
+ *
+ * Frees the queue, calling <b>del</b> on every element. The callback
+ * must return zero on success; on failure the operation stops and the
+ * remaining elements stay in the queue.
+ *
+ * @param[in]    lst    the queue.
+ * @param[in]    del    the callback function to free the elements.
+ * @return       int    CAF_OK on success, the deleted count on failure.
+ *
+ * @see      udeque_t
+ */
+int udeque_delete (udeque_t *lst, CAF_CAF_DEQUENODE_CBDEL(del));
+
+/**
+ *
+ * @brief    Deletes an unrolled deque.
+ *
+ * Frees the queue without touching the elements.
+ *
+ * @param[in]    lst    the queue.
+ * @return       int    CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      udeque_t
+ */
+int udeque_delete_nocb (udeque_t *lst);
+
+/**
+ *
+ * @brief    Verifies if the queue is empty or not
+ *
+ * @param[in]    lst    The queue to check
+ * @return       CAF_OK if is empty, CAF_ERROR if not.
+ *
+ * @see    udeque_t
+ */
+int udeque_empty_list (udeque_t *lst);
+
+/**
+ *
+ * @brief    Returns the length of the given queue.
+ *
+ * @param[in]    lst    The queue to get length
+ *
+ * @see    udeque_t
+ */
+int udeque_length (udeque_t *lst);
+
+/**
+ *
+ * @brief    Pushes an element at the end of the queue.
+ *
+ * @param[in]    lst            the queue.
+ * @param[in]    data           the data to store.
+ * @return       udeque_t *    the queue, NULL on failure.
+ *
+ * @see    udeque_pop
+ */
+udeque_t *udeque_push (udeque_t *lst, void *data);
+
+/**
+ *
+ * @brief    Pushes an element at the start of the queue.
+ *
+ * @param[in]    lst            the queue.
+ * @param[in]    data           the data to store.
+ * @return       udeque_t *    the queue, NULL on failure.
+ *
+ * @see    udeque_first
+ */
+udeque_t *udeque_push_front (udeque_t *lst, void *data);
+
+/**
+ *
+ * @brief    Pops (gets and removes) the last element in the queue.
+ *
+ * @param[in]    lst            the queue.
+ * @return       void *         the element data, NULL if empty.
+ *
+ * @see    udeque_push
+ */
+void *udeque_pop (udeque_t *lst);
+
+/**
+ *
+ * @brief    Gets and removes the first element in the queue.
+ *
+ * @param[in]    lst            the queue.
+ * @return       void *         the element data, NULL if empty.
+ *
+ * @see    udeque_push_front
+ */
+void *udeque_first (udeque_t *lst);
+
+/**
+ *
+ * @brief    Gets the data in the given position.
+ *
+ * Walks the blocks from the nearest end, so the cost is
+ * proportional to the position divided by CAF_UDEQUE_SLOTS.
+ *
+ * @param[in]    lst            the queue.
+ * @param[in]    pos            the position.
+ * @return       void *         the element data, NULL if out of range.
+ *
+ * @see    udeque_set
+ */
+void *udeque_get (udeque_t *lst, int pos);
+
+/**
+ *
+ * @brief    Sets the data in the given position.
+ *
+ * @param[in]    lst            the queue.
+ * @param[in]    pos            the position.
+ * @param[in]    data           the data to store.
+ * @return       int            the position, CAF_ERROR_SUB if out of range.
+ *
+ * @see    udeque_get
+ */
+int udeque_set (udeque_t *lst, int pos, void *data);
+
+/**
+ *
+ * @brief    Apply a function to the queue elements.
+ *
+ * @param[in]    lst        the queue to walk.
+ * @param[in]    step       the function to apply.
+ * @return       int        the number of afected elements.
+ *
+ * @see      udeque_t
+ */
+int udeque_map (udeque_t *lst, CAF_CAF_DEQUENODE_CBMAP(step));
+
+/**
+ *
+ * @brief    Apply a function to the queue elements.
+ *
+ * Like udeque_map, but stops on the first step that does not
+ * return CAF_OK.
+ *
+ * @param[in]    lst        the queue to walk.
+ * @param[in]    step       the function to apply.
+ * @return       int        the number of afected elements.
+ *
+ * @see      udeque_t
+ */
+int udeque_map_checked (udeque_t *lst, CAF_CAF_DEQUENODE_CBMAP(step));
+
+/**
+ *
+ * @brief    Searches for an element using a callback function.
+ *
+ * The comparision callback must return zero on success.
+ *
+ * @param[in]    lst        the queue to search.
+ * @param[in]    data       the data to compare with.
+ * @param[in]    srch       the comparision callback.
+ * @return       void *     the found data, NULL if not found.
+ *
+ * @see      udeque_t
+ */
+void *udeque_search (udeque_t *lst, void *data,
+                     CAF_CAF_DEQUENODE_CBSRCH(srch));
+
+/**
+ *
+ * @brief    Dumps the queue elements.
+ *
+ * @param[in]    out        FILE output stream.
+ * @param[in]    lst        the queue to dump.
+ * @param[in]    dmp        element dumper callback.
+ *
+ * @see      udeque_t
+ */
+void udeque_dump (FILE *out, udeque_t *lst, CAF_CAF_DEQUENODE_CBDUMP(dmp));
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_DATA_UDEQUE_H */
+/* caf_data_udeque.h ends here */
+
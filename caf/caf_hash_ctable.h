@@ -0,0 +1,279 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_HASH_CTABLE_H
+#define CAF_HASH_CTABLE_H 1
+/**
+ * @defgroup      caf_hash_ctable    Concurrent Hash Table Functions
+ * @ingroup       caf_data_struct
+ * @addtogroup    caf_hash_ctable
+ * @{
+ *
+ * @brief     Concurrent Hash Table Functions.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Concurrent Hash Table Functions. The table is split in shards, each
+ * one a <b>caf_hash_table_t</b> guarded by its own <b>pth_rwlock_t</b>,
+ * so threads working on different shards do not contend.
+ *
+ */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+#include <caf/caf_thread_rwlock.h>
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Concurrent hash table structure size @see caf_hash_ctable_t */
+#define CAF_HASH_CTABLE_SZ          (sizeof (caf_hash_ctable_t))
+/** Shard structure size @see caf_hash_cshard_t */
+#define CAF_HASH_CSHARD_SZ          (sizeof (caf_hash_cshard_t))
+/** Default shard count, used when zero shards are requested */
+#define CAF_HASH_CTABLE_SHARDS      16
+/** Maximum shard count */
+#define CAF_HASH_CTABLE_MAXSHARDS   4096
+/** Cache line size used to pad the shards */
+#define CAF_HASH_CTABLE_LINE        64
+/** Optimistic read attempts before a reader takes the shard lock */
+#define CAF_HASH_CTABLE_SPINS       8
+/** Flag: lookups run without the shard lock */
+#define CAF_HASH_CTABLE_LOCKFREE    0x01
+
+/**
+ * @brief Concurrent Hash Table Shard Type.
+ *
+ * Concurrent Hash Table Shard type.
+ *
+ * @see caf_hash_cshard_s
+ */
+typedef struct caf_hash_cshard_s caf_hash_cshard_t;
+
+/**
+ * @brief Concurrent Hash Table Shard.
+ *
+ * A hash table, its lock, the sequence counter used by the lock
+ * free readers and the reader counts that delay the release of the
+ * retired bucket arrays, padded to a cache line to avoid false
+ * sharing with the neighbour shards.
+ *
+ * @see caf_hash_cshard_t
+ */
+struct caf_hash_cshard_s {
+	/** Shard Lock */
+	pth_rwlock_t *lock;
+	/** Shard Table */
+	caf_hash_table_t *table;
+	/** Write Sequence, odd while a writer is active */
+	unsigned int seq;
+	/** Reader Epoch, selects the reader count new readers use */
+	unsigned int epoch;
+	/** Lock-free Readers inside each epoch */
+	unsigned int readers[2];
+	/** Padding to the cache line size */
+	char pad[CAF_HASH_CTABLE_LINE - 2 * sizeof (void *)
+	         - 4 * sizeof (unsigned int)];
+};
+
+/**
+ * @brief Concurrent Hash Table Type.
+ *
+ * Concurrent Hash Table type.
+ *
+ * @see caf_hash_ctable_s
+ */
+typedef struct caf_hash_ctable_s caf_hash_ctable_t;
+
+/**
+ * @brief Concurrent Hash Table Structure.
+ *
+ * Concurrent Hash Table Structure.
+ *
+ * @see caf_hash_ctable_t
+ */
+struct caf_hash_ctable_s {
+	/** Hash Table Identifier */
+	int id;
+	/** Table Flags */
+	int flags;
+	/** First Hash Callback Function */
+	CAF_HASH_STR_FUNCTION(f1);
+	/** Second Hash Callback Function */
+	CAF_HASH_STR_FUNCTION(f2);
+	/** Shard Count, always a power of two */
+	size_t count;
+	/** Bits of hash1 used to select the shard */
+	int bits;
+	/** Shard Array */
+	caf_hash_cshard_t *shards;
+};
+
+/**
+ * @brief Creates a new empty concurrent hash table.
+ *
+ * Creates a new concurrent hash table with <b>shards</b> shards,
+ * rounded up to a power of two, or <b>CAF_HASH_CTABLE_SHARDS</b>
+ * when zero. Keys are routed to the shards using the high bits of
+ * <b>hash1</b>, while each shard table uses the low bits, so both
+ * levels spread the keys independently.
+ *
+ * With the <b>CAF_HASH_CTABLE_LOCKFREE</b> flag, lookups do not take
+ * the shard lock: writers bump the shard sequence counter around
+ * every change and the readers retry when it moved, falling back
+ * to the lock after <b>CAF_HASH_CTABLE_SPINS</b> attempts. In this
+ * mode the bucket arrays replaced by a rehash are kept until
+ * <b>caf_hash_ctable_reclaim</b> or <b>caf_hash_ctable_delete</b>.
+ * Keys must not be released while they can be compared by a reader.
+ *
+ * @param id[in]						Hash Table Identifier
+ * @param shards[in]					Shard Count
+ * @param flags[in]						Table Flags
+ * @param CAF_HASH_STR_FUNCTION[in]		Hash Callback 1
+ * @param CAF_HASH_STR_FUNCTION[in]		Hash Callback 2
+ *
+ * @return caf_hash_ctable_t			a new allocated table
+ *
+ * @see caf_hash_ctable_t
+ * @see caf_hash_table_t
+ */
+caf_hash_ctable_t *caf_hash_ctable_new (const int id, const size_t shards,
+                                        const int flags,
+                                        CAF_HASH_STR_FUNCTION(f1),
+                                        CAF_HASH_STR_FUNCTION(f2));
+
+/**
+ * @brief Deallocates a Concurrent Hash Table
+ *
+ * Deallocates the given table <b>table</b>, its shards and locks.
+ * No thread may be using the table. The key and data pointers are
+ * not deallocated.
+ *
+ * @param table[in]		table to deallocate
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_ctable_delete (caf_hash_ctable_t *table);
+
+/**
+ * @brief Adds a key to the given table
+ *
+ * Adds or replaces the <b>key</b> of size <b>ksz</b> pointing to
+ * <b>data</b>, locking only the shard of the key.
+ *
+ * @param table[in]		table to add the key
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ * @param data[in]		data pointer
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_ctable_add (caf_hash_ctable_t *table, const void *key,
+                         const size_t ksz, const void *data);
+
+/**
+ * @brief Removes a key from the given table
+ *
+ * Removes the <b>key</b> of size <b>ksz</b>, locking only the shard
+ * of the key.
+ *
+ * @param table[in]		table from where to remove the key
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_ctable_remove (caf_hash_ctable_t *table, const void *key,
+                            const size_t ksz);
+
+/**
+ * @brief Obtains the data from the given table
+ *
+ * Obtains the data pointer of the <b>key</b> of size <b>ksz</b>.
+ * Takes the shard read lock, unless the table was created with the
+ * <b>CAF_HASH_CTABLE_LOCKFREE</b> flag.
+ *
+ * @param table[in]		table where to search the key
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ *
+ * @return void *		data pointer on success, NULL on failure
+ */
+void *caf_hash_ctable_get (caf_hash_ctable_t *table, const void *key,
+                           const size_t ksz);
+
+/**
+ * @brief Replaces the data pointer for the given key
+ *
+ * Replaces the data of an existing <b>key</b> of size <b>ksz</b>.
+ * If the key isn't found, the interface fails.
+ *
+ * @param table[in]		table
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ * @param data[in]		data to replace for
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_ctable_set (caf_hash_ctable_t *table, const void *key,
+                         const size_t ksz, void *data);
+
+/**
+ * @brief Counts the entries of the given table
+ *
+ * Sums the live entries of every shard. Each shard is read under its
+ * lock, but the total is not an atomic snapshot of the table.
+ *
+ * @param table[in]		table
+ *
+ * @return size_t		entry count
+ */
+size_t caf_hash_ctable_count (caf_hash_ctable_t *table);
+
+/**
+ * @brief Releases the retained bucket arrays
+ *
+ * Deallocates the bucket arrays retained for the lock-free readers.
+ * Each shard waits, holding its write lock, until the lock-free
+ * readers that could still see a retired array have left, so it may
+ * run next to readers. Writers of the shard wait meanwhile.
+ *
+ * @param table[in]		table
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_ctable_reclaim (caf_hash_ctable_t *table);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_HASH_CTABLE_H */
+/* caf_hash_ctable.h ends here */
+
@@ -0,0 +1,281 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_HASH_MTABLE_H
+#define CAF_HASH_MTABLE_H 1
+/**
+ * @defgroup      caf_hash_mtable    Mapped Hash Table Functions
+ * @ingroup       caf_data_struct
+ * @addtogroup    caf_hash_mtable
+ * @{
+ *
+ * @brief     Mapped Hash Table Functions.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Mapped Hash Table Functions. A <b>caf_hash_table_t</b> is written
+ * to a file that can be mapped with <b>mmap(2)</b> and queried in
+ * place, read-only, without rebuilding the table.
+ *
+ * The file has three sections: a fixed header, a power of two sized
+ * array of <b>caf_hash_mslot_t</b> slots and a heap holding the keys
+ * and data, each one aligned to <b>CAF_HASH_MTABLE_ALIGN</b> bytes.
+ * Offsets are relative to the start of the file and the integers
+ * use the byte order of the machine that wrote it.
+ *
+ */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Mapped hash table structure size @see caf_hash_mtable_t */
+#define CAF_HASH_MTABLE_SZ          (sizeof (caf_hash_mtable_t))
+/** Mapped hash table header size @see caf_hash_mheader_t */
+#define CAF_HASH_MHEADER_SZ         (sizeof (caf_hash_mheader_t))
+/** Mapped hash table slot size @see caf_hash_mslot_t */
+#define CAF_HASH_MSLOT_SZ           (sizeof (caf_hash_mslot_t))
+/** File magic */
+#define CAF_HASH_MTABLE_MAGIC       "CAFHMTB"
+/** File format version */
+#define CAF_HASH_MTABLE_VERSION     1
+/** Heap alignment of keys and data */
+#define CAF_HASH_MTABLE_ALIGN       8
+/** String hashed into the header to check the hash callbacks */
+#define CAF_HASH_MTABLE_CHECK       "caffeine mapped hash table"
+/** Declares a data size callback used by the writer */
+#define CAF_HASH_MTABLE_CBDSZ(dsz)  size_t (*dsz)(const void *data)
+
+/**
+ * @brief Mapped Hash Table File Header Type.
+ *
+ * Mapped Hash Table File Header type.
+ *
+ * @see caf_hash_mheader_s
+ */
+typedef struct caf_hash_mheader_s caf_hash_mheader_t;
+
+/**
+ * @brief Mapped Hash Table File Header.
+ *
+ * The header at the start of the file.
+ *
+ * @see caf_hash_mheader_t
+ */
+struct caf_hash_mheader_s {
+	/** File Magic, CAF_HASH_MTABLE_MAGIC */
+	char magic[8];
+	/** File Format Version */
+	u_int32_t version;
+	/** Header Size */
+	u_int32_t header_sz;
+	/** First Hash of CAF_HASH_MTABLE_CHECK */
+	u_int32_t check1;
+	/** Second Hash of CAF_HASH_MTABLE_CHECK */
+	u_int32_t check2;
+	/** Entry Count */
+	u_int64_t count;
+	/** Slot Count, always a power of two */
+	u_int64_t size;
+	/** Slot Array Offset */
+	u_int64_t slots_off;
+	/** Heap Offset */
+	u_int64_t heap_off;
+	/** File Size */
+	u_int64_t file_sz;
+};
+
+/**
+ * @brief Mapped Hash Table Slot Type.
+ *
+ * Mapped Hash Table Slot type.
+ *
+ * @see caf_hash_mslot_s
+ */
+typedef struct caf_hash_mslot_s caf_hash_mslot_t;
+
+/**
+ * @brief Mapped Hash Table Slot.
+ *
+ * A slot of the file slot array. Empty slots have a zero key offset.
+ *
+ * @see caf_hash_mslot_t
+ */
+struct caf_hash_mslot_s {
+	/** First Hash */
+	u_int32_t hash1;
+	/** Second Hash */
+	u_int32_t hash2;
+	/** Key Size */
+	u_int32_t key_sz;
+	/** Data Size */
+	u_int32_t data_sz;
+	/** Key Offset */
+	u_int64_t key_off;
+	/** Data Offset */
+	u_int64_t data_off;
+};
+
+/**
+ * @brief Mapped Hash Table Type.
+ *
+ * Mapped Hash Table type.
+ *
+ * @see caf_hash_mtable_s
+ */
+typedef struct caf_hash_mtable_s caf_hash_mtable_t;
+
+/**
+ * @brief Mapped Hash Table Structure.
+ *
+ * An opened, read-only, mapped hash table.
+ *
+ * @see caf_hash_mtable_t
+ */
+struct caf_hash_mtable_s {
+	/** Hash Table Identifier */
+	int id;
+	/** First Hash Callback Function */
+	CAF_HASH_STR_FUNCTION(f1);
+	/** Second Hash Callback Function */
+	CAF_HASH_STR_FUNCTION(f2);
+	/** Mapped File */
+	void *base;
+	/** Mapped File Size */
+	size_t base_sz;
+	/** File Header */
+	const caf_hash_mheader_t *header;
+	/** Slot Array */
+	const caf_hash_mslot_t *slots;
+};
+
+/**
+ * @brief Writes a hash table to a mappable file.
+ *
+ * Writes the entries of <b>table</b> to the file <b>path</b>. The key
+ * bytes are copied using the stored key size, while the data size is
+ * given by the <b>dsz</b> callback, or treated as a NUL terminated
+ * string when <b>dsz</b> is NULL. The file is written to a temporary
+ * name and renamed over <b>path</b>, so processes opening the table
+ * never see a partial file.
+ *
+ * @param table[in]		table to write
+ * @param path[in]		file path
+ * @param dsz[in]		data size callback, can be NULL
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_mtable_write (caf_hash_table_t *table, const char *path,
+                           CAF_HASH_MTABLE_CBDSZ(dsz));
+
+/**
+ * @brief Opens a mapped hash table.
+ *
+ * Maps the file <b>path</b> read-only and checks its header. The
+ * <b>f1</b> and <b>f2</b> callbacks must be the ones of the table
+ * that wrote the file, which is verified against the check hashes
+ * stored in the header. Opening does not read the slots, so the cost
+ * does not depend on the table size; pages are loaded on demand by
+ * the lookups. The mapping is shared, so opening the table before
+ * <b>ppm_pool_create</b> or <b>fork(2)</b> shares its pages between
+ * every worker process.
+ *
+ * @param id[in]						Hash Table Identifier
+ * @param path[in]						file path
+ * @param CAF_HASH_STR_FUNCTION[in]		Hash Callback 1
+ * @param CAF_HASH_STR_FUNCTION[in]		Hash Callback 2
+ *
+ * @return caf_hash_mtable_t			the opened table, NULL on failure
+ */
+caf_hash_mtable_t *caf_hash_mtable_open (const int id, const char *path,
+                                         CAF_HASH_STR_FUNCTION(f1),
+                                         CAF_HASH_STR_FUNCTION(f2));
+
+/**
+ * @brief Closes a mapped hash table.
+ *
+ * Unmaps the file and deallocates the table. Pointers returned by
+ * the lookups are not valid after this call.
+ *
+ * @param table[in]		table to close
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_mtable_close (caf_hash_mtable_t *table);
+
+/**
+ * @brief Obtains the data from a mapped hash table.
+ *
+ * Works like <b>caf_hash_table_get</b>. The returned pointer points
+ * into the read-only mapping.
+ *
+ * @param table[in]		table where to search the key
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ *
+ * @return void *		data pointer on success, NULL on failure
+ */
+const void *caf_hash_mtable_get (caf_hash_mtable_t *table, const void *key,
+                                 const size_t ksz);
+
+/**
+ * @brief Searches a key in a mapped hash table.
+ *
+ * Searches the <b>key</b> of size <b>ksz</b>, returning the mapped
+ * data pointer in <b>data</b> and its size in <b>dsz</b>.
+ *
+ * @param table[in]		table where to search the key
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ * @param data[out]		data pointer
+ * @param dsz[out]		data size, can be NULL
+ *
+ * @return int			CAF_OK when found, CAF_ERROR otherwise
+ */
+int caf_hash_mtable_find (caf_hash_mtable_t *table, const void *key,
+                          const size_t ksz, const void **data, size_t *dsz);
+
+/**
+ * @brief Counts the entries of a mapped hash table.
+ *
+ * @param table[in]		table
+ *
+ * @return size_t		entry count
+ */
+size_t caf_hash_mtable_count (caf_hash_mtable_t *table);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_HASH_MTABLE_H */
+/* caf_hash_mtable.h ends here */
+
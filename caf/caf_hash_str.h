@@ -48,6 +48,10 @@ CAF_BEGIN_C_EXTERNS
 /** Common string hashing function (interface) define */
 #define CAF_HASH_STR_FUNCTION(f)    \
     u_int32_t (*f) (const char *str, const u_int32_t len)
+/** Keyed string hashing function (interface) define */
+#define CAF_HASH_KEYED_FUNCTION(f)  \
+    u_int64_t (*f) (const char *str, const u_int32_t len, \
+                    const u_int64_t k0, const u_int64_t k1)
 
 /**
  * Computes the RS Hash for the given string (str) with
@@ -159,6 +163,97 @@ u_int32_t caf_shash_bp (const char *str, const u_int32_t len);
  */
 u_int32_t caf_shash_fnv (const char *str, const u_int32_t len);
 
+/** Block hash implementation: best supported by the running CPU */
+#define CAF_SHASH64_AUTO            0
+/** Block hash implementation: portable C */
+#define CAF_SHASH64_SCALAR          1
+/** Block hash implementation: SSE2 */
+#define CAF_SHASH64_SSE2            2
+/** Block hash implementation: AVX2 */
+#define CAF_SHASH64_AVX2            3
+/** Seed used by caf_shash_blk */
+#define CAF_SHASH_BLK_SEED1         0x0ULL
+/** Seed used by caf_shash_blk2, independent from the first one */
+#define CAF_SHASH_BLK_SEED2         0x9E3779B97F4A7C15ULL
+
+/**
+ * Computes the seeded 64 bit block hash for the given string (str)
+ * with the given length (len). Keys are consumed 8 bytes at time,
+ * and keys over 256 bytes in 64 byte stripes using SIMD code when
+ * the CPU supports it. Every implementation returns the same value.
+ *
+ * @param str			input string
+ * @param len			string length
+ * @param seed			hash seed
+ *
+ * @return Computed hash.
+ */
+u_int64_t caf_shash64 (const char *str, const u_int32_t len,
+                       const u_int64_t seed);
+
+/**
+ * Computes the 64 bit block hash for the given string (str) with
+ * the given length (len) using CAF_SHASH_BLK_SEED1, folded to 32
+ * bits. Usable as CAF_HASH_STR_FUNCTION.
+ *
+ * @param str			input string
+ * @param len			string length
+ *
+ * @return Computed hash.
+ */
+u_int32_t caf_shash_blk (const char *str, const u_int32_t len);
+
+/**
+ * Computes the 64 bit block hash for the given string (str) with
+ * the given length (len) using CAF_SHASH_BLK_SEED2, folded to 32
+ * bits. Intended as the second hash when caf_shash_blk is the first.
+ *
+ * @param str			input string
+ * @param len			string length
+ *
+ * @return Computed hash.
+ */
+u_int32_t caf_shash_blk2 (const char *str, const u_int32_t len);
+
+/**
+ * Selects the implementation used by caf_shash64 for long keys,
+ * one of the CAF_SHASH64_* values. CAF_SHASH64_AUTO picks the best
+ * one supported by the running CPU, which is also the default.
+ *
+ * @param impl			implementation to use
+ *
+ * @return the selected implementation, or -1 if unsupported.
+ */
+int caf_shash64_impl (const int impl);
+
+/**
+ * Computes the SipHash-2-4 keyed hash for the given string (str)
+ * with the given length (len) and the 128 bit key (k0, k1). Without
+ * the key, colliding inputs cannot be computed in advance, so it is
+ * safe for tables indexed by untrusted input. Usable as
+ * CAF_HASH_KEYED_FUNCTION.
+ *
+ * @param str			input string
+ * @param len			string length
+ * @param k0			first half of the key
+ * @param k1			second half of the key
+ *
+ * @return Computed hash.
+ */
+u_int64_t caf_shash_sip (const char *str, const u_int32_t len,
+                         const u_int64_t k0, const u_int64_t k1);
+
+/**
+ * Fills the 128 bit key (seed) with random data from the kernel,
+ * using getrandom(2) or /dev/urandom. If none is available, falls
+ * back to a weak seed derived from the time and the process id.
+ *
+ * @param seed			the two 64 bit words to fill
+ *
+ * @return 0 with a strong seed, -1 with the weak fallback.
+ */
+int caf_shash_seed (u_int64_t seed[2]);
+
 #ifdef __cplusplus
 CAF_END_C_EXTERNS
 #endif /* !__cplusplus */
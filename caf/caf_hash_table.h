@@ -39,8 +39,9 @@
  *
  */
 
+#include <stdio.h>
 #include <sys/types.h>
-#include <caf/caf_data_cdeque.h>
+#include <caf/caf_hash_str.h>
 
 #ifdef __cplusplus
 CAF_BEGIN_C_EXTERNS
@@ -50,6 +51,12 @@ CAF_BEGIN_C_EXTERNS
 #define CAF_HASH_SZ                 (sizeof (caf_hash_t))
 /** Hash table structure size @see caf_hash_table_t */
 #define CAF_HASH_TABLE_SZ           (sizeof (caf_hash_table_t))
+/** Initial bucket count of a new table, must be a power of two */
+#define CAF_HASH_TABLE_INITSZ       16
+/** Buckets migrated from the old array on every write operation */
+#define CAF_HASH_TABLE_REHASH_STEP  8
+/** Declares a walk callback to use with hash table entries */
+#define CAF_HASH_TABLE_CBMAP(map)   int (*map)(caf_hash_t *hash, void *arg)
 
 /**
  * @brief		Double Hash Structure Type.
@@ -103,8 +110,32 @@ struct caf_hash_table_s {
 	CAF_HASH_STR_FUNCTION(f1);
 	/** Second Hash Callback Function */
 	CAF_HASH_STR_FUNCTION(f2);
-	/** Hash List */
-	cdeque_t *hashes;
+	/** Keyed Hash Callback Function, replaces f1 and f2 when set */
+	CAF_HASH_KEYED_FUNCTION(kf);
+	/** Keyed Hash Key, random per table */
+	u_int64_t seed[2];
+	/** Live Entries in both Bucket Arrays */
+	size_t count;
+	/** Used Buckets (live and deleted) in the Current Array */
+	size_t used;
+	/** Current Array Size, always a power of two */
+	size_t size;
+	/** Current Bucket Array */
+	caf_hash_t *buckets;
+	/** Bucket Array being migrated by the incremental rehash */
+	caf_hash_t *old;
+	/** Old Array Size */
+	size_t old_size;
+	/** Live Entries left in the Old Array */
+	size_t old_count;
+	/** Next Old Array Bucket to migrate */
+	size_t old_idx;
+	/** Keep replaced Bucket Arrays until reclaimed */
+	int retain;
+	/** Replaced Bucket Arrays waiting to be reclaimed */
+	caf_hash_t **retired;
+	/** Replaced Bucket Arrays Count */
+	size_t retired_count;
 };
 
 /**
@@ -128,6 +159,28 @@ caf_hash_t *caf_hash_new (const void *key, const size_t ksz, const void *data,
                           CAF_HASH_STR_FUNCTION(f1),
                           CAF_HASH_STR_FUNCTION(f2));
 
+/**
+ * @brief Computes a hash node in place.
+ *
+ * Fills the caller provided <b>caf_hash_t</b> structure <b>hash</b>,
+ * calculating the double hashing using the callback functions
+ * <b>f1</b> and <b>f2</b>, without allocating memory. This allows to
+ * build probe keys on the stack. When <b>f2</b> is NULL, the second
+ * hash takes the value of the first one.
+ *
+ * @param hash[out]						hash node to fill
+ * @param key[in]						key pointer
+ * @param ksz[in]						key size
+ * @param data[in]						data pointer, can be NULL
+ * @param CAF_HASH_STR_FUNCTION[in]		hash callback 1
+ * @param CAF_HASH_STR_FUNCTION[in]		hash callback 2
+ *
+ * @return int							CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_init (caf_hash_t *hash, const void *key, const size_t ksz,
+                   const void *data, CAF_HASH_STR_FUNCTION(f1),
+                   CAF_HASH_STR_FUNCTION(f2));
+
 /**
  * @brief Creates an empy hash node.
  *
@@ -163,11 +216,16 @@ int caf_hash_delete (caf_hash_t *hash);
 /**
  * @brief Creates a new empty hash table.
  *
- * Creates a new empty hash table. The hash table implementation
- * it's <b>caf_cdeque_t</b> based. This means that search algorithms
- * are linear, and using the <b>Circular Linked List</b> sequence.
- * Future implementations will include fater search methods and
- * faster data type structures.
+ * Creates a new empty hash table. The hash table uses open
+ * addressing over a power of two sized array of <b>caf_hash_t</b>
+ * buckets, probing with the double hash: <b>hash1</b> selects the
+ * first bucket and <b>hash2</b> the probe stride. Both hashes are
+ * stored in the bucket and compared before the key, rejecting most
+ * mismatches without touching the key memory. When the table fills
+ * over three quarters, a new array of double size is allocated and
+ * the old buckets are migrated <b>CAF_HASH_TABLE_REHASH_STEP</b> at
+ * time by the following write operations, so no single operation
+ * pays for the whole rehash. The <b>f2</b> callback is optional.
  *
  * @param id[in]						Hash Table Identifier
  * @param CAF_HASH_STR_FUNCTION[in]		Hash Callback 1
@@ -175,7 +233,6 @@ int caf_hash_delete (caf_hash_t *hash);
  *
  * @return caf_hash_table_t				a new allocated table
  *
- * @see cdeque_t
  * @see caf_hash_table_t
  * @see caf_hash_t
  */
@@ -183,11 +240,52 @@ caf_hash_table_t *caf_hash_table_new (const int id,
                                       CAF_HASH_STR_FUNCTION(f1),
                                       CAF_HASH_STR_FUNCTION(f2));
 
+/**
+ * @brief Creates a new empty keyed hash table.
+ *
+ * Creates a new empty hash table like <b>caf_hash_table_new</b>, but
+ * both hashes are taken from the 64 bit keyed hash <b>kf</b>, keyed
+ * with a random seed chosen for this table. An attacker who does not
+ * know the seed cannot build colliding keys, so the table keeps its
+ * constant time lookups on untrusted input. When <b>kf</b> is NULL,
+ * <b>caf_shash_sip</b> is used. The hashes depend on the seed, so
+ * keyed tables cannot be written with <b>caf_hash_mtable_write</b>.
+ *
+ * @param id[in]						Hash Table Identifier
+ * @param CAF_HASH_KEYED_FUNCTION[in]	Keyed Hash Callback
+ *
+ * @return caf_hash_table_t				a new allocated table
+ *
+ * @see caf_hash_table_new
+ * @see caf_shash_sip
+ */
+caf_hash_table_t *caf_hash_table_new_keyed (const int id,
+                                            CAF_HASH_KEYED_FUNCTION(kf));
+
+/**
+ * @brief Computes a hash node for the given table
+ *
+ * Fills <b>hash</b> like <b>caf_hash_init</b>, using the hash
+ * callbacks, or the keyed hash and seed, of the table <b>table</b>.
+ *
+ * @param table[in]		hash table
+ * @param hash[out]		hash node to fill
+ * @param key[in]		key pointer
+ * @param ksz[in]		key size
+ * @param data[in]		data pointer, can be NULL
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_table_hash (caf_hash_table_t *table, caf_hash_t *hash,
+                         const void *key, const size_t ksz,
+                         const void *data);
+
 /**
  * @brief Deallocates a Hash Table
  *
  * Deallocates the pointer of the given Hash Table <b>table</b>,
- * restoring the allocated memory through <b>free(2)</b>.
+ * restoring the allocated memory through <b>free(2)</b>. The key
+ * and data pointers stored in the table are not deallocated.
  *
  * @param table[in]		table to deallocate
  *
@@ -214,13 +312,29 @@ int caf_hash_table_delete (caf_hash_table_t *table);
 int caf_hash_table_add (caf_hash_table_t *table, const void *key,
                         const size_t ksz, const void *data);
 
+/**
+ * @brief Adds a precomputed hash to the given table
+ *
+ * Works like <b>caf_hash_table_add</b>, but takes a hash node
+ * <b>hash</b> already computed with <b>caf_hash_table_hash</b>
+ * for the same table, so callers that need the hash values
+ * before touching the table do not compute them twice. The node is
+ * copied into the table.
+ *
+ * @param table[in]		table to add the hash
+ * @param hash[in]		precomputed hash node
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_table_add_hash (caf_hash_table_t *table, const caf_hash_t *hash);
+
 /**
  * @brief Removes an element from the given Hash Table
  *
  * Removes the element identified by the hash key <b>key</b> of size
- * <b>ksz</b> from the given hash table <b>table</b>. This deallocates
- * the <b>caf_hash_t</b> pointer and removes the list node, but does
- * not deallocates the data and key pointers.
+ * <b>ksz</b> from the given hash table <b>table</b>. This marks the
+ * bucket as deleted, but does not deallocates the data and key
+ * pointers.
  *
  * @param table[in]		table from where to remove the item
  * @param key[in]		item key <b>data</b> string
@@ -231,6 +345,20 @@ int caf_hash_table_add (caf_hash_table_t *table, const void *key,
 int caf_hash_table_remove (caf_hash_table_t *table, const void *key,
                            const size_t ksz);
 
+/**
+ * @brief Removes a precomputed hash from the given Hash Table
+ *
+ * Works like <b>caf_hash_table_remove</b>, using the precomputed
+ * hash node <b>hash</b>.
+ *
+ * @param table[in]		table from where to remove the item
+ * @param hash[in]		precomputed hash node
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_table_remove_hash (caf_hash_table_t *table,
+                                const caf_hash_t *hash);
+
 /**
  * @brief Obtains a the data from the given hash table
  *
@@ -249,6 +377,42 @@ int caf_hash_table_remove (caf_hash_table_t *table, const void *key,
 void *caf_hash_table_get (caf_hash_table_t *table, const void *key,
                           const size_t ksz);
 
+/**
+ * @brief Obtains the data for a precomputed hash
+ *
+ * Works like <b>caf_hash_table_get</b>, using the precomputed
+ * hash node <b>hash</b>.
+ *
+ * @param table[in]		hash table where to search the node
+ * @param hash[in]		precomputed hash node
+ *
+ * @return void *		data pointer on success, NULL on failure
+ */
+void *caf_hash_table_get_hash (caf_hash_table_t *table,
+                               const caf_hash_t *hash);
+
+/**
+ * @brief Looks up a precomputed hash without locking
+ *
+ * Searches the precomputed hash node <b>hash</b> while other thread
+ * may be modifying the table. The lookup never reads past the bucket
+ * arrays, and writers publish a bucket key after its other fields,
+ * so a matched entry is never half written. The result can still be
+ * stale, so the caller must validate it, usually with a sequence
+ * counter bumped by the writers.
+ * The table must retain its replaced bucket arrays, see
+ * <b>caf_hash_table_retain</b>, or a concurrent rehash may release
+ * the memory under the reader.
+ *
+ * @param table[in]		hash table where to search the node
+ * @param hash[in]		precomputed hash node
+ * @param data[out]		found data pointer
+ *
+ * @return int			CAF_OK when found, CAF_ERROR otherwise
+ */
+int caf_hash_table_peek (caf_hash_table_t *table, const caf_hash_t *hash,
+                         void **data);
+
 /**
  * @brief Replaces the data pointer for the given key
  *
@@ -266,6 +430,63 @@ void *caf_hash_table_get (caf_hash_table_t *table, const void *key,
 int caf_hash_table_set (caf_hash_table_t *table, const void *key,
                         const size_t ksz, void *data);
 
+/**
+ * @brief Replaces the data pointer for a precomputed hash
+ *
+ * Works like <b>caf_hash_table_set</b>, using the precomputed
+ * hash node <b>hash</b> and its data pointer.
+ *
+ * @param table[in]		hash table
+ * @param hash[in]		precomputed hash node
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_table_set_hash (caf_hash_table_t *table, const caf_hash_t *hash);
+
+/**
+ * @brief Keeps the replaced bucket arrays of the table
+ *
+ * When <b>retain</b> is non zero, the bucket arrays replaced by a
+ * rehash are kept until <b>caf_hash_table_reclaim</b> is called or
+ * the table is deleted, allowing lock-free readers through
+ * <b>caf_hash_table_peek</b>.
+ *
+ * @param table[in]		hash table
+ * @param retain[in]	non zero to retain replaced arrays
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_table_retain (caf_hash_table_t *table, const int retain);
+
+/**
+ * @brief Releases the retained bucket arrays of the table
+ *
+ * Deallocates the bucket arrays kept by <b>caf_hash_table_retain</b>.
+ * The caller must ensure that no reader is using the table.
+ *
+ * @param table[in]		hash table
+ *
+ * @return int			CAF_OK on success, CAF_ERROR on failure
+ */
+int caf_hash_table_reclaim (caf_hash_table_t *table);
+
+/**
+ * @brief Applies a function to the hash table entries
+ *
+ * Crosses the table and applies the callback <b>step</b> to every
+ * live entry, passing <b>arg</b> as the second argument. The walk
+ * stops on the first callback that does not return CAF_OK. The
+ * table must not be modified by the callback.
+ *
+ * @param table[in]		table to walk
+ * @param step[in]		the function to apply
+ * @param arg[in]		callback argument
+ *
+ * @return size_t		the number of processed entries
+ */
+size_t caf_hash_table_map (caf_hash_table_t *table,
+                           CAF_HASH_TABLE_CBMAP(step), void *arg);
+
 /**
  * @brief Dumps the hash table contents to the given output
  *
@@ -44,6 +44,7 @@
  */
 
 #include <caf/caf_data_buffer.h>
+#include <caf/caf_data_chain.h>
 
 #ifdef __cplusplus
 CAF_BEGIN_C_EXTERNS
@@ -71,6 +72,8 @@ int io_fchanged (caf_io_file_t *r, struct timespec *lmt,
 				 struct timespec *lct);
 ssize_t io_read (caf_io_file_t *r, cbuffer_t *b);
 ssize_t io_write (caf_io_file_t *r, cbuffer_t *b);
+ssize_t io_readv (caf_io_file_t *r, cbuf_chain_t *ch);
+ssize_t io_writev (caf_io_file_t *r, cbuf_chain_t *ch);
 int io_pipe (caf_io_file_t *r);
 int io_fcntl (caf_io_file_t *r, int cmd, int *arg);
 int io_flseek (caf_io_file_t *r, off_t o, int w);
@@ -85,6 +85,8 @@ int caf_conn_connect (caf_conn_t *c);
 int caf_conn_hardtcpc (caf_conn_t *c);
 ssize_t caf_conn_recv (caf_conn_t *c, cbuffer_t *b, int flg);
 ssize_t caf_conn_send (caf_conn_t *c, cbuffer_t *b, int flg);
+ssize_t caf_conn_recvv (caf_conn_t *c, cbuf_chain_t *ch, int flg);
+ssize_t caf_conn_sendv (caf_conn_t *c, cbuf_chain_t *ch, int flg);
 int caf_conn_bind (caf_conn_t *c);
 int caf_conn_listen (caf_conn_t *c, int bl);
 int caf_conn_accept (caf_conn_t *c);
@@ -42,7 +42,20 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-#ifdef CAF_USE_POSIX_SEMAPHORES
+#if defined(CAF_USE_FUTEX_SEMAPHORES)
+#include <caf/caf_sem_futex.h>
+
+#define CAF_SEM_NEW(k,f,v)          ((void)(k), caf_sem_futex_new (f,v))
+#define CAF_SEM_GET(k,f,v)          ((void)(k), caf_sem_futex_new (f,v))
+#define CAF_SEM_DELETE(s)           caf_sem_futex_delete (s)
+#define CAF_SEM_EXISTS(s)           caf_sem_futex_exists (s)
+#define CAF_SEM_LOCK(s)             caf_sem_futex_lock (s)
+#define CAF_SEM_TRYLOCK(s)          caf_sem_futex_trylock (s)
+#define CAF_SEM_UNLOCK(s)           caf_sem_futex_unlock (s)
+
+#define CAF_SEM_T                   caf_sem_futex_t
+
+#elif defined(CAF_USE_POSIX_SEMAPHORES)
 #include <caf/caf_sem_posix.h>
 
 #define CAF_SEM_NEW(k,f,v)          caf_sem_posix_new (k,f,v)
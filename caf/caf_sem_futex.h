@@ -0,0 +1,173 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_SEM_FUTEX_H
+#define CAF_SEM_FUTEX_H 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @defgroup      caf_sem_futex        Futex Semaphores
+ * @ingroup       caf_sem
+ * @addtogroup    caf_sem_futex
+ * @{
+ *
+ * @brief     Futex Semaphores.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Counting semaphores on a futex word. Uncontended post and wait are
+ * a single atomic operation, the kernel is entered only to sleep or
+ * to wake a sleeper. The structure holds no pointers, so it can be
+ * placed with caf_sem_futex_init inside a caf_shm_alloc_t segment
+ * and used by every process attaching it.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+#define CAF_SEM_FUTEX_SZ                (sizeof (caf_sem_futex_t))
+
+/** The semaphore is used by threads of a single process */
+#define CAF_SEM_FUTEX_PRIVATE           0
+/** The semaphore lives in shared memory and is used by many processes */
+#define CAF_SEM_FUTEX_SHARED            1
+
+/** Static initializer of a process private semaphore */
+#define CAF_SEM_FUTEX_INITIALIZER(v)    { (v), 0, CAF_SEM_FUTEX_PRIVATE }
+
+typedef struct caf_sem_futex_s caf_sem_futex_t;
+struct caf_sem_futex_s {
+	/** Available count, also the futex word */
+	int value;
+	/** Sleepers on the futex word */
+	int waiters;
+	/** CAF_SEM_FUTEX_PRIVATE or CAF_SEM_FUTEX_SHARED */
+	int flag;
+};
+
+/**
+ *
+ * @brief    Allocates a process private semaphore.
+ *
+ * @param[in]    flag            CAF_SEM_FUTEX_PRIVATE or CAF_SEM_FUTEX_SHARED.
+ * @param[in]    value           initial count.
+ * @return       caf_sem_futex_t *   the semaphore, NULL on failure.
+ *
+ * @see      caf_sem_futex_init
+ */
+caf_sem_futex_t *caf_sem_futex_new (const int flag, const int value);
+
+/**
+ *
+ * @brief    Initializes a semaphore in place.
+ *
+ * Used for semaphores embedded in other structures or in shared
+ * memory segments; those need no cleanup. A shared semaphore must be
+ * initialized once, before the processes using it are forked or
+ * attach the segment.
+ *
+ * @param[out]   r               the semaphore.
+ * @param[in]    flag            CAF_SEM_FUTEX_PRIVATE or CAF_SEM_FUTEX_SHARED.
+ * @param[in]    value           initial count.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int caf_sem_futex_init (caf_sem_futex_t *r, const int flag, const int value);
+
+/**
+ *
+ * @brief    Releases a semaphore allocated by caf_sem_futex_new.
+ *
+ * @param[in]    r               the semaphore.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int caf_sem_futex_delete (caf_sem_futex_t *r);
+
+int caf_sem_futex_lock (caf_sem_futex_t *r);
+int caf_sem_futex_trylock (caf_sem_futex_t *r);
+int caf_sem_futex_unlock (caf_sem_futex_t *r);
+
+int caf_sem_futex_exists (caf_sem_futex_t *r);
+
+/**
+ *
+ * @brief    Increments the semaphore.
+ *
+ * Wakes one sleeper, if any.
+ *
+ * @param[in]    r               the semaphore.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int caf_sem_futex_post (caf_sem_futex_t *r);
+
+/**
+ *
+ * @brief    Current count of the semaphore.
+ *
+ * @param[in]    r               the semaphore.
+ * @return       int             the count, zero for a NULL semaphore.
+ */
+int caf_sem_futex_getvalue (caf_sem_futex_t *r);
+
+/**
+ *
+ * @brief    Decrements the semaphore, sleeping while it is zero.
+ *
+ * @param[in]    r               the semaphore.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int caf_sem_futex_wait (caf_sem_futex_t *r);
+
+/**
+ *
+ * @brief    Decrements the semaphore if it is not zero.
+ *
+ * @param[in]    r               the semaphore.
+ * @return       int             CAF_OK on success, CAF_ERROR if zero.
+ */
+int caf_sem_futex_trywait (caf_sem_futex_t *r);
+
+/**
+ *
+ * @brief    Decrements the semaphore, sleeping up to a deadline.
+ *
+ * @param[in]    r               the semaphore.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK on success, CAF_ERROR_SUB on
+ *                               timeout, CAF_ERROR on failure.
+ */
+int caf_sem_futex_timedwait (caf_sem_futex_t *r, const struct timespec *to);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_SEM_FUTEX_H */
+/* caf_sem_futex.h ends here */
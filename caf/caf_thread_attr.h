@@ -27,6 +27,7 @@
 
 #include <pthread.h>
 #include <caf/caf_data_deque.h>
+#include <caf/caf_thread_cpu.h>
 
 /**
  * @defgroup      caf_thread_attr    Thread Attributes
@@ -76,7 +77,11 @@ typedef enum {
 	/** pthread_attr_(set|get)schedpolicy */
 	PTH_ATTR_SCHEDPOLICY = 0000100,
 	/** pthread_attr_(set|get)scope */
-	PTH_ATTR_SCOPE = 0000200
+	PTH_ATTR_SCOPE = 0000200,
+	/** pth_cpuset_t *, pins pool worker i to pth_cpuset_cpu(set, i) */
+	PTH_ATTR_AFFINITY = 0000400,
+	/** const char *, names pool worker i as "name/i" */
+	PTH_ATTR_NAME = 0001000
 } pth_attr_types_t;
 
 /**
@@ -98,6 +103,10 @@ struct pth_attri_s {
 	int at;
 	/** Thread Attributes */
 	pthread_attr_t attr;
+	/** Worker CPU placement, not owned */
+	pth_cpuset_t *cpus;
+	/** Worker name prefix */
+	char name[CAF_PTH_NAME_LEN];
 };
 
 /**
@@ -199,6 +208,8 @@ int pth_attri_destroy (pth_attri_t *attri);
  * @brief    Sets pth_attri_t instance properties.
  *
  * Sets the properties of the given pth_attri_t pointer (instance).
+ * PTH_ATTR_AFFINITY and PTH_ATTR_NAME are applied per thread by the
+ * pool functions, a NULL data clears them.
  *
  * @param[in]    attri           pth_attri_t pointer.
  * @param[in]    t               property type.
@@ -222,6 +233,23 @@ int pth_attri_set (pth_attri_t *attri, pth_attr_types_t t, void *data);
  */
 int pth_attri_get (pth_attri_t *attri, pth_attr_types_t t, void *data);
 
+/**
+ *
+ * @brief    Copies pth_attri_t instance properties.
+ *
+ * Initializes the thread attributes of <b>dst</b> and copies into it
+ * every setting of <b>src</b>, including the CPU placement and the
+ * worker name, so the copy can be changed without touching the
+ * original. The copy must be released with pth_attr_destroy.
+ *
+ * @param[out]   dst             pth_attri_t pointer to fill.
+ * @param[in]    src             pth_attri_t pointer to copy.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      pth_attr_destroy
+ */
+int pth_attri_copy (pth_attri_t *dst, pth_attri_t *src);
+
 #ifdef __cplusplus
 CAF_END_C_EXTERNS
 #endif /* !__cplusplus */
@@ -41,7 +41,9 @@
  * @version   $Revision$
  * @author    Daniel Molina Wegener <dmw@coder.cl>
  *
- * Manage Thread Condition Variables.
+ * Manage Thread Condition Variables. Waits on adaptive mutexes, see
+ * PTHDR_MUTEX_ADAPTIVE, park on a futex sequence counter instead of the
+ * pthread condition, since the mutex is not a pthread mutex then.
  *
  */
 
@@ -56,6 +58,8 @@ struct pth_cond_s {
 	int at;
 	pthread_condattr_t attr;
 	pthread_cond_t cond;
+	int seq;
+	int waiters;
 };
 
 
@@ -0,0 +1,221 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_CPU_H
+#define CAF_THREAD_CPU_H 1
+
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @defgroup      caf_thread_cpu    CPU Placement
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_cpu
+ * @{
+ *
+ * @brief     CPU affinity, NUMA placement and thread names.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * A CPU set orders the CPUs the process may run on following a
+ * placement policy, so worker i of a pool runs on the i-th CPU of the
+ * set. The topology is read from sysfs on Linux; on other systems, or
+ * when sysfs is missing, every CPU is taken as a core of node zero and
+ * pinning is not available.
+ *
+ * There is no NUMA library behind the local allocator: it relies on the
+ * first touch policy, where a page is placed on the node of the thread
+ * that first writes it. Memory from pth_cpu_local_alloc is fresh from
+ * the kernel, so the thread that calls pth_cpu_local_touch on it, once
+ * pinned, gets it on its own node.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Defines the pth_cpuset_t structure size */
+#define CAF_PTH_CPUSET_SZ          sizeof(pth_cpuset_t)
+/** Thread name length, including the terminating null byte */
+#define CAF_PTH_NAME_LEN           16
+
+/**
+ *
+ * @brief    CPU placement policies.
+ */
+typedef enum {
+	/** Consecutive workers share cores, then packages and nodes */
+	PTH_CPU_COMPACT = 0,
+	/** Consecutive workers go to different packages, then cores */
+	PTH_CPU_SCATTER = 1,
+	/** An explicit list of CPUs */
+	PTH_CPU_LIST = 2
+} pth_cpu_policy_t;
+
+/**
+ *
+ * @brief    Caffeine CPU set type.
+ * @see      pth_cpuset_s
+ */
+typedef struct pth_cpuset_s pth_cpuset_t;
+
+/**
+ *
+ * @brief    Caffeine CPU set structure.
+ *
+ * The CPUs to use in placement order, with the NUMA node of each one.
+ */
+struct pth_cpuset_s {
+	/** Placement policy */
+	pth_cpu_policy_t policy;
+	/** Number of CPUs */
+	int count;
+	/** CPUs in placement order */
+	int *cpus;
+	/** NUMA node of each CPU */
+	int *nodes;
+};
+
+/**
+ *
+ * @brief    Creates a CPU set.
+ *
+ * For PTH_CPU_COMPACT and PTH_CPU_SCATTER the set holds the CPUs the
+ * process is allowed to run on, and <b>list</b> is ignored.
+ *
+ * @param[in]    policy           placement policy.
+ * @param[in]    list             CPUs for PTH_CPU_LIST.
+ * @param[in]    n                number of CPUs in list.
+ * @return       pth_cpuset_t *   the new CPU set, NULL on failure.
+ *
+ * @see      pth_cpuset_delete
+ */
+pth_cpuset_t *pth_cpuset_new (pth_cpu_policy_t policy, const int *list,
+							  int n);
+
+/**
+ *
+ * @brief    Deletes a CPU set.
+ *
+ * @param[in]    set              the CPU set.
+ */
+void pth_cpuset_delete (pth_cpuset_t *set);
+
+/**
+ *
+ * @brief    Gets the CPU for a worker.
+ *
+ * Workers past the set size wrap around.
+ *
+ * @param[in]    set              the CPU set.
+ * @param[in]    i                worker index.
+ * @return       int              the CPU, -1 on failure.
+ */
+int pth_cpuset_cpu (pth_cpuset_t *set, int i);
+
+/**
+ *
+ * @brief    Gets the NUMA node of a CPU.
+ *
+ * @param[in]    cpu              the CPU.
+ * @return       int              the node, zero when unknown.
+ */
+int pth_cpu_node (int cpu);
+
+/**
+ *
+ * @brief    Gets the CPU running the calling thread.
+ *
+ * @return       int              the CPU, -1 when unknown.
+ */
+int pth_cpu_current (void);
+
+/**
+ *
+ * @brief    Pins the calling thread to a CPU.
+ *
+ * @param[in]    cpu              the CPU.
+ * @return       int              CAF_OK on success, CAF_ERROR on failure.
+ */
+int pth_cpu_pin (int cpu);
+
+/**
+ *
+ * @brief    Names a thread.
+ *
+ * The name is "prefix/i", truncated to CAF_PTH_NAME_LEN, and shows in
+ * top, ps and perf.
+ *
+ * @param[in]    thr              the thread.
+ * @param[in]    prefix           name prefix.
+ * @param[in]    i                worker index.
+ * @return       int              CAF_OK on success, CAF_ERROR on failure.
+ */
+int pth_cpu_set_name (pthread_t thr, const char *prefix, int i);
+
+/**
+ *
+ * @brief    Allocates memory for node local placement.
+ *
+ * The memory is page aligned, zero filled and not yet placed on any
+ * node.
+ *
+ * @param[in]    sz               the size.
+ * @return       void *           the memory, NULL on failure.
+ *
+ * @see      pth_cpu_local_touch
+ * @see      pth_cpu_local_free
+ */
+void *pth_cpu_local_alloc (size_t sz);
+
+/**
+ *
+ * @brief    Places local memory on the calling thread node.
+ *
+ * Writes every page, call it from the thread using the memory.
+ *
+ * @param[in]    ptr              memory from pth_cpu_local_alloc.
+ * @param[in]    sz               the size given to pth_cpu_local_alloc.
+ */
+void pth_cpu_local_touch (void *ptr, size_t sz);
+
+/**
+ *
+ * @brief    Releases memory from pth_cpu_local_alloc.
+ *
+ * @param[in]    ptr              the memory.
+ * @param[in]    sz               the size given to pth_cpu_local_alloc.
+ */
+void pth_cpu_local_free (void *ptr, size_t sz);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_CPU_H */
+/* caf_thread_cpu.h ends here */
+
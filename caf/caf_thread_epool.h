@@ -0,0 +1,247 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_EPOOL_H
+#define CAF_THREAD_EPOOL_H 1
+
+#include <time.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_ring.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_pool.h>
+#include <caf/caf_thread_mutex.h>
+#include <caf/caf_thread_cond.h>
+
+/**
+ * @defgroup      caf_thread_epool    Elastic Thread Pool
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_epool
+ * @{
+ *
+ * @brief     Elastic Thread Pool.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * A task pool whose pth_pool_t grows and shrinks with the load, between
+ * a minimum and a maximum worker count. A worker is added when the
+ * oldest queued task has waited longer than the growth age and the
+ * backlog is larger than the idle and starting workers can take; the
+ * check runs on every submit and every time a worker takes a task. A
+ * worker idle for the idle timeout retires, down to the minimum.
+ *
+ * Tasks wait in a locked queue, so this pool suits blocking or long
+ * tasks and bursty load; for short compute tasks see pth_exec_t.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Computes the elastic pool structure size */
+#define CAF_PTH_EPOOL_SZ          sizeof(pth_epool_t)
+/** Default idle timeout before a worker retires, in microseconds */
+#define CAF_PTH_EPOOL_IDLE        1000000L
+/** Default backlog age that adds a worker, in microseconds */
+#define CAF_PTH_EPOOL_AGE         1000L
+/** Initial queue capacity, the queue grows as needed */
+#define CAF_PTH_EPOOL_QUEUE       256
+
+/**
+ *
+ * @brief    Caffeine elastic pool task type.
+ * @see      pth_etask_s
+ */
+typedef struct pth_etask_s pth_etask_t;
+
+/**
+ *
+ * @brief    Caffeine elastic pool task structure.
+ */
+struct pth_etask_s {
+	/** Task routine */
+	CAF_PT_PROTOTYPE(rtn);
+	/** Task argument */
+	void *arg;
+	/** Enqueue time, CLOCK_MONOTONIC nanoseconds */
+	long long enq;
+};
+
+/**
+ *
+ * @brief    Caffeine elastic pool counters type.
+ * @see      pth_epool_stats_s
+ */
+typedef struct pth_epool_stats_s pth_epool_stats_t;
+
+/**
+ *
+ * @brief    Caffeine elastic pool counters structure.
+ *
+ * Resize decisions and queueing delay, to tune the pool limits, the
+ * idle timeout and the growth age against a real load.
+ */
+struct pth_epool_stats_s {
+	/** Live workers, including starting ones */
+	int workers;
+	/** Workers waiting for tasks */
+	int idle;
+	/** Queued tasks */
+	int backlog;
+	/** Highest worker count */
+	int peak;
+	/** Workers added by backlog age */
+	long grows;
+	/** Failed worker additions */
+	long grow_fails;
+	/** Workers retired by idle timeout */
+	long retires;
+	/** Tasks run */
+	long runs;
+	/** Total task queueing delay in nanoseconds */
+	long long wait_ns;
+	/** Highest task queueing delay in nanoseconds */
+	long long wait_max_ns;
+};
+
+/**
+ *
+ * @brief    Caffeine elastic pool type.
+ * @see      pth_epool_s
+ */
+typedef struct pth_epool_s pth_epool_t;
+
+/**
+ *
+ * @brief    Caffeine elastic pool structure.
+ */
+struct pth_epool_s {
+	/** Worker threads */
+	pth_pool_t *pool;
+	/** Attributes created by the pool, if any */
+	pth_attri_t *attri;
+	/** Guards every field below */
+	pth_mutex_t *mtx;
+	/** Signaled on new tasks and on stop */
+	pth_cond_t *work;
+	/** Signaled when the pool runs out of work */
+	pth_cond_t *done;
+	/** Queued pth_etask_t pointers, oldest first */
+	ring_t *queue;
+	/** Task node cache */
+	caf_npool_t *tasks;
+	/** Minimum worker count */
+	int min;
+	/** Maximum worker count */
+	int max;
+	/** Idle timeout in microseconds */
+	long idle_us;
+	/** Growth age in microseconds */
+	long age_us;
+	/** Workers created but not yet running */
+	int starting;
+	/** Workers running a task */
+	int active;
+	/** Set on deletion */
+	int stop;
+	/** Counters */
+	pth_epool_stats_t st;
+};
+
+/**
+ *
+ * @brief    Creates an elastic pool.
+ *
+ * Starts <b>min</b> workers. The workers use a joinable copy of the
+ * attributes and the caller's attributes are left untouched; NULL
+ * attributes use the pthread defaults and name the workers "caf-epool".
+ *
+ * @param[in]    attrs           worker thread attributes, or NULL.
+ * @param[in]    min             minimum worker count, may be zero.
+ * @param[in]    max             maximum worker count.
+ * @param[in]    idle_us         idle timeout, zero or less for
+ *                               CAF_PTH_EPOOL_IDLE.
+ * @param[in]    age_us          growth age, zero grows as soon as the
+ *                               backlog exceeds the free workers, less
+ *                               than zero for CAF_PTH_EPOOL_AGE.
+ * @return       pth_epool_t *   the new pool, NULL on failure.
+ *
+ * @see      pth_epool_delete
+ */
+pth_epool_t *pth_epool_new (pth_attri_t *attrs, int min, int max,
+							long idle_us, long age_us);
+
+/**
+ *
+ * @brief    Deletes an elastic pool.
+ *
+ * Runs every queued task, then stops and joins the workers.
+ *
+ * @param[in]    ep              the pool.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int pth_epool_delete (pth_epool_t *ep);
+
+/**
+ *
+ * @brief    Submits a task.
+ *
+ * @param[in]    ep              the pool.
+ * @param[in]    rtn             task routine.
+ * @param[in]    arg             task argument.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int pth_epool_submit (pth_epool_t *ep, CAF_PT_PROTOTYPE(rtn), void *arg);
+
+/**
+ *
+ * @brief    Waits until the pool runs out of work.
+ *
+ * @param[in]    ep              the pool.
+ * @param[in]    to              absolute CLOCK_REALTIME timeout, NULL
+ *                               to wait forever.
+ * @return       int             CAF_OK when idle, CAF_ERROR_SUB on
+ *                               timeout, CAF_ERROR on failure.
+ */
+int pth_epool_wait (pth_epool_t *ep, const struct timespec *to);
+
+/**
+ *
+ * @brief    Reads the pool counters.
+ *
+ * @param[in]    ep              the pool.
+ * @param[out]   st              where to copy the counters.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ */
+int pth_epool_stats (pth_epool_t *ep, pth_epool_stats_t *st);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_EPOOL_H */
+/* caf_thread_epool.h ends here */
+
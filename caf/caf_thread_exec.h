@@ -0,0 +1,304 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_EXEC_H
+#define CAF_THREAD_EXEC_H 1
+
+#include <pthread.h>
+#include <time.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_pool.h>
+#include <caf/caf_thread_mpmc.h>
+
+/**
+ * @defgroup      caf_thread_exec    Thread Pool Executor
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_exec
+ * @{
+ *
+ * @brief     Task submission executor over a thread pool.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Runs submitted routines on a pth_pool_t of workers. Tasks submitted
+ * from outside the pool go through a shared lock-free queue; tasks
+ * submitted by a running task go to the local queue of its worker,
+ * which the owner pops in LIFO order and idle workers steal from in
+ * FIFO order. Idle workers park on a futex. A submission can return a
+ * future to wait for the routine result.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Defines the pth_exec_t structure size */
+#define CAF_PTH_EXEC_SZ           sizeof(pth_exec_t)
+/** Defines the pth_future_t structure size */
+#define CAF_PTH_FUTURE_SZ         sizeof(pth_future_t)
+/** Worker local queue capacity, a power of two */
+#define CAF_PTH_EXEC_LOCAL        1024
+/** Default shared queue capacity */
+#define CAF_PTH_EXEC_QUEUE        4096
+/** Cache line size used to keep the workers apart */
+#define CAF_PTH_EXEC_LINE         64
+
+/**
+ *
+ * @brief    Caffeine Executor Task Type.
+ * @see      pth_task_s
+ */
+typedef struct pth_task_s pth_task_t;
+
+/**
+ *
+ * @brief    Caffeine Future Type.
+ * @see      pth_future_s
+ */
+typedef struct pth_future_s pth_future_t;
+
+/**
+ *
+ * @brief    Caffeine Executor Worker Type.
+ * @see      pth_exec_worker_s
+ */
+typedef struct pth_exec_worker_s pth_exec_worker_t;
+
+/**
+ *
+ * @brief    Caffeine Executor Type.
+ * @see      pth_exec_s
+ */
+typedef struct pth_exec_s pth_exec_t;
+
+/**
+ *
+ * @brief    Caffeine Executor Task Structure.
+ */
+struct pth_task_s {
+	/** Task routine */
+	CAF_PT_PROTOTYPE(rtn);
+	/** Task argument */
+	void *arg;
+	/** Completion future, or NULL */
+	pth_future_t *future;
+};
+
+/**
+ *
+ * @brief    Caffeine Future Structure.
+ * The future is shared by the submitter and the worker, and released
+ * when both are done with it.
+ */
+struct pth_future_s {
+	/** Routine result */
+	void *result;
+	/** Futex word: 0 pending, 1 done, 2 pending with sleepers */
+	int state;
+	/** References, the submitter and the task */
+	int refs;
+};
+
+/**
+ *
+ * @brief    Caffeine Executor Worker Structure.
+ * Holds the worker local queue, a Chase-Lev work stealing deque: the
+ * owner pushes and pops at the bottom, thieves take from the top.
+ */
+struct pth_exec_worker_s {
+	/** Next position to steal */
+	long top;
+	char pad0[CAF_PTH_EXEC_LINE - sizeof (long)];
+	/** Next position to push */
+	long bottom;
+	/** Local queue slots */
+	pth_task_t **tasks;
+	/** Owner executor */
+	pth_exec_t *exec;
+	/** Tasks run by this worker */
+	size_t runs;
+	/** Tasks stolen from other workers */
+	size_t steals;
+	/** Victim selection state */
+	unsigned int rnd;
+	char pad1[CAF_PTH_EXEC_LINE - sizeof (long) - 2 * sizeof (void *)
+			  - 2 * sizeof (size_t) - sizeof (unsigned int)];
+};
+
+/**
+ *
+ * @brief    Caffeine Executor Structure.
+ */
+struct pth_exec_s {
+	/** Worker count */
+	int count;
+	/** Workers, count of them */
+	pth_exec_worker_t *workers;
+	/** Shared queue for tasks submitted from outside the pool */
+	pth_mpmc_t *queue;
+	/** Worker threads */
+	pth_pool_t *pool;
+	/** Attributes created by the executor, or NULL */
+	pth_attri_t *attri;
+	/** Next worker id to hand out */
+	int next;
+	/** Set when the executor is shutting down */
+	int stop;
+	/** Submitted and not finished tasks */
+	long pending;
+	/** Futex word bumped to wake parked workers */
+	int work_ev;
+	/** Parked or parking workers */
+	int sleepers;
+	/** Set while a parked worker is being woken */
+	int waking;
+	/** Event count for pth_exec_wait, bit 0 flags sleepers */
+	int done_ev;
+};
+
+/**
+ *
+ * @brief    Creates an executor.
+ *
+ * Starts <b>count</b> workers through pth_pool_create. The workers use
+ * a joinable copy of the attributes, since they are joined on deletion,
+ * and the caller's attributes are left untouched; NULL attributes use
+ * the pthread defaults and name the workers "caf-exec".
+ * With PTH_ATTR_AFFINITY every worker runs pinned and its local deque
+ * is placed on its NUMA node.
+ *
+ * @param[in]    attrs           worker thread attributes, or NULL.
+ * @param[in]    count           number of workers.
+ * @param[in]    qsize           shared queue capacity, zero for
+ *                               CAF_PTH_EXEC_QUEUE.
+ * @return       pth_exec_t *    the new executor, NULL on failure.
+ *
+ * @see      pth_exec_delete
+ */
+pth_exec_t *pth_exec_new (pth_attri_t *attrs, int count, size_t qsize);
+
+/**
+ *
+ * @brief    Deletes an executor.
+ *
+ * Runs every submitted task, including the ones they submit, then
+ * stops and joins the workers.
+ *
+ * @param[in]    exec            the executor.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      pth_exec_new
+ */
+int pth_exec_delete (pth_exec_t *exec);
+
+/**
+ *
+ * @brief    Submits a task.
+ *
+ * Queues <b>rtn</b>(<b>arg</b>) and returns without waiting; the
+ * routine result is discarded. When the shared queue is full other
+ * threads wait for room, while a task of this executor never waits:
+ * once its worker deque and the shared queue are both full, the new
+ * task runs inline before the call returns.
+ *
+ * @param[in]    exec            the executor.
+ * @param[in]    rtn             the task routine.
+ * @param[in]    arg             the task argument.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      pth_exec_async
+ */
+int pth_exec_submit (pth_exec_t *exec, CAF_PT_PROTOTYPE(rtn), void *arg);
+
+/**
+ *
+ * @brief    Submits a task with a completion future.
+ *
+ * Queues like pth_exec_submit, including the inline run of a task
+ * submitted from a worker when every queue is full.
+ *
+ * @param[in]    exec            the executor.
+ * @param[in]    rtn             the task routine.
+ * @param[in]    arg             the task argument.
+ * @return       pth_future_t *  the future, NULL on failure. It must be
+ *                               released with pth_future_delete.
+ *
+ * @see      pth_future_wait
+ */
+pth_future_t *pth_exec_async (pth_exec_t *exec, CAF_PT_PROTOTYPE(rtn),
+							  void *arg);
+
+/**
+ *
+ * @brief    Waits until every submitted task has finished.
+ *
+ * @param[in]    exec            the executor.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK when idle, CAF_ERROR_SUB on timeout.
+ */
+int pth_exec_wait (pth_exec_t *exec, const struct timespec *to);
+
+/**
+ *
+ * @brief    Waits for a future.
+ *
+ * @param[in]    f               the future.
+ * @param[out]   result          where to store the routine result, or NULL.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK when done, CAF_ERROR_SUB on timeout.
+ *
+ * @see      pth_exec_async
+ */
+int pth_future_wait (pth_future_t *f, void **result,
+					 const struct timespec *to);
+
+/**
+ *
+ * @brief    Checks whether a future is done.
+ *
+ * @param[in]    f               the future.
+ * @return       int             CAF_OK if done, CAF_ERROR if pending.
+ */
+int pth_future_done (pth_future_t *f);
+
+/**
+ *
+ * @brief    Releases a future.
+ *
+ * The future may be released before the task has run.
+ *
+ * @param[in]    f               the future.
+ */
+void pth_future_delete (pth_future_t *f);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_EXEC_H */
+/* caf_thread_exec.h ends here */
+
@@ -0,0 +1,143 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_FUTEX_H
+#define CAF_THREAD_FUTEX_H 1
+
+#include <time.h>
+
+/**
+ * @defgroup      caf_thread_futex    Thread Futexes
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_futex
+ * @{
+ *
+ * @brief     Thread Futexes.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Wait and wake primitives on a 32 bit word, used to park threads
+ * in lock-free structures. On Linux these map to the futex system
+ * call; elsewhere the wait polls the word with short sleeps.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Wakes all the waiters */
+#define CAF_PTH_FUTEX_ALL         0x7fffffff
+/** Default bound of adaptive lock spinning, in polls */
+#define CAF_PTH_SPIN_MAX          200
+
+/** Spin loop hint, lets the sibling hardware thread run */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CAF_PTH_RELAX()           __builtin_ia32_pause ()
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define CAF_PTH_RELAX()           __asm__ __volatile__ ("yield" ::: "memory")
+#else /* !__GNUC__ */
+#define CAF_PTH_RELAX()           do { } while (0)
+#endif /* !__GNUC__ */
+
+/**
+ *
+ * @brief    Waits on a futex word.
+ *
+ * Sleeps while the word at <b>addr</b> holds <b>val</b>, until
+ * pth_futex_wake is called on it or the deadline expires. Returns
+ * immediately if the word does not hold <b>val</b>. Spurious wakeups
+ * are possible, callers must check their condition again.
+ *
+ * @param[in]    addr            the futex word.
+ * @param[in]    val             the expected value.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK when woken, CAF_ERROR_SUB on timeout.
+ *
+ * @see      pth_futex_wake
+ */
+int pth_futex_wait (int *addr, int val, const struct timespec *to);
+
+/**
+ *
+ * @brief    Wakes futex waiters.
+ *
+ * @param[in]    addr            the futex word.
+ * @param[in]    n               maximum number of waiters to wake.
+ * @return       int             the number of woken waiters.
+ *
+ * @see      pth_futex_wait
+ */
+int pth_futex_wake (int *addr, int n);
+
+/**
+ *
+ * @brief    Waits on a futex word shared between processes.
+ *
+ * Same as pth_futex_wait, but the word may live in a shared memory
+ * segment mapped by several processes, at different addresses.
+ *
+ * @param[in]    addr            the futex word.
+ * @param[in]    val             the expected value.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK when woken, CAF_ERROR_SUB on timeout.
+ *
+ * @see      pth_futex_wake_shared
+ */
+int pth_futex_wait_shared (int *addr, int val, const struct timespec *to);
+
+/**
+ *
+ * @brief    Wakes futex waiters of any process.
+ *
+ * @param[in]    addr            the futex word.
+ * @param[in]    n               maximum number of waiters to wake.
+ * @return       int             the number of woken waiters.
+ *
+ * @see      pth_futex_wait_shared
+ */
+int pth_futex_wake_shared (int *addr, int n);
+
+/**
+ *
+ * @brief    Bounds adaptive spinning.
+ *
+ * Spinning only pays when the lock holder runs on another CPU, so the
+ * bound is zero on single CPU systems.
+ *
+ * @param[in]    want            wanted bound, zero or less for
+ *                               CAF_PTH_SPIN_MAX.
+ * @return       int             the spin bound to use.
+ */
+int pth_futex_spin_max (int want);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_FUTEX_H */
+/* caf_thread_futex.h ends here */
+
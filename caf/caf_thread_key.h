@@ -44,6 +44,12 @@
  * release callback is set, the normal pthread behavior does the
  * TSD release.
  *
+ * Pools index their keys by identifier, so pth_kpool_get does not
+ * depend on the number of keys. Identifiers from PTH_KPOOL_SLOTS_MAX
+ * on are looked up in the key list. Building with CAF_USE_PTH_KEY_TLS
+ * also serves key data from a per thread __thread cache; then key
+ * data must be set through pth_key_set for the cache to see it.
+ *
  */
 
 #ifdef __cplusplus
@@ -56,6 +62,12 @@ CAF_BEGIN_C_EXTERNS
 #define PTH_KEY_T_SZ                            sizeof(pth_key_t)
 /** Defines the pth_kpool_t structure size */
 #define PTH_KPOOL_T_SZ                          sizeof(pth_kpool_t)
+/** Initial length of the key pool slot table */
+#define PTH_KPOOL_SLOTS                         8
+/** Largest slot table, keys with greater identifiers are searched */
+#define PTH_KPOOL_SLOTS_MAX                     4096
+/** Entries of the per thread key data cache, a power of two */
+#define PTH_KEY_TLS_SLOTS                       64
 
 
 /**
@@ -84,6 +96,8 @@ struct pth_key_s {
 	pthread_key_t key;
 	/** Pointer Destruction Routine */
 	PTH_KEY_DESTROY_RTN(rtn);
+	/** Unique Key Sequence, tags the thread-local lookup cache */
+	unsigned long seq;
 };
 
 /**
@@ -107,6 +121,10 @@ struct pth_kpool_s {
 	pthread_t *thr;
 	/** The Key List */
 	deque_t *keys;
+	/** Keys indexed by identifier, for constant time lookups */
+	pth_key_t **slots;
+	/** Length of the slot table */
+	int nslots;
 };
 
 
@@ -159,7 +177,8 @@ int pth_key_set (pth_key_t *key, size_t sz);
  *
  * @brief    Gets the key specific data.
  *
- * Gets the pointer to the key specific data.
+ * Gets the pointer to the key specific data, from the thread-local
+ * cache when built with CAF_USE_PTH_KEY_TLS.
  *
  * @param[in]    key             Caffeine Thread Key.
  * @return       void *          Key specific data pointer, NULL on error.
@@ -0,0 +1,262 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_LPROF_H
+#define CAF_THREAD_LPROF_H 1
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * @defgroup      caf_thread_lprof    Thread Lock Profiling
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_lprof
+ * @{
+ *
+ * @brief     Thread Lock Profiling.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Contention statistics for pth_mutex_t and pth_rwlock_t, kept in a
+ * process wide table keyed by lock kind and identifier. Locks opt in
+ * through PTHDR_MUTEX_PROFILE and PTHDR_RWLOCK_PROFILE; locks sharing
+ * an identifier share their entry. An acquisition that succeeds at
+ * the first try costs a few atomic increments, only contended ones
+ * read the clock for the wait time. Hold times are sampled on
+ * exclusive holds, every contended one and one in pth_lprof_sample
+ * uncontended ones; each lock keeps the start of its own sampled hold,
+ * so locks sharing an entry never end each other's holds. Histograms
+ * have power of two nanosecond buckets,
+ * bucket i counts times below 2^i ns and the last one the rest.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Number of profiled lock identifiers */
+#define CAF_PTH_LPROF_MAX         128
+/** Number of histogram buckets */
+#define CAF_PTH_LPROF_BUCKETS     32
+/** Default uncontended hold sampling period, a power of two */
+#define CAF_PTH_LPROF_SAMPLE      8
+/** Marks a valid table, as seen in shared memory */
+#define CAF_PTH_LPROF_MAGIC       0x4c50524f
+
+/**
+ *
+ * @brief    Profiled lock kinds.
+ */
+typedef enum {
+	/** pth_mutex_t, keyed by the PTHDR_MUTEX_PROFILE data */
+	PTH_LPROF_MUTEX = 1,
+	/** pth_rwlock_t, keyed by its id field */
+	PTH_LPROF_RWLOCK = 2
+} pth_lprof_kind_t;
+
+/**
+ *
+ * @brief    Lock Profile Entry Type.
+ * @see      pth_lprof_s
+ */
+typedef struct pth_lprof_s pth_lprof_t;
+/**
+ *
+ * @brief    Lock Profile Entry Structure.
+ * Counters are updated with relaxed atomics, times are nanoseconds.
+ * The structure holds no pointers, so tables can be copied to shared
+ * memory as they are.
+ */
+struct pth_lprof_s {
+	/** Lock identifier */
+	int id;
+	/** Lock kind, zero for a free entry */
+	int kind;
+	/** Acquisitions */
+	long long acq;
+	/** Shared (read) acquisitions */
+	long long rd_acq;
+	/** Acquisitions that had to wait */
+	long long contended;
+	/** Failed try and timed acquisitions */
+	long long fails;
+	/** Condition variable waits */
+	long long cond_waits;
+	/** Time spent in condition variable waits */
+	long long cond_ns;
+	/** Total contended wait time */
+	long long wait_ns;
+	/** Longest contended wait */
+	long long wait_max;
+	/** Sampled exclusive holds */
+	long long holds;
+	/** Total sampled hold time */
+	long long hold_ns;
+	/** Longest sampled hold */
+	long long hold_max;
+	/** Contended wait time histogram */
+	long long wait_hist[CAF_PTH_LPROF_BUCKETS];
+	/** Sampled hold time histogram */
+	long long hold_hist[CAF_PTH_LPROF_BUCKETS];
+};
+
+/**
+ *
+ * @brief    Lock Profile Table Type.
+ * @see      pth_lprof_tab_s
+ */
+typedef struct pth_lprof_tab_s pth_lprof_tab_t;
+/**
+ *
+ * @brief    Lock Profile Table Structure.
+ * The layout written by pth_lprof_dump_shm.
+ */
+struct pth_lprof_tab_s {
+	/** CAF_PTH_LPROF_MAGIC */
+	int magic;
+	/** Entries in use */
+	int used;
+	/** Uncontended hold sampling period */
+	int sample;
+	/** Entries */
+	pth_lprof_t ent[CAF_PTH_LPROF_MAX];
+};
+
+/**
+ *
+ * @brief    Finds or claims the entry of a lock.
+ *
+ * @param[in]    kind            lock kind.
+ * @param[in]    id              lock identifier.
+ * @return       pth_lprof_t *   the entry, NULL if the table is full.
+ */
+pth_lprof_t *pth_lprof_get (pth_lprof_kind_t kind, int id);
+
+/**
+ *
+ * @brief    Sets the uncontended hold sampling period.
+ *
+ * @param[in]    n               period, rounded up to a power of two;
+ *                               one times every hold.
+ */
+void pth_lprof_sample (int n);
+
+/**
+ *
+ * @brief    Clears the counters of every entry, keeping the entries.
+ */
+void pth_lprof_reset (void);
+
+/**
+ *
+ * @brief    Copies the table.
+ *
+ * @param[out]   dst             where to copy the table.
+ * @return       int             CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_lprof_snapshot (pth_lprof_tab_t *dst);
+
+/**
+ *
+ * @brief    Prints the entries in use, one line each, plus the non empty
+ *           histogram buckets.
+ *
+ * @param[in]    out             output stream.
+ * @return       int             CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_lprof_dump (FILE *out);
+
+/**
+ *
+ * @brief    Copies the table into a System V shared memory segment.
+ *
+ * The segment is created if needed and left in place, so other
+ * processes can attach it with the same key and read a
+ * pth_lprof_tab_t from it.
+ *
+ * @param[in]    key             IPC key of the segment.
+ * @return       int             CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_lprof_dump_shm (key_t key);
+
+/**
+ *
+ * @brief    Reads the profiling clock.
+ *
+ * @return       long long       monotonic time in nanoseconds.
+ */
+long long pth_lprof_now (void);
+
+/**
+ *
+ * @brief    Records an acquisition.
+ *
+ * The lock keeps the returned time and hands it back to
+ * pth_lprof_released when it is released.
+ *
+ * @param[in]    p               lock entry.
+ * @param[in]    rd              non zero for a shared acquisition.
+ * @param[in]    t0              start of the wait, zero if the lock was
+ *                               taken without waiting.
+ * @return       long long       start of the sampled hold, zero if the
+ *                               hold is not sampled.
+ */
+long long pth_lprof_acquired (pth_lprof_t *p, int rd, long long t0);
+
+/**
+ *
+ * @brief    Records a release, ending the sampled hold if any.
+ *
+ * @param[in]    p               lock entry.
+ * @param[in]    start           the pth_lprof_acquired result of the
+ *                               hold, zero if none.
+ */
+void pth_lprof_released (pth_lprof_t *p, long long start);
+
+/**
+ *
+ * @brief    Records a failed try or timed acquisition.
+ *
+ * @param[in]    p               lock entry.
+ */
+void pth_lprof_failed (pth_lprof_t *p);
+
+/**
+ *
+ * @brief    Records a condition variable wait.
+ *
+ * @param[in]    p               entry of the mutex waited with.
+ * @param[in]    t0              start of the wait.
+ */
+void pth_lprof_cond (pth_lprof_t *p, long long t0);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_LPROF_H */
+/* caf_thread_lprof.h ends here */
@@ -0,0 +1,210 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_MPMC_H
+#define CAF_THREAD_MPMC_H 1
+
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * @defgroup      caf_thread_mpmc    Thread MPMC Queues
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_mpmc
+ * @{
+ *
+ * @brief     Lock-free bounded multi-producer multi-consumer queues.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Bounded queue of data pointers for handing work between threads.
+ * Every cell carries a sequence number telling whether it is ready to
+ * be written or read at the current lap, so producers and consumers
+ * only contend on their own position counter and never take a lock.
+ * The blocking variants park on a futex word; the wake system call
+ * is only made when somebody is actually sleeping.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Defines the pth_mpmc_t structure size */
+#define CAF_PTH_MPMC_SZ           sizeof(pth_mpmc_t)
+/** Cache line size used to keep the positions apart */
+#define CAF_PTH_MPMC_LINE         64
+/** Minimum queue capacity */
+#define CAF_PTH_MPMC_MIN          2
+
+/**
+ *
+ * @brief    Caffeine MPMC Queue Cell Type.
+ * @see      pth_mpmc_cell_s
+ */
+typedef struct pth_mpmc_cell_s pth_mpmc_cell_t;
+
+/**
+ *
+ * @brief    Caffeine MPMC Queue Cell Structure.
+ * A cell is free for the producer at position p when seq == p, and
+ * holds data for the consumer at position p when seq == p + 1.
+ */
+struct pth_mpmc_cell_s {
+	/** Cell sequence number */
+	size_t seq;
+	/** Stored data */
+	void *data;
+};
+
+/**
+ *
+ * @brief    Caffeine MPMC Queue Type.
+ * @see      pth_mpmc_s
+ */
+typedef struct pth_mpmc_s pth_mpmc_t;
+
+/**
+ *
+ * @brief    Caffeine MPMC Queue Structure.
+ * The producer position, the consumer position and the futex words
+ * live in separate cache lines.
+ */
+struct pth_mpmc_s {
+	/** Cells, mask + 1 of them */
+	pth_mpmc_cell_t *cells;
+	/** Capacity minus one, the capacity is a power of two */
+	size_t mask;
+	char pad0[CAF_PTH_MPMC_LINE - sizeof (void *) - sizeof (size_t)];
+	/** Next position to write */
+	size_t enq;
+	char pad1[CAF_PTH_MPMC_LINE - sizeof (size_t)];
+	/** Next position to read */
+	size_t deq;
+	char pad2[CAF_PTH_MPMC_LINE - sizeof (size_t)];
+	/** Event count bumped when a cell is freed, bit 0 flags sleepers */
+	int put_ev;
+	/** Event count bumped when a cell is filled, bit 0 flags sleepers */
+	int get_ev;
+	char pad3[CAF_PTH_MPMC_LINE - 2 * sizeof (int)];
+};
+
+/**
+ *
+ * @brief    Creates a new MPMC queue.
+ *
+ * @param[in]    size            capacity, rounded up to a power of two
+ *                               and at least CAF_PTH_MPMC_MIN.
+ * @return       pth_mpmc_t *    the new queue, NULL on failure.
+ *
+ * @see      pth_mpmc_delete
+ */
+pth_mpmc_t *pth_mpmc_new (size_t size);
+
+/**
+ *
+ * @brief    Deletes an MPMC queue.
+ *
+ * The queue must not be in use by any thread. Data still queued is
+ * not released.
+ *
+ * @param[in]    q               the queue.
+ * @return       int             CAF_OK on success, CAF_ERROR on failure.
+ *
+ * @see      pth_mpmc_new
+ */
+int pth_mpmc_delete (pth_mpmc_t *q);
+
+/**
+ *
+ * @brief    Tries to enqueue a data pointer.
+ *
+ * @param[in]    q               the queue.
+ * @param[in]    data            the data to enqueue.
+ * @return       int             CAF_OK on success, CAF_ERROR if full.
+ *
+ * @see      pth_mpmc_push
+ */
+int pth_mpmc_trypush (pth_mpmc_t *q, void *data);
+
+/**
+ *
+ * @brief    Tries to dequeue a data pointer.
+ *
+ * @param[in]    q               the queue.
+ * @param[out]   data            where to store the dequeued data.
+ * @return       int             CAF_OK on success, CAF_ERROR if empty.
+ *
+ * @see      pth_mpmc_pop
+ */
+int pth_mpmc_trypop (pth_mpmc_t *q, void **data);
+
+/**
+ *
+ * @brief    Enqueues a data pointer, waiting for room.
+ *
+ * @param[in]    q               the queue.
+ * @param[in]    data            the data to enqueue.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK on success, CAF_ERROR_SUB on
+ *                               timeout or failure.
+ *
+ * @see      pth_mpmc_trypush
+ */
+int pth_mpmc_push (pth_mpmc_t *q, void *data, const struct timespec *to);
+
+/**
+ *
+ * @brief    Dequeues a data pointer, waiting for data.
+ *
+ * @param[in]    q               the queue.
+ * @param[out]   data            where to store the dequeued data.
+ * @param[in]    to              absolute CLOCK_REALTIME deadline, or NULL.
+ * @return       int             CAF_OK on success, CAF_ERROR_SUB on
+ *                               timeout or failure.
+ *
+ * @see      pth_mpmc_trypop
+ */
+int pth_mpmc_pop (pth_mpmc_t *q, void **data, const struct timespec *to);
+
+/**
+ *
+ * @brief    Returns the number of queued elements.
+ *
+ * The count is a snapshot and may be stale under concurrent use.
+ *
+ * @param[in]    q               the queue.
+ * @return       size_t          the queued elements.
+ */
+size_t pth_mpmc_count (pth_mpmc_t *q);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_MPMC_H */
+/* caf_thread_mpmc.h ends here */
+
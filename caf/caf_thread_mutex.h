@@ -26,6 +26,7 @@
 #define CAF_THREAD_MUTEX_H 1
 
 #include <pthread.h>
+#include <caf/caf_thread_lprof.h>
 
 /**
  * @defgroup      caf_thread_mutex    Thread Mutexes
@@ -42,6 +43,17 @@
  * maintain the mutex and his attributes. Also a bitfield to manage
  * get information about the attributes that has been set for the mutex.
  *
+ * Setting PTHDR_MUTEX_ADAPTIVE turns the mutex into a futex based lock,
+ * which spins a bounded and adaptive number of polls while the holder
+ * runs on another CPU and then parks the thread in the kernel. The
+ * spin bound follows the length of the recent waits, so short critical
+ * sections are taken without sleeping and long ones stop wasting CPU.
+ * The futex lock does not track its owner, so it is refused for
+ * recursive and error checking mutexes, and the other way around.
+ *
+ * Setting PTHDR_MUTEX_PROFILE records the mutex contention under the
+ * given identifier, see caf_thread_lprof.
+ *
  */
 
 #ifdef __cplusplus
@@ -64,7 +76,11 @@ typedef enum {
 	/** pthread_attr_(set|get)schedparam */
 	PTHDR_MUTEX_TYPE = 0000004,
 	/** locked */
-	PTHDR_MUTEX_LOCK = 0000010
+	PTHDR_MUTEX_LOCK = 0000010,
+	/** spin-then-park futex lock, data is the spin bound or zero */
+	PTHDR_MUTEX_ADAPTIVE = 0000020,
+	/** contention profiling, data is the identifier or -1 to stop */
+	PTHDR_MUTEX_PROFILE = 0000040
 } pth_mutexattr_types_t;
 
 /**
@@ -88,6 +104,20 @@ struct pth_mutex_s {
 	pthread_mutexattr_t attr;
 	/** The Thread Mutex */
 	pthread_mutex_t mutex;
+	/** Lock kind, zero or PTHDR_MUTEX_ADAPTIVE */
+	int kind;
+	/** Futex word: 0 free, 1 locked, 2 locked with sleepers */
+	int futex;
+	/** Running estimate of the polls needed to take the lock */
+	int spin;
+	/** Spin bound, zero parks at once */
+	int spin_max;
+	/** Contention profile, NULL when not profiled */
+	pth_lprof_t *prof;
+	/** Start of the sampled hold, zero if none */
+	long long hold_start;
+	/** Profiled acquisitions held, above one for recursive holds */
+	int hold_depth;
 };
 
 /**
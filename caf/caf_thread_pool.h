@@ -86,7 +86,8 @@ struct pth_pool_s {
  *
  * Allocates memory for a pth_pool_t structure, setting the attributes of
  * the pool threads, the common routine to all threads and the amount
- * of threads to launch.
+ * of threads to launch. A zero count gives an empty pool, to be grown
+ * with pth_pool_add.
  *
  * @param[in]    attrs           Caffeine Thread Attributes.
  * @param[in]    rtn             thread routine.
@@ -128,7 +129,8 @@ int pth_pool_delete_callback (void *ptr);
  * @brief    Creates a new Pool.
  *
  * Do all the job to create a thread pool with a common task, ideal for single
- * services.
+ * services. Thread i is pinned and named following the PTH_ATTR_AFFINITY
+ * and PTH_ATTR_NAME attributes, when set.
  *
  * @param[in]    attrs           Caffeine Thread Attributes.
  * @param[in]    rtn             thread routine.
@@ -145,7 +147,8 @@ pth_pool_t *pth_pool_create (pth_attri_t *attrs,
  *
  * @brief    Adds a Thread to the Pool.
  *
- * Adds threads to the given pool.
+ * Adds threads to the given pool. The new thread is the pool worker
+ * number count for placement and naming, and count grows by one.
  *
  * @param[in]    p               Caffeine Thread Pool.
  * @param[in]    attrs           Caffeine Thread Attributes.
@@ -161,7 +164,9 @@ int pth_pool_add (pth_pool_t *p, pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn),
  *
  * @brief    Joins the entire given pool.
  *
- * Joins the all the threads in the given thread pool.
+ * Joins the all the threads in the given thread pool. The joined
+ * threads are released from the pool, so a later detach, cancel
+ * or delete does not touch them.
  *
  * @param[in]    pool            Caffeine Thread Pool.
  * @return       int             zero on success, upper to zero on error.
@@ -0,0 +1,256 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_RCU_H
+#define CAF_THREAD_RCU_H 1
+
+#include <caf/caf_thread_mutex.h>
+
+/**
+ * @defgroup      caf_thread_rcu    Thread Read-Copy-Update
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_rcu
+ * @{
+ *
+ * @brief     Thread Read-Copy-Update.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Epoch based publication of pointer swapped structures, such as a
+ * caf_hash_table_t replaced as a whole. Readers register once, then
+ * bracket their reads with pth_rcu_read_lock and pth_rcu_read_unlock,
+ * which only write the reader own cache line. Writers build a new copy,
+ * swap it in with pth_rcu_publish and hand the old one to pth_rcu_retire,
+ * which frees it once every reader that could still see it has left its
+ * read section. Read sections must not call pth_rcu_synchronize,
+ * pth_rcu_retire or pth_rcu_barrier on their own domain.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Cache line size used to pad the reader slots */
+#define CAF_PTH_RCU_LINE          64
+/** Retired objects queued before a reclamation pass */
+#define CAF_PTH_RCU_BATCH         64
+/** Defines the pth_rcu_t structure size */
+#define CAF_PTH_RCU_SZ            (sizeof (pth_rcu_t))
+
+/** Reclamation callback, NULL stands for xfree */
+#define CAF_RCU_CBFREE(f)         void (*f)(void *ptr)
+
+/**
+ *
+ * @brief    RCU Reader Slot Type.
+ * @see      pth_rcu_reader_s
+ */
+typedef struct pth_rcu_reader_s pth_rcu_reader_t;
+/**
+ *
+ * @brief    RCU Reader Slot Structure.
+ * One cache line per registered reader thread.
+ */
+struct pth_rcu_reader_s {
+	/** Epoch seen when entering the read section, zero outside */
+	long epoch;
+	/** Slot claimed by a thread */
+	int used;
+	/** Read section nesting depth */
+	int depth;
+	/** Padding to the cache line size */
+	char pad[CAF_PTH_RCU_LINE - sizeof (long) - 2 * sizeof (int)];
+};
+
+/**
+ *
+ * @brief    RCU Retired Object Type.
+ * @see      pth_rcu_cb_s
+ */
+typedef struct pth_rcu_cb_s pth_rcu_cb_t;
+/**
+ *
+ * @brief    RCU Retired Object Structure.
+ */
+struct pth_rcu_cb_s {
+	/** Retired object */
+	void *ptr;
+	/** Reclamation callback */
+	CAF_RCU_CBFREE(del);
+	/** Next retired object */
+	pth_rcu_cb_t *next;
+};
+
+/**
+ *
+ * @brief    RCU Domain Type.
+ * @see      pth_rcu_s
+ */
+typedef struct pth_rcu_s pth_rcu_t;
+/**
+ *
+ * @brief    RCU Domain Structure.
+ */
+struct pth_rcu_s {
+	/** Domain identifier */
+	int id;
+	/** Reader slots */
+	int max;
+	/** Global epoch, advanced by each grace period */
+	long epoch;
+	/** Reader slots, cache line aligned */
+	pth_rcu_reader_t *readers;
+	/** Serializes grace periods and the retired list */
+	pth_mutex_t *mtx;
+	/** Retired objects waiting for a grace period */
+	pth_rcu_cb_t *pending;
+	/** Retired objects count */
+	int npending;
+	/** Grace periods run */
+	long syncs;
+	/** Objects reclaimed */
+	long reclaimed;
+};
+
+/**
+ *
+ * @brief    Creates a new RCU domain.
+ *
+ * @param[in]    id              domain identifier.
+ * @param[in]    readers         maximum registered reader threads.
+ * @return       pth_rcu_t *     the new domain, NULL on failure.
+ */
+pth_rcu_t *pth_rcu_new (int id, int readers);
+
+/**
+ *
+ * @brief    Deletes an RCU domain, reclaiming the retired objects.
+ *
+ * No reader may be inside a read section.
+ *
+ * @param[in]    rcu             domain to delete.
+ */
+void pth_rcu_delete (pth_rcu_t *rcu);
+
+/**
+ *
+ * @brief    Claims a reader slot for the calling thread.
+ *
+ * @param[in]    rcu                  domain.
+ * @return       pth_rcu_reader_t *   the slot, NULL if all are taken.
+ */
+pth_rcu_reader_t *pth_rcu_register (pth_rcu_t *rcu);
+
+/**
+ *
+ * @brief    Releases a reader slot.
+ *
+ * @param[in]    rcu             domain.
+ * @param[in]    r               slot from pth_rcu_register.
+ */
+void pth_rcu_unregister (pth_rcu_t *rcu, pth_rcu_reader_t *r);
+
+/**
+ *
+ * @brief    Enters a read section, sections may nest.
+ *
+ * @param[in]    rcu             domain.
+ * @param[in]    r               the calling thread slot.
+ */
+void pth_rcu_read_lock (pth_rcu_t *rcu, pth_rcu_reader_t *r);
+
+/**
+ *
+ * @brief    Leaves a read section.
+ *
+ * @param[in]    r               the calling thread slot.
+ */
+void pth_rcu_read_unlock (pth_rcu_reader_t *r);
+
+/**
+ *
+ * @brief    Loads a published pointer inside a read section.
+ *
+ * @param[in]    pp              published pointer location.
+ * @return       void *          the pointer, valid until the section ends.
+ */
+void *pth_rcu_deref (void **pp);
+
+/**
+ *
+ * @brief    Publishes a new pointer.
+ *
+ * Everything written to the object before the call is visible to the
+ * readers that load the pointer.
+ *
+ * @param[in]    pp              published pointer location.
+ * @param[in]    nv              new object.
+ * @return       void *          the replaced object, to retire.
+ */
+void *pth_rcu_publish (void **pp, void *nv);
+
+/**
+ *
+ * @brief    Waits for a grace period.
+ *
+ * Returns once every read section that started before the call has
+ * ended.
+ *
+ * @param[in]    rcu             domain.
+ * @return       int             CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_rcu_synchronize (pth_rcu_t *rcu);
+
+/**
+ *
+ * @brief    Reclaims an unpublished object after a grace period.
+ *
+ * Objects are queued and reclaimed by batches of CAF_PTH_RCU_BATCH, the
+ * call that fills a batch waits for its grace period.
+ *
+ * @param[in]    rcu             domain.
+ * @param[in]    ptr             object no longer reachable by new readers.
+ * @param[in]    del             callback freeing it, NULL for xfree.
+ * @return       int             CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_rcu_retire (pth_rcu_t *rcu, void *ptr, CAF_RCU_CBFREE(del));
+
+/**
+ *
+ * @brief    Reclaims every retired object now.
+ *
+ * @param[in]    rcu             domain.
+ * @return       int             CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_rcu_barrier (pth_rcu_t *rcu);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_RCU_H */
+/* caf_thread_rcu.h ends here */
@@ -27,6 +27,7 @@
 
 #include <pthread.h>
 #include <time.h>
+#include <caf/caf_thread_lprof.h>
 
 /**
  * @defgroup      caf_thread_rwlock    Thread Read/Write Locks
@@ -39,7 +40,16 @@
  * @version   $Revision$
  * @author    Daniel Molina Wegener <dmw@coder.cl>
  *
+ * Read/write locks wrapping pthread_rwlock_t. Setting PTHDR_RWLOCK_READER
+ * or PTHDR_RWLOCK_WRITER through pth_rwlattr_set switches the lock to a
+ * futex based implementation with bounded adaptive spinning. The reader
+ * mode admits readers whenever no writer holds the lock, so a steady
+ * stream of readers may starve writers. The writer mode stops admitting
+ * readers once a writer waits, and hands the lock over to waiting
+ * writers before readers.
  *
+ * Setting PTHDR_RWLOCK_PROFILE records the lock contention under the
+ * lock identifier, see caf_thread_lprof.
  *
  */
 
@@ -54,6 +64,8 @@ CAF_BEGIN_C_EXTERNS
                                         PTHDR_RWLOCK_WRLOCK | \
                                         PTHDR_RWLOCK_TRDLOCK | \
                                         PTHDR_RWLOCK_TWRLOCK)
+/** Writer bit of the futex lock state, the low bits count readers */
+#define CAF_PTH_RWLOCK_WRITER          0x40000000
 
 /**
  *
@@ -72,7 +84,13 @@ typedef enum {
 	/** timed read lock */
 	PTHDR_RWLOCK_TRDLOCK = 0000020,
 	/** timed write lock */
-	PTHDR_RWLOCK_TWRLOCK = 0000040
+	PTHDR_RWLOCK_TWRLOCK = 0000040,
+	/** reader-biased futex lock, data is the spin bound or zero */
+	PTHDR_RWLOCK_READER = 0000100,
+	/** writer-preferring futex lock, data is the spin bound or zero */
+	PTHDR_RWLOCK_WRITER = 0000200,
+	/** contention profiling under the lock id, data -1 stops it */
+	PTHDR_RWLOCK_PROFILE = 0000400
 } pth_rwlock_types_t;
 
 /**
@@ -98,6 +116,28 @@ struct pth_rwlock_s {
 	pthread_rwlockattr_t attr;
 	/** The Thread Mutex */
 	pthread_rwlock_t rwlock;
+	/** Lock kind, zero, PTHDR_RWLOCK_READER or PTHDR_RWLOCK_WRITER */
+	int kind;
+	/** Futex lock state, writer bit and reader count */
+	int state;
+	/** Writers waiting for the lock */
+	int wwant;
+	/** Readers parked on rseq */
+	int rsleep;
+	/** Writers parked on wseq */
+	int wsleep;
+	/** Reader wake up sequence */
+	int rseq;
+	/** Writer wake up sequence */
+	int wseq;
+	/** Running estimate of the polls needed to take the lock */
+	int spin;
+	/** Spin bound, zero parks at once */
+	int spin_max;
+	/** Contention profile, NULL when not profiled */
+	pth_lprof_t *prof;
+	/** Start of the sampled write hold, zero if none */
+	long long hold_start;
 };
 
 /**
@@ -208,8 +248,42 @@ int pth_rwlattr_set (pth_rwlock_t *rwl, pth_rwlock_types_t t, int data);
  * @see      pth_rwlock_t
  */
 int pth_rwlattr_get (pth_rwlock_t *rwl, pth_rwlock_types_t t, int *data);
+
+/**
+ *
+ * @brief    Write locks the given Caffeine RWLock Instance
+ *
+ * @param[in]    rwl             rwlock instance.
+ * @param[in]    tl              non zero to try the lock without waiting.
+ * @param[in]    to              absolute CLOCK_REALTIME timeout, or NULL.
+ * @return       int             CAF_OK on success, CAF_ERROR_SUB otherwise.
+ *
+ * @see      pth_rwlock_t
+ */
 int pth_rwl_wrlock (pth_rwlock_t *rwl, int tl, const struct timespec *to);
+
+/**
+ *
+ * @brief    Read locks the given Caffeine RWLock Instance
+ *
+ * @param[in]    rwl             rwlock instance.
+ * @param[in]    tl              non zero to try the lock without waiting.
+ * @param[in]    to              absolute CLOCK_REALTIME timeout, or NULL.
+ * @return       int             CAF_OK on success, CAF_ERROR_SUB otherwise.
+ *
+ * @see      pth_rwlock_t
+ */
 int pth_rwl_rdlock (pth_rwlock_t *rwl, int tl, const struct timespec *to);
+
+/**
+ *
+ * @brief    Releases a read or write lock on the given RWLock Instance
+ *
+ * @param[in]    rwl             rwlock instance.
+ * @return       int             CAF_OK on success, CAF_ERROR_SUB otherwise.
+ *
+ * @see      pth_rwlock_t
+ */
 int pth_rwl_unlock (pth_rwlock_t *rwl);
 
 #ifdef __cplusplus
@@ -0,0 +1,178 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+
+  $Id$
+*/
+#ifndef CAF_THREAD_SEQLOCK_H
+#define CAF_THREAD_SEQLOCK_H 1
+
+#include <stddef.h>
+
+/**
+ * @defgroup      caf_thread_seqlock    Thread Sequence Locks
+ * @ingroup       caf_thread
+ * @addtogroup    caf_thread_seqlock
+ * @{
+ *
+ * @brief     Thread Sequence Locks.
+ * @date      $Date$
+ * @version   $Revision$
+ * @author    Daniel Molina Wegener <dmw@coder.cl>
+ *
+ * Sequence locks protect small plain data snapshots read far more often
+ * than written. Readers never write shared memory, they read the
+ * sequence, copy the data and retry if a writer ran meanwhile, so they
+ * do not bounce a lock cache line between CPUs. Writers exclude each
+ * other and make the sequence odd while they write. The protected data
+ * must hold no pointers the reader follows, since a reader may see it
+ * torn before it retries.
+ *
+ */
+
+#ifdef __cplusplus
+CAF_BEGIN_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** Defines the pth_seqlock_t structure size */
+#define CAF_PTH_SEQLOCK_SZ        (sizeof (pth_seqlock_t))
+
+/**
+ *
+ * @brief    Caffeine Sequence Lock Type.
+ * @see      pth_seqlock_s
+ */
+typedef struct pth_seqlock_s pth_seqlock_t;
+/**
+ *
+ * @brief    Caffeine Sequence Lock Structure.
+ */
+struct pth_seqlock_s {
+	/** Lock identifier */
+	int id;
+	/** Sequence, odd while a writer is active */
+	int seq;
+	/** Spin bound before yielding */
+	int spin_max;
+};
+
+/**
+ *
+ * @brief    Creates a new sequence lock.
+ *
+ * @param[in]    id                lock identifier.
+ * @return       pth_seqlock_t *   the allocated lock, NULL on failure.
+ */
+pth_seqlock_t *pth_seql_new (int id);
+
+/**
+ *
+ * @brief    Deletes a sequence lock.
+ *
+ * @param[in]    sl                lock to delete.
+ */
+void pth_seql_delete (pth_seqlock_t *sl);
+
+/**
+ *
+ * @brief    Initializes a sequence lock in place.
+ *
+ * @param[in]    sl                lock to initialize.
+ * @param[in]    id                lock identifier.
+ * @return       int               CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_seql_init (pth_seqlock_t *sl, int id);
+
+/**
+ *
+ * @brief    Starts a read section.
+ *
+ * Waits until no writer is active and returns the sequence to check
+ * with pth_seql_read_retry.
+ *
+ * @param[in]    sl                sequence lock.
+ * @return       int               the even sequence read.
+ */
+int pth_seql_read_begin (pth_seqlock_t *sl);
+
+/**
+ *
+ * @brief    Ends a read section.
+ *
+ * @param[in]    sl                sequence lock.
+ * @param[in]    seq               value returned by pth_seql_read_begin.
+ * @return       int               non zero if a writer ran and the read
+ *                                 must be done again.
+ */
+int pth_seql_read_retry (pth_seqlock_t *sl, int seq);
+
+/**
+ *
+ * @brief    Starts a write section, excluding other writers.
+ *
+ * @param[in]    sl                sequence lock.
+ * @return       int               CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_seql_wrlock (pth_seqlock_t *sl);
+
+/**
+ *
+ * @brief    Ends a write section.
+ *
+ * @param[in]    sl                sequence lock.
+ * @return       int               CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_seql_wrunlock (pth_seqlock_t *sl);
+
+/**
+ *
+ * @brief    Copies a consistent snapshot of the protected data.
+ *
+ * Retries until no writer overlapped the copy. The copy is done with
+ * relaxed atomic loads, so it is well defined while writers run.
+ *
+ * @param[in]    sl                sequence lock.
+ * @param[out]   dst               snapshot destination.
+ * @param[in]    src               protected data.
+ * @param[in]    sz                data size.
+ * @return       int               CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_seql_read (pth_seqlock_t *sl, void *dst, const void *src, size_t sz);
+
+/**
+ *
+ * @brief    Replaces the protected data under the write lock.
+ *
+ * @param[in]    sl                sequence lock.
+ * @param[out]   dst               protected data.
+ * @param[in]    src               new contents.
+ * @param[in]    sz                data size.
+ * @return       int               CAF_OK on success, CAF_ERROR otherwise.
+ */
+int pth_seql_write (pth_seqlock_t *sl, void *dst, const void *src, size_t sz);
+
+#ifdef __cplusplus
+CAF_END_C_EXTERNS
+#endif /* !__cplusplus */
+
+/** }@ */
+#endif /* !CAF_THREAD_SEQLOCK_H */
+/* caf_thread_seqlock.h ends here */
@@ -0,0 +1,43 @@
+/* -*- mode: c; c-default-style: "k&r"; indent-tabs-mode: nil; -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 expandtab: */
+/* kate: space-indent on; indent-width 4; mixedindent off; indent-mode cstyle; */
+#ifndef _CAF_CONFIG_H
+#define _CAF_CONFIG_H 1
+
+#define        STDC_HEADERS                1
+
+#define        HAVE_STDDEF_H               1
+#define        HAVE_STDBOOL_H              1
+
+#define        HAVE_MALLOC_H               1
+#define        HAVE_STRINGS_H              1
+#define        HAVE_MEMORY_H               1
+#define        HAVE_SYS_TYPES_H            1
+
+#define        HAVE_UNISTD_H               1
+#define        HAVE_SYS_UIO_H              1
+
+#define        HAVE_FCNTL_H                1
+
+#define        HAVE_DLFCN_H                1
+
+#define        HAVE_AIO_H                  1
+
+#define        CADDR_T_SZ                  8
+#define        OFF_T_SZ                    8
+
+#define        SIZE_T_SZ                   8
+#define        VOID_P_SZ                   8
+
+/* #undef HAVE_DLFUNC_T */
+/* #undef HAVE_DLFUNC_SZ */
+/* #undef HAVE_DLFUNC */
+
+/* #undef HAVE_AIO_WAITCOMPLETE */
+
+#if SIZE_T_SZ != VOID_P_SZ
+#error strange compiler behavoir: sizeof(void *) != sizeof(size_t)
+#endif /* SIZE_T_SZ == VOID_P_SZ */
+
+#endif /* _CAF_CONFIG_H */
+/* config.h ends here */
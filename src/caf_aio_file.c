@@ -181,6 +181,11 @@ caf_aio_read (caf_aio_file_t *r, cbuffer_t *b) {
 	if (r != (caf_aio_file_t *)NULL
 		&& b != (cbuffer_t *)NULL
 		&& (r->fd >= 0 && (b->sz > 0 || b->iosz > 0))) {
+		/* the read lands in r->buf, it must not reach its slices */
+		if (cbuf_own (r->buf) != CAF_OK) {
+			return -1;
+		}
+		r->iocb.aio_buf = r->buf->data;
 		prev_errno = errno;
 		errno = 0;
 		rd = aio_read (&(r->iocb));
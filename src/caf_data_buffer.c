@@ -33,20 +33,49 @@ static char Id[] = "$Id$";
 #include <string.h>
 #include <unistd.h>
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif /* !__SSE2__ */
+
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
 #include "caf/caf_data_buffer.h"
 
+/* longest pattern searched by its first and last bytes */
+#define CAF_BUFF_SEARCH_SHORT    16
+
+/* a pattern prepared for cbuf_find */
+typedef struct cbuf_finder_s cbuf_finder_t;
+struct cbuf_finder_s {
+	const unsigned char *p;
+	size_t m;
+	size_t skip[256];
+};
+
+static void cbuf_finder_init (cbuf_finder_t *f, const void *p, size_t m);
+static size_t cbuf_find (const cbuf_finder_t *f, const unsigned char *h,
+						 size_t n);
+static size_t cbuf_find_short (const unsigned char *h, size_t n,
+							   const unsigned char *p, size_t m);
+static void *cbuf_data_alloc (cbuffer_t *buf, size_t sz);
+static void *cbuf_data_resize (cbuffer_t *buf, size_t sz);
+static cbuffer_t *cbuf_new_like (const cbuffer_t *src);
+static int cbuf_store_new (cbuffer_t *buf);
+static void cbuf_store_release (cbuf_store_t *store, caf_arena_t *arena);
+static deque_t *cbuf_split_pieces (cbuffer_t *src, const void *pattern,
+								   size_t patsz, int view);
 
 
 cbuffer_t *
 cbuf_new (void) {
 	cbuffer_t *buf;
-	buf = (cbuffer_t *)xmalloc (CAF_BUFF_SZ);
+	buf = (cbuffer_t *)xobjalloc (CAF_BUFF_SZ);
 	if (buf != (cbuffer_t *)NULL) {
 		buf->sz = 0;
 		buf->iosz = 0;
 		buf->data = (void *)NULL;
+		buf->arena = (caf_arena_t *)NULL;
+		buf->store = (cbuf_store_t *)NULL;
 	}
 	return buf;
 }
@@ -55,8 +84,10 @@ cbuf_new (void) {
 cbuffer_t *
 cbuf_create (size_t sz) {
 	cbuffer_t *buf;
-	buf = (cbuffer_t *)xmalloc (CAF_BUFF_SZ);
+	buf = (cbuffer_t *)xobjalloc (CAF_BUFF_SZ);
 	if (buf != (cbuffer_t *)NULL) {
+		buf->arena = (caf_arena_t *)NULL;
+		buf->store = (cbuf_store_t *)NULL;
 		if (sz > 0) {
 			buf->sz = sz;
 			buf->iosz = 0;
@@ -64,7 +95,7 @@ cbuf_create (size_t sz) {
 			if (buf->data != (void *)NULL) {
 				return buf;
 			} else {
-				xfree (buf);
+				xobjfree (buf, CAF_BUFF_SZ);
 				return (void *)NULL;
 			}
 		} else {
@@ -77,15 +108,55 @@ cbuf_create (size_t sz) {
 }
 
 
+cbuffer_t *
+cbuf_new_arena (caf_arena_t *arena) {
+	cbuffer_t *buf;
+	buf = (cbuffer_t *)caf_arena_alloc (arena, CAF_BUFF_SZ);
+	if (buf != (cbuffer_t *)NULL) {
+		buf->sz = 0;
+		buf->iosz = 0;
+		buf->data = (void *)NULL;
+		buf->arena = arena;
+		buf->store = (cbuf_store_t *)NULL;
+	}
+	return buf;
+}
+
+
+cbuffer_t *
+cbuf_create_arena (caf_arena_t *arena, size_t sz) {
+	cbuffer_t *buf;
+	buf = cbuf_new_arena (arena);
+	if (buf != (cbuffer_t *)NULL && sz > 0) {
+		buf->data = caf_arena_alloc (arena, sz);
+		if (buf->data == (void *)NULL) {
+			return (cbuffer_t *)NULL;
+		}
+		buf->sz = sz;
+	}
+	return buf;
+}
+
+
 void
 cbuf_delete (cbuffer_t *buf) {
+	if (buf != (cbuffer_t *)NULL && buf->arena != (caf_arena_t *)NULL) {
+		buf->sz = 0;
+		buf->data = (void *)NULL;
+		buf->store = (cbuf_store_t *)NULL;
+		return;
+	}
 	if (buf != (cbuffer_t *)NULL) {
-		if (buf->data != (void *)NULL) {
+		if (buf->store != (cbuf_store_t *)NULL) {
+			cbuf_store_release (buf->store, buf->arena);
+			buf->store = (cbuf_store_t *)NULL;
+			buf->data = (void *)NULL;
+		} else if (buf->data != (void *)NULL) {
 			xfree (buf->data);
 			buf->data = (void *)NULL;
 		}
 		buf->sz = 0;
-		xfree (buf);
+		xobjfree (buf, CAF_BUFF_SZ);
 		buf = (cbuffer_t *)NULL;
 	}
 }
@@ -94,9 +165,11 @@ cbuf_delete (cbuffer_t *buf) {
 int
 cbuf_delete_interactive (cbuffer_t *buf,
 						 CAF_BUFF_DELETE_CB(cb)) {
-	if (buf != (cbuffer_t *)NULL) {
+	if (buf != (cbuffer_t *)NULL && cbuf_own (buf) == CAF_OK) {
 		if ((cb (buf->data, buf->sz)) == 0) {
-			xfree (buf);
+			if (buf->arena == (caf_arena_t *)NULL) {
+				xobjfree (buf, CAF_BUFF_SZ);
+			}
 			return CAF_OK;
 		}
 	}
@@ -113,7 +186,7 @@ cbuf_delete_callback (void *cbuf) {
 
 void
 cbuf_clean (cbuffer_t *buf) {
-	if (buf != (cbuffer_t *)NULL) {
+	if (buf != (cbuffer_t *)NULL && cbuf_own (buf) == CAF_OK) {
 		xempty(buf->data, buf->sz);
 		buf->iosz = 0;
 	}
@@ -123,16 +196,17 @@ cbuf_clean (cbuffer_t *buf) {
 size_t
 cbuf_copy (cbuffer_t *dst, const cbuffer_t *src) {
 	void *new_ptr = (void *)NULL;
-	if (src != (cbuffer_t *)NULL && dst != (cbuffer_t *)NULL) {
+	if (src != (cbuffer_t *)NULL && dst != (cbuffer_t *)NULL
+		&& cbuf_own (dst) == CAF_OK) {
 		if (src->sz > 0 && src->data != (void *)NULL) {
 			if (dst->sz > 0 && dst->data != (void *)NULL) {
 				cbuf_clean(dst);
-				dst->data = xrealloc (dst->data, src->sz);
+				dst->data = cbuf_data_resize (dst, src->sz);
 				if (dst->data == (void *)NULL) {
 					return 0;
 				}
 			} else if (dst->data != (void *)NULL) {
-				new_ptr = xrealloc(dst->data, src->sz);
+				new_ptr = cbuf_data_resize (dst, src->sz);
 				if (new_ptr != (void *)NULL) {
 					xempty(new_ptr, src->sz);
 					dst->data = new_ptr;
@@ -141,7 +215,7 @@ cbuf_copy (cbuffer_t *dst, const cbuffer_t *src) {
 					return 0;
 				}
 			} else {
-				dst->data = xmalloc(src->sz);
+				dst->data = cbuf_data_alloc (dst, src->sz);
 				if (dst->data == (void *)NULL) {
 					return 0;
 				}
@@ -161,15 +235,15 @@ size_t
 cbuf_import (cbuffer_t *dst, const void *data,
 			 const size_t sz) {
 	if (data != (void *)NULL && dst
-		!= (cbuffer_t *)NULL && sz > 0) {
+		!= (cbuffer_t *)NULL && sz > 0 && cbuf_own (dst) == CAF_OK) {
 		cbuf_clean(dst);
 		if (dst->data != (void *)NULL) {
-			dst->data = xrealloc (dst->data, sz);
+			dst->data = cbuf_data_resize (dst, sz);
 			if (dst->data == (void *)NULL) {
 				return 0;
 			}
 		} else {
-			dst->data = xmalloc(sz);
+			dst->data = cbuf_data_alloc (dst, sz);
 			if (dst->data == (void *)NULL) {
 				return 0;
 			}
@@ -194,7 +268,7 @@ cbuf_extract (const cbuffer_t *src, const size_t from,
 		if (from > to) {
 			return (cbuffer_t *)NULL;
 		} else {
-			ret = cbuf_new();
+			ret = cbuf_new_like (src);
 			cbuf_clean(ret);
 			b_ptr = (void *)((size_t)src->data + from);
 			diff = to - from;
@@ -217,7 +291,7 @@ cbuf_cut (cbuffer_t *src, const size_t from,
 	void *final = (void *)NULL;
 	size_t diff = 0, trailing = 0, final_sz = 0;
 	void *sptr = (void *)NULL, *eptr = (void *)NULL;
-	if (src != (cbuffer_t *)NULL) {
+	if (src != (cbuffer_t *)NULL && cbuf_own (src) == CAF_OK) {
 		if (from < to) {
 			newb = cbuf_extract(src, from, to);
 			if (newb != (cbuffer_t *)NULL) {
@@ -229,7 +303,7 @@ cbuf_cut (cbuffer_t *src, const size_t from,
 					trailing = src->sz - to;
 					final = xmemcpy(eptr, sptr, trailing);
 					if (final != (void *)NULL) {
-						final = xrealloc(src->data, final_sz);
+						final = cbuf_data_resize (src, final_sz);
 						if (final != (void *)NULL) {
 							src->data = final;
 							src->sz = final_sz;
@@ -255,7 +329,8 @@ cbuf_paste (cbuffer_t *dst, const cbuffer_t *src,
 			const size_t to_src) {
 	size_t diff_src = 0, diff_dst = 0;
 	void *from_ptr = (void *)NULL, *to_ptr = (void *)NULL;
-	if (dst != (cbuffer_t *)NULL && src != (cbuffer_t *)NULL) {
+	if (dst != (cbuffer_t *)NULL && src != (cbuffer_t *)NULL
+		&& cbuf_own (dst) == CAF_OK) {
 		if ((int)from_dst < 0 ||
 			((int)to_src < 0 || (int)from_src < 0)) {
 			return (cbuffer_t *)NULL;
@@ -281,36 +356,45 @@ cbuf_paste (cbuffer_t *dst, const cbuffer_t *src,
 
 deque_t *
 cbuf_split (cbuffer_t *src, const void *pattern, size_t patsz) {
+	return cbuf_split_pieces (src, pattern, patsz, 0);
+}
+
+
+deque_t *
+cbuf_split_slice (cbuffer_t *src, const void *pattern, size_t patsz) {
+	return cbuf_split_pieces (src, pattern, patsz, 1);
+}
+
+
+static deque_t *
+cbuf_split_pieces (cbuffer_t *src, const void *pattern, size_t patsz,
+				   int view) {
 	cbuffer_t *current = (cbuffer_t *)NULL;
 	deque_t *lst = (deque_t *)NULL;
-	size_t idx = 0, idx_current = 0, idx_over = 0, idx_tail = 0;
-	size_t btop = 0;
+	cbuf_finder_t f;
+	size_t idx = 0, idx_tail = 0;
 	if (src != (cbuffer_t *)NULL && pattern != (void *)NULL) {
-		lst = deque_create ();
-		btop = ((size_t)src->data) + src->sz;
-		idx_current = ((size_t)src->data);
-		idx_over = ((size_t)src->data) + (idx + patsz);
-		idx_tail = 0;
-		while (idx_current < btop) {
-			if (idx_over < btop) {
-				if (memcmp ((void *)idx_current, pattern, patsz) == 0) {
-					current = cbuf_extract (src, idx_tail, idx);
-					if (current != (cbuffer_t *)NULL) {
-						deque_push (lst, current);
-					}
-					idx += patsz;
-					idx_tail = idx;
-				}
-			} else {
-				current = cbuf_extract (src, idx_tail, src->sz);
+		if (src->arena != (caf_arena_t *)NULL) {
+			lst = deque_create_arena (src->arena);
+		} else {
+			lst = deque_create ();
+		}
+		if (lst == (deque_t *)NULL || src->data == (void *)NULL) {
+			return lst;
+		}
+		cbuf_finder_init (&f, pattern, patsz);
+		while (idx_tail < src->sz) {
+			idx = idx_tail + cbuf_find (&f, (unsigned char *)src->data
+										+ idx_tail, src->sz - idx_tail);
+			/* empty pieces between adjacent patterns are skipped */
+			if (idx > idx_tail) {
+				current = view ? cbuf_slice (src, idx_tail, idx)
+					: cbuf_extract (src, idx_tail, idx);
 				if (current != (cbuffer_t *)NULL) {
 					deque_push (lst, current);
 				}
-				idx = btop;
 			}
-			idx++;
-			idx_current = ((size_t)src->data) + (idx);
-			idx_over = ((size_t)src->data) + (idx + patsz);
+			idx_tail = idx + patsz;
 		}
 	}
 	return lst;
@@ -365,62 +449,61 @@ cbuf_join (deque_t *lst) {
 cbuffer_t *
 cbuf_replace (cbuffer_t *src, void *srch, void *repl, size_t srchsz,
               size_t replsz) {
-	cbuffer_t *buffer, *current;
-	deque_t *lst;
-	caf_dequen_t *n;
-	size_t idx = 0, idx_current = 0, idx_over = 0, idx_tail = 0;
-	size_t btop = 0, btotal = 0, count = 0;
-	if (src != (cbuffer_t *)NULL && srch != (void *)NULL) {
-		btotal = src->sz;
-		btop = (size_t)src->data + (size_t)src->sz;
-		idx_current = ((size_t)src->data);
-		idx_over = ((size_t)src->data) + srchsz;
-		lst = deque_create ();
-		while (idx_current < btop) {
-			if (idx_over <= btop) {
-				if (memcmp ((void *)idx_current, srch, srchsz) == 0) {
-					current = cbuf_extract (src, idx_tail,
-											idx_tail + srchsz);
-					if (current != (cbuffer_t *)NULL) {
-						deque_push (lst, (void *)idx_current);
-						cbuf_delete (current);
-						count++;
-					}
-					idx += srchsz;
-					idx_tail = idx;
-				}
-			} else {
-				idx = btop;
+	cbuffer_t *buffer;
+	cbuf_finder_t f;
+	void *data;
+	size_t idx = 0, idx_tail = 0, len = 0, cap, need;
+	if (src == (cbuffer_t *)NULL || srch == (void *)NULL || srchsz == 0
+		|| (repl == (void *)NULL && replsz > 0)) {
+		return (cbuffer_t *)NULL;
+	}
+	if (src->sz == 0 || src->data == (void *)NULL) {
+		return cbuf_create (0);
+	}
+	/* one pass, the output only grows when replsz > srchsz */
+	cap = src->sz;
+	buffer = cbuf_create (cap);
+	if (buffer == (cbuffer_t *)NULL) {
+		return (cbuffer_t *)NULL;
+	}
+	cbuf_finder_init (&f, srch, srchsz);
+	while (idx_tail <= src->sz) {
+		idx = idx_tail + cbuf_find (&f, (unsigned char *)src->data
+									+ idx_tail, src->sz - idx_tail);
+		need = len + (idx - idx_tail) + (idx < src->sz ? replsz : 0);
+		if (need > cap) {
+			while (cap < need) {
+				cap *= 2;
+			}
+			data = xrealloc (buffer->data, cap);
+			if (data == (void *)NULL) {
+				cbuf_delete (buffer);
+				return (cbuffer_t *)NULL;
 			}
-			idx++;
-			idx_current = ((size_t)src->data) + (idx);
-			idx_over = ((size_t)src->data) + (idx + srchsz);
+			buffer->data = data;
 		}
-	} else {
-		return (cbuffer_t *)NULL;
+		memcpy ((char *)buffer->data + len, (char *)src->data + idx_tail,
+				idx - idx_tail);
+		len += idx - idx_tail;
+		if (idx >= src->sz) {
+			break;
+		}
+		if (replsz > 0) {
+			memcpy ((char *)buffer->data + len, repl, replsz);
+			len += replsz;
+		}
+		idx_tail = idx + srchsz;
 	}
-	btotal = (btotal - count * srchsz) + count * replsz;
-	buffer = cbuf_create (btotal);
-	if (buffer != (cbuffer_t *)NULL && lst != (deque_t *)NULL) {
-		btop = (size_t)src->data + (size_t)src->sz;
-		idx = (size_t)src->data;
-		idx_current = (size_t)buffer->data;
-		n = lst->head;
-		while (n != (caf_dequen_t *)NULL) {
-			btotal = ((size_t)n->data - idx); /* idx is src */
-			btop = idx_current + btotal; /* btop is dst */
-			memcpy ((void *)idx_current, (void *)idx, btotal);
-			memcpy ((void *)btop, (void *)repl, replsz);
-			idx += (btotal + srchsz); /* btop is src */
-			idx_current += (btotal + replsz); /* idx_current is dst */
-			n = n->next;
-		}
-		count = (size_t)src->data + src->sz;
-		if (idx < count) {
-			memcpy ((void *)idx_current, (void *)idx, (count - idx));
-		}
-	}
-	deque_delete_nocb (lst);
+	if (len == 0) {
+		xfree (buffer->data);
+		buffer->data = (void *)NULL;
+	} else if (len < cap) {
+		data = xrealloc (buffer->data, len);
+		if (data != (void *)NULL) {
+			buffer->data = data;
+		}
+	}
+	buffer->sz = len;
 	return buffer;
 }
 
@@ -433,7 +516,8 @@ cbuf_append (cbuffer_t *head, cbuffer_t *tail)
 	if (head != (cbuffer_t *)NULL && tail != (cbuffer_t *)NULL) {
 		if (head->iosz > 0 && tail->iosz > 0) {
 			tsz = (size_t)head->iosz + (size_t)tail->iosz;
-			r = cbuf_create (tsz);
+			r = head->arena != (caf_arena_t *)NULL
+				? cbuf_create_arena (head->arena, tsz) : cbuf_create (tsz);
 			if (r != (cbuffer_t *)NULL) {
 				cbuf_clean (r);
 				xmemcpy (r->data, head->data, head->iosz);
@@ -442,7 +526,8 @@ cbuf_append (cbuffer_t *head, cbuffer_t *tail)
 			}
 		} else {
 			tsz = head->sz + tail->sz;
-			r = cbuf_create (tsz);
+			r = head->arena != (caf_arena_t *)NULL
+				? cbuf_create_arena (head->arena, tsz) : cbuf_create (tsz);
 			if (r != (cbuffer_t *)NULL) {
 				cbuf_clean (r);
 				xmemcpy (r->data, head->data, head->sz);
@@ -458,26 +543,23 @@ cbuf_append (cbuffer_t *head, cbuffer_t *tail)
 deque_t *
 cbuf_search (cbuffer_t *src, void *srch, size_t srchsz) {
 	deque_t *lst;
-	size_t idx = 0, idx_current = 0, idx_over = 0, idx_tail = 0;
-	size_t btop = 0;
+	cbuf_finder_t f;
+	size_t idx = 0, idx_tail = 0;
 	if (src != (cbuffer_t *)NULL && srch != (void *)NULL) {
-		btop = (size_t)src->data + (size_t)src->sz;
-		idx_current = ((size_t)src->data);
-		idx_over = ((size_t)src->data) + srchsz;
 		lst = deque_create ();
-		while (idx_current < btop) {
-			if (idx_over <= btop) {
-				if (memcmp ((void *)idx_current, srch, srchsz) == 0) {
-					deque_push (lst, (void *)idx_current);
-					idx_tail = idx_current;
-					idx_current += srchsz;
-				} else {
-					idx_current++;
-				}
-			} else {
-				idx = btop;
+		if (lst == (deque_t *)NULL || src->data == (void *)NULL
+			|| srchsz == 0) {
+			return lst;
+		}
+		cbuf_finder_init (&f, srch, srchsz);
+		while (idx_tail < src->sz) {
+			idx = idx_tail + cbuf_find (&f, (unsigned char *)src->data
+										+ idx_tail, src->sz - idx_tail);
+			if (idx >= src->sz) {
+				break;
 			}
-			idx_over = idx_current + srchsz;
+			deque_push (lst, (void *)((size_t)src->data + idx));
+			idx_tail = idx + srchsz;
 		}
 		return lst;
 	}
@@ -532,5 +614,209 @@ cbuf_tail_cut (cbuffer_t *src, size_t sz) {
 	return ret;
 }
 
+
+cbuffer_t *
+cbuf_slice (cbuffer_t *src, const size_t from, const size_t to) {
+	cbuffer_t *ret;
+	if (src == (cbuffer_t *)NULL || src->data == (void *)NULL
+		|| from >= to || to > src->sz) {
+		return (cbuffer_t *)NULL;
+	}
+	if (src->store == (cbuf_store_t *)NULL && cbuf_store_new (src) != CAF_OK) {
+		return (cbuffer_t *)NULL;
+	}
+	ret = cbuf_new_like (src);
+	if (ret != (cbuffer_t *)NULL) {
+		__atomic_add_fetch (&(src->store->refs), 1, __ATOMIC_RELAXED);
+		ret->store = src->store;
+		ret->data = (void *)((size_t)src->data + from);
+		ret->sz = to - from;
+	}
+	return ret;
+}
+
+
+int
+cbuf_own (cbuffer_t *buf) {
+	cbuf_store_t *store;
+	void *data = (void *)NULL;
+	if (buf == (cbuffer_t *)NULL) {
+		return CAF_ERROR;
+	}
+	store = buf->store;
+	if (store == (cbuf_store_t *)NULL) {
+		return CAF_OK;
+	}
+	if (__atomic_load_n (&(store->refs), __ATOMIC_ACQUIRE) == 1
+		&& buf->data == store->data) {
+		/* the last reference keeps the allocation */
+		buf->store = (cbuf_store_t *)NULL;
+		if (buf->arena == (caf_arena_t *)NULL) {
+			xobjfree (store, CAF_BUFF_STORE_SZ);
+		}
+		return CAF_OK;
+	}
+	if (buf->sz > 0) {
+		data = cbuf_data_alloc (buf, buf->sz);
+		if (data == (void *)NULL) {
+			return CAF_ERROR;
+		}
+		memcpy (data, buf->data, buf->sz);
+	}
+	buf->store = (cbuf_store_t *)NULL;
+	buf->data = data;
+	cbuf_store_release (store, buf->arena);
+	return CAF_OK;
+}
+
+
+static void
+cbuf_finder_init (cbuf_finder_t *f, const void *p, size_t m) {
+	size_t i;
+	f->p = (const unsigned char *)p;
+	f->m = m;
+	if (m <= CAF_BUFF_SEARCH_SHORT) {
+		return;
+	}
+	/* Horspool shifts, by the last byte of the window */
+	for (i = 0; i < 256; i++) {
+		f->skip[i] = m;
+	}
+	for (i = 0; i < m - 1; i++) {
+		f->skip[f->p[i]] = m - 1 - i;
+	}
+}
+
+
+/* offset of the first occurrence of the pattern, n if none */
+static size_t
+cbuf_find (const cbuf_finder_t *f, const unsigned char *h, size_t n) {
+	const unsigned char *p = f->p, *r;
+	size_t m = f->m, i = 0;
+	unsigned char last;
+	if (m == 0 || m > n) {
+		return n;
+	}
+	if (m == 1) {
+		r = (const unsigned char *)memchr (h, p[0], n);
+		return r != (const unsigned char *)NULL ? (size_t)(r - h) : n;
+	}
+	if (m <= CAF_BUFF_SEARCH_SHORT) {
+		return cbuf_find_short (h, n, p, m);
+	}
+	last = p[m - 1];
+	while (i <= n - m) {
+		if (h[i + m - 1] == last && memcmp (h + i, p, m - 1) == 0) {
+			return i;
+		}
+		i += f->skip[h[i + m - 1]];
+	}
+	return n;
+}
+
+
+/*
+ * Candidates must match the first and the last byte of the pattern,
+ * tested sixteen positions at a time with SSE2, or found with memchr.
+ */
+static size_t
+cbuf_find_short (const unsigned char *h, size_t n, const unsigned char *p,
+				 size_t m) {
+	const unsigned char *s = h, *e = h + (n - m + 1);
+	size_t i = 0;
+#if defined(__GNUC__) && defined(__SSE2__)
+	const __m128i first = _mm_set1_epi8 ((char)p[0]);
+	const __m128i last = _mm_set1_epi8 ((char)p[m - 1]);
+	__m128i a, b;
+	unsigned int mask;
+	for (; i + m - 1 + 16 <= n; i += 16) {
+		a = _mm_loadu_si128 ((const __m128i *)(h + i));
+		b = _mm_loadu_si128 ((const __m128i *)(h + i + m - 1));
+		mask = (unsigned int)_mm_movemask_epi8 (
+			_mm_and_si128 (_mm_cmpeq_epi8 (a, first),
+						   _mm_cmpeq_epi8 (b, last)));
+		while (mask != 0) {
+			if (memcmp (h + i + __builtin_ctz (mask) + 1, p + 1, m - 2) == 0) {
+				return i + (size_t)__builtin_ctz (mask);
+			}
+			mask &= mask - 1;
+		}
+	}
+	s = h + i;
+#endif /* !__SSE2__ */
+	while (s < e) {
+		s = (const unsigned char *)memchr (s, p[0], (size_t)(e - s));
+		if (s == (const unsigned char *)NULL) {
+			break;
+		}
+		if (s[m - 1] == p[m - 1] && memcmp (s + 1, p + 1, m - 2) == 0) {
+			return (size_t)(s - h);
+		}
+		s++;
+	}
+	return n;
+}
+
+
+static void *
+cbuf_data_alloc (cbuffer_t *buf, size_t sz) {
+	if (buf->arena != (caf_arena_t *)NULL) {
+		return caf_arena_alloc (buf->arena, sz);
+	}
+	return xmalloc (sz);
+}
+
+
+static void *
+cbuf_data_resize (cbuffer_t *buf, size_t sz) {
+	if (buf->arena != (caf_arena_t *)NULL) {
+		return caf_arena_realloc (buf->arena, buf->data, buf->sz, sz);
+	}
+	return xrealloc (buf->data, sz);
+}
+
+
+static cbuffer_t *
+cbuf_new_like (const cbuffer_t *src) {
+	if (src->arena != (caf_arena_t *)NULL) {
+		return cbuf_new_arena (src->arena);
+	}
+	return cbuf_new ();
+}
+
+
+/* moves the data of a buffer into a store, the buffer holds a reference */
+static int
+cbuf_store_new (cbuffer_t *buf) {
+	cbuf_store_t *store;
+	if (buf->arena != (caf_arena_t *)NULL) {
+		store = (cbuf_store_t *)caf_arena_alloc (buf->arena,
+												 CAF_BUFF_STORE_SZ);
+	} else {
+		store = (cbuf_store_t *)xobjalloc (CAF_BUFF_STORE_SZ);
+	}
+	if (store == (cbuf_store_t *)NULL) {
+		return CAF_ERROR;
+	}
+	store->refs = 1;
+	store->sz = buf->sz;
+	store->data = buf->data;
+	buf->store = store;
+	return CAF_OK;
+}
+
+
+static void
+cbuf_store_release (cbuf_store_t *store, caf_arena_t *arena) {
+	/* arena stores go away with the arena */
+	if (arena != (caf_arena_t *)NULL) {
+		return;
+	}
+	if (__atomic_sub_fetch (&(store->refs), 1, __ATOMIC_ACQ_REL) == 0) {
+		xfree (store->data);
+		xobjfree (store, CAF_BUFF_STORE_SZ);
+	}
+}
+
 /* caf_data_buffer.c ends here */
 
@@ -36,6 +36,8 @@ static char Id[] = "$Id: caf_data_lstdl.c 8 2007-05-03 00:50:25Z damowe $";
 #include "caf/caf_data_mem.h"
 #include "caf/caf_data_cdeque.h"
 
+static caf_cdequen_t *cdeque_node_alloc (cdeque_t *lst);
+
 
 cdeque_t *
 cdeque_new (void *data) {
@@ -53,6 +55,7 @@ cdeque_new (void *data) {
 			lst->head = n;
 			lst->tail = n;
 			lst->size = 1;
+			lst->pool = (caf_npool_t *)NULL;
 		} else {
 			free (lst);
 			lst = (cdeque_t *)NULL;
@@ -71,11 +74,42 @@ cdeque_create (void) {
 		lst->head = (caf_cdequen_t *)NULL;
 		lst->tail = (caf_cdequen_t *)NULL;
 		lst->size = 0;
+		lst->pool = (caf_npool_t *)NULL;
+	}
+	return lst;
+}
+
+
+cdeque_t *
+cdeque_create_pool (caf_npool_t *pool) {
+	cdeque_t *lst;
+	lst = cdeque_create ();
+	if (lst != (cdeque_t *)NULL) {
+		lst->pool = pool;
 	}
 	return lst;
 }
 
 
+static caf_cdequen_t *
+cdeque_node_alloc (cdeque_t *lst) {
+	if (lst->pool != (caf_npool_t *)NULL) {
+		return (caf_cdequen_t *)caf_npool_get (lst->pool);
+	}
+	return (caf_cdequen_t *)xmalloc (CAF_LSTDLCNODE_SZ);
+}
+
+
+void
+cdeque_node_release (cdeque_t *lst, caf_cdequen_t *n) {
+	if (lst != (cdeque_t *)NULL && lst->pool != (caf_npool_t *)NULL) {
+		caf_npool_put (lst->pool, n);
+	} else {
+		xfree (n);
+	}
+}
+
+
 int
 cdeque_delete (cdeque_t *lst, CAF_LSTDLCNODE_CBDEL(del)) {
 	caf_cdequen_t *cur, *destroy;
@@ -87,7 +121,7 @@ cdeque_delete (cdeque_t *lst, CAF_LSTDLCNODE_CBDEL(del)) {
 				return CAF_OK;
 			} else if (cdeque_oneitem_list (lst) == CAF_OK) {
 				if (del (lst->head->data) == CAF_OK) {
-					xfree (lst->head);
+					cdeque_node_release (lst, lst->head);
 					xfree (lst);
 					return CAF_OK;
 				}
@@ -97,20 +131,21 @@ cdeque_delete (cdeque_t *lst, CAF_LSTDLCNODE_CBDEL(del)) {
 					if ((del (cur->data)) == CAF_OK) {
 						destroy = cur;
 						cur = cur->next;
-						xfree(destroy);
+						cdeque_node_release (lst, destroy);
 					} else {
 						lst->head = cur;
 						return CAF_ERROR;
 					}
 				} while (cur != lst->tail);
 				if (del (lst->tail->data) == CAF_OK) {
-					xfree (lst->tail);
+					cdeque_node_release (lst, lst->tail);
 				}
 				xfree(lst);
 				lst = (cdeque_t *)NULL;
 				return CAF_OK;
 			}
 		} else {
+			xfree (lst);
 			return CAF_OK;
 		}
 	}
@@ -128,7 +163,7 @@ cdeque_delete_nocb (cdeque_t *lst) {
 				xfree (lst);
 				return CAF_OK;
 			} else if (cdeque_oneitem_list (lst) == CAF_OK) {
-				xfree (lst->head);
+				cdeque_node_release (lst, lst->head);
 				xfree (lst);
 				return CAF_OK;
 			} else {
@@ -136,13 +171,14 @@ cdeque_delete_nocb (cdeque_t *lst) {
 				do {
 					destroy = cur;
 					cur = cur->next;
-					xfree(destroy);
+					cdeque_node_release (lst, destroy);
 				} while (cur != lst->tail);
-				xfree (lst->tail);
+				cdeque_node_release (lst, lst->tail);
 				xfree (lst);
 				return CAF_OK;
 			}
 		} else {
+			xfree (lst);
 			return CAF_OK;
 		}
 	}
@@ -162,7 +198,7 @@ cdeque_node_delete (cdeque_t *lst, caf_cdequen_t *n, CAF_LSTDLCNODE_CBDEL(del))
 				return CAF_ERROR;
 			} else if (cdeque_oneitem_list (lst) == CAF_OK) {
 				if ((del (lst->head->data)) == CAF_OK) {
-					xfree (lst->head);
+					cdeque_node_release (lst, lst->head);
 					lst->head = (caf_cdequen_t *)NULL;
 					lst->tail = (caf_cdequen_t *)NULL;
 					return CAF_OK;
@@ -174,7 +210,7 @@ cdeque_node_delete (cdeque_t *lst, caf_cdequen_t *n, CAF_LSTDLCNODE_CBDEL(del))
 						next = nr->next;
 						prev->next = next;
 						next->prev = prev;
-						xfree (nr);
+						cdeque_node_release (lst, nr);
 						lst->size--;
 						lst->head = next;
 						return CAF_OK;
@@ -185,7 +221,7 @@ cdeque_node_delete (cdeque_t *lst, caf_cdequen_t *n, CAF_LSTDLCNODE_CBDEL(del))
 						next = nr->next;
 						prev->next = next;
 						next->prev = prev;
-						xfree (nr);
+						cdeque_node_release (lst, nr);
 						lst->size--;
 						lst->tail = prev;
 						return CAF_OK;
@@ -198,7 +234,7 @@ cdeque_node_delete (cdeque_t *lst, caf_cdequen_t *n, CAF_LSTDLCNODE_CBDEL(del))
 								next = nr->next;
 								prev->next = next;
 								next->prev = prev;
-								xfree (nr);
+								cdeque_node_release (lst, nr);
 								lst->size--;
 								return CAF_OK;
 							}
@@ -226,7 +262,7 @@ cdeque_node_delete_by_data (cdeque_t *lst, void *n,
 				return CAF_ERROR;
 			} else if (cdeque_oneitem_list (lst) == CAF_OK) {
 				if ((del (lst->head->data)) == CAF_OK) {
-					xfree (lst->head);
+					cdeque_node_release (lst, lst->head);
 					lst->head = (caf_cdequen_t *)NULL;
 					lst->tail = (caf_cdequen_t *)NULL;
 					return CAF_OK;
@@ -238,7 +274,7 @@ cdeque_node_delete_by_data (cdeque_t *lst, void *n,
 						next = nr->next;
 						prev->next = next;
 						next->prev = prev;
-						xfree (nr);
+						cdeque_node_release (lst, nr);
 						lst->size--;
 						lst->head = next;
 						return CAF_OK;
@@ -249,7 +285,7 @@ cdeque_node_delete_by_data (cdeque_t *lst, void *n,
 						next = nr->next;
 						prev->next = next;
 						next->prev = prev;
-						xfree (nr);
+						cdeque_node_release (lst, nr);
 						lst->size--;
 						lst->tail = prev;
 						return CAF_OK;
@@ -262,7 +298,7 @@ cdeque_node_delete_by_data (cdeque_t *lst, void *n,
 								next = nr->next;
 								prev->next = next;
 								next->prev = prev;
-								xfree (nr);
+								cdeque_node_release (lst, nr);
 								lst->size--;
 								return CAF_OK;
 							}
@@ -322,7 +358,7 @@ cdeque_push (cdeque_t *lst, void *data) {
 	caf_cdequen_t *tail = (caf_cdequen_t *)NULL, *head = (caf_cdequen_t *)NULL;
 	caf_cdequen_t *xnew = (caf_cdequen_t *)NULL;
 	if (lst != (cdeque_t *)NULL) {
-		xnew = (caf_cdequen_t *)xmalloc (CAF_LSTDLCNODE_SZ);
+		xnew = cdeque_node_alloc (lst);
 		if (xnew != (caf_cdequen_t *)NULL) {
 			xnew->data = data;
 			if (cdeque_empty_list (lst) == CAF_OK) {
@@ -448,7 +484,7 @@ cdeque_insert (cdeque_t *lst, int pos, void *data) {
 			return CAF_ERROR_SUB;
 		} else if (cdeque_oneitem_list (lst) == CAF_OK) {
 			if (pos == 0) {
-				nn = (caf_cdequen_t *)xmalloc (CAF_LSTDLCNODE_SZ);
+				nn = cdeque_node_alloc (lst);
 				nn->data = data;
 				nn->next = lst->head;
 				lst->head->prev = nn;
@@ -461,7 +497,7 @@ cdeque_insert (cdeque_t *lst, int pos, void *data) {
 			pn = lst->head;
 			do {
 				if (pos == c) {
-					nn = (caf_cdequen_t *)xmalloc (CAF_LSTDLCNODE_SZ);
+					nn = cdeque_node_alloc (lst);
 					nn->data = data;
 					nn->next = pn;
 					nn = pn->prev;
@@ -471,7 +507,7 @@ cdeque_insert (cdeque_t *lst, int pos, void *data) {
 				c++;
 			} while (pn != lst->tail);
 			if (pos == c) {
-				nn = (caf_cdequen_t *)xmalloc (CAF_LSTDLCNODE_SZ);
+				nn = cdeque_node_alloc (lst);
 				nn->data = data;
 				nn->next = lst->head;
 				nn->prev = lst->tail;
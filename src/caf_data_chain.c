@@ -0,0 +1,264 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_data_buffer.h"
+#include "caf/caf_data_chain.h"
+
+#define CAF_CHAIN_SEGLEN(b) \
+	((b)->iosz > 0 ? (size_t)(b)->iosz : (b)->sz)
+
+static int cbuf_chain_room (cbuf_chain_t *ch, int front);
+
+
+cbuf_chain_t *
+cbuf_chain_new (void) {
+	cbuf_chain_t *ch;
+	ch = (cbuf_chain_t *)xmalloc (CAF_CHAIN_SZ);
+	if (ch != (cbuf_chain_t *)NULL) {
+		ch->segs = (cbuffer_t **)xmalloc (CAF_CHAIN_SEGS
+										  * sizeof (cbuffer_t *));
+		ch->iov = (struct iovec *)xmalloc (CAF_CHAIN_SEGS
+										   * sizeof (struct iovec));
+		if (ch->segs == (cbuffer_t **)NULL
+			|| ch->iov == (struct iovec *)NULL) {
+			xfree (ch->segs);
+			xfree (ch->iov);
+			xfree (ch);
+			return (cbuf_chain_t *)NULL;
+		}
+		ch->first = 0;
+		ch->count = 0;
+		ch->cap = CAF_CHAIN_SEGS;
+		ch->len = 0;
+	}
+	return ch;
+}
+
+
+void
+cbuf_chain_delete (cbuf_chain_t *ch) {
+	int i;
+	if (ch != (cbuf_chain_t *)NULL) {
+		for (i = ch->first; i < ch->first + ch->count; i++) {
+			cbuf_delete (ch->segs[i]);
+		}
+		xfree (ch->segs);
+		xfree (ch->iov);
+		xfree (ch);
+	}
+}
+
+
+/* makes room for one segment at the front or at the back */
+static int
+cbuf_chain_room (cbuf_chain_t *ch, int front) {
+	cbuffer_t **segs;
+	struct iovec *iov;
+	int cap = ch->cap, first;
+	if (front ? ch->first > 0 : ch->first + ch->count < ch->cap) {
+		return CAF_OK;
+	}
+	if (ch->count + 1 > cap / 2) {
+		cap *= 2;
+		segs = (cbuffer_t **)xrealloc (ch->segs, cap * sizeof (cbuffer_t *));
+		if (segs == (cbuffer_t **)NULL) {
+			return CAF_ERROR;
+		}
+		ch->segs = segs;
+		iov = (struct iovec *)xrealloc (ch->iov, cap * sizeof (struct iovec));
+		if (iov == (struct iovec *)NULL) {
+			return CAF_ERROR;
+		}
+		ch->iov = iov;
+		ch->cap = cap;
+	}
+	/* centers the segments, leaving room at both ends */
+	first = (cap - ch->count) / 2;
+	memmove (ch->segs + first, ch->segs + ch->first,
+			 (size_t)ch->count * sizeof (cbuffer_t *));
+	memmove (ch->iov + first, ch->iov + ch->first,
+			 (size_t)ch->count * sizeof (struct iovec));
+	ch->first = first;
+	return CAF_OK;
+}
+
+
+int
+cbuf_chain_append (cbuf_chain_t *ch, cbuffer_t *b) {
+	int i;
+	if (ch == (cbuf_chain_t *)NULL || b == (cbuffer_t *)NULL
+		|| cbuf_chain_room (ch, 0) != CAF_OK) {
+		return CAF_ERROR;
+	}
+	i = ch->first + ch->count;
+	ch->segs[i] = b;
+	ch->iov[i].iov_base = b->data;
+	ch->iov[i].iov_len = CAF_CHAIN_SEGLEN(b);
+	ch->len += ch->iov[i].iov_len;
+	ch->count++;
+	return CAF_OK;
+}
+
+
+int
+cbuf_chain_prepend (cbuf_chain_t *ch, cbuffer_t *b) {
+	int i;
+	if (ch == (cbuf_chain_t *)NULL || b == (cbuffer_t *)NULL
+		|| cbuf_chain_room (ch, 1) != CAF_OK) {
+		return CAF_ERROR;
+	}
+	i = --(ch->first);
+	ch->segs[i] = b;
+	ch->iov[i].iov_base = b->data;
+	ch->iov[i].iov_len = CAF_CHAIN_SEGLEN(b);
+	ch->len += ch->iov[i].iov_len;
+	ch->count++;
+	return CAF_OK;
+}
+
+
+size_t
+cbuf_chain_consume (cbuf_chain_t *ch, size_t n) {
+	struct iovec *v;
+	size_t done = 0;
+	if (ch == (cbuf_chain_t *)NULL) {
+		return 0;
+	}
+	while (ch->count > 0) {
+		v = &(ch->iov[ch->first]);
+		if (v->iov_len > n - done) {
+			v->iov_base = (void *)((size_t)v->iov_base + (n - done));
+			v->iov_len -= n - done;
+			done = n;
+			break;
+		}
+		done += v->iov_len;
+		cbuf_delete (ch->segs[ch->first]);
+		ch->first++;
+		ch->count--;
+	}
+	if (ch->count == 0) {
+		ch->first = 0;
+	}
+	ch->len -= done;
+	return done;
+}
+
+
+struct iovec *
+cbuf_chain_iov (cbuf_chain_t *ch, int *cnt) {
+	if (ch == (cbuf_chain_t *)NULL || cnt == (int *)NULL) {
+		return (struct iovec *)NULL;
+	}
+	*cnt = ch->count;
+	return ch->count > 0 ? &(ch->iov[ch->first]) : (struct iovec *)NULL;
+}
+
+
+struct iovec *
+cbuf_chain_iov_in (cbuf_chain_t *ch, int *cnt) {
+	cbuffer_t *b;
+	int i;
+	if (ch == (cbuf_chain_t *)NULL || cnt == (int *)NULL) {
+		return (struct iovec *)NULL;
+	}
+	/* a failure leaves the iovec array as it was */
+	for (i = ch->first; i < ch->first + ch->count; i++) {
+		if (cbuf_own (ch->segs[i]) != CAF_OK) {
+			*cnt = -1;
+			return (struct iovec *)NULL;
+		}
+	}
+	for (i = ch->first; i < ch->first + ch->count; i++) {
+		b = ch->segs[i];
+		ch->iov[i].iov_base = b->data;
+		ch->iov[i].iov_len = b->sz;
+	}
+	return cbuf_chain_iov (ch, cnt);
+}
+
+
+void
+cbuf_chain_received (cbuf_chain_t *ch, size_t n) {
+	cbuffer_t *b;
+	size_t left = n;
+	int i;
+	if (ch == (cbuf_chain_t *)NULL) {
+		return;
+	}
+	for (i = ch->first; i < ch->first + ch->count; i++) {
+		b = ch->segs[i];
+		b->iosz = (ssize_t)(left < b->sz ? left : b->sz);
+		ch->iov[i].iov_len = (size_t)b->iosz;
+		left -= (size_t)b->iosz;
+	}
+	ch->len = n - left;
+}
+
+
+size_t
+cbuf_chain_length (const cbuf_chain_t *ch) {
+	if (ch != (cbuf_chain_t *)NULL) {
+		return ch->len;
+	}
+	return 0;
+}
+
+
+cbuffer_t *
+cbuf_chain_flatten (const cbuf_chain_t *ch) {
+	cbuffer_t *r;
+	size_t off = 0;
+	int i;
+	if (ch == (cbuf_chain_t *)NULL || ch->len == 0) {
+		return (cbuffer_t *)NULL;
+	}
+	r = cbuf_create (ch->len);
+	if (r != (cbuffer_t *)NULL) {
+		for (i = ch->first; i < ch->first + ch->count; i++) {
+			memcpy ((void *)((size_t)r->data + off), ch->iov[i].iov_base,
+					ch->iov[i].iov_len);
+			off += ch->iov[i].iov_len;
+		}
+	}
+	return r;
+}
+
+/* caf_data_chain.c ends here */
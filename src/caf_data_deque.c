@@ -36,6 +36,8 @@ static char Id[] = "$Id$";
 #include "caf/caf_data_mem.h"
 #include "caf/caf_data_deque.h"
 
+static caf_dequen_t *deque_node_alloc (deque_t *lst);
+
 
 deque_t *
 deque_new (void *data) {
@@ -43,7 +45,7 @@ deque_new (void *data) {
 	caf_dequen_t *n;
 	lst = (deque_t *)xmalloc (CAF_DEQUE_SZ);
 	if (lst != NULL) {
-		n = (caf_dequen_t *)xmalloc (CAF_CAF_DEQUENODE_SZ);
+		n = (caf_dequen_t *)xobjalloc (CAF_CAF_DEQUENODE_SZ);
 		if (n != (caf_dequen_t *)NULL) {
 			if (data != (void *)NULL) {
 				n->data = data;
@@ -53,6 +55,8 @@ deque_new (void *data) {
 			lst->head = n;
 			lst->tail = n;
 			lst->size = 1;
+			lst->pool = (caf_npool_t *)NULL;
+			lst->arena = (caf_arena_t *)NULL;
 		} else {
 			free (lst);
 			lst = (deque_t *)NULL;
@@ -71,11 +75,65 @@ deque_create (void) {
 		lst->head = (caf_dequen_t *)NULL;
 		lst->tail = (caf_dequen_t *)NULL;
 		lst->size = 0;
+		lst->pool = (caf_npool_t *)NULL;
+		lst->arena = (caf_arena_t *)NULL;
+	}
+	return lst;
+}
+
+
+deque_t *
+deque_create_pool (caf_npool_t *pool) {
+	deque_t *lst;
+	lst = deque_create ();
+	if (lst != (deque_t *)NULL) {
+		lst->pool = pool;
+	}
+	return lst;
+}
+
+
+deque_t *
+deque_create_arena (caf_arena_t *arena) {
+	deque_t *lst;
+	lst = (deque_t *)caf_arena_alloc (arena, CAF_DEQUE_SZ);
+	if (lst != (deque_t *)NULL) {
+		lst->head = (caf_dequen_t *)NULL;
+		lst->tail = (caf_dequen_t *)NULL;
+		lst->size = 0;
+		lst->pool = (caf_npool_t *)NULL;
+		lst->arena = arena;
 	}
 	return lst;
 }
 
 
+static caf_dequen_t *
+deque_node_alloc (deque_t *lst) {
+	if (lst->arena != (caf_arena_t *)NULL) {
+		return (caf_dequen_t *)caf_arena_alloc (lst->arena,
+												CAF_CAF_DEQUENODE_SZ);
+	}
+	if (lst->pool != (caf_npool_t *)NULL) {
+		return (caf_dequen_t *)caf_npool_get (lst->pool);
+	}
+	return (caf_dequen_t *)xobjalloc (CAF_CAF_DEQUENODE_SZ);
+}
+
+
+void
+deque_node_release (deque_t *lst, caf_dequen_t *n) {
+	if (lst != (deque_t *)NULL && lst->arena != (caf_arena_t *)NULL) {
+		return;
+	}
+	if (lst != (deque_t *)NULL && lst->pool != (caf_npool_t *)NULL) {
+		caf_npool_put (lst->pool, n);
+	} else {
+		xobjfree (n, CAF_CAF_DEQUENODE_SZ);
+	}
+}
+
+
 int
 deque_delete (deque_t *lst, CAF_CAF_DEQUENODE_CBDEL(del)) {
 	caf_dequen_t *cur, *destroy;
@@ -86,7 +144,7 @@ deque_delete (deque_t *lst, CAF_CAF_DEQUENODE_CBDEL(del)) {
 			destroy = cur;
 			cur = cur->next;
 			if ((del (destroy->data)) == CAF_OK) {
-				xfree(destroy);
+				deque_node_release (lst, destroy);
 				cnt++;
 			} else {
 				lst->head = destroy;
@@ -95,14 +153,16 @@ deque_delete (deque_t *lst, CAF_CAF_DEQUENODE_CBDEL(del)) {
 		}
 		if (cur != (caf_dequen_t *)NULL) {
 			if ((del (cur->data)) == CAF_OK) {
-				xfree (cur);
+				deque_node_release (lst, cur);
 				cnt++;
 			} else {
 				lst->head = cur;
 				return cnt;
 			}
 		}
-		xfree(lst);
+		if (lst->arena == (caf_arena_t *)NULL) {
+			xfree(lst);
+		}
 		lst = (deque_t *)NULL;
 		return CAF_OK;
 	}
@@ -120,13 +180,15 @@ deque_delete_nocb (deque_t *lst) {
 			cnt++;
 			destroy = cur;
 			cur = cur->next;
-			xfree(destroy);
+			deque_node_release (lst, destroy);
 		}
 		if (cur != (caf_dequen_t *)NULL) {
 			cnt++;
-			xfree (cur);
+			deque_node_release (lst, cur);
+		}
+		if (lst->arena == (caf_arena_t *)NULL) {
+			xfree(lst);
 		}
-		xfree(lst);
 		return CAF_OK;
 	}
 	return CAF_ERROR;
@@ -147,17 +209,17 @@ deque_node_delete (deque_t *lst, caf_dequen_t *n, CAF_CAF_DEQUENODE_CBDEL(del))
 						if ((del (nr->data)) == CAF_OK) {
 							prev = nr->prev;
 							next = nr->next;
-							if (prev != (caf_dequen_t *)NULL &&
-								next != (caf_dequen_t *)NULL) {
-								prev->next = next;
-								next->prev = prev;
-							} else if (prev != (caf_dequen_t *)NULL &&
-							           next == (caf_dequen_t *)NULL) {
+							if (prev != (caf_dequen_t *)NULL) {
 								prev->next = next;
 							} else {
+								lst->head = next;
+							}
+							if (next != (caf_dequen_t *)NULL) {
 								next->prev = prev;
+							} else {
+								lst->tail = prev;
 							}
-							xfree (nr);
+							deque_node_release (lst, nr);
 							lst->size--;
 							return CAF_OK;
 						}
@@ -185,17 +247,17 @@ deque_node_delete_by_data (deque_t *lst, void *n, CAF_CAF_DEQUENODE_CBDEL(del))
 						if ((del (nr->data)) == CAF_OK) {
 							prev = nr->prev;
 							next = nr->next;
-							if (prev != (caf_dequen_t *)NULL &&
-								next != (caf_dequen_t *)NULL) {
-								prev->next = next;
-								next->prev = prev;
-							} else if (prev != (caf_dequen_t *)NULL &&
-							           next == (caf_dequen_t *)NULL) {
+							if (prev != (caf_dequen_t *)NULL) {
 								prev->next = next;
 							} else {
+								lst->head = next;
+							}
+							if (next != (caf_dequen_t *)NULL) {
 								next->prev = prev;
+							} else {
+								lst->tail = prev;
 							}
-							xfree (nr);
+							deque_node_release (lst, nr);
 							lst->size--;
 							return CAF_OK;
 						}
@@ -250,7 +312,7 @@ deque_t *
 deque_push (deque_t *lst, void *data) {
 	caf_dequen_t *tail, *xnew;
 	if (lst != (deque_t *)NULL) {
-		xnew = (caf_dequen_t *)xmalloc (CAF_CAF_DEQUENODE_SZ);
+		xnew = deque_node_alloc (lst);
 		if (xnew != (caf_dequen_t *)NULL) {
 			if (lst->tail != (caf_dequen_t *)NULL &&
 				lst->head != (caf_dequen_t *)NULL) {
@@ -318,6 +380,10 @@ deque_first (deque_t *lst) {
 				ex->prev = (void *)NULL;
 				lst->head = ex;
 				lst->size--;
+			} else {
+				lst->head = (caf_dequen_t *)NULL;
+				lst->tail = (caf_dequen_t *)NULL;
+				lst->size--;
 			}
 		}
 	}
@@ -354,7 +420,7 @@ deque_insert (deque_t *lst, int pos, void *data) {
 		pn = lst->head;
 		while (pn != (caf_dequen_t *)NULL) {
 			if (pos == c) {
-				xnew = (caf_dequen_t *)xmalloc (CAF_CAF_DEQUENODE_SZ);
+				xnew = deque_node_alloc (lst);
 				xnew->data = data;
 				xnew->prev = pn->prev;
 				xnew->next = pn;
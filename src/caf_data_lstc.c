@@ -36,10 +36,47 @@ static char Id[] = "$Id$";
 #include "caf/caf_data_mem.h"
 #include "caf/caf_data_lstc.h"
 
+#if defined(__GNUC__)
+#define CAF_LSTC_TLS        __thread
+#else /* !__GNUC__ */
+#define CAF_LSTC_TLS
+#endif /* !__GNUC__ */
+
+static CAF_LSTC_TLS caf_npool_t *lstc_pool = (caf_npool_t *)NULL;
+
+static lstcn_t *lstc_node_alloc (void);
+
+
+caf_npool_t *
+lstc_pool_set (caf_npool_t *pool) {
+	caf_npool_t *old = lstc_pool;
+	lstc_pool = pool;
+	return old;
+}
+
+
+static lstcn_t *
+lstc_node_alloc (void) {
+	if (lstc_pool != (caf_npool_t *)NULL) {
+		return (lstcn_t *)caf_npool_get (lstc_pool);
+	}
+	return (lstcn_t *)xmalloc (CAF_LSTC_SZ);
+}
+
+
+void
+lstc_node_release (lstcn_t *n) {
+	if (lstc_pool != (caf_npool_t *)NULL) {
+		caf_npool_put (lstc_pool, n);
+	} else {
+		xfree (n);
+	}
+}
+
 
 lstcn_t *
 lstc_new (void *data) {
-	lstcn_t *node = (lstcn_t *)xmalloc (CAF_LSTC_SZ);
+	lstcn_t *node = lstc_node_alloc ();
 	if (node != (lstcn_t *)NULL) {
 		node->data = data;
 		node->next = node;
@@ -51,7 +88,7 @@ lstc_new (void *data) {
 
 lstcn_t *
 lstc_create () {
-	lstcn_t *node = (lstcn_t *)xmalloc (CAF_LSTC_SZ);
+	lstcn_t *node = lstc_node_alloc ();
 	if (node != (lstcn_t *)NULL) {
 		node->data = (void *)NULL;
 		node->next = (lstcn_t *)NULL;
@@ -70,7 +107,7 @@ lstc_delete (lstcn_t *lst, CAF_LSTCNODE_CBDEL(del)) {
 			if ((del (current->data)) == CAF_OK) {
 				xtodel = current;
 				current = current->next;
-				xfree(xtodel);
+				lstc_node_release (xtodel);
 			} else {
 				lst = current;
 				return CAF_ERROR;
@@ -95,7 +132,7 @@ lstc_node_delete (lstcn_t *lst, lstcn_t *n, CAF_LSTCNODE_CBDEL(del)) {
 			next->prev = prev;
 			prev->next = next;
 			if ((del (nr->data)) == CAF_OK) {
-				xfree (nr);
+				lstc_node_release (nr);
 				return CAF_OK;
 			} else {
 				nr->next = next;
@@ -125,7 +162,7 @@ lstc_node_delete_by_data (lstcn_t *lst, void *data, CAF_LSTCNODE_CBDEL(del)) {
 				next->prev = prev;
 				prev->next = next;
 				if ((del (nr->data) == CAF_OK)) {
-					xfree (nr);
+					lstc_node_release (nr);
 					return CAF_OK;
 				} else {
 					nr->next = next;
@@ -188,7 +225,7 @@ lstc_push (lstcn_t *lst, void *data) {
 			lst->prev = lst;
 			lst->data = data;
 		} else {
-			xnew = (lstcn_t *)xmalloc (CAF_LSTC_SZ);
+			xnew = lstc_node_alloc ();
 			if (xnew != (lstcn_t *)NULL) {
 				last = lst->prev;
 				last->next = xnew;
@@ -252,7 +289,7 @@ lstc_insert (lstcn_t *lst, int pos, void *data) {
 	if (lst != (lstcn_t *)NULL) {
 		do {
 			if (pos == c) {
-				nn = (lstcn_t *)xmalloc (CAF_LSTC_SZ);
+				nn = lstc_node_alloc ();
 				nn->prev = pn->prev;
 				nn->next = pn;
 				pn->prev = nn;
@@ -31,10 +31,17 @@ static char Id[] = "$Id$";
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
+#ifdef CAFFEINE_MEMTRACE
+#include <unistd.h>
+#include <signal.h>
+#endif /* !CAFFEINE_MEMTRACE */
+
+#include "caf/caf.h"
 #include "caf/caf_data_mem.h"
 
-#ifndef CAFFEINE_DEBUG
+#if !defined(CAFFEINE_DEBUG) && !defined(CAFFEINE_MEMTRACE)
 
 void *
 xmalloc (size_t mem) {
@@ -98,5 +105,1105 @@ xmemcpy (void *dst, void *src, size_t sz) {
 }
 
 #endif /* !CAFFEINE_DEBUG */
+
+#ifdef CAFFEINE_MEMTRACE
+
+/* a live traced block */
+typedef struct caf_mtrace_ptr_s caf_mtrace_ptr_t;
+struct caf_mtrace_ptr_s {
+	caf_mtrace_ptr_t *next;
+	void *ptr;
+	size_t sz;
+	caf_mtrace_site_t *site;
+};
+
+/* a lock stripe of the live block buckets, with its spare records */
+typedef struct caf_mtrace_lock_s caf_mtrace_lock_t;
+struct caf_mtrace_lock_s {
+	pthread_mutex_t lock;
+	caf_mtrace_ptr_t *spare;
+};
+
+static caf_mtrace_site_t *caf_mtrace_sites[CAF_MTRACE_SITES];
+static caf_mtrace_ptr_t **caf_mtrace_ptrs = (caf_mtrace_ptr_t **)NULL;
+static caf_mtrace_lock_t caf_mtrace_locks[CAF_MTRACE_LOCKS];
+static pthread_mutex_t caf_mtrace_site_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t caf_mtrace_once = PTHREAD_ONCE_INIT;
+static caf_mtrace_site_t caf_mtrace_total;
+static int caf_mtrace_fd = 2;
+static int caf_mtrace_top = 10;
+
+/* room for one report line */
+#define CAF_MTRACE_LINE     512
+
+static void caf_mtrace_init (void);
+static size_t caf_mtrace_hash (const void *ptr);
+static caf_mtrace_site_t *caf_mtrace_site (const char *file, int line);
+static void caf_mtrace_account (caf_mtrace_site_t *s, size_t sz);
+static int caf_mtrace_link (void *ptr, size_t sz, caf_mtrace_site_t *s);
+static caf_mtrace_site_t *caf_mtrace_unlink (void *ptr, size_t *sz);
+static void caf_mtrace_release (caf_mtrace_site_t *s, size_t sz);
+static void caf_mtrace_insert (void *ptr, size_t sz, caf_mtrace_site_t *s);
+static void caf_mtrace_remove (void *ptr);
+static size_t caf_mtrace_put (char *line, size_t len, const char *str,
+							  int width);
+static size_t caf_mtrace_putn (char *line, size_t len, unsigned long v,
+							   int width);
+static void caf_mtrace_exit (void);
+static void caf_mtrace_signal (int sig);
+
+
+static void
+caf_mtrace_init (void) {
+	int i;
+	caf_mtrace_ptrs = (caf_mtrace_ptr_t **)
+		calloc (CAF_MTRACE_BUCKETS, sizeof (caf_mtrace_ptr_t *));
+	for (i = 0; i < CAF_MTRACE_LOCKS; i++) {
+		pthread_mutex_init (&(caf_mtrace_locks[i].lock),
+							(pthread_mutexattr_t *)NULL);
+		caf_mtrace_locks[i].spare = (caf_mtrace_ptr_t *)NULL;
+	}
+}
+
+
+static size_t
+caf_mtrace_hash (const void *ptr) {
+	size_t h = (size_t)ptr >> 4;
+	h ^= h >> 16;
+	return (h * 0x45d9f3bU) & (CAF_MTRACE_BUCKETS - 1);
+}
+
+
+/* sites are only added, readers walk the buckets without locking */
+static caf_mtrace_site_t *
+caf_mtrace_site (const char *file, int line) {
+	size_t h = (((size_t)file >> 3) ^ ((size_t)line * 2654435761U))
+		& (CAF_MTRACE_SITES - 1);
+	caf_mtrace_site_t *s;
+	s = __atomic_load_n (&(caf_mtrace_sites[h]), __ATOMIC_ACQUIRE);
+	for (; s != (caf_mtrace_site_t *)NULL; s = s->next) {
+		if (s->file == file && s->line == line) {
+			return s;
+		}
+	}
+	pthread_mutex_lock (&caf_mtrace_site_lock);
+	for (s = caf_mtrace_sites[h]; s != (caf_mtrace_site_t *)NULL;
+		 s = s->next) {
+		if (s->file == file && s->line == line) {
+			break;
+		}
+	}
+	if (s == (caf_mtrace_site_t *)NULL) {
+		s = (caf_mtrace_site_t *)calloc (1, sizeof (caf_mtrace_site_t));
+		if (s != (caf_mtrace_site_t *)NULL) {
+			s->file = file;
+			s->line = line;
+			s->next = caf_mtrace_sites[h];
+			__atomic_store_n (&(caf_mtrace_sites[h]), s, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock (&caf_mtrace_site_lock);
+	return s;
+}
+
+
+/* adds sz bytes to the live bytes of a site, raising its peak */
+static void
+caf_mtrace_account (caf_mtrace_site_t *s, size_t sz) {
+	size_t bytes, peak;
+	bytes = __atomic_add_fetch (&(s->bytes), sz, __ATOMIC_RELAXED);
+	__atomic_add_fetch (&(s->live), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch (&(s->allocs), 1, __ATOMIC_RELAXED);
+	peak = __atomic_load_n (&(s->peak), __ATOMIC_RELAXED);
+	while (bytes > peak
+		   && !__atomic_compare_exchange_n (&(s->peak), &peak, bytes, 1,
+											__ATOMIC_RELAXED,
+											__ATOMIC_RELAXED)) {
+	}
+}
+
+
+/* adds the record of a block without touching the counters */
+static int
+caf_mtrace_link (void *ptr, size_t sz, caf_mtrace_site_t *s) {
+	size_t h = caf_mtrace_hash (ptr);
+	caf_mtrace_lock_t *l = &(caf_mtrace_locks[h % CAF_MTRACE_LOCKS]);
+	caf_mtrace_ptr_t *r;
+	pthread_mutex_lock (&(l->lock));
+	r = l->spare;
+	if (r != (caf_mtrace_ptr_t *)NULL) {
+		l->spare = r->next;
+	} else {
+		r = (caf_mtrace_ptr_t *)malloc (sizeof (caf_mtrace_ptr_t));
+		if (r == (caf_mtrace_ptr_t *)NULL) {
+			pthread_mutex_unlock (&(l->lock));
+			return CAF_ERROR;
+		}
+	}
+	r->ptr = ptr;
+	r->sz = sz;
+	r->site = s;
+	r->next = caf_mtrace_ptrs[h];
+	caf_mtrace_ptrs[h] = r;
+	pthread_mutex_unlock (&(l->lock));
+	return CAF_OK;
+}
+
+
+/* takes out the record of a block, returning its site and size */
+static caf_mtrace_site_t *
+caf_mtrace_unlink (void *ptr, size_t *sz) {
+	size_t h = caf_mtrace_hash (ptr);
+	caf_mtrace_lock_t *l = &(caf_mtrace_locks[h % CAF_MTRACE_LOCKS]);
+	caf_mtrace_ptr_t *r, **pr;
+	caf_mtrace_site_t *s = (caf_mtrace_site_t *)NULL;
+	pthread_mutex_lock (&(l->lock));
+	for (pr = &(caf_mtrace_ptrs[h]); *pr != (caf_mtrace_ptr_t *)NULL;
+		 pr = &((*pr)->next)) {
+		r = *pr;
+		if (r->ptr == ptr) {
+			*pr = r->next;
+			s = r->site;
+			*sz = r->sz;
+			r->next = l->spare;
+			l->spare = r;
+			break;
+		}
+	}
+	pthread_mutex_unlock (&(l->lock));
+	return s;
+}
+
+
+/* counts the release of sz bytes allocated at a site */
+static void
+caf_mtrace_release (caf_mtrace_site_t *s, size_t sz) {
+	__atomic_sub_fetch (&(s->bytes), sz, __ATOMIC_RELAXED);
+	__atomic_sub_fetch (&(s->live), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch (&(s->frees), 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch (&(caf_mtrace_total.bytes), sz, __ATOMIC_RELAXED);
+	__atomic_sub_fetch (&(caf_mtrace_total.live), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch (&(caf_mtrace_total.frees), 1, __ATOMIC_RELAXED);
+}
+
+
+static void
+caf_mtrace_insert (void *ptr, size_t sz, caf_mtrace_site_t *s) {
+	/* without a record the block stays untraced */
+	if (caf_mtrace_link (ptr, sz, s) == CAF_OK) {
+		caf_mtrace_account (s, sz);
+		caf_mtrace_account (&caf_mtrace_total, sz);
+	}
+}
+
+
+static void
+caf_mtrace_remove (void *ptr) {
+	caf_mtrace_site_t *s;
+	size_t sz = 0;
+	s = caf_mtrace_unlink (ptr, &sz);
+	if (s != (caf_mtrace_site_t *)NULL) {
+		caf_mtrace_release (s, sz);
+	}
+}
+
+
+void *
+caf_mtrace_malloc (size_t sz, const char *file, int line) {
+	caf_mtrace_site_t *s;
+	void *ptr;
+	if (sz == 0) {
+		return (void *)NULL;
+	}
+	ptr = malloc (sz);
+	pthread_once (&caf_mtrace_once, caf_mtrace_init);
+	if (ptr != (void *)NULL && caf_mtrace_ptrs != (caf_mtrace_ptr_t **)NULL) {
+		s = caf_mtrace_site (file, line);
+		if (s != (caf_mtrace_site_t *)NULL) {
+			caf_mtrace_insert (ptr, sz, s);
+		}
+	}
+	return ptr;
+}
+
+
+void *
+caf_mtrace_realloc (void *ptr, size_t sz, const char *file, int line) {
+	caf_mtrace_site_t *s, *old;
+	size_t old_sz = 0;
+	void *r;
+	if (ptr == (void *)NULL) {
+		return caf_mtrace_malloc (sz, file, line);
+	}
+	pthread_once (&caf_mtrace_once, caf_mtrace_init);
+	if (caf_mtrace_ptrs == (caf_mtrace_ptr_t **)NULL) {
+		return realloc (ptr, sz);
+	}
+	/*
+	 * The record goes first, the old address may be reused at once,
+	 * but the counters change only once realloc succeeds; on failure
+	 * the record goes back and the block stays traced. A zero size
+	 * frees the block.
+	 */
+	old = caf_mtrace_unlink (ptr, &old_sz);
+	r = realloc (ptr, sz);
+	if (r == (void *)NULL && sz > 0) {
+		if (old != (caf_mtrace_site_t *)NULL
+			&& caf_mtrace_link (ptr, old_sz, old) != CAF_OK) {
+			caf_mtrace_release (old, old_sz);
+		}
+		return r;
+	}
+	if (old != (caf_mtrace_site_t *)NULL) {
+		caf_mtrace_release (old, old_sz);
+	}
+	if (r != (void *)NULL) {
+		s = caf_mtrace_site (file, line);
+		if (s != (caf_mtrace_site_t *)NULL) {
+			caf_mtrace_insert (r, sz, s);
+		}
+	}
+	return r;
+}
+
+
+void
+caf_mtrace_free (void *ptr) {
+	if (ptr != (void *)NULL) {
+		if (caf_mtrace_ptrs != (caf_mtrace_ptr_t **)NULL) {
+			caf_mtrace_remove (ptr);
+		}
+		free (ptr);
+	}
+}
+
+
+void
+caf_mtrace_destroy (void *ptr, size_t sz) {
+	if (ptr != (void *)NULL) {
+		memset (ptr, 0, sz);
+		caf_mtrace_free (ptr);
+	}
+}
+
+
+void
+caf_mtrace_strdestroy (void *ptr) {
+	if (ptr != (void *)NULL) {
+		caf_mtrace_destroy (ptr, strlen ((char *)ptr));
+	}
+}
+
+
+int
+caf_mtrace_stats (caf_mtrace_site_t *total) {
+	caf_mtrace_site_t *s;
+	int i, n = 0;
+	if (total == (caf_mtrace_site_t *)NULL) {
+		return 0;
+	}
+	memset (total, 0, sizeof (caf_mtrace_site_t));
+	total->bytes = __atomic_load_n (&(caf_mtrace_total.bytes),
+									__ATOMIC_RELAXED);
+	total->live = __atomic_load_n (&(caf_mtrace_total.live), __ATOMIC_RELAXED);
+	total->peak = __atomic_load_n (&(caf_mtrace_total.peak), __ATOMIC_RELAXED);
+	total->allocs = __atomic_load_n (&(caf_mtrace_total.allocs),
+									 __ATOMIC_RELAXED);
+	total->frees = __atomic_load_n (&(caf_mtrace_total.frees),
+									__ATOMIC_RELAXED);
+	for (i = 0; i < CAF_MTRACE_SITES; i++) {
+		s = __atomic_load_n (&(caf_mtrace_sites[i]), __ATOMIC_ACQUIRE);
+		for (; s != (caf_mtrace_site_t *)NULL; s = s->next) {
+			n++;
+		}
+	}
+	return n;
+}
+
+
+caf_mtrace_site_t *
+caf_mtrace_find (const char *file, int line) {
+	caf_mtrace_site_t *s;
+	int i;
+	if (file == (const char *)NULL) {
+		return (caf_mtrace_site_t *)NULL;
+	}
+	for (i = 0; i < CAF_MTRACE_SITES; i++) {
+		s = __atomic_load_n (&(caf_mtrace_sites[i]), __ATOMIC_ACQUIRE);
+		for (; s != (caf_mtrace_site_t *)NULL; s = s->next) {
+			if (s->line == line && strcmp (s->file, file) == 0) {
+				return s;
+			}
+		}
+	}
+	return (caf_mtrace_site_t *)NULL;
+}
+
+
+/*
+ * Appends str right aligned to width. The report may run in a signal
+ * handler, where snprintf is not safe, so it is formatted by hand.
+ */
+static size_t
+caf_mtrace_put (char *line, size_t len, const char *str, int width) {
+	size_t n = strlen (str);
+	for (; width > (int)n && len < CAF_MTRACE_LINE; width--) {
+		line[len++] = ' ';
+	}
+	for (; *str != '\0' && len < CAF_MTRACE_LINE; str++) {
+		line[len++] = *str;
+	}
+	return len;
+}
+
+
+/* appends v in decimal, right aligned to width */
+static size_t
+caf_mtrace_putn (char *line, size_t len, unsigned long v, int width) {
+	char digits[24];
+	size_t i = sizeof (digits) - 1;
+	digits[i] = '\0';
+	do {
+		digits[--i] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v > 0);
+	return caf_mtrace_put (line, len, &(digits[i]), width);
+}
+
+
+int
+caf_mtrace_dump (int fd, int top) {
+	caf_mtrace_site_t *sel[CAF_MTRACE_TOP], *s;
+	size_t bytes[CAF_MTRACE_TOP], peak[CAF_MTRACE_TOP], b, pk;
+	char line[CAF_MTRACE_LINE];
+	size_t len;
+	int i, j, n = 0, sites = 0;
+	if (top > CAF_MTRACE_TOP) {
+		top = CAF_MTRACE_TOP;
+	}
+	/* keeps the top sites by live bytes then peak, sorted by insertion */
+	for (i = 0; i < CAF_MTRACE_SITES; i++) {
+		s = __atomic_load_n (&(caf_mtrace_sites[i]), __ATOMIC_ACQUIRE);
+		for (; s != (caf_mtrace_site_t *)NULL; s = s->next) {
+			sites++;
+			b = __atomic_load_n (&(s->bytes), __ATOMIC_RELAXED);
+			pk = __atomic_load_n (&(s->peak), __ATOMIC_RELAXED);
+			if (top <= 0 || (n == top && (b < bytes[n - 1]
+										   || (b == bytes[n - 1]
+											   && pk <= peak[n - 1])))) {
+				continue;
+			}
+			j = n < top ? n++ : n - 1;
+			for (; j > 0 && (bytes[j - 1] < b
+							 || (bytes[j - 1] == b && peak[j - 1] < pk)); j--) {
+				sel[j] = sel[j - 1];
+				bytes[j] = bytes[j - 1];
+				peak[j] = peak[j - 1];
+			}
+			sel[j] = s;
+			bytes[j] = b;
+			peak[j] = pk;
+		}
+	}
+	len = caf_mtrace_put (line, 0, "caf_mtrace: ", 0);
+	len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+						   (&(caf_mtrace_total.bytes), __ATOMIC_RELAXED), 0);
+	len = caf_mtrace_put (line, len, " live bytes in ", 0);
+	len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+						   (&(caf_mtrace_total.live), __ATOMIC_RELAXED), 0);
+	len = caf_mtrace_put (line, len, " blocks, peak ", 0);
+	len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+						   (&(caf_mtrace_total.peak), __ATOMIC_RELAXED), 0);
+	len = caf_mtrace_put (line, len, ", ", 0);
+	len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+						   (&(caf_mtrace_total.allocs), __ATOMIC_RELAXED), 0);
+	len = caf_mtrace_put (line, len, " allocs, ", 0);
+	len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+						   (&(caf_mtrace_total.frees), __ATOMIC_RELAXED), 0);
+	len = caf_mtrace_put (line, len, " frees, ", 0);
+	len = caf_mtrace_putn (line, len, (unsigned long)sites, 0);
+	len = caf_mtrace_put (line, len, " sites\n", 0);
+	len = caf_mtrace_put (line, len, "live bytes", 12);
+	len = caf_mtrace_put (line, len, " ", 0);
+	len = caf_mtrace_put (line, len, "blocks", 10);
+	len = caf_mtrace_put (line, len, " ", 0);
+	len = caf_mtrace_put (line, len, "peak bytes", 12);
+	len = caf_mtrace_put (line, len, " ", 0);
+	len = caf_mtrace_put (line, len, "allocs", 10);
+	len = caf_mtrace_put (line, len, "  site\n", 0);
+	if (write (fd, line, len) < 0) {
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		s = sel[i];
+		len = caf_mtrace_putn (line, 0, (unsigned long)bytes[i], 12);
+		len = caf_mtrace_put (line, len, " ", 0);
+		len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+							   (&(s->live), __ATOMIC_RELAXED), 10);
+		len = caf_mtrace_put (line, len, " ", 0);
+		len = caf_mtrace_putn (line, len, (unsigned long)peak[i], 12);
+		len = caf_mtrace_put (line, len, " ", 0);
+		len = caf_mtrace_putn (line, len, (unsigned long)__atomic_load_n
+							   (&(s->allocs), __ATOMIC_RELAXED), 10);
+		len = caf_mtrace_put (line, len, "  ", 0);
+		len = caf_mtrace_put (line, len, s->file, 0);
+		len = caf_mtrace_put (line, len, ":", 0);
+		len = caf_mtrace_putn (line, len, (unsigned long)s->line, 0);
+		/* a truncated line still ends the row */
+		line[len < CAF_MTRACE_LINE ? len++ : CAF_MTRACE_LINE - 1] = '\n';
+		if (write (fd, line, len) < 0) {
+			return i;
+		}
+	}
+	return n;
+}
+
+
+static void
+caf_mtrace_exit (void) {
+	caf_mtrace_dump (caf_mtrace_fd, caf_mtrace_top);
+}
+
+
+static void
+caf_mtrace_signal (int sig) {
+	(void)sig;
+	caf_mtrace_dump (caf_mtrace_fd, caf_mtrace_top);
+}
+
+
+int
+caf_mtrace_report (int fd, int top, int sig) {
+	static int registered = 0;
+	struct sigaction sa;
+	if (fd < 0) {
+		return CAF_ERROR;
+	}
+	caf_mtrace_fd = fd;
+	caf_mtrace_top = top;
+	if (!registered) {
+		if (atexit (caf_mtrace_exit) != 0) {
+			return CAF_ERROR;
+		}
+		registered = 1;
+	}
+	if (sig > 0) {
+		memset (&sa, 0, sizeof (sa));
+		sa.sa_handler = caf_mtrace_signal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset (&(sa.sa_mask));
+		if (sigaction (sig, &sa, (struct sigaction *)NULL) != 0) {
+			return CAF_ERROR;
+		}
+	}
+	return CAF_OK;
+}
+
+#endif /* !CAFFEINE_MEMTRACE */
+
+
+caf_npool_t *
+caf_npool_new (size_t node_sz, size_t cap) {
+	caf_npool_t *pool;
+	if (node_sz == 0) {
+		return (caf_npool_t *)NULL;
+	}
+	pool = (caf_npool_t *)xmalloc (CAF_NPOOL_SZ);
+	if (pool != (caf_npool_t *)NULL) {
+		pool->free = (void *)NULL;
+		pool->node_sz = node_sz < sizeof (void *) ? sizeof (void *) : node_sz;
+		pool->cap = cap;
+		pool->cached = 0;
+		pool->allocs = 0;
+		pool->frees = 0;
+		pool->hits = 0;
+	}
+	return pool;
+}
+
+
+int
+caf_npool_delete (caf_npool_t *pool) {
+	if (pool != (caf_npool_t *)NULL) {
+		caf_npool_set_cap (pool, 0);
+		xfree (pool);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+void *
+caf_npool_get (caf_npool_t *pool) {
+	void *ptr;
+	if (pool == (caf_npool_t *)NULL) {
+		return (void *)NULL;
+	}
+	ptr = pool->free;
+	if (ptr != (void *)NULL) {
+		pool->free = *((void **)ptr);
+		pool->cached--;
+		pool->hits++;
+		return ptr;
+	}
+	ptr = xmalloc (pool->node_sz);
+	if (ptr != (void *)NULL) {
+		pool->allocs++;
+	}
+	return ptr;
+}
+
+
+void
+caf_npool_put (caf_npool_t *pool, void *ptr) {
+	if (pool == (caf_npool_t *)NULL || ptr == (void *)NULL) {
+		return;
+	}
+	if (pool->cached < pool->cap) {
+		*((void **)ptr) = pool->free;
+		pool->free = ptr;
+		pool->cached++;
+	} else {
+		xfree (ptr);
+		pool->frees++;
+	}
+}
+
+
+int
+caf_npool_set_cap (caf_npool_t *pool, size_t cap) {
+	void *ptr;
+	if (pool == (caf_npool_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pool->cap = cap;
+	while (pool->cached > cap) {
+		ptr = pool->free;
+		pool->free = *((void **)ptr);
+		pool->cached--;
+		xfree (ptr);
+		pool->frees++;
+	}
+	return CAF_OK;
+}
+
+
+/* block header size, keeps the first allocation aligned */
+#define CAF_ARENA_HDR       ((sizeof (caf_arena_blk_t) + CAF_ARENA_ALIGN - 1) \
+							 & ~((size_t)CAF_ARENA_ALIGN - 1))
+
+#define CAF_ARENA_ROUND(sz) (((sz) + CAF_ARENA_ALIGN - 1) \
+							 & ~((size_t)CAF_ARENA_ALIGN - 1))
+
+#define CAF_ARENA_DATA(b)   ((char *)(b) + CAF_ARENA_HDR)
+
+/* largest request that can be rounded and given a header without wrapping */
+#define CAF_ARENA_MAX       ((size_t)-1 - CAF_ARENA_ALIGN - CAF_ARENA_HDR)
+
+static caf_arena_blk_t *caf_arena_blk_new (caf_arena_t *a, size_t sz);
+static void caf_arena_blk_free (caf_arena_blk_t *b);
+
+
+caf_arena_t *
+caf_arena_new (size_t blk_sz) {
+	caf_arena_t *a;
+	if (blk_sz > CAF_ARENA_MAX) {
+		return (caf_arena_t *)NULL;
+	}
+	a = (caf_arena_t *)xmalloc (CAF_ARENA_SZ);
+	if (a != (caf_arena_t *)NULL) {
+		a->blk = (caf_arena_blk_t *)NULL;
+		a->spare = (caf_arena_blk_t *)NULL;
+		a->blk_sz = CAF_ARENA_ROUND (blk_sz > 0 ? blk_sz : CAF_ARENA_BLK);
+		a->blocks = 0;
+		a->allocs = 0;
+		a->used = 0;
+	}
+	return a;
+}
+
+
+int
+caf_arena_delete (caf_arena_t *a) {
+	if (a != (caf_arena_t *)NULL) {
+		caf_arena_blk_free (a->blk);
+		caf_arena_blk_free (a->spare);
+		xfree (a);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+void *
+caf_arena_alloc (caf_arena_t *a, size_t sz) {
+	caf_arena_blk_t *b;
+	void *ptr;
+	if (a == (caf_arena_t *)NULL || sz == 0 || sz > CAF_ARENA_MAX) {
+		return (void *)NULL;
+	}
+	sz = CAF_ARENA_ROUND (sz);
+	b = a->blk;
+	if (b == (caf_arena_blk_t *)NULL || b->sz - b->used < sz) {
+		if (sz > a->blk_sz) {
+			/* oversized, the current block keeps its free space */
+			b = caf_arena_blk_new (a, sz);
+			if (b == (caf_arena_blk_t *)NULL) {
+				return (void *)NULL;
+			}
+			if (a->blk != (caf_arena_blk_t *)NULL) {
+				b->next = a->blk->next;
+				a->blk->next = b;
+			} else {
+				a->blk = b;
+			}
+		} else {
+			b = a->spare;
+			if (b != (caf_arena_blk_t *)NULL) {
+				a->spare = b->next;
+			} else {
+				b = caf_arena_blk_new (a, a->blk_sz);
+				if (b == (caf_arena_blk_t *)NULL) {
+					return (void *)NULL;
+				}
+			}
+			b->next = a->blk;
+			a->blk = b;
+		}
+	}
+	ptr = CAF_ARENA_DATA (b) + b->used;
+	b->used += sz;
+	a->used += sz;
+	a->allocs++;
+	return ptr;
+}
+
+
+void *
+caf_arena_realloc (caf_arena_t *a, void *ptr, size_t old_sz, size_t sz) {
+	caf_arena_blk_t *b;
+	size_t osz, nsz;
+	void *r;
+	if (a == (caf_arena_t *)NULL || sz > CAF_ARENA_MAX) {
+		return (void *)NULL;
+	}
+	if (ptr == (void *)NULL) {
+		return caf_arena_alloc (a, sz);
+	}
+	b = a->blk;
+	osz = CAF_ARENA_ROUND (old_sz);
+	nsz = CAF_ARENA_ROUND (sz);
+	if (b != (caf_arena_blk_t *)NULL && nsz > 0
+		&& (char *)ptr + osz == CAF_ARENA_DATA (b) + b->used
+		&& b->used - osz + nsz <= b->sz) {
+		b->used = b->used - osz + nsz;
+		a->used = a->used - osz + nsz;
+		return ptr;
+	}
+	r = caf_arena_alloc (a, sz);
+	if (r != (void *)NULL) {
+		memcpy (r, ptr, old_sz < sz ? old_sz : sz);
+	}
+	return r;
+}
+
+
+int
+caf_arena_reset (caf_arena_t *a) {
+	caf_arena_blk_t *b, *next;
+	if (a == (caf_arena_t *)NULL) {
+		return CAF_ERROR;
+	}
+	b = a->blk;
+	while (b != (caf_arena_blk_t *)NULL) {
+		next = b->next;
+		if (b->sz == a->blk_sz) {
+			b->used = 0;
+			b->next = a->spare;
+			a->spare = b;
+		} else {
+			xfree (b);
+		}
+		b = next;
+	}
+	a->blk = (caf_arena_blk_t *)NULL;
+	a->used = 0;
+	return CAF_OK;
+}
+
+
+static caf_arena_blk_t *
+caf_arena_blk_new (caf_arena_t *a, size_t sz) {
+	caf_arena_blk_t *b;
+	b = (caf_arena_blk_t *)xmalloc (CAF_ARENA_HDR + sz);
+	if (b != (caf_arena_blk_t *)NULL) {
+		b->next = (caf_arena_blk_t *)NULL;
+		b->sz = sz;
+		b->used = 0;
+		a->blocks++;
+	}
+	return b;
+}
+
+
+static void
+caf_arena_blk_free (caf_arena_blk_t *b) {
+	caf_arena_blk_t *next;
+	while (b != (caf_arena_blk_t *)NULL) {
+		next = b->next;
+		xfree (b);
+		b = next;
+	}
+}
+
+
+/* only with CAF_USE_SLAB: initial-exec TLS marks the library
+   STATIC_TLS, which a dlopen() may refuse to load */
+#if defined(__GNUC__) && defined(CAF_USE_SLAB)
+#define CAF_SLAB_TLS        __thread __attribute__((tls_model("initial-exec")))
+#endif /* !__GNUC__ || !CAF_USE_SLAB */
+
+/* the two magazines a thread keeps per size class */
+typedef struct caf_slab_cache_s caf_slab_cache_t;
+struct caf_slab_cache_s {
+	caf_slab_mag_t *loaded;
+	caf_slab_mag_t *prev;
+};
+
+static const size_t caf_slab_sizes[CAF_SLAB_CLASSES] = {
+	16, 32, 48, 64, 80, 96, 128, 160, 192, 256, 384, 512
+};
+
+static caf_slab_class_t caf_slab_classes[CAF_SLAB_CLASSES];
+/* size class by size in 16 byte steps */
+static unsigned char caf_slab_index[CAF_SLAB_MAX / 16 + 1];
+static pthread_once_t caf_slab_once = PTHREAD_ONCE_INIT;
+static int caf_slab_ready = 0;
+static pthread_key_t caf_slab_key;
+#ifdef CAFFEINE_DEBUG
+static int caf_slab_poison = 1;
+#else /* !CAFFEINE_DEBUG */
+static int caf_slab_poison = 0;
+#endif /* !CAFFEINE_DEBUG */
+static unsigned char caf_slab_pattern[CAF_SLAB_MAX];
+
+#ifdef CAF_SLAB_TLS
+static CAF_SLAB_TLS caf_slab_cache_t caf_slab_cache[CAF_SLAB_CLASSES];
+static CAF_SLAB_TLS int caf_slab_cache_set = 0;
+static int caf_slab_fill (caf_slab_class_t *c, caf_slab_mag_t *m);
+#endif /* !CAF_SLAB_TLS */
+
+static void caf_slab_init (void);
+static caf_slab_class_t *caf_slab_lookup (size_t sz);
+static void caf_slab_exit (void *p);
+static void caf_slab_check (caf_slab_class_t *c, void *ptr);
+static void *caf_slab_alloc_locked (caf_slab_class_t *c);
+static void caf_slab_free_locked (caf_slab_class_t *c, void *ptr);
+
+
+static void
+caf_slab_init (void) {
+	int i, c = 0;
+	for (i = 0; i <= CAF_SLAB_MAX / 16; i++) {
+		while (caf_slab_sizes[c] < (size_t)i * 16) {
+			c++;
+		}
+		caf_slab_index[i] = (unsigned char)c;
+	}
+	for (i = 0; i < CAF_SLAB_CLASSES; i++) {
+		memset (&(caf_slab_classes[i]), 0, sizeof (caf_slab_class_t));
+		caf_slab_classes[i].sz = caf_slab_sizes[i];
+		pthread_mutex_init (&(caf_slab_classes[i].lock),
+							(pthread_mutexattr_t *)NULL);
+	}
+	memset (caf_slab_pattern, CAF_SLAB_POISON, CAF_SLAB_MAX);
+	pthread_key_create (&caf_slab_key, caf_slab_exit);
+	__atomic_store_n (&caf_slab_ready, 1, __ATOMIC_RELEASE);
+}
+
+
+static caf_slab_class_t *
+caf_slab_lookup (size_t sz) {
+	if (sz == 0 || sz > CAF_SLAB_MAX) {
+		return (caf_slab_class_t *)NULL;
+	}
+	if (!__atomic_load_n (&caf_slab_ready, __ATOMIC_ACQUIRE)) {
+		pthread_once (&caf_slab_once, caf_slab_init);
+	}
+	return &(caf_slab_classes[caf_slab_index[(sz + 15) / 16]]);
+}
+
+
+caf_slab_class_t *
+caf_slab_class (size_t sz) {
+	return caf_slab_lookup (sz);
+}
+
+
+void
+caf_slab_debug (int on) {
+	caf_slab_poison = on;
+}
+
+
+static void
+caf_slab_check (caf_slab_class_t *c, void *ptr) {
+	if (memcmp (ptr, caf_slab_pattern, c->sz) != 0) {
+		__atomic_add_fetch (&(c->corrupt), 1, __ATOMIC_RELAXED);
+		fprintf (stderr, "caf_slab: %p (%lu bytes) modified after release\n",
+				 ptr, (unsigned long)c->sz);
+	}
+}
+
+
+/* takes an object from the flushed list or the chunk, lock held */
+static void *
+caf_slab_alloc_locked (caf_slab_class_t *c) {
+	void *ptr = c->free;
+	if (ptr != (void *)NULL) {
+		c->free = *((void **)ptr);
+		if (caf_slab_poison) {
+			*((void **)ptr) = (void *)NULL;
+			memset (ptr, CAF_SLAB_POISON, sizeof (void *));
+		}
+		return ptr;
+	}
+	if (c->cur == (char *)NULL || c->cur + c->sz > c->end) {
+		c->cur = (char *)xmalloc (CAF_SLAB_CHUNK);
+		if (c->cur == (char *)NULL) {
+			return (void *)NULL;
+		}
+		c->end = c->cur + CAF_SLAB_CHUNK;
+		c->chunks++;
+		if (caf_slab_poison) {
+			memset (c->cur, CAF_SLAB_POISON, CAF_SLAB_CHUNK);
+		}
+	}
+	ptr = c->cur;
+	c->cur += c->sz;
+	return ptr;
+}
+
+
+static void
+caf_slab_free_locked (caf_slab_class_t *c, void *ptr) {
+	*((void **)ptr) = c->free;
+	c->free = ptr;
+}
+
+
+#ifdef CAF_SLAB_TLS
+
+/* loads an empty magazine with new objects, lock held */
+static int
+caf_slab_fill (caf_slab_class_t *c, caf_slab_mag_t *m) {
+	void *ptr;
+	while (m->rounds < CAF_SLAB_MAG) {
+		ptr = caf_slab_alloc_locked (c);
+		if (ptr == (void *)NULL) {
+			break;
+		}
+		m->obj[m->rounds++] = ptr;
+	}
+	return m->rounds > 0 ? CAF_OK : CAF_ERROR;
+}
+
+
+/* hands the magazines of an exiting thread back to the depot */
+static void
+caf_slab_exit (void *p) {
+	caf_slab_class_t *c;
+	caf_slab_mag_t *m[2];
+	int i, j;
+	(void)p;
+	for (i = 0; i < CAF_SLAB_CLASSES; i++) {
+		c = &(caf_slab_classes[i]);
+		m[0] = caf_slab_cache[i].loaded;
+		m[1] = caf_slab_cache[i].prev;
+		caf_slab_cache[i].loaded = (caf_slab_mag_t *)NULL;
+		caf_slab_cache[i].prev = (caf_slab_mag_t *)NULL;
+		pthread_mutex_lock (&(c->lock));
+		for (j = 0; j < 2; j++) {
+			if (m[j] == (caf_slab_mag_t *)NULL) {
+				continue;
+			}
+			if (m[j]->rounds == CAF_SLAB_MAG) {
+				m[j]->next = c->full;
+				c->full = m[j];
+				continue;
+			}
+			while (m[j]->rounds > 0) {
+				caf_slab_free_locked (c, m[j]->obj[--(m[j]->rounds)]);
+			}
+			m[j]->next = c->empty;
+			c->empty = m[j];
+		}
+		pthread_mutex_unlock (&(c->lock));
+	}
+	caf_slab_cache_set = 0;
+}
+
+
+void *
+caf_slab_alloc (size_t sz) {
+	caf_slab_class_t *c = caf_slab_lookup (sz);
+	caf_slab_cache_t *t;
+	caf_slab_mag_t *m;
+	void *ptr;
+	if (c == (caf_slab_class_t *)NULL) {
+		return xmalloc (sz);
+	}
+	t = &(caf_slab_cache[c - caf_slab_classes]);
+	m = t->loaded;
+	if (m == (caf_slab_mag_t *)NULL || m->rounds == 0) {
+		if (t->prev != (caf_slab_mag_t *)NULL && t->prev->rounds > 0) {
+			t->loaded = t->prev;
+			t->prev = m;
+		} else {
+			if (!caf_slab_cache_set) {
+				caf_slab_cache_set = 1;
+				pthread_setspecific (caf_slab_key, (void *)caf_slab_cache);
+			}
+			pthread_mutex_lock (&(c->lock));
+			c->trades++;
+			if (c->full != (caf_slab_mag_t *)NULL) {
+				/* the empty one goes back, a full one comes */
+				if (t->prev != (caf_slab_mag_t *)NULL) {
+					t->prev->next = c->empty;
+					c->empty = t->prev;
+				}
+				t->prev = m;
+				t->loaded = c->full;
+				c->full = t->loaded->next;
+			} else {
+				if (m == (caf_slab_mag_t *)NULL) {
+					m = (caf_slab_mag_t *)xmalloc (sizeof (caf_slab_mag_t));
+					if (m == (caf_slab_mag_t *)NULL) {
+						ptr = caf_slab_alloc_locked (c);
+						pthread_mutex_unlock (&(c->lock));
+						return ptr;
+					}
+					m->rounds = 0;
+					t->loaded = m;
+				}
+				if (caf_slab_fill (c, m) != CAF_OK) {
+					pthread_mutex_unlock (&(c->lock));
+					return (void *)NULL;
+				}
+			}
+			pthread_mutex_unlock (&(c->lock));
+		}
+		m = t->loaded;
+	}
+	ptr = m->obj[--(m->rounds)];
+	if (caf_slab_poison) {
+		caf_slab_check (c, ptr);
+	}
+	return ptr;
+}
+
+
+void
+caf_slab_free (void *ptr, size_t sz) {
+	caf_slab_class_t *c;
+	caf_slab_cache_t *t;
+	caf_slab_mag_t *m;
+	if (ptr == (void *)NULL) {
+		return;
+	}
+	c = caf_slab_lookup (sz);
+	if (c == (caf_slab_class_t *)NULL) {
+		xfree (ptr);
+		return;
+	}
+	if (caf_slab_poison) {
+		memset (ptr, CAF_SLAB_POISON, c->sz);
+	}
+	t = &(caf_slab_cache[c - caf_slab_classes]);
+	m = t->loaded;
+	if (m == (caf_slab_mag_t *)NULL || m->rounds == CAF_SLAB_MAG) {
+		if (t->prev != (caf_slab_mag_t *)NULL
+			&& t->prev->rounds < CAF_SLAB_MAG) {
+			t->loaded = t->prev;
+			t->prev = m;
+		} else {
+			if (!caf_slab_cache_set) {
+				caf_slab_cache_set = 1;
+				pthread_setspecific (caf_slab_key, (void *)caf_slab_cache);
+			}
+			pthread_mutex_lock (&(c->lock));
+			c->trades++;
+			/* the full one goes to the depot, an empty one comes */
+			if (t->prev != (caf_slab_mag_t *)NULL) {
+				t->prev->next = c->full;
+				c->full = t->prev;
+			}
+			t->prev = m;
+			t->loaded = c->empty;
+			if (t->loaded != (caf_slab_mag_t *)NULL) {
+				c->empty = t->loaded->next;
+			} else {
+				t->loaded = (caf_slab_mag_t *)
+					xmalloc (sizeof (caf_slab_mag_t));
+				if (t->loaded == (caf_slab_mag_t *)NULL) {
+					caf_slab_free_locked (c, ptr);
+					pthread_mutex_unlock (&(c->lock));
+					return;
+				}
+			}
+			t->loaded->rounds = 0;
+			pthread_mutex_unlock (&(c->lock));
+		}
+		m = t->loaded;
+	}
+	m->obj[m->rounds++] = ptr;
+}
+
+#else /* !CAF_SLAB_TLS */
+
+static void
+caf_slab_exit (void *p) {
+	(void)p;
+}
+
+
+void *
+caf_slab_alloc (size_t sz) {
+	caf_slab_class_t *c = caf_slab_lookup (sz);
+	void *ptr;
+	if (c == (caf_slab_class_t *)NULL) {
+		return xmalloc (sz);
+	}
+	pthread_mutex_lock (&(c->lock));
+	ptr = caf_slab_alloc_locked (c);
+	pthread_mutex_unlock (&(c->lock));
+	if (ptr != (void *)NULL && caf_slab_poison) {
+		caf_slab_check (c, ptr);
+	}
+	return ptr;
+}
+
+
+void
+caf_slab_free (void *ptr, size_t sz) {
+	caf_slab_class_t *c;
+	if (ptr == (void *)NULL) {
+		return;
+	}
+	c = caf_slab_lookup (sz);
+	if (c == (caf_slab_class_t *)NULL) {
+		xfree (ptr);
+		return;
+	}
+	if (caf_slab_poison) {
+		memset (ptr, CAF_SLAB_POISON, c->sz);
+	}
+	pthread_mutex_lock (&(c->lock));
+	caf_slab_free_locked (c, ptr);
+	pthread_mutex_unlock (&(c->lock));
+}
+
+#endif /* !CAF_SLAB_TLS */
+
 /* caf_data_mem.c ends here */
 
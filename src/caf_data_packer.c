@@ -133,9 +133,11 @@ caf_unit_delete (caf_unit_t *r) {
 }
 
 
-caf_unit_value_t *
-caf_unit_value_new (caf_unit_type_t type, size_t sz, void *data) {
+static caf_unit_value_t *
+caf_unit_value_alloc (caf_arena_t *arena, caf_unit_type_t type, size_t sz,
+					  void *data) {
 	caf_unit_value_t *r = (caf_unit_value_t *)NULL;
+	size_t hsz = CAF_UNIT_VALUE_SZ;
 	if (sz > 0 && data != (void *)NULL) {
 		switch (type) {
 		case CAF_UNIT_OCTET:
@@ -144,12 +146,31 @@ caf_unit_value_new (caf_unit_type_t type, size_t sz, void *data) {
 		case CAF_UNIT_QWORD:
 		case CAF_UNIT_STRING:
 		case CAF_UNIT_PSTRING:
-			r = (caf_unit_value_t *)xmalloc (CAF_UNIT_VALUE_SZ);
-			if (r != (caf_unit_value_t *)NULL) {
-				r->type = type;
-				r->sz = sz;
-				memcpy (r->data, data, sz);
+			if (arena != (caf_arena_t *)NULL) {
+				/* one allocation, the data follows the aligned value */
+				hsz = (hsz + CAF_ARENA_ALIGN - 1)
+					& ~((size_t)CAF_ARENA_ALIGN - 1);
+				r = (caf_unit_value_t *)caf_arena_alloc (arena, hsz + sz);
+				if (r == (caf_unit_value_t *)NULL) {
+					break;
+				}
+				r->data = (void *)((char *)r + hsz);
+			} else {
+				r = (caf_unit_value_t *)xobjalloc (CAF_UNIT_VALUE_SZ);
+				if (r == (caf_unit_value_t *)NULL) {
+					break;
+				}
+				r->data = xmalloc (sz);
+				if (r->data == (void *)NULL) {
+					xobjfree (r, CAF_UNIT_VALUE_SZ);
+					r = (caf_unit_value_t *)NULL;
+					break;
+				}
 			}
+			r->type = type;
+			r->sz = sz;
+			r->arena = arena;
+			memcpy (r->data, data, sz);
 			break;
 		}
 	}
@@ -157,11 +178,29 @@ caf_unit_value_new (caf_unit_type_t type, size_t sz, void *data) {
 }
 
 
+caf_unit_value_t *
+caf_unit_value_new (caf_unit_type_t type, size_t sz, void *data) {
+	return caf_unit_value_alloc ((caf_arena_t *)NULL, type, sz, data);
+}
+
+
+caf_unit_value_t *
+caf_unit_value_new_arena (caf_arena_t *arena, caf_unit_type_t type,
+						  size_t sz, void *data) {
+	if (arena != (caf_arena_t *)NULL) {
+		return caf_unit_value_alloc (arena, type, sz, data);
+	}
+	return (caf_unit_value_t *)NULL;
+}
+
+
 int
 caf_unit_value_delete (caf_unit_value_t *r) {
 	if (r != (caf_unit_value_t *)NULL) {
-		xfree (r->data);
-		xfree (r);
+		if (r->arena == (caf_arena_t *)NULL) {
+			xfree (r->data);
+			xobjfree (r, CAF_UNIT_VALUE_SZ);
+		}
 		return CAF_OK;
 	}
 	return CAF_ERROR;
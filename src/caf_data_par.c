@@ -0,0 +1,663 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_data_deque.h"
+#include "caf/caf_data_cdeque.h"
+#include "caf/caf_data_lstc.h"
+#include "caf/caf_thread_exec.h"
+#include "caf/caf_data_par.h"
+
+#define CAF_PAR_OP_MAP            0
+#define CAF_PAR_OP_SEARCH         1
+#define CAF_PAR_OP_SEARCH_ALL     2
+#define CAF_PAR_OP_REDUCE         3
+
+/* node layout access, so every list type shares the chunk code */
+typedef void *(*caf_par_next_f)(void *n);
+typedef void *(*caf_par_data_f)(void *n);
+
+typedef struct caf_par_op_s caf_par_op_t;
+struct caf_par_op_s {
+	int kind;
+	caf_par_next_f next;
+	caf_par_data_f data;
+	CAF_CAF_DEQUENODE_CBMAP(step);
+	CAF_CAF_DEQUENODE_CBSRCH(srch);
+	CAF_PAR_CBREDUCE(red);
+	CAF_PAR_CBCOMB(comb);
+	void *key;
+	void *init;
+	/* lowest chunk index holding a match, for first match searches */
+	int best;
+};
+
+typedef struct caf_par_job_s caf_par_job_t;
+struct caf_par_job_s {
+	caf_par_op_t *op;
+	caf_par_chunk_t *stat;
+	void *start;
+	int count;
+	int idx;
+	/* search match or reduce accumulator */
+	void *res;
+	deque_t *all;
+};
+
+static void caf_par_op_init (caf_par_op_t *op, int kind,
+							 caf_par_next_f next, caf_par_data_f data);
+static long caf_par_now (void);
+static void *caf_par_run (void *arg);
+static caf_par_job_t *caf_par_exec (caf_par_t *p, caf_par_op_t *op,
+									void *head, int count);
+static int caf_par_map (caf_par_t *p, caf_par_op_t *op, void *head,
+						int count);
+static void *caf_par_search (caf_par_t *p, caf_par_op_t *op, void *head,
+							 int count);
+static deque_t *caf_par_search_all (caf_par_t *p, caf_par_op_t *op,
+									void *head, int count);
+static void *caf_par_reduce (caf_par_t *p, caf_par_op_t *op, void *head,
+							 int count);
+static void *deque_par_next (void *n);
+static void *deque_par_data (void *n);
+static void *cdeque_par_next (void *n);
+static void *cdeque_par_data (void *n);
+static void *lstc_par_next (void *n);
+static void *lstc_par_data (void *n);
+static int deque_par_count (deque_t *lst);
+static int cdeque_par_count (cdeque_t *lst);
+static int lstc_par_count (lstcn_t *lst);
+
+
+caf_par_t *
+caf_par_new (pth_exec_t *exec, int chunks) {
+	caf_par_t *r = (caf_par_t *)NULL;
+	if (exec == (pth_exec_t *)NULL || chunks < 0) {
+		return r;
+	}
+	if (chunks == 0) {
+		chunks = exec->count * CAF_PAR_CHUNKS_PER_WORKER;
+	}
+	r = (caf_par_t *)xmalloc (CAF_PAR_SZ);
+	if (r != (caf_par_t *)NULL) {
+		r->stats = (caf_par_chunk_t *)xmalloc (sizeof(caf_par_chunk_t)
+											   * (size_t)chunks);
+		if (r->stats == (caf_par_chunk_t *)NULL) {
+			xfree (r);
+			return (caf_par_t *)NULL;
+		}
+		r->exec = exec;
+		r->chunks = chunks;
+		r->used = 0;
+		r->ns = 0;
+	}
+	return r;
+}
+
+
+int
+caf_par_delete (caf_par_t *p) {
+	if (p != (caf_par_t *)NULL) {
+		xfree (p->stats);
+		xfree (p);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_par_dump (FILE *out, caf_par_t *p) {
+	int i, c = 0;
+	long sum = 0, max = 0;
+	if (out == (FILE *)NULL || p == (caf_par_t *)NULL) {
+		return c;
+	}
+	for (i = 0; i < p->used; i++) {
+		c += fprintf (out, "chunk %3d: %8d/%8d elements %12ld ns\n", i,
+					  p->stats[i].visited, p->stats[i].count,
+					  p->stats[i].ns);
+		sum += p->stats[i].ns;
+		max = p->stats[i].ns > max ? p->stats[i].ns : max;
+	}
+	c += fprintf (out, "chunks %d, wall %ld ns, chunk sum %ld ns, "
+				  "slowest %ld ns\n", p->used, p->ns, sum, max);
+	return c;
+}
+
+
+int
+deque_pmap (caf_par_t *p, deque_t *lst, CAF_CAF_DEQUENODE_CBMAP(step)) {
+	caf_par_op_t op;
+	if (lst == (deque_t *)NULL || step == NULL) {
+		return 0;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_MAP, deque_par_next, deque_par_data);
+	op.step = step;
+	return caf_par_map (p, &op, lst->head, deque_par_count (lst));
+}
+
+
+void *
+deque_psearch (caf_par_t *p, deque_t *lst, void *data,
+			   CAF_CAF_DEQUENODE_CBSRCH(srch)) {
+	caf_par_op_t op;
+	if (lst == (deque_t *)NULL || srch == NULL) {
+		return NULL;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_SEARCH, deque_par_next,
+					 deque_par_data);
+	op.srch = srch;
+	op.key = data;
+	return caf_par_search (p, &op, lst->head, deque_par_count (lst));
+}
+
+
+deque_t *
+deque_psearch_all (caf_par_t *p, deque_t *lst, void *data,
+				   CAF_CAF_DEQUENODE_CBSRCH(srch)) {
+	caf_par_op_t op;
+	if (lst == (deque_t *)NULL || srch == NULL) {
+		return (deque_t *)NULL;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_SEARCH_ALL, deque_par_next,
+					 deque_par_data);
+	op.srch = srch;
+	op.key = data;
+	return caf_par_search_all (p, &op, lst->head, deque_par_count (lst));
+}
+
+
+void *
+deque_preduce (caf_par_t *p, deque_t *lst, void *init,
+			   CAF_PAR_CBREDUCE(red), CAF_PAR_CBCOMB(comb)) {
+	caf_par_op_t op;
+	if (lst == (deque_t *)NULL || red == NULL || comb == NULL) {
+		return init;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_REDUCE, deque_par_next,
+					 deque_par_data);
+	op.red = red;
+	op.comb = comb;
+	op.init = init;
+	return caf_par_reduce (p, &op, lst->head, deque_par_count (lst));
+}
+
+
+int
+cdeque_pmap (caf_par_t *p, cdeque_t *lst, CAF_LSTDLCNODE_CBMAP(step)) {
+	caf_par_op_t op;
+	if (lst == (cdeque_t *)NULL || step == NULL) {
+		return 0;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_MAP, cdeque_par_next, cdeque_par_data);
+	op.step = step;
+	return caf_par_map (p, &op, lst->head, cdeque_par_count (lst));
+}
+
+
+void *
+cdeque_psearch (caf_par_t *p, cdeque_t *lst, void *data,
+				CAF_LSTDLCNODE_CBSRCH(srch)) {
+	caf_par_op_t op;
+	if (lst == (cdeque_t *)NULL || srch == NULL) {
+		return NULL;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_SEARCH, cdeque_par_next,
+					 cdeque_par_data);
+	op.srch = srch;
+	op.key = data;
+	return caf_par_search (p, &op, lst->head, cdeque_par_count (lst));
+}
+
+
+deque_t *
+cdeque_psearch_all (caf_par_t *p, cdeque_t *lst, void *data,
+					CAF_LSTDLCNODE_CBSRCH(srch)) {
+	caf_par_op_t op;
+	if (lst == (cdeque_t *)NULL || srch == NULL) {
+		return (deque_t *)NULL;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_SEARCH_ALL, cdeque_par_next,
+					 cdeque_par_data);
+	op.srch = srch;
+	op.key = data;
+	return caf_par_search_all (p, &op, lst->head, cdeque_par_count (lst));
+}
+
+
+void *
+cdeque_preduce (caf_par_t *p, cdeque_t *lst, void *init,
+				CAF_PAR_CBREDUCE(red), CAF_PAR_CBCOMB(comb)) {
+	caf_par_op_t op;
+	if (lst == (cdeque_t *)NULL || red == NULL || comb == NULL) {
+		return init;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_REDUCE, cdeque_par_next,
+					 cdeque_par_data);
+	op.red = red;
+	op.comb = comb;
+	op.init = init;
+	return caf_par_reduce (p, &op, lst->head, cdeque_par_count (lst));
+}
+
+
+int
+lstc_pmap (caf_par_t *p, lstcn_t *lst, CAF_LSTCNODE_CBMAP(step)) {
+	caf_par_op_t op;
+	if (lst == (lstcn_t *)NULL || step == NULL) {
+		return 0;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_MAP, lstc_par_next, lstc_par_data);
+	op.step = step;
+	return caf_par_map (p, &op, lst, lstc_par_count (lst));
+}
+
+
+void *
+lstc_psearch (caf_par_t *p, lstcn_t *lst, void *data,
+			  CAF_LSTCNODE_CBSRCH(srch)) {
+	caf_par_op_t op;
+	if (lst == (lstcn_t *)NULL || srch == NULL) {
+		return NULL;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_SEARCH, lstc_par_next, lstc_par_data);
+	op.srch = srch;
+	op.key = data;
+	return caf_par_search (p, &op, lst, lstc_par_count (lst));
+}
+
+
+deque_t *
+lstc_psearch_all (caf_par_t *p, lstcn_t *lst, void *data,
+				  CAF_LSTCNODE_CBSRCH(srch)) {
+	caf_par_op_t op;
+	if (lst == (lstcn_t *)NULL || srch == NULL) {
+		return (deque_t *)NULL;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_SEARCH_ALL, lstc_par_next,
+					 lstc_par_data);
+	op.srch = srch;
+	op.key = data;
+	return caf_par_search_all (p, &op, lst, lstc_par_count (lst));
+}
+
+
+void *
+lstc_preduce (caf_par_t *p, lstcn_t *lst, void *init,
+			  CAF_PAR_CBREDUCE(red), CAF_PAR_CBCOMB(comb)) {
+	caf_par_op_t op;
+	if (lst == (lstcn_t *)NULL || red == NULL || comb == NULL) {
+		return init;
+	}
+	caf_par_op_init (&op, CAF_PAR_OP_REDUCE, lstc_par_next, lstc_par_data);
+	op.red = red;
+	op.comb = comb;
+	op.init = init;
+	return caf_par_reduce (p, &op, lst, lstc_par_count (lst));
+}
+
+
+static void
+caf_par_op_init (caf_par_op_t *op, int kind, caf_par_next_f next,
+				 caf_par_data_f data) {
+	op->kind = kind;
+	op->next = next;
+	op->data = data;
+	op->step = NULL;
+	op->srch = NULL;
+	op->red = NULL;
+	op->comb = NULL;
+	op->key = NULL;
+	op->init = NULL;
+	op->best = INT_MAX;
+}
+
+
+static long
+caf_par_now (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+
+static void *
+caf_par_run (void *arg) {
+	caf_par_job_t *job = (caf_par_job_t *)arg;
+	caf_par_op_t *op = job->op;
+	void *n = job->start;
+	void *acc = op->init;
+	int i, m;
+	long t0 = caf_par_now ();
+	for (i = 0; i < job->count; i++, n = op->next (n)) {
+		switch (op->kind) {
+		case CAF_PAR_OP_MAP:
+			op->step (op->data (n));
+			break;
+		case CAF_PAR_OP_SEARCH:
+			/* a match in an earlier chunk wins, stop here */
+			if (__atomic_load_n (&op->best, __ATOMIC_RELAXED) < job->idx) {
+				goto done;
+			}
+			if (op->srch (op->data (n), op->key) == CAF_OK) {
+				job->res = op->data (n);
+				m = __atomic_load_n (&op->best, __ATOMIC_RELAXED);
+				while (m > job->idx
+					   && !__atomic_compare_exchange_n (&op->best, &m,
+														job->idx, 1,
+														__ATOMIC_RELAXED,
+														__ATOMIC_RELAXED)) {
+				}
+				i++;
+				goto done;
+			}
+			break;
+		case CAF_PAR_OP_SEARCH_ALL:
+			if (op->srch (op->data (n), op->key) == CAF_OK) {
+				if (deque_push (job->all, op->data (n)) == (deque_t *)NULL) {
+					job->res = job;
+					i++;
+					goto done;
+				}
+			}
+			break;
+		case CAF_PAR_OP_REDUCE:
+			acc = op->red (acc, op->data (n));
+			break;
+		}
+	}
+done:
+	if (op->kind == CAF_PAR_OP_REDUCE) {
+		job->res = acc;
+	}
+	job->stat->count = job->count;
+	job->stat->visited = i;
+	job->stat->ns = caf_par_now () - t0;
+	return job;
+}
+
+
+/*
+ * Splits the count nodes from head in p->chunks runs of consecutive
+ * nodes and waits for all of them. Returns the job array, which the
+ * caller releases, or NULL on failure.
+ */
+static caf_par_job_t *
+caf_par_exec (caf_par_t *p, caf_par_op_t *op, void *head, int count) {
+	caf_par_job_t *jobs;
+	pth_future_t **fs;
+	void *n = head, *r;
+	int i, j, used, per, extra, status = CAF_OK;
+	long t0 = caf_par_now ();
+	if (p == (caf_par_t *)NULL) {
+		return (caf_par_job_t *)NULL;
+	}
+	used = count < p->chunks ? count : p->chunks;
+	used = used > 0 ? used : 1;
+	jobs = (caf_par_job_t *)xmalloc (sizeof(caf_par_job_t) * (size_t)used);
+	fs = (pth_future_t **)xmalloc (sizeof(pth_future_t *) * (size_t)used);
+	if (jobs == (caf_par_job_t *)NULL || fs == (pth_future_t **)NULL) {
+		xfree (jobs);
+		xfree (fs);
+		return (caf_par_job_t *)NULL;
+	}
+	per = count / used;
+	extra = count % used;
+	for (i = 0; i < used; i++) {
+		jobs[i].op = op;
+		jobs[i].stat = &(p->stats[i]);
+		jobs[i].start = n;
+		jobs[i].count = per + (i < extra ? 1 : 0);
+		jobs[i].idx = i;
+		jobs[i].res = NULL;
+		jobs[i].all = (deque_t *)NULL;
+		if (op->kind == CAF_PAR_OP_SEARCH_ALL) {
+			jobs[i].all = deque_create ();
+			if (jobs[i].all == (deque_t *)NULL) {
+				status = CAF_ERROR;
+				break;
+			}
+		}
+		for (j = 0; j < jobs[i].count; j++) {
+			n = op->next (n);
+		}
+	}
+	used = i;
+	for (i = 0; i < used && status == CAF_OK; i++) {
+		fs[i] = pth_exec_async (p->exec, caf_par_run, &(jobs[i]));
+		if (fs[i] == (pth_future_t *)NULL) {
+			status = CAF_ERROR;
+			break;
+		}
+	}
+	/* every submitted chunk must finish before the jobs go away */
+	for (j = 0; j < i; j++) {
+		pth_future_wait (fs[j], &r, (const struct timespec *)NULL);
+		pth_future_delete (fs[j]);
+	}
+	xfree (fs);
+	p->used = used;
+	p->ns = caf_par_now () - t0;
+	if (status != CAF_OK) {
+		for (i = 0; i < used; i++) {
+			if (jobs[i].all != (deque_t *)NULL) {
+				deque_delete_nocb (jobs[i].all);
+			}
+		}
+		xfree (jobs);
+		return (caf_par_job_t *)NULL;
+	}
+	return jobs;
+}
+
+
+static int
+caf_par_map (caf_par_t *p, caf_par_op_t *op, void *head, int count) {
+	caf_par_job_t *jobs;
+	if (count == 0) {
+		return 0;
+	}
+	jobs = caf_par_exec (p, op, head, count);
+	if (jobs == (caf_par_job_t *)NULL) {
+		return 0;
+	}
+	xfree (jobs);
+	return count;
+}
+
+
+static void *
+caf_par_search (caf_par_t *p, caf_par_op_t *op, void *head, int count) {
+	caf_par_job_t *jobs;
+	void *r = NULL;
+	if (count == 0) {
+		return r;
+	}
+	jobs = caf_par_exec (p, op, head, count);
+	if (jobs == (caf_par_job_t *)NULL) {
+		return r;
+	}
+	if (op->best != INT_MAX) {
+		r = jobs[op->best].res;
+	}
+	xfree (jobs);
+	return r;
+}
+
+
+static deque_t *
+caf_par_search_all (caf_par_t *p, caf_par_op_t *op, void *head,
+					int count) {
+	caf_par_job_t *jobs;
+	deque_t *r, *c;
+	int i, used, status = CAF_OK;
+	if (count == 0) {
+		return deque_create ();
+	}
+	jobs = caf_par_exec (p, op, head, count);
+	if (jobs == (caf_par_job_t *)NULL) {
+		return (deque_t *)NULL;
+	}
+	used = p->used;
+	r = deque_create ();
+	/* splice the chunk results in list order */
+	for (i = 0; i < used; i++) {
+		c = jobs[i].all;
+		if (jobs[i].res != NULL || r == (deque_t *)NULL) {
+			status = CAF_ERROR;
+		}
+		if (status == CAF_OK && c->head != (caf_dequen_t *)NULL) {
+			if (r->tail == (caf_dequen_t *)NULL) {
+				r->head = c->head;
+			} else {
+				r->tail->next = c->head;
+				c->head->prev = r->tail;
+			}
+			r->tail = c->tail;
+			r->size += c->size;
+			c->head = (caf_dequen_t *)NULL;
+			c->tail = (caf_dequen_t *)NULL;
+		}
+		deque_delete_nocb (c);
+	}
+	xfree (jobs);
+	if (status != CAF_OK && r != (deque_t *)NULL) {
+		deque_delete_nocb (r);
+		r = (deque_t *)NULL;
+	}
+	return r;
+}
+
+
+static void *
+caf_par_reduce (caf_par_t *p, caf_par_op_t *op, void *head, int count) {
+	caf_par_job_t *jobs;
+	void *r;
+	int i;
+	if (count == 0) {
+		return op->init;
+	}
+	jobs = caf_par_exec (p, op, head, count);
+	if (jobs == (caf_par_job_t *)NULL) {
+		return op->init;
+	}
+	r = jobs[0].res;
+	for (i = 1; i < p->used; i++) {
+		r = op->comb (r, jobs[i].res);
+	}
+	xfree (jobs);
+	return r;
+}
+
+
+static void *
+deque_par_next (void *n) {
+	return ((caf_dequen_t *)n)->next;
+}
+
+
+static void *
+deque_par_data (void *n) {
+	return ((caf_dequen_t *)n)->data;
+}
+
+
+static void *
+cdeque_par_next (void *n) {
+	return ((caf_cdequen_t *)n)->next;
+}
+
+
+static void *
+cdeque_par_data (void *n) {
+	return ((caf_cdequen_t *)n)->data;
+}
+
+
+static void *
+lstc_par_next (void *n) {
+	return ((lstcn_t *)n)->next;
+}
+
+
+static void *
+lstc_par_data (void *n) {
+	return ((lstcn_t *)n)->data;
+}
+
+
+static int
+deque_par_count (deque_t *lst) {
+	caf_dequen_t *n;
+	int c = 0;
+	for (n = lst->head; n != (caf_dequen_t *)NULL; n = n->next) {
+		c++;
+	}
+	return c;
+}
+
+
+static int
+cdeque_par_count (cdeque_t *lst) {
+	caf_cdequen_t *n;
+	int c = 0;
+	if (lst->head == (caf_cdequen_t *)NULL
+		|| lst->tail == (caf_cdequen_t *)NULL) {
+		return c;
+	}
+	for (n = lst->head; n != lst->tail; n = n->next) {
+		c++;
+	}
+	return c + 1;
+}
+
+
+static int
+lstc_par_count (lstcn_t *lst) {
+	lstcn_t *n = lst;
+	int c = 0;
+	if (lstc_empty_list (lst) == CAF_OK) {
+		return c;
+	}
+	do {
+		c++;
+		n = n->next;
+	} while (n != lst);
+	return c;
+}
+
+/* caf_data_par.c ends here */
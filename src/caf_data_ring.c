@@ -0,0 +1,279 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_data_ring.h"
+
+static int ring_grow (ring_t *r, unsigned int cap);
+
+
+static int
+ring_grow (ring_t *r, unsigned int cap) {
+	void **slots;
+	unsigned int first;
+	slots = (void **)xmalloc (sizeof (void *) * cap);
+	if (slots == (void **)NULL) {
+		return CAF_ERROR;
+	}
+	if (r->size > 0) {
+		first = r->mask + 1 - r->head;
+		if (first >= (unsigned int)r->size) {
+			memcpy (slots, r->slots + r->head, sizeof (void *) * r->size);
+		} else {
+			memcpy (slots, r->slots + r->head, sizeof (void *) * first);
+			memcpy (slots + first, r->slots,
+					sizeof (void *) * (r->size - first));
+		}
+	}
+	xfree (r->slots);
+	r->slots = slots;
+	r->mask = cap - 1;
+	r->head = 0;
+	return CAF_OK;
+}
+
+
+ring_t *
+ring_create (int cap) {
+	ring_t *r;
+	r = (ring_t *)xmalloc (CAF_RING_SZ);
+	if (r != (ring_t *)NULL) {
+		r->slots = (void **)NULL;
+		r->mask = 0;
+		r->head = 0;
+		r->size = 0;
+		if (ring_reserve (r, cap < CAF_RING_MIN ? CAF_RING_MIN : cap)
+			!= CAF_OK) {
+			xfree (r);
+			r = (ring_t *)NULL;
+		}
+	}
+	return r;
+}
+
+
+int
+ring_delete (ring_t *r, CAF_CAF_DEQUENODE_CBDEL(del)) {
+	int cnt = 0;
+	if (r != (ring_t *)NULL) {
+		while (r->size > 0) {
+			if ((del (r->slots[r->head])) != CAF_OK) {
+				return cnt;
+			}
+			cnt++;
+			ring_pop_front (r);
+		}
+		return ring_delete_nocb (r);
+	}
+	return CAF_ERROR_SUB;
+}
+
+
+int
+ring_delete_nocb (ring_t *r) {
+	if (r != (ring_t *)NULL) {
+		xfree (r->slots);
+		xfree (r);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+ring_empty_list (ring_t *r) {
+	if (r != (ring_t *)NULL) {
+		if (r->size == 0) {
+			return CAF_OK;
+		}
+	}
+	return CAF_ERROR;
+}
+
+
+int
+ring_length (ring_t *r) {
+	if (r != (ring_t *)NULL) {
+		return r->size;
+	}
+	return CAF_ERROR_SUB;
+}
+
+
+int
+ring_reserve (ring_t *r, int cap) {
+	unsigned int c;
+	if (r == (ring_t *)NULL || cap < 0 || cap > (INT_MAX >> 1) + 1) {
+		return CAF_ERROR;
+	}
+	if (r->slots != (void **)NULL && (unsigned int)cap <= r->mask + 1) {
+		return CAF_OK;
+	}
+	for (c = CAF_RING_MIN; c < (unsigned int)cap; c <<= 1) {
+		;
+	}
+	return ring_grow (r, c);
+}
+
+
+ring_t *
+ring_push_back (ring_t *r, void *data) {
+	if (r == (ring_t *)NULL) {
+		return (ring_t *)NULL;
+	}
+	if ((unsigned int)r->size > r->mask
+		&& ring_reserve (r, r->size + 1) != CAF_OK) {
+		return (ring_t *)NULL;
+	}
+	r->slots[(r->head + r->size) & r->mask] = data;
+	r->size++;
+	return r;
+}
+
+
+ring_t *
+ring_push_front (ring_t *r, void *data) {
+	if (r == (ring_t *)NULL) {
+		return (ring_t *)NULL;
+	}
+	if ((unsigned int)r->size > r->mask
+		&& ring_reserve (r, r->size + 1) != CAF_OK) {
+		return (ring_t *)NULL;
+	}
+	r->head = (r->head - 1) & r->mask;
+	r->slots[r->head] = data;
+	r->size++;
+	return r;
+}
+
+
+void *
+ring_pop_front (ring_t *r) {
+	void *data;
+	if (r == (ring_t *)NULL || r->size == 0) {
+		return (void *)NULL;
+	}
+	data = r->slots[r->head];
+	r->head = (r->head + 1) & r->mask;
+	r->size--;
+	return data;
+}
+
+
+void *
+ring_pop_back (ring_t *r) {
+	if (r == (ring_t *)NULL || r->size == 0) {
+		return (void *)NULL;
+	}
+	r->size--;
+	return r->slots[(r->head + r->size) & r->mask];
+}
+
+
+void *
+ring_get (ring_t *r, int pos) {
+	if (r != (ring_t *)NULL && pos >= 0 && pos < r->size) {
+		return r->slots[(r->head + pos) & r->mask];
+	}
+	return (void *)NULL;
+}
+
+
+int
+ring_set (ring_t *r, int pos, void *data) {
+	if (r != (ring_t *)NULL && pos >= 0 && pos < r->size) {
+		r->slots[(r->head + pos) & r->mask] = data;
+		return pos;
+	}
+	return CAF_ERROR_SUB;
+}
+
+
+int
+ring_map (ring_t *r, CAF_CAF_DEQUENODE_CBMAP(step)) {
+	int c;
+	if (r == (ring_t *)NULL) {
+		return 0;
+	}
+	for (c = 0; c < r->size; c++) {
+		step (r->slots[(r->head + c) & r->mask]);
+	}
+	return c;
+}
+
+
+int
+ring_map_checked (ring_t *r, CAF_CAF_DEQUENODE_CBMAP(step)) {
+	int c;
+	if (r == (ring_t *)NULL) {
+		return 0;
+	}
+	for (c = 0; c < r->size; c++) {
+		if ((step (r->slots[(r->head + c) & r->mask])) != CAF_OK) {
+			return c;
+		}
+	}
+	return c;
+}
+
+
+void *
+ring_search (ring_t *r, void *data, CAF_CAF_DEQUENODE_CBSRCH(srch)) {
+	void *n;
+	int c;
+	if (r != (ring_t *)NULL) {
+		for (c = 0; c < r->size; c++) {
+			n = r->slots[(r->head + c) & r->mask];
+			if ((srch (n, data)) == CAF_OK) {
+				return n;
+			}
+		}
+	}
+	return (void *)NULL;
+}
+
+
+void
+ring_dump (FILE *out, ring_t *r, CAF_CAF_DEQUENODE_CBDUMP(dmp)) {
+	int c;
+	if (r != (ring_t *)NULL && out != (FILE *)NULL) {
+		for (c = 0; c < r->size; c++) {
+			dmp (out, r->slots[(r->head + c) & r->mask]);
+		}
+	}
+}
+
+/* caf_data_ring.c ends here */
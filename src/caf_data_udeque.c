@@ -0,0 +1,383 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_data_udeque.h"
+
+static caf_udequeb_t *udeque_block_get (udeque_t *lst);
+static void udeque_block_put (udeque_t *lst, caf_udequeb_t *b);
+static void **udeque_slot (udeque_t *lst, int pos);
+
+
+static caf_udequeb_t *
+udeque_block_get (udeque_t *lst) {
+	caf_udequeb_t *b;
+	void *mem = (void *)NULL;
+	if (lst->spare != (caf_udequeb_t *)NULL) {
+		b = lst->spare;
+		lst->spare = (caf_udequeb_t *)NULL;
+	} else {
+		if (posix_memalign (&mem, CAF_UDEQUE_ALIGN,
+							sizeof (caf_udequeb_t)) != 0) {
+			return (caf_udequeb_t *)NULL;
+		}
+		b = (caf_udequeb_t *)mem;
+	}
+	b->prev = (caf_udequeb_t *)NULL;
+	b->next = (caf_udequeb_t *)NULL;
+	b->start = 0;
+	b->count = 0;
+	return b;
+}
+
+
+static void
+udeque_block_put (udeque_t *lst, caf_udequeb_t *b) {
+	if (lst->spare == (caf_udequeb_t *)NULL) {
+		lst->spare = b;
+	} else {
+		free (b);
+	}
+}
+
+
+udeque_t *
+udeque_create (void) {
+	udeque_t *lst;
+	lst = (udeque_t *)xmalloc (CAF_UDEQUE_SZ);
+	if (lst != (udeque_t *)NULL) {
+		lst->head = (caf_udequeb_t *)NULL;
+		lst->tail = (caf_udequeb_t *)NULL;
+		lst->spare = (caf_udequeb_t *)NULL;
+		lst->size = 0;
+	}
+	return lst;
+}
+
+
+udeque_t *
+udeque_new (void *data) {
+	udeque_t *lst;
+	lst = udeque_create ();
+	if (lst != (udeque_t *)NULL) {
+		if ((udeque_push (lst, data)) == (udeque_t *)NULL) {
+			xfree (lst);
+			lst = (udeque_t *)NULL;
+		}
+	}
+	return lst;
+}
+
+
+int
+udeque_delete (udeque_t *lst, CAF_CAF_DEQUENODE_CBDEL(del)) {
+	caf_udequeb_t *b;
+	int cnt = 0;
+	if (lst != (udeque_t *)NULL) {
+		while ((b = lst->head) != (caf_udequeb_t *)NULL) {
+			if ((del (b->slots[b->start])) != CAF_OK) {
+				return cnt;
+			}
+			cnt++;
+			udeque_first (lst);
+		}
+		return udeque_delete_nocb (lst);
+	}
+	return CAF_ERROR_SUB;
+}
+
+
+int
+udeque_delete_nocb (udeque_t *lst) {
+	caf_udequeb_t *b, *destroy;
+	if (lst != (udeque_t *)NULL) {
+		b = lst->head;
+		while (b != (caf_udequeb_t *)NULL) {
+			destroy = b;
+			b = b->next;
+			free (destroy);
+		}
+		if (lst->spare != (caf_udequeb_t *)NULL) {
+			free (lst->spare);
+		}
+		xfree (lst);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+udeque_empty_list (udeque_t *lst) {
+	if (lst != (udeque_t *)NULL) {
+		if (lst->size == 0) {
+			return CAF_OK;
+		}
+	}
+	return CAF_ERROR;
+}
+
+
+int
+udeque_length (udeque_t *lst) {
+	if (lst != (udeque_t *)NULL) {
+		return lst->size;
+	}
+	return CAF_ERROR_SUB;
+}
+
+
+udeque_t *
+udeque_push (udeque_t *lst, void *data) {
+	caf_udequeb_t *b;
+	if (lst == (udeque_t *)NULL) {
+		return (udeque_t *)NULL;
+	}
+	b = lst->tail;
+	if (b == (caf_udequeb_t *)NULL
+		|| b->start + b->count == (int)CAF_UDEQUE_SLOTS) {
+		b = udeque_block_get (lst);
+		if (b == (caf_udequeb_t *)NULL) {
+			return (udeque_t *)NULL;
+		}
+		b->prev = lst->tail;
+		if (lst->tail != (caf_udequeb_t *)NULL) {
+			lst->tail->next = b;
+		} else {
+			lst->head = b;
+		}
+		lst->tail = b;
+	}
+	b->slots[b->start + b->count] = data;
+	b->count++;
+	lst->size++;
+	return lst;
+}
+
+
+udeque_t *
+udeque_push_front (udeque_t *lst, void *data) {
+	caf_udequeb_t *b;
+	if (lst == (udeque_t *)NULL) {
+		return (udeque_t *)NULL;
+	}
+	b = lst->head;
+	if (b == (caf_udequeb_t *)NULL || b->start == 0) {
+		b = udeque_block_get (lst);
+		if (b == (caf_udequeb_t *)NULL) {
+			return (udeque_t *)NULL;
+		}
+		b->start = (int)CAF_UDEQUE_SLOTS;
+		b->next = lst->head;
+		if (lst->head != (caf_udequeb_t *)NULL) {
+			lst->head->prev = b;
+		} else {
+			lst->tail = b;
+		}
+		lst->head = b;
+	}
+	b->start--;
+	b->slots[b->start] = data;
+	b->count++;
+	lst->size++;
+	return lst;
+}
+
+
+void *
+udeque_pop (udeque_t *lst) {
+	caf_udequeb_t *b;
+	void *data;
+	if (lst == (udeque_t *)NULL || lst->tail == (caf_udequeb_t *)NULL) {
+		return (void *)NULL;
+	}
+	b = lst->tail;
+	b->count--;
+	data = b->slots[b->start + b->count];
+	lst->size--;
+	if (b->count == 0) {
+		lst->tail = b->prev;
+		if (lst->tail != (caf_udequeb_t *)NULL) {
+			lst->tail->next = (caf_udequeb_t *)NULL;
+		} else {
+			lst->head = (caf_udequeb_t *)NULL;
+		}
+		udeque_block_put (lst, b);
+	}
+	return data;
+}
+
+
+void *
+udeque_first (udeque_t *lst) {
+	caf_udequeb_t *b;
+	void *data;
+	if (lst == (udeque_t *)NULL || lst->head == (caf_udequeb_t *)NULL) {
+		return (void *)NULL;
+	}
+	b = lst->head;
+	data = b->slots[b->start];
+	b->start++;
+	b->count--;
+	lst->size--;
+	if (b->count == 0) {
+		lst->head = b->next;
+		if (lst->head != (caf_udequeb_t *)NULL) {
+			lst->head->prev = (caf_udequeb_t *)NULL;
+		} else {
+			lst->tail = (caf_udequeb_t *)NULL;
+		}
+		udeque_block_put (lst, b);
+	}
+	return data;
+}
+
+
+static void **
+udeque_slot (udeque_t *lst, int pos) {
+	caf_udequeb_t *b;
+	if (lst == (udeque_t *)NULL || pos < 0 || pos >= lst->size) {
+		return (void **)NULL;
+	}
+	if (pos < lst->size / 2) {
+		b = lst->head;
+		while (pos >= b->count) {
+			pos -= b->count;
+			b = b->next;
+		}
+		return &(b->slots[b->start + pos]);
+	}
+	pos = lst->size - 1 - pos;
+	b = lst->tail;
+	while (pos >= b->count) {
+		pos -= b->count;
+		b = b->prev;
+	}
+	return &(b->slots[b->start + b->count - 1 - pos]);
+}
+
+
+void *
+udeque_get (udeque_t *lst, int pos) {
+	void **s;
+	s = udeque_slot (lst, pos);
+	if (s != (void **)NULL) {
+		return *s;
+	}
+	return (void *)NULL;
+}
+
+
+int
+udeque_set (udeque_t *lst, int pos, void *data) {
+	void **s;
+	s = udeque_slot (lst, pos);
+	if (s != (void **)NULL) {
+		*s = data;
+		return pos;
+	}
+	return CAF_ERROR_SUB;
+}
+
+
+int
+udeque_map (udeque_t *lst, CAF_CAF_DEQUENODE_CBMAP(step)) {
+	caf_udequeb_t *b;
+	int c = 0, i, e;
+	if (lst != (udeque_t *)NULL) {
+		for (b = lst->head; b != (caf_udequeb_t *)NULL; b = b->next) {
+			e = b->start + b->count;
+			for (i = b->start; i < e; i++) {
+				step (b->slots[i]);
+				c++;
+			}
+		}
+	}
+	return c;
+}
+
+
+int
+udeque_map_checked (udeque_t *lst, CAF_CAF_DEQUENODE_CBMAP(step)) {
+	caf_udequeb_t *b;
+	int c = 0, i, e;
+	if (lst != (udeque_t *)NULL) {
+		for (b = lst->head; b != (caf_udequeb_t *)NULL; b = b->next) {
+			e = b->start + b->count;
+			for (i = b->start; i < e; i++) {
+				if ((step (b->slots[i])) != CAF_OK) {
+					return c;
+				}
+				c++;
+			}
+		}
+	}
+	return c;
+}
+
+
+void *
+udeque_search (udeque_t *lst, void *data, CAF_CAF_DEQUENODE_CBSRCH(srch)) {
+	caf_udequeb_t *b;
+	int i, e;
+	if (lst != (udeque_t *)NULL) {
+		for (b = lst->head; b != (caf_udequeb_t *)NULL; b = b->next) {
+			e = b->start + b->count;
+			for (i = b->start; i < e; i++) {
+				if ((srch (b->slots[i], data)) == CAF_OK) {
+					return b->slots[i];
+				}
+			}
+		}
+	}
+	return (void *)NULL;
+}
+
+
+void
+udeque_dump (FILE *out, udeque_t *lst, CAF_CAF_DEQUENODE_CBDUMP(dmp)) {
+	caf_udequeb_t *b;
+	int i, e;
+	if (lst != (udeque_t *)NULL && out != (FILE *)NULL) {
+		for (b = lst->head; b != (caf_udequeb_t *)NULL; b = b->next) {
+			e = b->start + b->count;
+			for (i = b->start; i < e; i++) {
+				dmp (out, b->slots[i]);
+			}
+		}
+	}
+}
+
+/* caf_data_udeque.c ends here */
@@ -0,0 +1,344 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_hash_str.h"
+#include "caf/caf_hash_table.h"
+#include "caf/caf_thread_rwlock.h"
+#include "caf/caf_hash_ctable.h"
+
+
+#define CAF_HASH_CSHARD(t,h) \
+	(&((t)->shards[(t)->bits > 0 ? (h)->hash1 >> (32 - (t)->bits) : 0]))
+
+static int caf_hash_cshard_init (caf_hash_ctable_t *table,
+                                 caf_hash_cshard_t *shard);
+static void caf_hash_cshard_destroy (caf_hash_cshard_t *shard);
+static int caf_hash_cshard_wrlock (caf_hash_ctable_t *table,
+                                   caf_hash_cshard_t *shard);
+static int caf_hash_cshard_unlock (caf_hash_ctable_t *table,
+                                   caf_hash_cshard_t *shard);
+static void caf_hash_cshard_grace (caf_hash_cshard_t *shard);
+
+
+caf_hash_ctable_t *
+caf_hash_ctable_new (const int id, const size_t shards, const int flags,
+                     CAF_HASH_STR_FUNCTION(f1), CAF_HASH_STR_FUNCTION(f2)) {
+	caf_hash_ctable_t *r = (caf_hash_ctable_t *)NULL;
+	size_t i;
+	if (id > 0 && f1 != NULL && shards <= CAF_HASH_CTABLE_MAXSHARDS) {
+		r = (caf_hash_ctable_t *)xmalloc (CAF_HASH_CTABLE_SZ);
+		if (r != (caf_hash_ctable_t *)NULL) {
+			r->id = id;
+			r->flags = flags;
+			r->f1 = f1;
+			r->f2 = f2;
+			r->count = 1;
+			r->bits = 0;
+			while (r->count < (shards > 0 ? shards : CAF_HASH_CTABLE_SHARDS)) {
+				r->count <<= 1;
+				r->bits++;
+			}
+			r->shards = (caf_hash_cshard_t *)xmalloc (CAF_HASH_CSHARD_SZ
+			                                          * r->count);
+			if (r->shards == (caf_hash_cshard_t *)NULL) {
+				xfree (r);
+				return (caf_hash_ctable_t *)NULL;
+			}
+			memset (r->shards, 0, CAF_HASH_CSHARD_SZ * r->count);
+			for (i = 0; i < r->count; i++) {
+				if ((caf_hash_cshard_init (r, &(r->shards[i]))) != CAF_OK) {
+					caf_hash_ctable_delete (r);
+					return (caf_hash_ctable_t *)NULL;
+				}
+			}
+		}
+	}
+	return r;
+}
+
+
+int
+caf_hash_ctable_delete (caf_hash_ctable_t *table) {
+	size_t i;
+	if (table != (caf_hash_ctable_t *)NULL) {
+		for (i = 0; i < table->count; i++) {
+			caf_hash_cshard_destroy (&(table->shards[i]));
+		}
+		xfree (table->shards);
+		xfree (table);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_hash_ctable_add (caf_hash_ctable_t *table, const void *key,
+                     const size_t ksz, const void *data) {
+	caf_hash_cshard_t *shard;
+	caf_hash_t probe;
+	int r = CAF_ERROR;
+	if (table != (caf_hash_ctable_t *)NULL &&
+		caf_hash_init (&probe, key, ksz, data, table->f1, table->f2)
+		== CAF_OK) {
+		shard = CAF_HASH_CSHARD(table, &probe);
+		if ((caf_hash_cshard_wrlock (table, shard)) == CAF_OK) {
+			r = caf_hash_table_add_hash (shard->table, &probe);
+			caf_hash_cshard_unlock (table, shard);
+		}
+	}
+	return r;
+}
+
+
+int
+caf_hash_ctable_remove (caf_hash_ctable_t *table, const void *key,
+                        const size_t ksz) {
+	caf_hash_cshard_t *shard;
+	caf_hash_t probe;
+	int r = CAF_ERROR;
+	if (table != (caf_hash_ctable_t *)NULL &&
+		caf_hash_init (&probe, key, ksz, (const void *)NULL, table->f1,
+		               table->f2) == CAF_OK) {
+		shard = CAF_HASH_CSHARD(table, &probe);
+		if ((caf_hash_cshard_wrlock (table, shard)) == CAF_OK) {
+			r = caf_hash_table_remove_hash (shard->table, &probe);
+			caf_hash_cshard_unlock (table, shard);
+		}
+	}
+	return r;
+}
+
+
+void *
+caf_hash_ctable_get (caf_hash_ctable_t *table, const void *key,
+                     const size_t ksz) {
+	caf_hash_cshard_t *shard;
+	caf_hash_t probe;
+	void *data = (void *)NULL;
+	unsigned int seq, epoch;
+	int i, ok = 0;
+	if (table != (caf_hash_ctable_t *)NULL &&
+		caf_hash_init (&probe, key, ksz, (const void *)NULL, table->f1,
+		               table->f2) == CAF_OK) {
+		shard = CAF_HASH_CSHARD(table, &probe);
+		if (table->flags & CAF_HASH_CTABLE_LOCKFREE) {
+			/* counted, so reclaim cannot free an array under the peek */
+			epoch = __atomic_load_n (&(shard->epoch), __ATOMIC_SEQ_CST) & 1;
+			__atomic_add_fetch (&(shard->readers[epoch]), 1,
+			                    __ATOMIC_SEQ_CST);
+			for (i = 0; i < CAF_HASH_CTABLE_SPINS && !ok; i++) {
+				seq = __atomic_load_n (&(shard->seq), __ATOMIC_ACQUIRE);
+				if (seq & 1) {
+					continue;
+				}
+				caf_hash_table_peek (shard->table, &probe, &data);
+				__atomic_thread_fence (__ATOMIC_ACQUIRE);
+				ok = seq == __atomic_load_n (&(shard->seq), __ATOMIC_RELAXED);
+			}
+			__atomic_sub_fetch (&(shard->readers[epoch]), 1,
+			                    __ATOMIC_RELEASE);
+			if (ok) {
+				return data;
+			}
+			data = (void *)NULL;
+		}
+		if ((pth_rwl_rdlock (shard->lock, 0, (struct timespec *)NULL))
+			== CAF_OK) {
+			data = caf_hash_table_get_hash (shard->table, &probe);
+			pth_rwl_unlock (shard->lock);
+			return data;
+		}
+	}
+	return (void *)NULL;
+}
+
+
+int
+caf_hash_ctable_set (caf_hash_ctable_t *table, const void *key,
+                     const size_t ksz, void *data) {
+	caf_hash_cshard_t *shard;
+	caf_hash_t probe;
+	int r = CAF_ERROR;
+	if (table != (caf_hash_ctable_t *)NULL &&
+		caf_hash_init (&probe, key, ksz, data, table->f1, table->f2)
+		== CAF_OK) {
+		shard = CAF_HASH_CSHARD(table, &probe);
+		if ((caf_hash_cshard_wrlock (table, shard)) == CAF_OK) {
+			r = caf_hash_table_set_hash (shard->table, &probe);
+			caf_hash_cshard_unlock (table, shard);
+		}
+	}
+	return r;
+}
+
+
+size_t
+caf_hash_ctable_count (caf_hash_ctable_t *table) {
+	size_t i, c = 0;
+	caf_hash_cshard_t *shard;
+	if (table != (caf_hash_ctable_t *)NULL) {
+		for (i = 0; i < table->count; i++) {
+			shard = &(table->shards[i]);
+			if ((pth_rwl_rdlock (shard->lock, 0, (struct timespec *)NULL))
+				== CAF_OK) {
+				c += shard->table->count;
+				pth_rwl_unlock (shard->lock);
+			}
+		}
+	}
+	return c;
+}
+
+
+int
+caf_hash_ctable_reclaim (caf_hash_ctable_t *table) {
+	size_t i;
+	caf_hash_cshard_t *shard;
+	if (table != (caf_hash_ctable_t *)NULL) {
+		for (i = 0; i < table->count; i++) {
+			shard = &(table->shards[i]);
+			if ((pth_rwl_wrlock (shard->lock, 0, (struct timespec *)NULL))
+				== CAF_OK) {
+				if (shard->table->retired_count > 0) {
+					caf_hash_cshard_grace (shard);
+					caf_hash_table_reclaim (shard->table);
+				}
+				pth_rwl_unlock (shard->lock);
+			}
+		}
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+static int
+caf_hash_cshard_init (caf_hash_ctable_t *table, caf_hash_cshard_t *shard) {
+	shard->seq = 0;
+	shard->epoch = 0;
+	shard->readers[0] = 0;
+	shard->readers[1] = 0;
+	shard->table = caf_hash_table_new (table->id, table->f1, table->f2);
+	if (shard->table == (caf_hash_table_t *)NULL) {
+		return CAF_ERROR;
+	}
+	caf_hash_table_retain (shard->table,
+	                       table->flags & CAF_HASH_CTABLE_LOCKFREE);
+	shard->lock = pth_rwl_new (table->id);
+	if (shard->lock == (pth_rwlock_t *)NULL) {
+		return CAF_ERROR;
+	}
+	if ((pth_rwlattr_init (shard->lock)) != 0) {
+		pth_rwl_delete (shard->lock);
+		shard->lock = (pth_rwlock_t *)NULL;
+		return CAF_ERROR;
+	}
+	if ((pth_rwl_init (shard->lock)) != 0) {
+		pth_rwlattr_destroy (shard->lock);
+		pth_rwl_delete (shard->lock);
+		shard->lock = (pth_rwlock_t *)NULL;
+		return CAF_ERROR;
+	}
+	return CAF_OK;
+}
+
+
+static void
+caf_hash_cshard_destroy (caf_hash_cshard_t *shard) {
+	if (shard->table != (caf_hash_table_t *)NULL) {
+		caf_hash_table_delete (shard->table);
+		shard->table = (caf_hash_table_t *)NULL;
+	}
+	if (shard->lock != (pth_rwlock_t *)NULL) {
+		pth_rwl_destroy (shard->lock);
+		pth_rwlattr_destroy (shard->lock);
+		pth_rwl_delete (shard->lock);
+		shard->lock = (pth_rwlock_t *)NULL;
+	}
+}
+
+
+static int
+caf_hash_cshard_wrlock (caf_hash_ctable_t *table, caf_hash_cshard_t *shard) {
+	if ((pth_rwl_wrlock (shard->lock, 0, (struct timespec *)NULL))
+		!= CAF_OK) {
+		return CAF_ERROR;
+	}
+	if (table->flags & CAF_HASH_CTABLE_LOCKFREE) {
+		/* odd sequence: readers must not trust what they see */
+		__atomic_store_n (&(shard->seq), shard->seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence (__ATOMIC_RELEASE);
+	}
+	return CAF_OK;
+}
+
+
+static int
+caf_hash_cshard_unlock (caf_hash_ctable_t *table, caf_hash_cshard_t *shard) {
+	if (table->flags & CAF_HASH_CTABLE_LOCKFREE) {
+		__atomic_store_n (&(shard->seq), shard->seq + 1, __ATOMIC_RELEASE);
+	}
+	return pth_rwl_unlock (shard->lock);
+}
+
+
+
+/*
+ * Waits until no lock-free reader can hold a retired array. The
+ * arrays were unlinked before, so a reader counted after the check
+ * of its epoch count only finds the live ones. Flipping the epoch
+ * first sends the new readers to the other count, and flipping twice
+ * covers readers that loaded the epoch just before a flip.
+ */
+static void
+caf_hash_cshard_grace (caf_hash_cshard_t *shard) {
+	unsigned int e;
+	int i;
+	for (i = 0; i < 2; i++) {
+		e = __atomic_load_n (&(shard->epoch), __ATOMIC_RELAXED) & 1;
+		__atomic_store_n (&(shard->epoch), e ^ 1, __ATOMIC_SEQ_CST);
+		while (__atomic_load_n (&(shard->readers[e]), __ATOMIC_SEQ_CST)
+			   != 0) {
+			sched_yield ();
+		}
+	}
+}
+
+/* caf_hash_ctable.c ends here */
@@ -0,0 +1,348 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_hash_str.h"
+#include "caf/caf_hash_table.h"
+#include "caf/caf_hash_mtable.h"
+
+
+#define CAF_HASH_MTABLE_PAD(x) \
+	(((x) + (CAF_HASH_MTABLE_ALIGN - 1)) & ~((u_int64_t)CAF_HASH_MTABLE_ALIGN - 1))
+
+typedef struct caf_hash_mwriter_s caf_hash_mwriter_t;
+struct caf_hash_mwriter_s {
+	FILE *out;
+	caf_hash_mslot_t *slots;
+	u_int64_t size;
+	u_int64_t off;
+	CAF_HASH_MTABLE_CBDSZ(dsz);
+};
+
+static u_int32_t caf_hash_mtable_mix (u_int32_t h);
+static int caf_hash_mtable_put (caf_hash_t *hash, void *arg);
+static int caf_hash_mtable_heap (caf_hash_mwriter_t *w, const void *ptr,
+                                 size_t sz, u_int64_t *off);
+static int caf_hash_mtable_check (caf_hash_mtable_t *table);
+
+
+int
+caf_hash_mtable_write (caf_hash_table_t *table, const char *path,
+                       CAF_HASH_MTABLE_CBDSZ(dsz)) {
+	caf_hash_mheader_t header;
+	caf_hash_mwriter_t w;
+	char *tmp;
+	size_t tmp_sz;
+	int r = CAF_ERROR;
+	if (table == (caf_hash_table_t *)NULL || path == (const char *)NULL
+		|| table->f1 == NULL) {
+		/* keyed tables hash with a seed the readers do not know */
+		return CAF_ERROR;
+	}
+	memset (&header, 0, CAF_HASH_MHEADER_SZ);
+	memcpy (header.magic, CAF_HASH_MTABLE_MAGIC, sizeof (header.magic));
+	header.version = CAF_HASH_MTABLE_VERSION;
+	header.header_sz = (u_int32_t)CAF_HASH_MHEADER_SZ;
+	header.check1 = table->f1 (CAF_HASH_MTABLE_CHECK,
+	                           strlen (CAF_HASH_MTABLE_CHECK));
+	header.check2 = table->f2 != NULL ?
+		table->f2 (CAF_HASH_MTABLE_CHECK, strlen (CAF_HASH_MTABLE_CHECK)) :
+		header.check1;
+	header.count = table->count;
+	/* half full at most, keeping the probe chains short */
+	header.size = CAF_HASH_TABLE_INITSZ;
+	while (header.size < header.count * 2) {
+		header.size <<= 1;
+	}
+	header.slots_off = CAF_HASH_MTABLE_PAD(CAF_HASH_MHEADER_SZ);
+	header.heap_off = header.slots_off + header.size * CAF_HASH_MSLOT_SZ;
+	w.size = header.size;
+	w.off = header.heap_off;
+	w.dsz = dsz;
+	w.slots = (caf_hash_mslot_t *)xmalloc (CAF_HASH_MSLOT_SZ * w.size);
+	tmp_sz = strlen (path) + 32;
+	tmp = (char *)xmalloc (tmp_sz);
+	if (w.slots == (caf_hash_mslot_t *)NULL || tmp == (char *)NULL) {
+		if (w.slots != (caf_hash_mslot_t *)NULL) {
+			xfree (w.slots);
+		}
+		if (tmp != (char *)NULL) {
+			xfree (tmp);
+		}
+		return CAF_ERROR;
+	}
+	memset (w.slots, 0, CAF_HASH_MSLOT_SZ * w.size);
+	snprintf (tmp, tmp_sz, "%s.%ld.tmp", path, (long)getpid ());
+	w.out = fopen (tmp, "wb");
+	if (w.out != (FILE *)NULL) {
+		if (fseek (w.out, (long)w.off, SEEK_SET) == 0
+			&& caf_hash_table_map (table, caf_hash_mtable_put, &w)
+			== table->count) {
+			header.file_sz = w.off;
+			if (fseek (w.out, 0, SEEK_SET) == 0
+				&& fwrite (&header, CAF_HASH_MHEADER_SZ, 1, w.out) == 1
+				&& fseek (w.out, (long)header.slots_off, SEEK_SET) == 0
+				&& fwrite (w.slots, CAF_HASH_MSLOT_SZ, (size_t)w.size, w.out)
+				== (size_t)w.size && fflush (w.out) == 0
+				&& fsync (fileno (w.out)) == 0) {
+				r = CAF_OK;
+			}
+		}
+		if (fclose (w.out) != 0) {
+			r = CAF_ERROR;
+		}
+		if (r == CAF_OK && rename (tmp, path) != 0) {
+			r = CAF_ERROR;
+		}
+		if (r != CAF_OK) {
+			unlink (tmp);
+		}
+	}
+	xfree (w.slots);
+	xfree (tmp);
+	return r;
+}
+
+
+caf_hash_mtable_t *
+caf_hash_mtable_open (const int id, const char *path,
+                      CAF_HASH_STR_FUNCTION(f1), CAF_HASH_STR_FUNCTION(f2)) {
+	caf_hash_mtable_t *r = (caf_hash_mtable_t *)NULL;
+	struct stat st;
+	void *base;
+	int fd;
+	if (id <= 0 || path == (const char *)NULL || f1 == NULL) {
+		return r;
+	}
+	fd = open (path, O_RDONLY);
+	if (fd < 0) {
+		return r;
+	}
+	if (fstat (fd, &st) != 0 || (size_t)st.st_size < CAF_HASH_MHEADER_SZ) {
+		close (fd);
+		return r;
+	}
+	base = mmap ((void *)NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+	             fd, 0);
+	close (fd);
+	if (base == MAP_FAILED) {
+		return r;
+	}
+#ifdef MADV_RANDOM
+	madvise (base, (size_t)st.st_size, MADV_RANDOM);
+#endif /* !MADV_RANDOM */
+	r = (caf_hash_mtable_t *)xmalloc (CAF_HASH_MTABLE_SZ);
+	if (r != (caf_hash_mtable_t *)NULL) {
+		r->id = id;
+		r->f1 = f1;
+		r->f2 = f2;
+		r->base = base;
+		r->base_sz = (size_t)st.st_size;
+		r->header = (const caf_hash_mheader_t *)base;
+		r->slots = (const caf_hash_mslot_t *)((const char *)base
+		                                      + r->header->slots_off);
+		if ((caf_hash_mtable_check (r)) == CAF_OK) {
+			return r;
+		}
+		xfree (r);
+		r = (caf_hash_mtable_t *)NULL;
+	}
+	munmap (base, (size_t)st.st_size);
+	return r;
+}
+
+
+int
+caf_hash_mtable_close (caf_hash_mtable_t *table) {
+	if (table != (caf_hash_mtable_t *)NULL) {
+		munmap (table->base, table->base_sz);
+		xfree (table);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+const void *
+caf_hash_mtable_get (caf_hash_mtable_t *table, const void *key,
+                     const size_t ksz) {
+	const void *data;
+	if ((caf_hash_mtable_find (table, key, ksz, &data, (size_t *)NULL))
+		== CAF_OK) {
+		return data;
+	}
+	return (const void *)NULL;
+}
+
+
+int
+caf_hash_mtable_find (caf_hash_mtable_t *table, const void *key,
+                      const size_t ksz, const void **data, size_t *dsz) {
+	const char *base;
+	const caf_hash_mslot_t *slot;
+	caf_hash_t probe;
+	u_int64_t mask, idx, step, i;
+	if (table == (caf_hash_mtable_t *)NULL || data == (const void **)NULL
+		|| caf_hash_init (&probe, key, ksz, (const void *)NULL, table->f1,
+		                  table->f2) != CAF_OK) {
+		return CAF_ERROR;
+	}
+	base = (const char *)table->base;
+	mask = table->header->size - 1;
+	idx = caf_hash_mtable_mix (probe.hash1) & mask;
+	step = (caf_hash_mtable_mix (~probe.hash2) | 1) & mask;
+	for (i = 0; i <= mask; i++) {
+		slot = &(table->slots[idx]);
+		if (slot->key_off == 0) {
+			break;
+		}
+		if (slot->hash1 == probe.hash1 && slot->hash2 == probe.hash2
+			&& slot->key_sz == ksz
+			&& ksz <= table->base_sz && slot->data_sz <= table->base_sz
+			&& slot->key_off <= table->base_sz - ksz
+			&& slot->data_off <= table->base_sz - slot->data_sz
+			&& memcmp (base + slot->key_off, key, ksz) == 0) {
+			*data = (const void *)(base + slot->data_off);
+			if (dsz != (size_t *)NULL) {
+				*dsz = slot->data_sz;
+			}
+			return CAF_OK;
+		}
+		idx = (idx + step) & mask;
+	}
+	*data = (const void *)NULL;
+	return CAF_ERROR;
+}
+
+
+size_t
+caf_hash_mtable_count (caf_hash_mtable_t *table) {
+	if (table != (caf_hash_mtable_t *)NULL) {
+		return (size_t)table->header->count;
+	}
+	return 0;
+}
+
+
+static u_int32_t
+caf_hash_mtable_mix (u_int32_t h) {
+	/* part of the file format, must not change between versions */
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
+}
+
+
+static int
+caf_hash_mtable_put (caf_hash_t *hash, void *arg) {
+	caf_hash_mwriter_t *w = (caf_hash_mwriter_t *)arg;
+	caf_hash_mslot_t *slot;
+	u_int64_t mask = w->size - 1;
+	u_int64_t idx = caf_hash_mtable_mix (hash->hash1) & mask;
+	u_int64_t step = (caf_hash_mtable_mix (~hash->hash2) | 1) & mask;
+	size_t dsz;
+	if (hash->data == (void *)NULL) {
+		return CAF_ERROR;
+	}
+	dsz = w->dsz != NULL ? w->dsz (hash->data) : strlen (hash->data) + 1;
+	if (hash->key_sz > 0xFFFFFFFFu || dsz > 0xFFFFFFFFu) {
+		return CAF_ERROR;
+	}
+	while (w->slots[idx].key_off != 0) {
+		idx = (idx + step) & mask;
+	}
+	slot = &(w->slots[idx]);
+	slot->hash1 = hash->hash1;
+	slot->hash2 = hash->hash2;
+	slot->key_sz = (u_int32_t)hash->key_sz;
+	slot->data_sz = (u_int32_t)dsz;
+	if ((caf_hash_mtable_heap (w, hash->key, hash->key_sz, &(slot->key_off)))
+		!= CAF_OK) {
+		return CAF_ERROR;
+	}
+	return caf_hash_mtable_heap (w, hash->data, dsz, &(slot->data_off));
+}
+
+
+static int
+caf_hash_mtable_heap (caf_hash_mwriter_t *w, const void *ptr, size_t sz,
+                      u_int64_t *off) {
+	static const char zero[CAF_HASH_MTABLE_ALIGN];
+	size_t pad = (size_t)(CAF_HASH_MTABLE_PAD(w->off + sz) - (w->off + sz));
+	if ((sz > 0 && fwrite (ptr, sz, 1, w->out) != 1)
+		|| (pad > 0 && fwrite (zero, pad, 1, w->out) != 1)) {
+		return CAF_ERROR;
+	}
+	*off = w->off;
+	w->off += sz + pad;
+	return CAF_OK;
+}
+
+
+static int
+caf_hash_mtable_check (caf_hash_mtable_t *table) {
+	const caf_hash_mheader_t *h = table->header;
+	u_int32_t c1, c2;
+	if (memcmp (h->magic, CAF_HASH_MTABLE_MAGIC, sizeof (h->magic)) != 0
+		|| h->version != CAF_HASH_MTABLE_VERSION
+		|| h->header_sz != CAF_HASH_MHEADER_SZ
+		|| h->file_sz != table->base_sz
+		|| h->size == 0 || (h->size & (h->size - 1)) != 0
+		|| h->slots_off < CAF_HASH_MHEADER_SZ
+		|| (h->slots_off % CAF_HASH_MTABLE_ALIGN) != 0
+		|| h->slots_off > h->file_sz
+		|| h->size > (h->file_sz - h->slots_off) / CAF_HASH_MSLOT_SZ
+		|| h->heap_off != h->slots_off + h->size * CAF_HASH_MSLOT_SZ) {
+		return CAF_ERROR;
+	}
+	c1 = table->f1 (CAF_HASH_MTABLE_CHECK, strlen (CAF_HASH_MTABLE_CHECK));
+	c2 = table->f2 != NULL ?
+		table->f2 (CAF_HASH_MTABLE_CHECK, strlen (CAF_HASH_MTABLE_CHECK)) : c1;
+	if (c1 != h->check1 || c2 != h->check2) {
+		return CAF_ERROR;
+	}
+	return CAF_OK;
+}
+
+/* caf_hash_mtable.c ends here */
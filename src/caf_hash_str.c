@@ -29,10 +29,76 @@ static char Id[] = "$Id$";
 #endif /* !HAVE_CONFIG_H */
 
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#ifdef LINUX_SYSTEM
+#include <sys/syscall.h>
+#endif /* !LINUX_SYSTEM */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CAF_SHASH64_X86 1
+#include <immintrin.h>
+#endif /* !__GNUC__ && x86 */
 
 #include "caf/caf_hash_str.h"
 
+#define CAF_SHASH64_P1          0x9E3779B185EBCA87ULL
+#define CAF_SHASH64_P2          0xC2B2AE3D27D4EB4FULL
+#define CAF_SHASH64_P3          0x165667B19E3779F9ULL
+#define CAF_SHASH64_P4          0x85EBCA77C2B2AE63ULL
+#define CAF_SHASH64_P32         0x9E3779B1ULL
+#define CAF_SHASH64_LANES       8
+#define CAF_SHASH64_STRIPE      64
+/* stripes accumulated between two scrambles of the accumulators */
+#define CAF_SHASH64_BLOCK       16
+/* keys up to this size are hashed in 16 byte chunks */
+#define CAF_SHASH64_MEDIUM      256
+
+#define CAF_SHASH_ROTL64(x,b)   (((x) << (b)) | ((x) >> (64 - (b))))
+#define CAF_SHASH_SIPROUND(v0,v1,v2,v3) \
+	do { \
+		v0 += v1; v1 = CAF_SHASH_ROTL64(v1, 13); v1 ^= v0; \
+		v0 = CAF_SHASH_ROTL64(v0, 32); \
+		v2 += v3; v3 = CAF_SHASH_ROTL64(v3, 16); v3 ^= v2; \
+		v0 += v3; v3 = CAF_SHASH_ROTL64(v3, 21); v3 ^= v0; \
+		v2 += v1; v1 = CAF_SHASH_ROTL64(v1, 17); v1 ^= v2; \
+		v2 = CAF_SHASH_ROTL64(v2, 32); \
+	} while (0)
+
+typedef void (*caf_shash64_stripes_t) (u_int64_t *acc, const char *p,
+                                       u_int64_t n, u_int64_t first,
+                                       const u_int64_t *key);
+
+static const u_int64_t caf_shash64_keys[CAF_SHASH64_LANES] = {
+	0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL,
+	0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+	0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL,
+	0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL
+};
+
+static u_int64_t caf_shash64_read64 (const char *p);
+static u_int64_t caf_shash64_read32 (const char *p);
+static u_int64_t caf_shash64_mum (u_int64_t a, u_int64_t b);
+static u_int64_t caf_shash64_avalanche (u_int64_t h);
+static u_int64_t caf_shash64_long (const char *p, u_int64_t len,
+                                   const u_int64_t seed);
+static void caf_shash64_stripes_c (u_int64_t *acc, const char *p,
+                                   u_int64_t n, u_int64_t first,
+                                   const u_int64_t *key);
+#ifdef CAF_SHASH64_X86
+static void caf_shash64_stripes_sse2 (u_int64_t *acc, const char *p,
+                                      u_int64_t n, u_int64_t first,
+                                      const u_int64_t *key);
+static void caf_shash64_stripes_avx2 (u_int64_t *acc, const char *p,
+                                      u_int64_t n, u_int64_t first,
+                                      const u_int64_t *key);
+#endif /* !CAF_SHASH64_X86 */
+
+static caf_shash64_stripes_t caf_shash64_stripes = NULL;
+
 u_int32_t
 caf_shash_rs (const char *str, const u_int len) {
 	/* Modified Robert Sedgwicks String Hash Algorithm */
@@ -399,5 +465,360 @@ caf_shash_fnv (const char* str, const u_int len) {
 	return 0;
 }
 
+u_int64_t
+caf_shash64 (const char *str, const u_int32_t len, const u_int64_t seed) {
+	u_int64_t h, a, b;
+	u_int32_t i;
+	if (str == (const char *)NULL || len == 0) {
+		return caf_shash64_avalanche (seed ^ CAF_SHASH64_P1);
+	}
+	if (len <= 3) {
+		a = ((u_int64_t)(unsigned char)str[0] << 16)
+			| ((u_int64_t)(unsigned char)str[len >> 1] << 24)
+			| (u_int64_t)(unsigned char)str[len - 1] | ((u_int64_t)len << 8);
+		return caf_shash64_avalanche (
+			caf_shash64_mum (a ^ (caf_shash64_keys[0] + seed),
+			                 CAF_SHASH64_P1 ^ len));
+	}
+	if (len <= 8) {
+		a = caf_shash64_read32 (str)
+			| (caf_shash64_read32 (str + len - 4) << 32);
+		return caf_shash64_avalanche (
+			len + caf_shash64_mum (a ^ (caf_shash64_keys[1] + seed),
+			                       (caf_shash64_keys[2] - seed) ^ len));
+	}
+	if (len <= 16) {
+		a = caf_shash64_read64 (str);
+		b = caf_shash64_read64 (str + len - 8);
+		return caf_shash64_avalanche (
+			len + caf_shash64_mum (a ^ (caf_shash64_keys[3] + seed),
+			                       b ^ (caf_shash64_keys[4] - seed)));
+	}
+	if (len <= CAF_SHASH64_MEDIUM) {
+		/* 16 byte chunks, the last one may overlap its predecessor */
+		h = (u_int64_t)len * CAF_SHASH64_P1;
+		for (i = 0; (i + 1) * 16 < len; i++) {
+			a = caf_shash64_read64 (str + i * 16);
+			b = caf_shash64_read64 (str + i * 16 + 8);
+			h += caf_shash64_mum (a ^ (caf_shash64_keys[i & 7] + seed),
+			                      b ^ (caf_shash64_keys[(i + 1) & 7] - seed));
+		}
+		a = caf_shash64_read64 (str + len - 16);
+		b = caf_shash64_read64 (str + len - 8);
+		h += caf_shash64_mum (a ^ (CAF_SHASH64_P2 + seed),
+		                      b ^ (CAF_SHASH64_P3 - seed));
+		return caf_shash64_avalanche (h);
+	}
+	return caf_shash64_long (str, len, seed);
+}
+
+
+u_int32_t
+caf_shash_blk (const char *str, const u_int32_t len) {
+	u_int64_t h = caf_shash64 (str, len, CAF_SHASH_BLK_SEED1);
+	return (u_int32_t)(h ^ (h >> 32));
+}
+
+
+u_int32_t
+caf_shash_blk2 (const char *str, const u_int32_t len) {
+	u_int64_t h = caf_shash64 (str, len, CAF_SHASH_BLK_SEED2);
+	return (u_int32_t)(h ^ (h >> 32));
+}
+
+
+int
+caf_shash64_impl (const int impl) {
+	switch (impl) {
+	case CAF_SHASH64_AUTO:
+#ifdef CAF_SHASH64_X86
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("avx2")) {
+			return caf_shash64_impl (CAF_SHASH64_AVX2);
+		}
+		if (__builtin_cpu_supports ("sse2")) {
+			return caf_shash64_impl (CAF_SHASH64_SSE2);
+		}
+#endif /* !CAF_SHASH64_X86 */
+		return caf_shash64_impl (CAF_SHASH64_SCALAR);
+	case CAF_SHASH64_SCALAR:
+		caf_shash64_stripes = caf_shash64_stripes_c;
+		return impl;
+#ifdef CAF_SHASH64_X86
+	case CAF_SHASH64_SSE2:
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("sse2")) {
+			caf_shash64_stripes = caf_shash64_stripes_sse2;
+			return impl;
+		}
+		return -1;
+	case CAF_SHASH64_AVX2:
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("avx2")) {
+			caf_shash64_stripes = caf_shash64_stripes_avx2;
+			return impl;
+		}
+		return -1;
+#endif /* !CAF_SHASH64_X86 */
+	default:
+		return -1;
+	}
+}
+
+
+u_int64_t
+caf_shash_sip (const char *str, const u_int32_t len, const u_int64_t k0,
+               const u_int64_t k1) {
+	u_int64_t v0 = 0x736F6D6570736575ULL ^ k0;
+	u_int64_t v1 = 0x646F72616E646F6DULL ^ k1;
+	u_int64_t v2 = 0x6C7967656E657261ULL ^ k0;
+	u_int64_t v3 = 0x7465646279746573ULL ^ k1;
+	u_int64_t m, b = (u_int64_t)len << 56;
+	const unsigned char *p = (const unsigned char *)str;
+	u_int32_t i, left = len & 7;
+	if (str == (const char *)NULL && len > 0) {
+		return 0;
+	}
+	for (i = 0; i + 8 <= len; i += 8) {
+		/* the words are little endian on every host */
+		m = (u_int64_t)p[i] | ((u_int64_t)p[i + 1] << 8)
+			| ((u_int64_t)p[i + 2] << 16) | ((u_int64_t)p[i + 3] << 24)
+			| ((u_int64_t)p[i + 4] << 32) | ((u_int64_t)p[i + 5] << 40)
+			| ((u_int64_t)p[i + 6] << 48) | ((u_int64_t)p[i + 7] << 56);
+		v3 ^= m;
+		CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+		CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+	while (left > 0) {
+		left--;
+		b |= (u_int64_t)p[i + left] << (left * 8);
+	}
+	v3 ^= b;
+	CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+	CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+	v2 ^= 0xFF;
+	CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+	CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+	CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+	CAF_SHASH_SIPROUND(v0, v1, v2, v3);
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+
+int
+caf_shash_seed (u_int64_t seed[2]) {
+	size_t got = 0;
+	ssize_t r;
+	int fd;
+#if defined(LINUX_SYSTEM) && defined(SYS_getrandom)
+	while (got < sizeof (u_int64_t) * 2) {
+		r = syscall (SYS_getrandom, (char *)seed + got,
+		             sizeof (u_int64_t) * 2 - got, 0);
+		if (r <= 0) {
+			break;
+		}
+		got += (size_t)r;
+	}
+#endif /* !LINUX_SYSTEM && SYS_getrandom */
+	if (got < sizeof (u_int64_t) * 2) {
+		fd = open ("/dev/urandom", O_RDONLY);
+		if (fd >= 0) {
+			while (got < sizeof (u_int64_t) * 2) {
+				r = read (fd, (char *)seed + got,
+				          sizeof (u_int64_t) * 2 - got);
+				if (r <= 0) {
+					break;
+				}
+				got += (size_t)r;
+			}
+			close (fd);
+		}
+	}
+	if (got < sizeof (u_int64_t) * 2) {
+		seed[0] = caf_shash64_avalanche ((u_int64_t)time ((time_t *)NULL)
+		                                 ^ CAF_SHASH64_P1);
+		seed[1] = caf_shash64_avalanche ((u_int64_t)getpid ()
+		                                 ^ (u_int64_t)(size_t)seed
+		                                 ^ CAF_SHASH64_P2);
+		return -1;
+	}
+	return 0;
+}
+
+
+static u_int64_t
+caf_shash64_read64 (const char *p) {
+	u_int64_t v;
+	memcpy (&v, p, sizeof (v));
+	return v;
+}
+
+
+static u_int64_t
+caf_shash64_read32 (const char *p) {
+	u_int32_t v;
+	memcpy (&v, p, sizeof (v));
+	return (u_int64_t)v;
+}
+
+
+static u_int64_t
+caf_shash64_mum (u_int64_t a, u_int64_t b) {
+	/* folded 128 bit product */
+#ifdef __SIZEOF_INT128__
+	__extension__ typedef unsigned __int128 caf_u128_t;
+	caf_u128_t r = (caf_u128_t)a * b;
+	return (u_int64_t)r ^ (u_int64_t)(r >> 64);
+#else /* !__SIZEOF_INT128__ */
+	u_int64_t ah = a >> 32, al = a & 0xFFFFFFFFULL;
+	u_int64_t bh = b >> 32, bl = b & 0xFFFFFFFFULL;
+	u_int64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+	u_int64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFULL) + (hl & 0xFFFFFFFFULL);
+	u_int64_t lo = (mid << 32) | (ll & 0xFFFFFFFFULL);
+	u_int64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	return lo ^ hi;
+#endif /* !__SIZEOF_INT128__ */
+}
+
+
+static u_int64_t
+caf_shash64_avalanche (u_int64_t h) {
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ULL;
+	h ^= h >> 32;
+	return h;
+}
+
+
+static u_int64_t
+caf_shash64_long (const char *p, u_int64_t len, const u_int64_t seed) {
+	u_int64_t acc[CAF_SHASH64_LANES] = {
+		CAF_SHASH64_P32, CAF_SHASH64_P1, CAF_SHASH64_P2, CAF_SHASH64_P3,
+		CAF_SHASH64_P4, CAF_SHASH64_P2 ^ CAF_SHASH64_P3,
+		CAF_SHASH64_P1 ^ CAF_SHASH64_P4, CAF_SHASH64_P32 ^ CAF_SHASH64_P2
+	};
+	u_int64_t key[CAF_SHASH64_LANES];
+	u_int64_t n = len / CAF_SHASH64_STRIPE, h;
+	int i;
+	if (caf_shash64_stripes == NULL) {
+		caf_shash64_impl (CAF_SHASH64_AUTO);
+	}
+	for (i = 0; i < CAF_SHASH64_LANES; i++) {
+		key[i] = caf_shash64_keys[i] + ((i & 1) ? -seed : seed);
+	}
+	/* the last full stripe is folded with the tail below */
+	if ((len % CAF_SHASH64_STRIPE) == 0) {
+		n--;
+	}
+	caf_shash64_stripes (acc, p, n, 0, key);
+	caf_shash64_stripes_c (acc, p + len - CAF_SHASH64_STRIPE, 1, n, key);
+	h = len * CAF_SHASH64_P1;
+	for (i = 0; i < CAF_SHASH64_LANES; i += 2) {
+		h += caf_shash64_mum (acc[i] ^ key[i], acc[i + 1] ^ key[i + 1]);
+	}
+	return caf_shash64_avalanche (h);
+}
+
+
+static void
+caf_shash64_stripes_c (u_int64_t *acc, const char *p, u_int64_t n,
+                       u_int64_t first, const u_int64_t *key) {
+	u_int64_t s, d, dk, sk;
+	int i;
+	for (s = first; s < first + n; s++, p += CAF_SHASH64_STRIPE) {
+		sk = s * CAF_SHASH64_P3;
+		for (i = 0; i < CAF_SHASH64_LANES; i++) {
+			d = caf_shash64_read64 (p + i * 8);
+			dk = d ^ key[i] ^ sk;
+			acc[i ^ 1] += d;
+			acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+		}
+		if ((s % CAF_SHASH64_BLOCK) == (CAF_SHASH64_BLOCK - 1)) {
+			for (i = 0; i < CAF_SHASH64_LANES; i++) {
+				acc[i] ^= acc[i] >> 47;
+				acc[i] ^= key[i];
+				acc[i] *= CAF_SHASH64_P32;
+			}
+		}
+	}
+}
+
+#ifdef CAF_SHASH64_X86
+__attribute__((target("sse2")))
+static void
+caf_shash64_stripes_sse2 (u_int64_t *acc, const char *p, u_int64_t n,
+                          u_int64_t first, const u_int64_t *key) {
+	__m128i a[4], k[4], d, dk, sk;
+	const __m128i p32 = _mm_set1_epi32 ((int)CAF_SHASH64_P32);
+	u_int64_t s;
+	int i;
+	for (i = 0; i < 4; i++) {
+		a[i] = _mm_loadu_si128 ((const __m128i *)(acc + i * 2));
+		k[i] = _mm_loadu_si128 ((const __m128i *)(key + i * 2));
+	}
+	for (s = first; s < first + n; s++, p += CAF_SHASH64_STRIPE) {
+		sk = _mm_set1_epi64x ((long long)(s * CAF_SHASH64_P3));
+		for (i = 0; i < 4; i++) {
+			d = _mm_loadu_si128 ((const __m128i *)(p + i * 16));
+			dk = _mm_xor_si128 (_mm_xor_si128 (d, k[i]), sk);
+			a[i] = _mm_add_epi64 (a[i], _mm_shuffle_epi32 (d, 0x4E));
+			a[i] = _mm_add_epi64 (a[i], _mm_mul_epu32 (dk,
+			                      _mm_srli_epi64 (dk, 32)));
+		}
+		if ((s % CAF_SHASH64_BLOCK) == (CAF_SHASH64_BLOCK - 1)) {
+			for (i = 0; i < 4; i++) {
+				d = _mm_xor_si128 (a[i], _mm_srli_epi64 (a[i], 47));
+				d = _mm_xor_si128 (d, k[i]);
+				a[i] = _mm_add_epi64 (_mm_mul_epu32 (d, p32),
+				       _mm_slli_epi64 (_mm_mul_epu32 (
+				                       _mm_srli_epi64 (d, 32), p32), 32));
+			}
+		}
+	}
+	for (i = 0; i < 4; i++) {
+		_mm_storeu_si128 ((__m128i *)(acc + i * 2), a[i]);
+	}
+}
+
+
+__attribute__((target("avx2")))
+static void
+caf_shash64_stripes_avx2 (u_int64_t *acc, const char *p, u_int64_t n,
+                          u_int64_t first, const u_int64_t *key) {
+	__m256i a[2], k[2], d, dk, sk;
+	const __m256i p32 = _mm256_set1_epi32 ((int)CAF_SHASH64_P32);
+	u_int64_t s;
+	int i;
+	for (i = 0; i < 2; i++) {
+		a[i] = _mm256_loadu_si256 ((const __m256i *)(acc + i * 4));
+		k[i] = _mm256_loadu_si256 ((const __m256i *)(key + i * 4));
+	}
+	for (s = first; s < first + n; s++, p += CAF_SHASH64_STRIPE) {
+		sk = _mm256_set1_epi64x ((long long)(s * CAF_SHASH64_P3));
+		for (i = 0; i < 2; i++) {
+			d = _mm256_loadu_si256 ((const __m256i *)(p + i * 32));
+			dk = _mm256_xor_si256 (_mm256_xor_si256 (d, k[i]), sk);
+			a[i] = _mm256_add_epi64 (a[i], _mm256_shuffle_epi32 (d, 0x4E));
+			a[i] = _mm256_add_epi64 (a[i], _mm256_mul_epu32 (dk,
+			                         _mm256_srli_epi64 (dk, 32)));
+		}
+		if ((s % CAF_SHASH64_BLOCK) == (CAF_SHASH64_BLOCK - 1)) {
+			for (i = 0; i < 2; i++) {
+				d = _mm256_xor_si256 (a[i], _mm256_srli_epi64 (a[i], 47));
+				d = _mm256_xor_si256 (d, k[i]);
+				a[i] = _mm256_add_epi64 (_mm256_mul_epu32 (d, p32),
+				       _mm256_slli_epi64 (_mm256_mul_epu32 (
+				                          _mm256_srli_epi64 (d, 32), p32), 32));
+			}
+		}
+	}
+	for (i = 0; i < 2; i++) {
+		_mm256_storeu_si256 ((__m256i *)(acc + i * 4), a[i]);
+	}
+}
+#endif /* !CAF_SHASH64_X86 */
+
 /* caf_hash_str.c ends here */
 
@@ -29,6 +29,7 @@ static char Id[] = "$Id$";
 #endif /* !HAVE_CONFIG_H */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "caf/caf.h"
@@ -37,9 +38,32 @@ static char Id[] = "$Id$";
 #include "caf/caf_hash_table.h"
 
 
-static int caf_hash_search_callback (void *lptr, void *data);
-static int caf_hash_delete_callback (void *data);
-static int caf_hash_dump (FILE *out, void *data);
+#define CAF_HASH_EMPTY(h)       ((h)->key == (void *)NULL)
+#define CAF_HASH_DELETED(h)     ((h)->key == (void *)&caf_hash_tombstone)
+#define CAF_HASH_LIVE(h)        (!CAF_HASH_EMPTY(h) && !CAF_HASH_DELETED(h))
+/* bucket arrays carry their size in a hidden leading bucket */
+#define CAF_HASH_BUCKETS_SZ(b)  ((b)[-1].key_sz)
+
+/* deleted buckets point their key here, keeping probe chains intact */
+static char caf_hash_tombstone;
+
+static u_int32_t caf_hash_mix (u_int32_t h);
+static caf_hash_t *caf_hash_buckets_new (size_t sz);
+static int caf_hash_buckets_free (caf_hash_table_t *table, caf_hash_t *b);
+static caf_hash_t *caf_hash_buckets_find (caf_hash_t *b, size_t sz,
+                                          const caf_hash_t *probe);
+static caf_hash_t *caf_hash_buckets_slot (caf_hash_t *b, size_t sz,
+                                          u_int32_t h1, u_int32_t h2);
+static int caf_hash_buckets_peek (caf_hash_t *b, const caf_hash_t *probe,
+                                  void **data);
+static void caf_hash_bucket_store (caf_hash_t *to, const caf_hash_t *from);
+static void caf_hash_bucket_update (caf_hash_t *to, void *key, void *data);
+static void caf_hash_bucket_clear (caf_hash_t *to);
+static caf_hash_t *caf_hash_table_find (caf_hash_table_t *table,
+                                        const caf_hash_t *probe);
+static void caf_hash_table_rehash (caf_hash_table_t *table, size_t steps);
+static int caf_hash_table_grow (caf_hash_table_t *table);
+static int caf_hash_dump (FILE *out, caf_hash_t *hash);
 
 
 caf_hash_t *
@@ -49,13 +73,9 @@ caf_hash_new (const void *key, const size_t ksz, const void *data,
 	caf_hash_t *r = (caf_hash_t *)NULL;
 	if (key != (const void *)NULL && ksz > 0 && data != (const void *)NULL
 		&& f1 != NULL && f2 != NULL) {
-		r = (caf_hash_t *)xmalloc (CAF_HASH_SZ);
+		r = (caf_hash_t *)xobjalloc (CAF_HASH_SZ);
 		if (r != (caf_hash_t *)NULL) {
-			r->hash1 = f1 ((const char *)key, ksz);
-			r->hash2 = f2 ((const char *)key, ksz);
-			r->key_sz = ksz;
-			r->key = (void *)key;
-			r->data = (void *)data;
+			caf_hash_init (r, key, ksz, data, f1, f2);
 		}
 	}
 	return r;
@@ -67,22 +87,36 @@ caf_hash_t *caf_hash_new_nodata (const void *key, const size_t ksz,
                                  CAF_HASH_STR_FUNCTION(f2)) {
 	caf_hash_t *r = (caf_hash_t *)NULL;
 	if (key != (const void *)NULL && ksz > 0 && f1 != NULL && f2 != NULL) {
-		r = (caf_hash_t *)xmalloc (CAF_HASH_SZ);
+		r = (caf_hash_t *)xobjalloc (CAF_HASH_SZ);
 		if (r != (caf_hash_t *)NULL) {
-			r->hash1 = f1 ((const char *)key, ksz);
-			r->hash2 = f2 ((const char *)key, ksz);
-			r->key_sz = ksz;
-			r->key = (void *)key;
+			caf_hash_init (r, key, ksz, (const void *)NULL, f1, f2);
 		}
 	}
 	return r;
 }
 
 
+int
+caf_hash_init (caf_hash_t *hash, const void *key, const size_t ksz,
+               const void *data, CAF_HASH_STR_FUNCTION(f1),
+               CAF_HASH_STR_FUNCTION(f2)) {
+	if (hash != (caf_hash_t *)NULL && key != (const void *)NULL && ksz > 0
+		&& f1 != NULL) {
+		hash->hash1 = f1 ((const char *)key, ksz);
+		hash->hash2 = f2 != NULL ? f2 ((const char *)key, ksz) : hash->hash1;
+		hash->key_sz = ksz;
+		hash->key = (void *)key;
+		hash->data = (void *)data;
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
 int
 caf_hash_delete (caf_hash_t *hash) {
 	if (hash != (caf_hash_t *)NULL) {
-		xfree (hash);
+		xobjfree (hash, CAF_HASH_SZ);
 		return CAF_OK;
 	}
 	return CAF_ERROR;
@@ -99,8 +133,21 @@ caf_hash_table_new (const int id, CAF_HASH_STR_FUNCTION(f1),
 			r->id = id;
 			r->f1 = f1;
 			r->f2 = f2;
-			r->hashes = cdeque_create ();
-			if (r->hashes == (cdeque_t *)NULL) {
+			r->kf = NULL;
+			r->seed[0] = 0;
+			r->seed[1] = 0;
+			r->count = 0;
+			r->used = 0;
+			r->size = CAF_HASH_TABLE_INITSZ;
+			r->old = (caf_hash_t *)NULL;
+			r->old_size = 0;
+			r->old_count = 0;
+			r->old_idx = 0;
+			r->retain = 0;
+			r->retired = (caf_hash_t **)NULL;
+			r->retired_count = 0;
+			r->buckets = caf_hash_buckets_new (r->size);
+			if (r->buckets == (caf_hash_t *)NULL) {
 				xfree (r);
 				r = (caf_hash_table_t *)NULL;
 			}
@@ -110,45 +157,95 @@ caf_hash_table_new (const int id, CAF_HASH_STR_FUNCTION(f1),
 }
 
 
+caf_hash_table_t *
+caf_hash_table_new_keyed (const int id, CAF_HASH_KEYED_FUNCTION(kf)) {
+	/* f1 is only checked here, the keyed hash replaces it */
+	caf_hash_table_t *r = caf_hash_table_new (id, caf_shash_blk, NULL);
+	if (r != (caf_hash_table_t *)NULL) {
+		r->f1 = NULL;
+		r->kf = kf != NULL ? kf : caf_shash_sip;
+		caf_shash_seed (r->seed);
+	}
+	return r;
+}
+
+
+int
+caf_hash_table_hash (caf_hash_table_t *table, caf_hash_t *hash,
+                     const void *key, const size_t ksz, const void *data) {
+	u_int64_t h;
+	if (table == (caf_hash_table_t *)NULL) {
+		return CAF_ERROR;
+	}
+	if (table->kf == NULL) {
+		return caf_hash_init (hash, key, ksz, data, table->f1, table->f2);
+	}
+	if (hash != (caf_hash_t *)NULL && key != (const void *)NULL && ksz > 0) {
+		h = table->kf ((const char *)key, ksz, table->seed[0],
+		               table->seed[1]);
+		hash->hash1 = (u_int32_t)h;
+		hash->hash2 = (u_int32_t)(h >> 32);
+		hash->key_sz = ksz;
+		hash->key = (void *)key;
+		hash->data = (void *)data;
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
 int
 caf_hash_table_delete (caf_hash_table_t *table) {
 	if (table != (caf_hash_table_t *)NULL) {
-		if ((cdeque_delete (table->hashes, caf_hash_delete_callback)) ==
-			CAF_OK) {
-			xfree (table);
-			return CAF_OK;
+		table->retain = 0;
+		caf_hash_table_reclaim (table);
+		if (table->old != (caf_hash_t *)NULL) {
+			caf_hash_buckets_free (table, table->old);
 		}
+		caf_hash_buckets_free (table, table->buckets);
+		xfree (table);
+		return CAF_OK;
 	}
-	return CAF_OK;
+	return CAF_ERROR;
 }
 
 
 int
 caf_hash_table_add (caf_hash_table_t *table, const void *key,
                     const size_t ksz, const void *data) {
+	caf_hash_t probe;
+	if (table != (caf_hash_table_t *)NULL &&
+		caf_hash_table_hash (table, &probe, key, ksz, data) == CAF_OK) {
+		return caf_hash_table_add_hash (table, &probe);
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_hash_table_add_hash (caf_hash_table_t *table, const caf_hash_t *probe) {
 	caf_hash_t *hash;
-	caf_hash_t *hash_new;
-	if (table != (caf_hash_table_t *)NULL && key != (const void *)NULL &&
-		ksz > 0 && data != (const void *)NULL) {
-		hash_new = caf_hash_new_nodata (key, ksz, table->f1, table->f2);
-		hash = (caf_hash_t *)cdeque_search (table->hashes, (void *)hash_new,
-		                                    caf_hash_search_callback);
-		if (hash == (caf_hash_t *)NULL) {
-			hash = caf_hash_new (key, ksz, data, table->f1, table->f2);
-			if (hash != (caf_hash_t *)NULL) {
-				caf_hash_delete (hash_new);
-				return ((cdeque_push (table->hashes, (void *)hash))
-				        != (cdeque_t *)NULL) ? CAF_OK : CAF_ERROR;
-			}
-		} else {
-			hash->key = (void *)key;
-			hash->data = (void *)data;
-			hash->hash1 = hash_new->hash1;
-			hash->hash2 = hash_new->hash2;
-			hash->key_sz = ksz;
-			caf_hash_delete (hash_new);
+	if (table != (caf_hash_table_t *)NULL && probe != (caf_hash_t *)NULL
+		&& probe->key != (void *)NULL && probe->data != (void *)NULL) {
+		caf_hash_table_rehash (table, CAF_HASH_TABLE_REHASH_STEP);
+		hash = caf_hash_table_find (table, probe);
+		if (hash != (caf_hash_t *)NULL) {
+			caf_hash_bucket_update (hash, probe->key, probe->data);
 			return CAF_OK;
 		}
+		if (((table->used + 1) * 4) > (table->size * 3)) {
+			if ((caf_hash_table_grow (table)) != CAF_OK) {
+				return CAF_ERROR;
+			}
+		}
+		hash = caf_hash_buckets_slot (table->buckets, table->size,
+		                              probe->hash1, probe->hash2);
+		if (CAF_HASH_EMPTY(hash)) {
+			table->used++;
+		}
+		caf_hash_bucket_store (hash, probe);
+		table->count++;
+		return CAF_OK;
 	}
 	return CAF_ERROR;
 }
@@ -157,17 +254,32 @@ caf_hash_table_add (caf_hash_table_t *table, const void *key,
 int
 caf_hash_table_remove (caf_hash_table_t *table, const void *key,
                        const size_t ksz) {
+	caf_hash_t probe;
+	if (table != (caf_hash_table_t *)NULL &&
+		caf_hash_table_hash (table, &probe, key, ksz, (const void *)NULL)
+		== CAF_OK) {
+		return caf_hash_table_remove_hash (table, &probe);
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_hash_table_remove_hash (caf_hash_table_t *table,
+                            const caf_hash_t *probe) {
 	caf_hash_t *hash;
-	caf_hash_t *hash_new;
-	if (table != (caf_hash_table_t *)NULL && key != (const void *)NULL &&
-		ksz > 0) {
-		hash_new = caf_hash_new_nodata (key, ksz, table->f1, table->f2);
-		hash = (caf_hash_t *)cdeque_search (table->hashes, (void *)hash_new,
-		                                    caf_hash_search_callback);
+	if (table != (caf_hash_table_t *)NULL && probe != (caf_hash_t *)NULL
+		&& probe->key != (void *)NULL) {
+		caf_hash_table_rehash (table, CAF_HASH_TABLE_REHASH_STEP);
+		hash = caf_hash_table_find (table, probe);
 		if (hash != (caf_hash_t *)NULL) {
-			caf_hash_delete (hash_new);
-			return cdeque_node_delete_by_data (table->hashes, (void *)hash,
-			                                   caf_hash_delete_callback);
+			if (table->old != (caf_hash_t *)NULL && hash >= table->old
+				&& hash < (table->old + table->old_size)) {
+				table->old_count--;
+			}
+			caf_hash_bucket_clear (hash);
+			table->count--;
+			return CAF_OK;
 		}
 	}
 	return CAF_ERROR;
@@ -177,42 +289,73 @@ caf_hash_table_remove (caf_hash_table_t *table, const void *key,
 void *
 caf_hash_table_get (caf_hash_table_t *table, const void *key,
                     const size_t ksz) {
+	caf_hash_t probe;
+	if (table != (caf_hash_table_t *)NULL &&
+		caf_hash_table_hash (table, &probe, key, ksz, (const void *)NULL)
+		== CAF_OK) {
+		return caf_hash_table_get_hash (table, &probe);
+	}
+	return (void *)NULL;
+}
+
+
+void *
+caf_hash_table_get_hash (caf_hash_table_t *table, const caf_hash_t *probe) {
 	caf_hash_t *hash;
-	caf_hash_t *hash_new;
-	void *r = (void *)NULL;
-	if (table != (caf_hash_table_t *)NULL && key != (const void *)NULL &&
-		ksz > 0) {
-		hash_new = caf_hash_new_nodata (key, ksz, table->f1, table->f2);
-		if ((hash = (caf_hash_t *)cdeque_search (table->hashes,
-												 (void *)hash_new,
-												 caf_hash_search_callback))
-			!= (caf_hash_t *)NULL) {
-			caf_hash_delete (hash_new);
+	if (table != (caf_hash_table_t *)NULL && probe != (caf_hash_t *)NULL
+		&& probe->key != (void *)NULL) {
+		hash = caf_hash_table_find (table, probe);
+		if (hash != (caf_hash_t *)NULL) {
 			return hash->data;
 		}
 	}
-	return r;
+	return (void *)NULL;
+}
+
+
+int
+caf_hash_table_peek (caf_hash_table_t *table, const caf_hash_t *probe,
+                     void **data) {
+	caf_hash_t *b;
+	if (table != (caf_hash_table_t *)NULL && probe != (caf_hash_t *)NULL
+		&& probe->key != (void *)NULL && data != (void **)NULL) {
+		/* array sizes come from the arrays, never from the table */
+		b = __atomic_load_n (&(table->old), __ATOMIC_ACQUIRE);
+		if (b != (caf_hash_t *)NULL
+			&& caf_hash_buckets_peek (b, probe, data) == CAF_OK) {
+			return CAF_OK;
+		}
+		b = __atomic_load_n (&(table->buckets), __ATOMIC_ACQUIRE);
+		if (caf_hash_buckets_peek (b, probe, data) == CAF_OK) {
+			return CAF_OK;
+		}
+		*data = (void *)NULL;
+	}
+	return CAF_ERROR;
 }
 
 
 int
 caf_hash_table_set (caf_hash_table_t *table, const void *key,
                     const size_t ksz, void *data) {
+	caf_hash_t probe;
+	if (table != (caf_hash_table_t *)NULL &&
+		caf_hash_table_hash (table, &probe, key, ksz, data) == CAF_OK) {
+		return caf_hash_table_set_hash (table, &probe);
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_hash_table_set_hash (caf_hash_table_t *table, const caf_hash_t *probe) {
 	caf_hash_t *hash;
-	caf_hash_t *hash_new;
-	if (table != (caf_hash_table_t *)NULL && key != (const void *)NULL &&
-		ksz > 0) {
-		hash_new = caf_hash_new_nodata (key, ksz, table->f1, table->f2);
-		if ((hash = (caf_hash_t *)cdeque_search (table->hashes,
-												 (void *)hash_new,
-												 caf_hash_search_callback))
-			!= (caf_hash_t *)NULL) {
-			hash->data = (void *)data;
-			hash->key = (void *)key;
-			hash->key_sz = ksz;
-			hash->hash1 = hash_new->hash1;
-			hash->hash2 = hash_new->hash2;
-			caf_hash_delete (hash_new);
+	if (table != (caf_hash_table_t *)NULL && probe != (caf_hash_t *)NULL
+		&& probe->key != (void *)NULL) {
+		caf_hash_table_rehash (table, CAF_HASH_TABLE_REHASH_STEP);
+		hash = caf_hash_table_find (table, probe);
+		if (hash != (caf_hash_t *)NULL) {
+			caf_hash_bucket_update (hash, probe->key, probe->data);
 			return CAF_OK;
 		}
 	}
@@ -220,46 +363,299 @@ caf_hash_table_set (caf_hash_table_t *table, const void *key,
 }
 
 
+int
+caf_hash_table_retain (caf_hash_table_t *table, const int retain) {
+	if (table != (caf_hash_table_t *)NULL) {
+		table->retain = retain;
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_hash_table_reclaim (caf_hash_table_t *table) {
+	size_t i;
+	if (table != (caf_hash_table_t *)NULL) {
+		for (i = 0; i < table->retired_count; i++) {
+			xfree (table->retired[i]);
+		}
+		if (table->retired != (caf_hash_t **)NULL) {
+			xfree (table->retired);
+		}
+		table->retired = (caf_hash_t **)NULL;
+		table->retired_count = 0;
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+size_t
+caf_hash_table_map (caf_hash_table_t *table, CAF_HASH_TABLE_CBMAP(step),
+                    void *arg) {
+	size_t i, c = 0;
+	if (table != (caf_hash_table_t *)NULL && step != NULL) {
+		for (i = 0; table->old != (caf_hash_t *)NULL && i < table->old_size;
+			 i++) {
+			if (CAF_HASH_LIVE(&(table->old[i]))) {
+				if ((step (&(table->old[i]), arg)) != CAF_OK) {
+					return c;
+				}
+				c++;
+			}
+		}
+		for (i = 0; i < table->size; i++) {
+			if (CAF_HASH_LIVE(&(table->buckets[i]))) {
+				if ((step (&(table->buckets[i]), arg)) != CAF_OK) {
+					return c;
+				}
+				c++;
+			}
+		}
+	}
+	return c;
+}
+
+
 void
 caf_hash_table_dump (FILE *out, caf_hash_table_t *table) {
+	size_t i;
 	if (table != (caf_hash_table_t *)NULL) {
-		fprintf (out, "[%p] Hash Table\n", (void *)table);
-		cdeque_dump (out, table->hashes, caf_hash_dump);
+		fprintf (out, "[%p] Hash Table (%lu/%lu)\n", (void *)table,
+		         (unsigned long)table->count, (unsigned long)table->size);
+		for (i = 0; table->old != (caf_hash_t *)NULL && i < table->old_size;
+			 i++) {
+			caf_hash_dump (out, &(table->old[i]));
+		}
+		for (i = 0; i < table->size; i++) {
+			caf_hash_dump (out, &(table->buckets[i]));
+		}
 	}
 }
 
 
+static u_int32_t
+caf_hash_mix (u_int32_t h) {
+	/* spreads weak string hashes over the low bits used as index */
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
+}
+
+
+static caf_hash_t *
+caf_hash_buckets_new (size_t sz) {
+	caf_hash_t *b = (caf_hash_t *)xmalloc (CAF_HASH_SZ * (sz + 1));
+	if (b != (caf_hash_t *)NULL) {
+		memset (b, 0, CAF_HASH_SZ * (sz + 1));
+		b->key_sz = sz;
+		b++;
+	}
+	return b;
+}
+
+
 static int
-caf_hash_search_callback (void *lptr, void *data) {
-	caf_hash_t *hash1;
-	caf_hash_t *hash2;
-	if (lptr != (void *)NULL && data != (void *)NULL) {
-		hash1 = (caf_hash_t *)lptr;
-		hash2 = (caf_hash_t *)data;
-		return ((hash1->hash1 == hash2->hash1 && hash1->hash2 == hash2->hash2)
-		        ? CAF_OK : CAF_ERROR);
+caf_hash_buckets_free (caf_hash_table_t *table, caf_hash_t *b) {
+	caf_hash_t **r;
+	if (table->retain) {
+		r = (caf_hash_t **)xrealloc (table->retired, sizeof(caf_hash_t *)
+		                             * (table->retired_count + 1));
+		if (r != (caf_hash_t **)NULL) {
+			table->retired = r;
+			table->retired[table->retired_count++] = b - 1;
+			return CAF_OK;
+		}
+		/* cannot defer it, but leaking is safer than freeing */
+		return CAF_ERROR;
 	}
-	return CAF_ERROR;
+	xfree (b - 1);
+	return CAF_OK;
+}
+
+
+static caf_hash_t *
+caf_hash_buckets_find (caf_hash_t *b, size_t sz, const caf_hash_t *probe) {
+	size_t mask = sz - 1;
+	size_t idx = (size_t)caf_hash_mix (probe->hash1) & mask;
+	size_t step = ((size_t)caf_hash_mix (~probe->hash2) | 1) & mask;
+	size_t i;
+	caf_hash_t *hash;
+	for (i = 0; i < sz; i++) {
+		hash = &(b[idx]);
+		if (CAF_HASH_EMPTY(hash)) {
+			break;
+		}
+		if (hash->hash1 == probe->hash1 && hash->hash2 == probe->hash2
+			&& hash->key_sz == probe->key_sz && !CAF_HASH_DELETED(hash)
+			&& (hash->key == probe->key
+				|| memcmp (hash->key, probe->key, probe->key_sz) == 0)) {
+			return hash;
+		}
+		idx = (idx + step) & mask;
+	}
+	return (caf_hash_t *)NULL;
+}
+
+
+static caf_hash_t *
+caf_hash_buckets_slot (caf_hash_t *b, size_t sz, u_int32_t h1,
+                       u_int32_t h2) {
+	size_t mask = sz - 1;
+	size_t idx = (size_t)caf_hash_mix (h1) & mask;
+	size_t step = ((size_t)caf_hash_mix (~h2) | 1) & mask;
+	while (CAF_HASH_LIVE(&(b[idx]))) {
+		idx = (idx + step) & mask;
+	}
+	return &(b[idx]);
 }
 
 
+/*
+ * caf_hash_buckets_find for readers racing with the writers. Buckets
+ * publish their key last, so every field is read with an atomic load
+ * after an acquire load of the key, and the entry is never copied.
+ */
 static int
-caf_hash_delete_callback (void *data) {
-	if (data != (void *)NULL) {
-		xfree (data);
-		return CAF_OK;
+caf_hash_buckets_peek (caf_hash_t *b, const caf_hash_t *probe,
+                       void **data) {
+	size_t sz = CAF_HASH_BUCKETS_SZ(b);
+	size_t mask = sz - 1;
+	size_t idx = (size_t)caf_hash_mix (probe->hash1) & mask;
+	size_t step = ((size_t)caf_hash_mix (~probe->hash2) | 1) & mask;
+	size_t i;
+	caf_hash_t *hash;
+	void *key;
+	for (i = 0; i < sz; i++) {
+		hash = &(b[idx]);
+		key = __atomic_load_n (&(hash->key), __ATOMIC_ACQUIRE);
+		if (key == (void *)NULL) {
+			break;
+		}
+		if (key != (void *)&caf_hash_tombstone
+			&& __atomic_load_n (&(hash->hash1), __ATOMIC_RELAXED)
+			== probe->hash1
+			&& __atomic_load_n (&(hash->hash2), __ATOMIC_RELAXED)
+			== probe->hash2
+			&& __atomic_load_n (&(hash->key_sz), __ATOMIC_RELAXED)
+			== probe->key_sz
+			&& (key == probe->key
+				|| memcmp (key, probe->key, probe->key_sz) == 0)) {
+			*data = __atomic_load_n (&(hash->data), __ATOMIC_ACQUIRE);
+			return CAF_OK;
+		}
+		idx = (idx + step) & mask;
 	}
 	return CAF_ERROR;
 }
 
 
+/* fills a bucket, its key is stored last to publish it to the peeks */
+static void
+caf_hash_bucket_store (caf_hash_t *to, const caf_hash_t *from) {
+	__atomic_store_n (&(to->hash1), from->hash1, __ATOMIC_RELAXED);
+	__atomic_store_n (&(to->hash2), from->hash2, __ATOMIC_RELAXED);
+	__atomic_store_n (&(to->key_sz), from->key_sz, __ATOMIC_RELAXED);
+	__atomic_store_n (&(to->data), from->data, __ATOMIC_RELAXED);
+	__atomic_store_n (&(to->key), from->key, __ATOMIC_RELEASE);
+}
+
+
+static void
+caf_hash_bucket_update (caf_hash_t *to, void *key, void *data) {
+	__atomic_store_n (&(to->data), data, __ATOMIC_RELEASE);
+	__atomic_store_n (&(to->key), key, __ATOMIC_RELEASE);
+}
+
+
+static void
+caf_hash_bucket_clear (caf_hash_t *to) {
+	__atomic_store_n (&(to->key), (void *)&caf_hash_tombstone,
+	                  __ATOMIC_RELEASE);
+	__atomic_store_n (&(to->data), (void *)NULL, __ATOMIC_RELAXED);
+}
+
+
+static caf_hash_t *
+caf_hash_table_find (caf_hash_table_t *table, const caf_hash_t *probe) {
+	caf_hash_t *hash = (caf_hash_t *)NULL;
+	if (table->old != (caf_hash_t *)NULL) {
+		hash = caf_hash_buckets_find (table->old, table->old_size, probe);
+	}
+	if (hash == (caf_hash_t *)NULL) {
+		hash = caf_hash_buckets_find (table->buckets, table->size, probe);
+	}
+	return hash;
+}
+
+
+static void
+caf_hash_table_rehash (caf_hash_table_t *table, size_t steps) {
+	caf_hash_t *from, *to;
+	while (table->old != (caf_hash_t *)NULL) {
+		if (table->old_count == 0 || table->old_idx >= table->old_size) {
+			caf_hash_buckets_free (table, table->old);
+			__atomic_store_n (&(table->old), (caf_hash_t *)NULL,
+			                  __ATOMIC_RELEASE);
+			table->old_size = 0;
+			table->old_count = 0;
+			table->old_idx = 0;
+			break;
+		}
+		if (steps == 0) {
+			break;
+		}
+		from = &(table->old[table->old_idx]);
+		if (CAF_HASH_LIVE(from)) {
+			to = caf_hash_buckets_slot (table->buckets, table->size,
+			                            from->hash1, from->hash2);
+			if (CAF_HASH_EMPTY(to)) {
+				table->used++;
+			}
+			/* the copy is visible before the old bucket goes */
+			caf_hash_bucket_store (to, from);
+			caf_hash_bucket_clear (from);
+			table->old_count--;
+		}
+		table->old_idx++;
+		steps--;
+	}
+}
+
+
 static int
-caf_hash_dump (FILE *out, void *data) {
-	caf_hash_t *hash;
+caf_hash_table_grow (caf_hash_table_t *table) {
+	caf_hash_t *b;
+	size_t sz = table->size;
+	/* a pending migration must end before the current array retires */
+	caf_hash_table_rehash (table, table->old_size);
+	if ((table->count * 2) >= table->size) {
+		sz = table->size * 2;
+	}
+	b = caf_hash_buckets_new (sz);
+	if (b == (caf_hash_t *)NULL) {
+		return CAF_ERROR;
+	}
+	table->old_size = table->size;
+	table->old_count = table->count;
+	table->old_idx = 0;
+	__atomic_store_n (&(table->old), table->buckets, __ATOMIC_RELEASE);
+	__atomic_store_n (&(table->buckets), b, __ATOMIC_RELEASE);
+	table->size = sz;
+	table->used = 0;
+	return CAF_OK;
+}
+
+
+static int
+caf_hash_dump (FILE *out, caf_hash_t *hash) {
 	const char *msg = "[%p] hash1: %15.15u; hash2: %15.15u; key: %30.30s\n"
 		"     data: %s\n\n";
-	if (data != (void *)NULL) {
-		hash = (caf_hash_t *)data;
+	if (CAF_HASH_LIVE(hash)) {
 		fprintf (out, msg, hash, hash->hash1, hash->hash2, (char *)hash->key,
 		         (char *)hash->data);
 		return CAF_OK;
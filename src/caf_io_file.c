@@ -43,6 +43,7 @@ static char Id[] = "$Id$";
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
 #include "caf/caf_data_buffer.h"
+#include "caf/caf_data_chain.h"
 #include "caf/caf_io_file.h"
 
 
@@ -151,6 +152,10 @@ ssize_t
 io_read (caf_io_file_t *r, cbuffer_t *b) {
 	ssize_t sz = (ssize_t)-1;
 	if (r != (caf_io_file_t *)NULL && b != (cbuffer_t *)NULL) {
+		/* the read must not reach the slices sharing the data */
+		if (cbuf_own (b) != CAF_OK) {
+			return (ssize_t)-1;
+		}
 		if (r->fd >= 0 && b->sz > 0) {
 			sz = read (r->fd, b->data, b->sz);
 			b->iosz = sz;
@@ -178,6 +183,48 @@ io_write (caf_io_file_t *r, cbuffer_t *b) {
 }
 
 
+ssize_t
+io_readv (caf_io_file_t *r, cbuf_chain_t *ch) {
+	struct iovec *iov;
+	ssize_t sz = (ssize_t)-1;
+	int cnt = 0;
+	if (r != (caf_io_file_t *)NULL && ch != (cbuf_chain_t *)NULL
+		&& r->fd >= 0) {
+		iov = cbuf_chain_iov_in (ch, &cnt);
+		if (iov == (struct iovec *)NULL) {
+			return cnt == 0 ? 0 : sz;
+		}
+		sz = readv (r->fd, iov, cnt < CAF_CHAIN_IOV_MAX
+					? cnt : CAF_CHAIN_IOV_MAX);
+		if (sz >= 0) {
+			cbuf_chain_received (ch, (size_t)sz);
+		}
+	}
+	return sz;
+}
+
+
+ssize_t
+io_writev (caf_io_file_t *r, cbuf_chain_t *ch) {
+	struct iovec *iov;
+	ssize_t sz = (ssize_t)-1;
+	int cnt = 0;
+	if (r != (caf_io_file_t *)NULL && ch != (cbuf_chain_t *)NULL
+		&& r->fd >= 0) {
+		iov = cbuf_chain_iov (ch, &cnt);
+		if (iov == (struct iovec *)NULL) {
+			return 0;
+		}
+		sz = writev (r->fd, iov, cnt < CAF_CHAIN_IOV_MAX
+					 ? cnt : CAF_CHAIN_IOV_MAX);
+		if (sz > 0) {
+			cbuf_chain_consume (ch, (size_t)sz);
+		}
+	}
+	return sz;
+}
+
+
 int
 io_pipe (caf_io_file_t *r) {
 	if (r != (caf_io_file_t *)NULL) {
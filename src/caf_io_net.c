@@ -38,6 +38,7 @@ static char Id[] = "$Id$";
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/fcntl.h>
@@ -45,6 +46,7 @@ static char Id[] = "$Id$";
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
 #include "caf/caf_data_buffer.h"
+#include "caf/caf_data_chain.h"
 #include "caf/caf_io_file.h"
 #include "caf/caf_io_net.h"
 
@@ -82,7 +84,7 @@ caf_conn_new (int s, int f, socklen_t al, struct sockaddr *src,
               struct sockaddr *dst) {
 	caf_conn_t *con = (caf_conn_t *)NULL;
 	if (f > 0 && al > 0) {
-		con = (caf_conn_t *)xmalloc (CAF_CONNECTION_SZ);
+		con = (caf_conn_t *)xobjalloc (CAF_CONNECTION_SZ);
 		if (con != (caf_conn_t *)NULL) {
 			con->sock = s;
 			con->flags = f;
@@ -108,7 +110,7 @@ caf_conn_delete (caf_conn_t *c) {
 				xfree (c->daddr);
 			}
 		}
-		xfree (c);
+		xobjfree (c, CAF_CONNECTION_SZ);
 		return CAF_OK;
 	}
 	return CAF_ERROR;
@@ -253,6 +255,10 @@ caf_conn_connect (caf_conn_t *c) {
 ssize_t
 caf_conn_recv (caf_conn_t *c, cbuffer_t *b, int flg) {
 	if (c != (caf_conn_t *)NULL && b != (cbuffer_t *)NULL) {
+		/* the read must not reach the slices sharing the data */
+		if (cbuf_own (b) != CAF_OK) {
+			return (ssize_t)-1;
+		}
 		b->iosz = recvfrom (c->sock, b->data, b->sz, flg, c->saddr,
 		                    (socklen_t *)&(c->addrlen));
 		return b->iosz;
@@ -272,6 +278,57 @@ caf_conn_send (caf_conn_t *c, cbuffer_t *b, int flg) {
 }
 
 
+ssize_t
+caf_conn_recvv (caf_conn_t *c, cbuf_chain_t *ch, int flg) {
+	struct msghdr m;
+	ssize_t sz;
+	int cnt = 0;
+	if (c != (caf_conn_t *)NULL && ch != (cbuf_chain_t *)NULL) {
+		memset (&m, 0, sizeof (m));
+		m.msg_iov = cbuf_chain_iov_in (ch, &cnt);
+		if (m.msg_iov == (struct iovec *)NULL) {
+			return cnt == 0 ? 0 : (ssize_t)-1;
+		}
+		m.msg_iovlen = cnt < CAF_CHAIN_IOV_MAX ? cnt : CAF_CHAIN_IOV_MAX;
+		m.msg_name = c->saddr;
+		m.msg_namelen = c->saddr != (struct sockaddr *)NULL ? c->addrlen : 0;
+		sz = recvmsg (c->sock, &m, flg);
+		if (c->saddr != (struct sockaddr *)NULL) {
+			c->addrlen = m.msg_namelen;
+		}
+		if (sz >= 0) {
+			cbuf_chain_received (ch, (size_t)sz);
+		}
+		return sz;
+	}
+	return 0;
+}
+
+
+ssize_t
+caf_conn_sendv (caf_conn_t *c, cbuf_chain_t *ch, int flg) {
+	struct msghdr m;
+	ssize_t sz;
+	int cnt = 0;
+	if (c != (caf_conn_t *)NULL && ch != (cbuf_chain_t *)NULL) {
+		memset (&m, 0, sizeof (m));
+		m.msg_iov = cbuf_chain_iov (ch, &cnt);
+		if (m.msg_iov == (struct iovec *)NULL) {
+			return 0;
+		}
+		m.msg_iovlen = cnt < CAF_CHAIN_IOV_MAX ? cnt : CAF_CHAIN_IOV_MAX;
+		m.msg_name = c->daddr;
+		m.msg_namelen = c->daddr != (struct sockaddr *)NULL ? c->addrlen : 0;
+		sz = sendmsg (c->sock, &m, flg);
+		if (sz > 0) {
+			cbuf_chain_consume (ch, (size_t)sz);
+		}
+		return sz;
+	}
+	return 0;
+}
+
+
 int
 caf_conn_bind (caf_conn_t *c) {
 	if (c != (caf_conn_t *)NULL) {
@@ -142,9 +142,9 @@ caf_shm_alloc_t *
 caf_shm_seg_new (key_t k, size_t sz, int flg) {
 	int id;
 	caf_shm_alloc_t *r = (caf_shm_alloc_t *)NULL;
-	if (r != (caf_shm_alloc_t *)NULL) {
+	if (sz > 0) {
 		id = shmget (k, sz, flg);
-		if (id > 0) {
+		if (id >= 0) {
 			r = (caf_shm_alloc_t *)xmalloc (CAF_SHM_ALLOC_SZ);
 			if (r != (caf_shm_alloc_t *)NULL) {
 				r->id = id;
@@ -176,12 +176,13 @@ void *
 caf_shm_seg_attach (caf_shm_alloc_t *s) {
 	void *ptr = (void *)-1;
 	if (s != (caf_shm_alloc_t *)NULL) {
-		ptr = shmat (s->id, (void *)NULL, s->flags);
-		if (ptr != CAF_SHM_BAD_ALLOC) {
-			s->ptr = s;
+		ptr = shmat (s->id, (void *)NULL, 0);
+		if (ptr != (void *)-1) {
+			s->ptr = ptr;
+			return ptr;
 		}
 	}
-	return ptr;
+	return CAF_SHM_BAD_ALLOC;
 }
 
 
@@ -0,0 +1,202 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_thread_futex.h"
+#include "caf/caf_sem_futex.h"
+
+
+static int
+caf_sem_futex_take (caf_sem_futex_t *r) {
+	int v = __atomic_load_n (&(r->value), __ATOMIC_RELAXED);
+	while (v > 0) {
+		if (__atomic_compare_exchange_n (&(r->value), &v, v - 1, 0,
+										 __ATOMIC_ACQUIRE,
+										 __ATOMIC_RELAXED)) {
+			return CAF_OK;
+		}
+	}
+	return CAF_ERROR;
+}
+
+
+static int
+caf_sem_futex_sleep (caf_sem_futex_t *r, const struct timespec *to) {
+	if (r->flag == CAF_SEM_FUTEX_SHARED) {
+		return pth_futex_wait_shared (&(r->value), 0, to);
+	}
+	return pth_futex_wait (&(r->value), 0, to);
+}
+
+
+caf_sem_futex_t *
+caf_sem_futex_new (const int flag, const int value) {
+	caf_sem_futex_t *r = (caf_sem_futex_t *)NULL;
+	r = (caf_sem_futex_t *)xmalloc (CAF_SEM_FUTEX_SZ);
+	if (r != (caf_sem_futex_t *)NULL) {
+		if ((caf_sem_futex_init (r, flag, value)) == CAF_OK) {
+			return r;
+		}
+		xfree (r);
+		r = (caf_sem_futex_t *)NULL;
+	}
+	return r;
+}
+
+
+int
+caf_sem_futex_init (caf_sem_futex_t *r, const int flag, const int value) {
+	if (r != (caf_sem_futex_t *)NULL && value >= 0
+		&& (flag == CAF_SEM_FUTEX_PRIVATE || flag == CAF_SEM_FUTEX_SHARED)) {
+		r->flag = flag;
+		r->waiters = 0;
+		__atomic_store_n (&(r->value), value, __ATOMIC_RELEASE);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_sem_futex_delete (caf_sem_futex_t *r) {
+	if (r != (caf_sem_futex_t *)NULL) {
+		xfree (r);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_sem_futex_exists (caf_sem_futex_t *r) {
+	if (r != (caf_sem_futex_t *)NULL) {
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_sem_futex_post (caf_sem_futex_t *r) {
+	if (r != (caf_sem_futex_t *)NULL) {
+		__atomic_fetch_add (&(r->value), 1, __ATOMIC_SEQ_CST);
+		/* pairs with the waiters increment before the value check
+		   in caf_sem_futex_timedwait, one of both sides sees the other */
+		if (__atomic_load_n (&(r->waiters), __ATOMIC_SEQ_CST) > 0) {
+			if (r->flag == CAF_SEM_FUTEX_SHARED) {
+				pth_futex_wake_shared (&(r->value), 1);
+			} else {
+				pth_futex_wake (&(r->value), 1);
+			}
+		}
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_sem_futex_getvalue (caf_sem_futex_t *r) {
+	if (r != (caf_sem_futex_t *)NULL) {
+		return __atomic_load_n (&(r->value), __ATOMIC_RELAXED);
+	}
+	return 0;
+}
+
+
+int
+caf_sem_futex_timedwait (caf_sem_futex_t *r, const struct timespec *to) {
+	int v, res = CAF_ERROR_SUB;
+	if (r == (caf_sem_futex_t *)NULL) {
+		return CAF_ERROR;
+	}
+	if ((caf_sem_futex_take (r)) == CAF_OK) {
+		return CAF_OK;
+	}
+	__atomic_fetch_add (&(r->waiters), 1, __ATOMIC_SEQ_CST);
+	for (;;) {
+		v = __atomic_load_n (&(r->value), __ATOMIC_SEQ_CST);
+		if (v > 0) {
+			if (__atomic_compare_exchange_n (&(r->value), &v, v - 1, 0,
+											 __ATOMIC_ACQUIRE,
+											 __ATOMIC_RELAXED)) {
+				res = CAF_OK;
+				break;
+			}
+			continue;
+		}
+		if ((caf_sem_futex_sleep (r, to)) == CAF_ERROR_SUB) {
+			res = caf_sem_futex_take (r) == CAF_OK ? CAF_OK : CAF_ERROR_SUB;
+			break;
+		}
+	}
+	__atomic_fetch_sub (&(r->waiters), 1, __ATOMIC_RELAXED);
+	return res;
+}
+
+
+int
+caf_sem_futex_wait (caf_sem_futex_t *r) {
+	return caf_sem_futex_timedwait (r, (const struct timespec *)NULL);
+}
+
+
+int
+caf_sem_futex_trywait (caf_sem_futex_t *r) {
+	if (r != (caf_sem_futex_t *)NULL) {
+		return caf_sem_futex_take (r);
+	}
+	return CAF_ERROR;
+}
+
+
+int
+caf_sem_futex_lock (caf_sem_futex_t *r) {
+	return caf_sem_futex_wait (r);
+}
+
+
+int
+caf_sem_futex_trylock (caf_sem_futex_t *r) {
+	return caf_sem_futex_trywait (r);
+}
+
+
+int
+caf_sem_futex_unlock (caf_sem_futex_t *r) {
+	return caf_sem_futex_post (r);
+}
+
+/* caf_sem_futex.c ends here */
@@ -29,6 +29,7 @@ static char Id[] = "$Id$";
 #endif /* !HAVE_CONFIG_H */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <pthread.h>
 
@@ -43,6 +44,8 @@ pth_attri_new (void) {
 	attri = (pth_attri_t *)xmalloc (CAF_PT_ATTRI_SZ);
 	if (attri != (pth_attri_t *)NULL) {
 		attri->at = 0;
+		attri->cpus = (pth_cpuset_t *)NULL;
+		attri->name[0] = '\0';
 	}
 	return attri;
 }
@@ -114,12 +117,12 @@ pth_attri_set (pth_attri_t *attri, pth_attr_types_t t, void *data) {
 		case PTH_ATTR_DETACHED:
 			attri->at |= t;
 			return pthread_attr_setdetachstate (&(attri->attr),
-			                                    PTHREAD_CREATE_JOINABLE);
+			                                    PTHREAD_CREATE_DETACHED);
 			/* pthread_attr_setdetachstate */
 		case PTH_ATTR_JOINABLE:
 			attri->at |= t;
 			return pthread_attr_setdetachstate (&(attri->attr),
-			                                    PTHREAD_CREATE_DETACHED);
+			                                    PTHREAD_CREATE_JOINABLE);
 #ifndef LINUX
 			/* pthread_attr_setstacksize */
 		case PTH_ATTR_STACKSZ:
@@ -147,6 +150,20 @@ pth_attri_set (pth_attri_t *attri, pth_attr_types_t t, void *data) {
 		case PTH_ATTR_SCOPE:
 			attri->at |= t;
 			return pthread_attr_setscope (&(attri->attr), *di);
+			/* applied by pth_pool_create and pth_pool_add */
+		case PTH_ATTR_AFFINITY:
+			attri->cpus = (pth_cpuset_t *)data;
+			attri->at = data != NULL ? (attri->at | t) : (attri->at & ~t);
+			return CAF_OK;
+			/* applied by pth_pool_create and pth_pool_add */
+		case PTH_ATTR_NAME:
+			attri->name[0] = '\0';
+			if (data != NULL) {
+				strncat (attri->name, (const char *)data,
+						 CAF_PTH_NAME_LEN - 1);
+			}
+			attri->at = data != NULL ? (attri->at | t) : (attri->at & ~t);
+			return CAF_OK;
 		default:
 			return CAF_ERROR_SUB;
 		}
@@ -186,6 +203,14 @@ pth_attri_get (pth_attri_t *attri, pth_attr_types_t t, void *data) {
 			/* pthread_attr_getscope */
 		case PTH_ATTR_SCOPE:
 			return pthread_attr_getscope (&(attri->attr), (int *)data);
+			/* the pth_cpuset_t pointer */
+		case PTH_ATTR_AFFINITY:
+			*((pth_cpuset_t **)data) = attri->cpus;
+			return CAF_OK;
+			/* the name prefix, CAF_PTH_NAME_LEN bytes */
+		case PTH_ATTR_NAME:
+			memcpy (data, attri->name, CAF_PTH_NAME_LEN);
+			return CAF_OK;
 		default:
 			return CAF_ERROR_SUB;
 		}
@@ -193,5 +218,39 @@ pth_attri_get (pth_attri_t *attri, pth_attr_types_t t, void *data) {
 	return CAF_ERROR_SUB;
 }
 
+
+/* pthread_attr_t has no copy, the settings are read one by one */
+int
+pth_attri_copy (pth_attri_t *dst, pth_attri_t *src) {
+	struct sched_param sp;
+	size_t sz;
+	int v;
+	if (dst == (pth_attri_t *)NULL || src == (pth_attri_t *)NULL
+		|| pthread_attr_init (&(dst->attr)) != 0) {
+		return CAF_ERROR;
+	}
+	if (pthread_attr_getdetachstate (&(src->attr), &v) != 0
+		|| pthread_attr_setdetachstate (&(dst->attr), v) != 0
+		|| pthread_attr_getscope (&(src->attr), &v) != 0
+		|| pthread_attr_setscope (&(dst->attr), v) != 0
+		|| pthread_attr_getinheritsched (&(src->attr), &v) != 0
+		|| pthread_attr_setinheritsched (&(dst->attr), v) != 0
+		|| pthread_attr_getschedpolicy (&(src->attr), &v) != 0
+		|| pthread_attr_setschedpolicy (&(dst->attr), v) != 0
+		|| pthread_attr_getschedparam (&(src->attr), &sp) != 0
+		|| pthread_attr_setschedparam (&(dst->attr), &sp) != 0
+		|| pthread_attr_getstacksize (&(src->attr), &sz) != 0
+		|| pthread_attr_setstacksize (&(dst->attr), sz) != 0
+		|| pthread_attr_getguardsize (&(src->attr), &sz) != 0
+		|| pthread_attr_setguardsize (&(dst->attr), sz) != 0) {
+		pthread_attr_destroy (&(dst->attr));
+		return CAF_ERROR;
+	}
+	dst->at = src->at;
+	dst->cpus = src->cpus;
+	memcpy (dst->name, src->name, CAF_PTH_NAME_LEN);
+	return CAF_OK;
+}
+
 /* caf_thread_attr.c ends here */
 
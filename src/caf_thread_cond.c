@@ -35,14 +35,23 @@ static char Id[] = "$Id$";
 
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
+#include "caf/caf_thread_futex.h"
 #include "caf/caf_thread_cond.h"
 
 
+static int pth_cond_block (pth_cond_t *c, pth_mutex_t *m,
+						   const struct timespec *tm);
+static int pth_cond_futex_wait (pth_cond_t *c, pth_mutex_t *m,
+								const struct timespec *tm);
+
+
 pth_cond_t *
 pth_cond_new (void) {
 	pth_cond_t *c = (pth_cond_t *)xmalloc (PTH_COND_SZ);
 	if (c != (pth_cond_t *)NULL) {
 		c->at = 0;
+		c->seq = 0;
+		c->waiters = 0;
 	}
 	return c;
 }
@@ -132,6 +141,10 @@ pth_condi_delete (pth_cond_t *c) {
 int
 pth_cond_signal (pth_cond_t *c) {
 	if (c != (pth_cond_t *)NULL) {
+		__atomic_fetch_add (&(c->seq), 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n (&(c->waiters), __ATOMIC_SEQ_CST) > 0) {
+			pth_futex_wake (&(c->seq), 1);
+		}
 		return pthread_cond_signal (&(c->cond));
 	}
 	return CAF_ERROR;
@@ -141,6 +154,10 @@ pth_cond_signal (pth_cond_t *c) {
 int
 pth_cond_broadcast (pth_cond_t *c) {
 	if (c != (pth_cond_t *)NULL) {
+		__atomic_fetch_add (&(c->seq), 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n (&(c->waiters), __ATOMIC_SEQ_CST) > 0) {
+			pth_futex_wake (&(c->seq), CAF_PTH_FUTEX_ALL);
+		}
 		return pthread_cond_broadcast (&(c->cond));
 	}
 	return CAF_ERROR;
@@ -149,8 +166,17 @@ pth_cond_broadcast (pth_cond_t *c) {
 
 int
 pth_cond_wait (pth_cond_t *c, pth_mutex_t *m) {
-	if (c != (pth_cond_t *)NULL) {
-		pthread_cond_wait (&(c->cond), &(m->mutex));
+	long long t0 = 0;
+	int r;
+	if (c != (pth_cond_t *)NULL && m != (pth_mutex_t *)NULL) {
+		if (m->prof != (pth_lprof_t *)NULL) {
+			t0 = pth_lprof_now ();
+		}
+		r = pth_cond_block (c, m, (const struct timespec *)NULL);
+		if (m->prof != (pth_lprof_t *)NULL) {
+			pth_lprof_cond (m->prof, t0);
+		}
+		return r == CAF_OK ? CAF_OK : CAF_ERROR;
 	}
 	return CAF_ERROR;
 }
@@ -158,11 +184,64 @@ pth_cond_wait (pth_cond_t *c, pth_mutex_t *m) {
 
 int
 pth_cond_timedwait (pth_cond_t *c, pth_mutex_t *m, const struct timespec *tm) {
-	if (c != (pth_cond_t *)NULL) {
-		pthread_cond_timedwait (&(c->cond), &(m->mutex), tm);
+	long long t0 = 0;
+	int r;
+	if (c != (pth_cond_t *)NULL && m != (pth_mutex_t *)NULL) {
+		if (m->prof != (pth_lprof_t *)NULL) {
+			t0 = pth_lprof_now ();
+		}
+		r = pth_cond_block (c, m, tm);
+		if (m->prof != (pth_lprof_t *)NULL) {
+			pth_lprof_cond (m->prof, t0);
+		}
+		return r;
 	}
 	return CAF_ERROR;
 }
 
+
+static int
+pth_cond_block (pth_cond_t *c, pth_mutex_t *m, const struct timespec *tm) {
+	int r;
+	if (m->kind == PTHDR_MUTEX_ADAPTIVE) {
+		return pth_cond_futex_wait (c, m, tm);
+	}
+	/* pthread releases and takes the mutex back behind our back, the
+	   profile sees an uncontended acquisition */
+	if (m->prof != (pth_lprof_t *)NULL) {
+		pth_lprof_released (m->prof, m->hold_start);
+		m->hold_start = 0;
+	}
+	if (tm == (const struct timespec *)NULL) {
+		r = pthread_cond_wait (&(c->cond), &(m->mutex));
+	} else {
+		r = pthread_cond_timedwait (&(c->cond), &(m->mutex), tm);
+	}
+	if (m->prof != (pth_lprof_t *)NULL) {
+		m->hold_start = pth_lprof_acquired (m->prof, 0, 0);
+	}
+	if (r == 0) {
+		return CAF_OK;
+	}
+	/* timeouts are told apart, as pth_futex_wait does */
+	return r == ETIMEDOUT ? CAF_ERROR_SUB : CAF_ERROR;
+}
+
+
+static int
+pth_cond_futex_wait (pth_cond_t *c, pth_mutex_t *m,
+					 const struct timespec *tm) {
+	int r, s;
+	/* a signal after the sequence read changes the word and the wait
+	   returns at once, so no wake up is lost across the unlock */
+	__atomic_fetch_add (&(c->waiters), 1, __ATOMIC_SEQ_CST);
+	s = __atomic_load_n (&(c->seq), __ATOMIC_SEQ_CST);
+	pth_mtx_unlock (m);
+	r = pth_futex_wait (&(c->seq), s, tm);
+	__atomic_fetch_sub (&(c->waiters), 1, __ATOMIC_SEQ_CST);
+	pth_mtx_lock (m);
+	return r;
+}
+
 /* caf_thread_cond.c ends here */
 
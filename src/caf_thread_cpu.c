@@ -0,0 +1,365 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef LINUX_SYSTEM
+#include <sched.h>
+#include <dirent.h>
+#endif /* !LINUX_SYSTEM */
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_thread_cpu.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS             MAP_ANON
+#endif /* !MAP_ANONYMOUS */
+
+#define CAF_PTH_CPU_SYSFS         "/sys/devices/system/cpu/cpu%d"
+
+typedef struct pth_cpu_topo_s pth_cpu_topo_t;
+struct pth_cpu_topo_s {
+	int cpu;
+	int node;
+	int package;
+	int core;
+	/* hardware thread rank inside the core */
+	int smt;
+	/* rank among the package CPUs with the same smt rank */
+	int rank;
+};
+
+static int pth_cpu_allowed (int **cpus);
+static int pth_cpu_sysfs_int (int cpu, const char *attr, int def);
+static int pth_cpu_cmp_compact (const void *a, const void *b);
+static int pth_cpu_cmp_scatter (const void *a, const void *b);
+
+
+pth_cpuset_t *
+pth_cpuset_new (pth_cpu_policy_t policy, const int *list, int n) {
+	pth_cpuset_t *r;
+	pth_cpu_topo_t *t;
+	int *cpus = (int *)NULL;
+	int i, j, c;
+	if (policy == PTH_CPU_LIST) {
+		if (list == (const int *)NULL || n <= 0) {
+			return (pth_cpuset_t *)NULL;
+		}
+		c = n;
+	} else {
+		c = pth_cpu_allowed (&cpus);
+		if (c <= 0) {
+			return (pth_cpuset_t *)NULL;
+		}
+	}
+	r = (pth_cpuset_t *)xmalloc (CAF_PTH_CPUSET_SZ);
+	t = (pth_cpu_topo_t *)xmalloc (sizeof(pth_cpu_topo_t) * (size_t)c);
+	if (r == (pth_cpuset_t *)NULL || t == (pth_cpu_topo_t *)NULL) {
+		xfree (r);
+		xfree (t);
+		xfree (cpus);
+		return (pth_cpuset_t *)NULL;
+	}
+	r->policy = policy;
+	r->count = c;
+	r->cpus = (int *)xmalloc (sizeof(int) * (size_t)c);
+	r->nodes = (int *)xmalloc (sizeof(int) * (size_t)c);
+	if (r->cpus == (int *)NULL || r->nodes == (int *)NULL) {
+		xfree (t);
+		xfree (cpus);
+		pth_cpuset_delete (r);
+		return (pth_cpuset_t *)NULL;
+	}
+	for (i = 0; i < c; i++) {
+		t[i].cpu = policy == PTH_CPU_LIST ? list[i] : cpus[i];
+		t[i].node = pth_cpu_node (t[i].cpu);
+		t[i].package = pth_cpu_sysfs_int (t[i].cpu,
+										  "topology/physical_package_id", 0);
+		t[i].core = pth_cpu_sysfs_int (t[i].cpu, "topology/core_id",
+									   t[i].cpu);
+	}
+	if (policy != PTH_CPU_LIST) {
+		qsort (t, (size_t)c, sizeof(pth_cpu_topo_t), pth_cpu_cmp_compact);
+	}
+	if (policy == PTH_CPU_SCATTER) {
+		/* siblings are adjacent in compact order */
+		for (i = 0; i < c; i++) {
+			t[i].smt = (i > 0 && t[i - 1].package == t[i].package
+						&& t[i - 1].core == t[i].core) ? t[i - 1].smt + 1 : 0;
+			t[i].rank = 0;
+			for (j = 0; j < i; j++) {
+				if (t[j].node == t[i].node && t[j].package == t[i].package
+					&& t[j].smt == t[i].smt) {
+					t[i].rank++;
+				}
+			}
+		}
+		qsort (t, (size_t)c, sizeof(pth_cpu_topo_t), pth_cpu_cmp_scatter);
+	}
+	for (i = 0; i < c; i++) {
+		r->cpus[i] = t[i].cpu;
+		r->nodes[i] = t[i].node;
+	}
+	xfree (t);
+	xfree (cpus);
+	return r;
+}
+
+
+void
+pth_cpuset_delete (pth_cpuset_t *set) {
+	if (set != (pth_cpuset_t *)NULL) {
+		xfree (set->cpus);
+		xfree (set->nodes);
+		xfree (set);
+	}
+}
+
+
+int
+pth_cpuset_cpu (pth_cpuset_t *set, int i) {
+	if (set == (pth_cpuset_t *)NULL || set->count <= 0 || i < 0) {
+		return -1;
+	}
+	return set->cpus[i % set->count];
+}
+
+
+int
+pth_cpu_node (int cpu) {
+#ifdef LINUX_SYSTEM
+	char path[64];
+	DIR *d;
+	struct dirent *e;
+	int node = 0;
+	snprintf (path, sizeof(path), CAF_PTH_CPU_SYSFS, cpu);
+	d = opendir (path);
+	if (d == (DIR *)NULL) {
+		return 0;
+	}
+	while ((e = readdir (d)) != (struct dirent *)NULL) {
+		if (strncmp (e->d_name, "node", 4) == 0
+			&& sscanf (e->d_name + 4, "%d", &node) == 1) {
+			break;
+		}
+		node = 0;
+	}
+	closedir (d);
+	return node;
+#else /* !LINUX_SYSTEM */
+	(void)cpu;
+	return 0;
+#endif /* !LINUX_SYSTEM */
+}
+
+
+int
+pth_cpu_current (void) {
+#ifdef LINUX_SYSTEM
+	return sched_getcpu ();
+#else /* !LINUX_SYSTEM */
+	return -1;
+#endif /* !LINUX_SYSTEM */
+}
+
+
+int
+pth_cpu_pin (int cpu) {
+#ifdef LINUX_SYSTEM
+	cpu_set_t set;
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		return CAF_ERROR;
+	}
+	CPU_ZERO (&set);
+	CPU_SET (cpu, &set);
+	if (pthread_setaffinity_np (pthread_self (), sizeof(cpu_set_t),
+								&set) == 0) {
+		return CAF_OK;
+	}
+#else /* !LINUX_SYSTEM */
+	(void)cpu;
+#endif /* !LINUX_SYSTEM */
+	return CAF_ERROR;
+}
+
+
+int
+pth_cpu_set_name (pthread_t thr, const char *prefix, int i) {
+#ifdef LINUX_SYSTEM
+	char name[CAF_PTH_NAME_LEN];
+	if (prefix == (const char *)NULL) {
+		return CAF_ERROR;
+	}
+	snprintf (name, sizeof(name), "%s/%d", prefix, i);
+	if (pthread_setname_np (thr, name) == 0) {
+		return CAF_OK;
+	}
+#else /* !LINUX_SYSTEM */
+	(void)thr;
+	(void)prefix;
+	(void)i;
+#endif /* !LINUX_SYSTEM */
+	return CAF_ERROR;
+}
+
+
+void *
+pth_cpu_local_alloc (size_t sz) {
+	void *r;
+	if (sz == 0) {
+		return NULL;
+	}
+	/* anonymous pages are not placed until written */
+	r = mmap (NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+			  -1, 0);
+	return r == MAP_FAILED ? NULL : r;
+}
+
+
+void
+pth_cpu_local_touch (void *ptr, size_t sz) {
+	volatile char *p = (volatile char *)ptr;
+	size_t pg = (size_t)sysconf (_SC_PAGESIZE), i;
+	if (ptr == NULL) {
+		return;
+	}
+	for (i = 0; i < sz; i += pg) {
+		p[i] = 0;
+	}
+}
+
+
+void
+pth_cpu_local_free (void *ptr, size_t sz) {
+	if (ptr != NULL) {
+		munmap (ptr, sz);
+	}
+}
+
+
+static int
+pth_cpu_allowed (int **cpus) {
+	int c = 0, i, n;
+#ifdef LINUX_SYSTEM
+	cpu_set_t set;
+	if (sched_getaffinity (0, sizeof(cpu_set_t), &set) == 0) {
+		n = CPU_COUNT (&set);
+		*cpus = (int *)xmalloc (sizeof(int) * (size_t)n);
+		if (*cpus == (int *)NULL) {
+			return 0;
+		}
+		for (i = 0; i < CPU_SETSIZE && c < n; i++) {
+			if (CPU_ISSET (i, &set)) {
+				(*cpus)[c++] = i;
+			}
+		}
+		return c;
+	}
+#endif /* !LINUX_SYSTEM */
+	n = (int)sysconf (_SC_NPROCESSORS_ONLN);
+	n = n > 0 ? n : 1;
+	*cpus = (int *)xmalloc (sizeof(int) * (size_t)n);
+	if (*cpus == (int *)NULL) {
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		(*cpus)[c++] = i;
+	}
+	return c;
+}
+
+
+static int
+pth_cpu_sysfs_int (int cpu, const char *attr, int def) {
+#ifdef LINUX_SYSTEM
+	char path[128];
+	FILE *f;
+	int v;
+	snprintf (path, sizeof(path), CAF_PTH_CPU_SYSFS "/%s", cpu, attr);
+	f = fopen (path, "r");
+	if (f == (FILE *)NULL) {
+		return def;
+	}
+	if (fscanf (f, "%d", &v) != 1) {
+		v = def;
+	}
+	fclose (f);
+	return v;
+#else /* !LINUX_SYSTEM */
+	(void)cpu;
+	(void)attr;
+	return def;
+#endif /* !LINUX_SYSTEM */
+}
+
+
+static int
+pth_cpu_cmp_compact (const void *a, const void *b) {
+	const pth_cpu_topo_t *x = (const pth_cpu_topo_t *)a;
+	const pth_cpu_topo_t *y = (const pth_cpu_topo_t *)b;
+	if (x->node != y->node) {
+		return x->node < y->node ? -1 : 1;
+	}
+	if (x->package != y->package) {
+		return x->package < y->package ? -1 : 1;
+	}
+	if (x->core != y->core) {
+		return x->core < y->core ? -1 : 1;
+	}
+	return x->cpu < y->cpu ? -1 : (x->cpu > y->cpu);
+}
+
+
+static int
+pth_cpu_cmp_scatter (const void *a, const void *b) {
+	const pth_cpu_topo_t *x = (const pth_cpu_topo_t *)a;
+	const pth_cpu_topo_t *y = (const pth_cpu_topo_t *)b;
+	if (x->smt != y->smt) {
+		return x->smt < y->smt ? -1 : 1;
+	}
+	if (x->rank != y->rank) {
+		return x->rank < y->rank ? -1 : 1;
+	}
+	if (x->node != y->node) {
+		return x->node < y->node ? -1 : 1;
+	}
+	if (x->package != y->package) {
+		return x->package < y->package ? -1 : 1;
+	}
+	return x->cpu < y->cpu ? -1 : (x->cpu > y->cpu);
+}
+
+/* caf_thread_cpu.c ends here */
@@ -0,0 +1,390 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_data_deque.h"
+#include "caf/caf_data_ring.h"
+#include "caf/caf_thread_attr.h"
+#include "caf/caf_thread_pool.h"
+#include "caf/caf_thread_mutex.h"
+#include "caf/caf_thread_cond.h"
+#include "caf/caf_thread_epool.h"
+
+static long long pth_epool_now (void);
+static void pth_epool_grow (pth_epool_t *ep, long long now);
+static void pth_epool_retire (pth_epool_t *ep);
+static int pth_epool_thread_del (void *ptr);
+static int pth_epool_idle (pth_epool_t *ep);
+static void *pth_epool_rtn (void *arg);
+static void pth_epool_free (pth_epool_t *ep);
+
+
+pth_epool_t *
+pth_epool_new (pth_attri_t *attrs, int min, int max, long idle_us,
+			   long age_us) {
+	pth_epool_t *ep;
+	int i;
+	if (min < 0 || max < 1 || max < min) {
+		return (pth_epool_t *)NULL;
+	}
+	ep = (pth_epool_t *)xmalloc (CAF_PTH_EPOOL_SZ);
+	if (ep == (pth_epool_t *)NULL) {
+		return ep;
+	}
+	ep->min = min;
+	ep->max = max;
+	ep->idle_us = idle_us > 0 ? idle_us : CAF_PTH_EPOOL_IDLE;
+	ep->age_us = age_us >= 0 ? age_us : CAF_PTH_EPOOL_AGE;
+	ep->starting = 0;
+	ep->active = 0;
+	ep->stop = 0;
+	ep->st.workers = 0;
+	ep->st.idle = 0;
+	ep->st.backlog = 0;
+	ep->st.peak = 0;
+	ep->st.grows = 0;
+	ep->st.grow_fails = 0;
+	ep->st.retires = 0;
+	ep->st.runs = 0;
+	ep->st.wait_ns = 0;
+	ep->st.wait_max_ns = 0;
+	ep->attri = (pth_attri_t *)NULL;
+	ep->pool = (pth_pool_t *)NULL;
+	ep->work = pth_condi_init ();
+	ep->done = pth_condi_init ();
+	ep->queue = ring_create (CAF_PTH_EPOOL_QUEUE);
+	ep->tasks = caf_npool_new (sizeof(pth_etask_t), CAF_NPOOL_CAP);
+	ep->mtx = pth_mtx_new ();
+	if (ep->mtx != (pth_mutex_t *)NULL) {
+		pth_mtxattr_init (ep->mtx);
+		if (pth_mtx_init (ep->mtx) != 0) {
+			pth_mtxattr_destroy (ep->mtx);
+			pth_mtx_delete (ep->mtx);
+			ep->mtx = (pth_mutex_t *)NULL;
+		}
+	}
+	/* the workers are joined, so they run on a joinable private copy */
+	if (attrs == (pth_attri_t *)NULL) {
+		ep->attri = pth_attri_init ();
+		pth_attri_set (ep->attri, PTH_ATTR_NAME, (void *)"caf-epool");
+	} else {
+		ep->attri = pth_attri_new ();
+		if (ep->attri != (pth_attri_t *)NULL
+			&& pth_attri_copy (ep->attri, attrs) != CAF_OK) {
+			pth_attri_delete (ep->attri);
+			ep->attri = (pth_attri_t *)NULL;
+		}
+	}
+	if (ep->attri != (pth_attri_t *)NULL) {
+		pth_attri_set (ep->attri, PTH_ATTR_JOINABLE, (void *)NULL);
+		ep->pool = pth_pool_new (ep->attri, pth_epool_rtn, 0);
+	}
+	if (ep->work == (pth_cond_t *)NULL || ep->done == (pth_cond_t *)NULL
+		|| ep->queue == (ring_t *)NULL || ep->tasks == (caf_npool_t *)NULL
+		|| ep->mtx == (pth_mutex_t *)NULL || ep->pool == (pth_pool_t *)NULL) {
+		pth_epool_free (ep);
+		return (pth_epool_t *)NULL;
+	}
+	pth_mtx_lock (ep->mtx);
+	for (i = 0; i < min; i++) {
+		if (pth_pool_add (ep->pool, (pth_attri_t *)NULL, pth_epool_rtn,
+						  ep) != 0) {
+			break;
+		}
+		ep->st.workers++;
+		ep->starting++;
+	}
+	ep->st.peak = ep->st.workers;
+	pth_mtx_unlock (ep->mtx);
+	if (i < min) {
+		pth_epool_delete (ep);
+		return (pth_epool_t *)NULL;
+	}
+	return ep;
+}
+
+
+int
+pth_epool_delete (pth_epool_t *ep) {
+	if (ep == (pth_epool_t *)NULL) {
+		return CAF_ERROR;
+	}
+	/* no worker retires once stop is set, so the thread list is stable */
+	pth_mtx_lock (ep->mtx);
+	ep->stop = 1;
+	pth_cond_broadcast (ep->work);
+	pth_mtx_unlock (ep->mtx);
+	pth_pool_join (ep->pool);
+	pth_epool_free (ep);
+	return CAF_OK;
+}
+
+
+int
+pth_epool_submit (pth_epool_t *ep, CAF_PT_PROTOTYPE(rtn), void *arg) {
+	pth_etask_t *t;
+	if (ep == (pth_epool_t *)NULL || rtn == NULL) {
+		return CAF_ERROR;
+	}
+	pth_mtx_lock (ep->mtx);
+	/* a stopped pool only takes tasks from its own running tasks */
+	if (ep->stop != 0 && ep->active == 0) {
+		pth_mtx_unlock (ep->mtx);
+		return CAF_ERROR;
+	}
+	t = (pth_etask_t *)caf_npool_get (ep->tasks);
+	if (t == (pth_etask_t *)NULL) {
+		pth_mtx_unlock (ep->mtx);
+		return CAF_ERROR;
+	}
+	t->rtn = rtn;
+	t->arg = arg;
+	t->enq = pth_epool_now ();
+	if (ring_push_back (ep->queue, t) == (ring_t *)NULL) {
+		caf_npool_put (ep->tasks, t);
+		pth_mtx_unlock (ep->mtx);
+		return CAF_ERROR;
+	}
+	if (ep->st.idle > 0) {
+		pth_cond_signal (ep->work);
+	}
+	pth_epool_grow (ep, t->enq);
+	pth_mtx_unlock (ep->mtx);
+	return CAF_OK;
+}
+
+
+int
+pth_epool_wait (pth_epool_t *ep, const struct timespec *to) {
+	int r = CAF_OK;
+	if (ep == (pth_epool_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pth_mtx_lock (ep->mtx);
+	while ((ring_length (ep->queue) > 0 || ep->active > 0) && r == CAF_OK) {
+		if (to == (const struct timespec *)NULL) {
+			r = pth_cond_wait (ep->done, ep->mtx);
+		} else {
+			r = pth_cond_timedwait (ep->done, ep->mtx, to);
+		}
+	}
+	pth_mtx_unlock (ep->mtx);
+	return r;
+}
+
+
+int
+pth_epool_stats (pth_epool_t *ep, pth_epool_stats_t *st) {
+	if (ep == (pth_epool_t *)NULL || st == (pth_epool_stats_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pth_mtx_lock (ep->mtx);
+	ep->st.backlog = ring_length (ep->queue);
+	*st = ep->st;
+	pth_mtx_unlock (ep->mtx);
+	return CAF_OK;
+}
+
+
+static long long
+pth_epool_now (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/* adds a worker when the backlog is old and larger than the free workers */
+static void
+pth_epool_grow (pth_epool_t *ep, long long now) {
+	pth_etask_t *t;
+	int backlog = ring_length (ep->queue);
+	if (ep->stop != 0 || backlog == 0 || ep->st.workers >= ep->max
+		|| backlog <= ep->st.idle + ep->starting) {
+		return;
+	}
+	t = (pth_etask_t *)ring_get (ep->queue, 0);
+	/* with no workers nobody would ever look at the backlog again */
+	if (ep->st.workers > 0 && now - t->enq < (long long)ep->age_us * 1000) {
+		return;
+	}
+	if (pth_pool_add (ep->pool, (pth_attri_t *)NULL, pth_epool_rtn,
+					  ep) == 0) {
+		ep->st.workers++;
+		ep->starting++;
+		ep->st.grows++;
+		if (ep->st.workers > ep->st.peak) {
+			ep->st.peak = ep->st.workers;
+		}
+	} else {
+		ep->st.grow_fails++;
+	}
+}
+
+
+/* removes the calling worker from the pool, with the lock held */
+static void
+pth_epool_retire (pth_epool_t *ep) {
+	caf_dequen_t *n;
+	pthread_t self = pthread_self ();
+	for (n = ep->pool->threads->head; n != (caf_dequen_t *)NULL;
+		 n = n->next) {
+		if (n->data != NULL && pthread_equal (*((pthread_t *)n->data), self)) {
+			deque_node_delete (ep->pool->threads, n, pth_epool_thread_del);
+			break;
+		}
+	}
+	ep->pool->count--;
+	ep->st.workers--;
+	ep->st.retires++;
+	/* nobody joins a retired worker */
+	pthread_detach (self);
+}
+
+
+static int
+pth_epool_thread_del (void *ptr) {
+	xfree (ptr);
+	return CAF_OK;
+}
+
+
+/*
+ * Waits for work up to the idle timeout. Returns CAF_OK when there is
+ * work or the pool stops, CAF_ERROR_SUB on timeout.
+ */
+static int
+pth_epool_idle (pth_epool_t *ep) {
+	struct timespec dl;
+	int r = CAF_OK;
+	clock_gettime (CLOCK_REALTIME, &dl);
+	dl.tv_sec += ep->idle_us / 1000000L;
+	dl.tv_nsec += (ep->idle_us % 1000000L) * 1000L;
+	if (dl.tv_nsec >= 1000000000L) {
+		dl.tv_sec++;
+		dl.tv_nsec -= 1000000000L;
+	}
+	ep->st.idle++;
+	while (ring_length (ep->queue) == 0 && ep->stop == 0
+		   && r != CAF_ERROR_SUB) {
+		r = pth_cond_timedwait (ep->work, ep->mtx, &dl);
+		if (r == CAF_ERROR) {
+			break;
+		}
+	}
+	ep->st.idle--;
+	return ring_length (ep->queue) == 0 && ep->stop == 0 ? CAF_ERROR_SUB
+		: CAF_OK;
+}
+
+
+static void *
+pth_epool_rtn (void *arg) {
+	pth_epool_t *ep = (pth_epool_t *)arg;
+	pth_etask_t *t;
+	CAF_PT_PROTOTYPE(rtn);
+	void *targ;
+	long long now, w;
+	pth_mtx_lock (ep->mtx);
+	ep->starting--;
+	for (;;) {
+		if (ring_length (ep->queue) == 0) {
+			if (ep->stop != 0) {
+				break;
+			}
+			if (pth_epool_idle (ep) == CAF_ERROR_SUB
+				&& ep->st.workers > ep->min) {
+				pth_epool_retire (ep);
+				pth_mtx_unlock (ep->mtx);
+				return (void *)NULL;
+			}
+			continue;
+		}
+		t = (pth_etask_t *)ring_pop_front (ep->queue);
+		now = pth_epool_now ();
+		w = now - t->enq;
+		ep->st.wait_ns += w;
+		if (w > ep->st.wait_max_ns) {
+			ep->st.wait_max_ns = w;
+		}
+		rtn = t->rtn;
+		targ = t->arg;
+		caf_npool_put (ep->tasks, t);
+		pth_epool_grow (ep, now);
+		ep->active++;
+		pth_mtx_unlock (ep->mtx);
+		rtn (targ);
+		pth_mtx_lock (ep->mtx);
+		ep->active--;
+		ep->st.runs++;
+		if (ep->active == 0 && ring_length (ep->queue) == 0) {
+			pth_cond_broadcast (ep->done);
+		}
+	}
+	ep->st.workers--;
+	pth_mtx_unlock (ep->mtx);
+	return (void *)NULL;
+}
+
+
+static void
+pth_epool_free (pth_epool_t *ep) {
+	if (ep->pool != (pth_pool_t *)NULL) {
+		pth_pool_delete (ep->pool);
+	}
+	if (ep->attri != (pth_attri_t *)NULL) {
+		pth_attri_destroy (ep->attri);
+	}
+	if (ep->mtx != (pth_mutex_t *)NULL) {
+		pth_mtx_destroy (ep->mtx);
+		pth_mtxattr_destroy (ep->mtx);
+		pth_mtx_delete (ep->mtx);
+	}
+	if (ep->work != (pth_cond_t *)NULL) {
+		pth_condi_delete (ep->work);
+	}
+	if (ep->done != (pth_cond_t *)NULL) {
+		pth_condi_delete (ep->done);
+	}
+	if (ep->queue != (ring_t *)NULL) {
+		ring_delete_nocb (ep->queue);
+	}
+	if (ep->tasks != (caf_npool_t *)NULL) {
+		caf_npool_delete (ep->tasks);
+	}
+	xfree (ep);
+}
+
+/* caf_thread_epool.c ends here */
@@ -0,0 +1,527 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_thread_attr.h"
+#include "caf/caf_thread_cpu.h"
+#include "caf/caf_thread_pool.h"
+#include "caf/caf_thread_futex.h"
+#include "caf/caf_thread_mpmc.h"
+#include "caf/caf_thread_exec.h"
+
+/* worker deque slots, placed on the worker node */
+#define CAF_PTH_EXEC_TASKS_SZ     (sizeof (pth_task_t *) * CAF_PTH_EXEC_LOCAL)
+
+#if defined(__GNUC__)
+#define CAF_PTH_EXEC_TLS          __thread
+#else /* !__GNUC__ */
+#define CAF_PTH_EXEC_TLS
+#endif /* !__GNUC__ */
+
+/* the worker running on the calling thread, if any */
+static CAF_PTH_EXEC_TLS pth_exec_worker_t *pth_exec_self =
+	(pth_exec_worker_t *)NULL;
+
+static void pth_exec_notify (int *ev);
+static void pth_exec_wake (pth_exec_t *exec);
+static int pth_exec_enqueue (pth_exec_t *exec, pth_task_t *t);
+static int pth_exec_local_push (pth_exec_worker_t *w, pth_task_t *t);
+static pth_task_t *pth_exec_local_take (pth_exec_worker_t *w);
+static pth_task_t *pth_exec_steal (pth_exec_worker_t *w);
+static pth_task_t *pth_exec_find (pth_exec_worker_t *w);
+static void pth_exec_run (pth_exec_worker_t *w, pth_task_t *t);
+static void pth_future_complete (pth_future_t *f, void *result);
+void *pth_exec_rtn (void *arg);
+
+
+/* see pth_mpmc_notify, the event counts work the same way */
+static void
+pth_exec_notify (int *ev) {
+	int e;
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	e = __atomic_load_n (ev, __ATOMIC_RELAXED);
+	if ((e & 1) != 0) {
+		e = __atomic_exchange_n (ev, (e + 2) & ~1, __ATOMIC_SEQ_CST);
+		if ((e & 1) != 0) {
+			pth_futex_wake (ev, CAF_PTH_FUTEX_ALL);
+		}
+	}
+}
+
+
+/*
+ * Wakes one parked worker when there are sleepers and nobody is being
+ * woken already. The woken worker clears the waking flag and, if it
+ * finds work, wakes the next one, so a burst spreads over the pool
+ * without waking every worker on every submission.
+ */
+static void
+pth_exec_wake (pth_exec_t *exec) {
+	int w = 0;
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	if (__atomic_load_n (&(exec->sleepers), __ATOMIC_RELAXED) > 0
+		&& __atomic_load_n (&(exec->waking), __ATOMIC_RELAXED) == 0
+		&& __atomic_compare_exchange_n (&(exec->waking), &w, 1, 0,
+										__ATOMIC_SEQ_CST,
+										__ATOMIC_RELAXED)) {
+		__atomic_add_fetch (&(exec->work_ev), 1, __ATOMIC_SEQ_CST);
+		pth_futex_wake (&(exec->work_ev), 1);
+	}
+}
+
+
+pth_exec_t *
+pth_exec_new (pth_attri_t *attrs, int count, size_t qsize) {
+	pth_exec_t *exec;
+	void *mem = (void *)NULL;
+	int i, rt = CAF_ERROR;
+	if (count <= 0) {
+		return (pth_exec_t *)NULL;
+	}
+	exec = (pth_exec_t *)xmalloc (CAF_PTH_EXEC_SZ);
+	if (exec == (pth_exec_t *)NULL) {
+		return (pth_exec_t *)NULL;
+	}
+	exec->count = count;
+	exec->next = 0;
+	exec->stop = 0;
+	exec->pending = 0;
+	exec->work_ev = 0;
+	exec->sleepers = 0;
+	exec->waking = 0;
+	exec->done_ev = 0;
+	exec->pool = (pth_pool_t *)NULL;
+	exec->attri = (pth_attri_t *)NULL;
+	exec->queue = pth_mpmc_new (qsize > 0 ? qsize : CAF_PTH_EXEC_QUEUE);
+	if (posix_memalign (&mem, CAF_PTH_EXEC_LINE,
+						sizeof (pth_exec_worker_t) * count) != 0) {
+		mem = (void *)NULL;
+	}
+	exec->workers = (pth_exec_worker_t *)mem;
+	if (exec->queue == (pth_mpmc_t *)NULL
+		|| exec->workers == (pth_exec_worker_t *)NULL) {
+		pth_mpmc_delete (exec->queue);
+		free (exec->workers);
+		xfree (exec);
+		return (pth_exec_t *)NULL;
+	}
+	for (i = 0; i < count; i++) {
+		exec->workers[i].top = 0;
+		exec->workers[i].bottom = 0;
+		exec->workers[i].exec = exec;
+		exec->workers[i].runs = 0;
+		exec->workers[i].steals = 0;
+		exec->workers[i].rnd = 2463534242u + (unsigned int)i * 7919u;
+		exec->workers[i].tasks = (pth_task_t **)
+			pth_cpu_local_alloc (CAF_PTH_EXEC_TASKS_SZ);
+		if (exec->workers[i].tasks == (pth_task_t **)NULL) {
+			while (i-- > 0) {
+				pth_cpu_local_free (exec->workers[i].tasks,
+									CAF_PTH_EXEC_TASKS_SZ);
+			}
+			pth_mpmc_delete (exec->queue);
+			free (exec->workers);
+			xfree (exec);
+			return (pth_exec_t *)NULL;
+		}
+	}
+	/* the workers are joined, so they run on a joinable private copy */
+	exec->attri = pth_attri_new ();
+	if (exec->attri != (pth_attri_t *)NULL) {
+		if (attrs != (pth_attri_t *)NULL) {
+			rt = pth_attri_copy (exec->attri, attrs);
+		} else if ((rt = pth_attr_init (exec->attri)) == 0) {
+			pth_attri_set (exec->attri, PTH_ATTR_NAME, (void *)"caf-exec");
+		}
+		if (rt != 0) {
+			pth_attri_delete (exec->attri);
+			exec->attri = (pth_attri_t *)NULL;
+		}
+	}
+	if (exec->attri != (pth_attri_t *)NULL) {
+		pth_attri_set (exec->attri, PTH_ATTR_JOINABLE, (void *)NULL);
+		exec->pool = pth_pool_create (exec->attri, pth_exec_rtn, count,
+									  exec);
+	}
+	if (exec->pool == (pth_pool_t *)NULL) {
+		exec->stop = 1;
+		pth_exec_delete (exec);
+		return (pth_exec_t *)NULL;
+	}
+	return exec;
+}
+
+
+int
+pth_exec_delete (pth_exec_t *exec) {
+	int i;
+	if (exec == (pth_exec_t *)NULL) {
+		return CAF_ERROR;
+	}
+	if (exec->pool != (pth_pool_t *)NULL) {
+		__atomic_store_n (&(exec->stop), 1, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch (&(exec->work_ev), 1, __ATOMIC_SEQ_CST);
+		pth_futex_wake (&(exec->work_ev), CAF_PTH_FUTEX_ALL);
+		pth_pool_join (exec->pool);
+		pth_pool_delete (exec->pool);
+	}
+	if (exec->attri != (pth_attri_t *)NULL) {
+		pth_attr_destroy (exec->attri);
+		pth_attri_delete (exec->attri);
+	}
+	for (i = 0; i < exec->count; i++) {
+		pth_cpu_local_free (exec->workers[i].tasks, CAF_PTH_EXEC_TASKS_SZ);
+	}
+	free (exec->workers);
+	pth_mpmc_delete (exec->queue);
+	xfree (exec);
+	return CAF_OK;
+}
+
+
+/*
+ * Tasks submitted by a task stay on its worker, other submissions
+ * and local overflow go through the shared queue. A worker never
+ * waits for room: if every worker did, nobody would drain the queue,
+ * so when both its deque and the shared queue are full it runs the
+ * task itself.
+ */
+static int
+pth_exec_enqueue (pth_exec_t *exec, pth_task_t *t) {
+	pth_exec_worker_t *w = pth_exec_self;
+	__atomic_add_fetch (&(exec->pending), 1, __ATOMIC_RELAXED);
+	if (w == (pth_exec_worker_t *)NULL || w->exec != exec) {
+		if (pth_mpmc_push (exec->queue, t, (struct timespec *)NULL)
+			!= CAF_OK) {
+			__atomic_sub_fetch (&(exec->pending), 1, __ATOMIC_RELAXED);
+			return CAF_ERROR;
+		}
+	} else if (pth_exec_local_push (w, t) != CAF_OK
+			   && pth_mpmc_trypush (exec->queue, t) != CAF_OK) {
+		pth_exec_run (w, t);
+		return CAF_OK;
+	}
+	pth_exec_wake (exec);
+	return CAF_OK;
+}
+
+
+int
+pth_exec_submit (pth_exec_t *exec, CAF_PT_PROTOTYPE(rtn), void *arg) {
+	pth_task_t *t;
+	if (exec == (pth_exec_t *)NULL || rtn == NULL) {
+		return CAF_ERROR;
+	}
+	t = (pth_task_t *)xmalloc (sizeof (pth_task_t));
+	if (t == (pth_task_t *)NULL) {
+		return CAF_ERROR;
+	}
+	t->rtn = rtn;
+	t->arg = arg;
+	t->future = (pth_future_t *)NULL;
+	if (pth_exec_enqueue (exec, t) != CAF_OK) {
+		xfree (t);
+		return CAF_ERROR;
+	}
+	return CAF_OK;
+}
+
+
+pth_future_t *
+pth_exec_async (pth_exec_t *exec, CAF_PT_PROTOTYPE(rtn), void *arg) {
+	pth_task_t *t;
+	pth_future_t *f;
+	if (exec == (pth_exec_t *)NULL || rtn == NULL) {
+		return (pth_future_t *)NULL;
+	}
+	t = (pth_task_t *)xmalloc (sizeof (pth_task_t));
+	f = (pth_future_t *)xmalloc (CAF_PTH_FUTURE_SZ);
+	if (t == (pth_task_t *)NULL || f == (pth_future_t *)NULL) {
+		xfree (t);
+		xfree (f);
+		return (pth_future_t *)NULL;
+	}
+	f->result = (void *)NULL;
+	f->state = 0;
+	f->refs = 2;
+	t->rtn = rtn;
+	t->arg = arg;
+	t->future = f;
+	if (pth_exec_enqueue (exec, t) != CAF_OK) {
+		xfree (t);
+		xfree (f);
+		return (pth_future_t *)NULL;
+	}
+	return f;
+}
+
+
+int
+pth_exec_wait (pth_exec_t *exec, const struct timespec *to) {
+	int e;
+	if (exec == (pth_exec_t *)NULL) {
+		return CAF_ERROR_SUB;
+	}
+	for (;;) {
+		e = __atomic_or_fetch (&(exec->done_ev), 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n (&(exec->pending), __ATOMIC_SEQ_CST) == 0) {
+			return CAF_OK;
+		}
+		if (pth_futex_wait (&(exec->done_ev), e, to) != CAF_OK) {
+			return CAF_ERROR_SUB;
+		}
+	}
+}
+
+
+static void
+pth_future_complete (pth_future_t *f, void *result) {
+	f->result = result;
+	if (__atomic_exchange_n (&(f->state), 1, __ATOMIC_SEQ_CST) == 2) {
+		pth_futex_wake (&(f->state), CAF_PTH_FUTEX_ALL);
+	}
+	pth_future_delete (f);
+}
+
+
+int
+pth_future_wait (pth_future_t *f, void **result,
+				 const struct timespec *to) {
+	int s;
+	if (f == (pth_future_t *)NULL) {
+		return CAF_ERROR_SUB;
+	}
+	while ((s = __atomic_load_n (&(f->state), __ATOMIC_ACQUIRE)) != 1) {
+		if (s == 0 && !__atomic_compare_exchange_n (&(f->state), &s, 2, 0,
+													__ATOMIC_SEQ_CST,
+													__ATOMIC_ACQUIRE)) {
+			continue;
+		}
+		if (pth_futex_wait (&(f->state), 2, to) != CAF_OK) {
+			return CAF_ERROR_SUB;
+		}
+	}
+	if (result != (void **)NULL) {
+		*result = f->result;
+	}
+	return CAF_OK;
+}
+
+
+int
+pth_future_done (pth_future_t *f) {
+	if (f != (pth_future_t *)NULL
+		&& __atomic_load_n (&(f->state), __ATOMIC_ACQUIRE) == 1) {
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+void
+pth_future_delete (pth_future_t *f) {
+	if (f != (pth_future_t *)NULL
+		&& __atomic_sub_fetch (&(f->refs), 1, __ATOMIC_ACQ_REL) == 0) {
+		xfree (f);
+	}
+}
+
+
+/* owner side of the Chase-Lev deque */
+static int
+pth_exec_local_push (pth_exec_worker_t *w, pth_task_t *t) {
+	long b, top;
+	b = __atomic_load_n (&(w->bottom), __ATOMIC_RELAXED);
+	top = __atomic_load_n (&(w->top), __ATOMIC_ACQUIRE);
+	if (b - top >= CAF_PTH_EXEC_LOCAL) {
+		return CAF_ERROR;
+	}
+	__atomic_store_n (&(w->tasks[b & (CAF_PTH_EXEC_LOCAL - 1)]), t,
+					  __ATOMIC_RELAXED);
+	__atomic_store_n (&(w->bottom), b + 1, __ATOMIC_RELEASE);
+	return CAF_OK;
+}
+
+
+static pth_task_t *
+pth_exec_local_take (pth_exec_worker_t *w) {
+	pth_task_t *t = (pth_task_t *)NULL;
+	long b, top;
+	b = __atomic_load_n (&(w->bottom), __ATOMIC_RELAXED) - 1;
+	__atomic_store_n (&(w->bottom), b, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	top = __atomic_load_n (&(w->top), __ATOMIC_RELAXED);
+	if (top <= b) {
+		t = __atomic_load_n (&(w->tasks[b & (CAF_PTH_EXEC_LOCAL - 1)]),
+							 __ATOMIC_RELAXED);
+		if (top == b) {
+			/* last task, race the thieves for it */
+			if (!__atomic_compare_exchange_n (&(w->top), &top, top + 1, 0,
+											  __ATOMIC_SEQ_CST,
+											  __ATOMIC_RELAXED)) {
+				t = (pth_task_t *)NULL;
+			}
+			__atomic_store_n (&(w->bottom), b + 1, __ATOMIC_RELAXED);
+		}
+	} else {
+		__atomic_store_n (&(w->bottom), b + 1, __ATOMIC_RELAXED);
+	}
+	return t;
+}
+
+
+/* thief side, one pass over the other workers from a random start */
+static pth_task_t *
+pth_exec_steal (pth_exec_worker_t *w) {
+	pth_exec_t *exec = w->exec;
+	pth_exec_worker_t *v;
+	pth_task_t *t;
+	long top, b;
+	int i, start;
+	w->rnd ^= w->rnd << 13;
+	w->rnd ^= w->rnd >> 17;
+	w->rnd ^= w->rnd << 5;
+	start = (int)(w->rnd % (unsigned int)exec->count);
+	for (i = 0; i < exec->count; i++) {
+		v = &(exec->workers[(start + i) % exec->count]);
+		if (v == w) {
+			continue;
+		}
+		top = __atomic_load_n (&(v->top), __ATOMIC_ACQUIRE);
+		__atomic_thread_fence (__ATOMIC_SEQ_CST);
+		b = __atomic_load_n (&(v->bottom), __ATOMIC_ACQUIRE);
+		if (top < b) {
+			t = __atomic_load_n (&(v->tasks[top & (CAF_PTH_EXEC_LOCAL - 1)]),
+								 __ATOMIC_RELAXED);
+			if (__atomic_compare_exchange_n (&(v->top), &top, top + 1, 0,
+											 __ATOMIC_SEQ_CST,
+											 __ATOMIC_RELAXED)) {
+				w->steals++;
+				return t;
+			}
+		}
+	}
+	return (pth_task_t *)NULL;
+}
+
+
+static pth_task_t *
+pth_exec_find (pth_exec_worker_t *w) {
+	pth_task_t *t;
+	void *data;
+	t = pth_exec_local_take (w);
+	if (t != (pth_task_t *)NULL) {
+		return t;
+	}
+	if (pth_mpmc_trypop (w->exec->queue, &data) == CAF_OK) {
+		return (pth_task_t *)data;
+	}
+	return pth_exec_steal (w);
+}
+
+
+static void
+pth_exec_run (pth_exec_worker_t *w, pth_task_t *t) {
+	pth_exec_t *exec = w->exec;
+	void *r;
+	r = t->rtn (t->arg);
+	if (t->future != (pth_future_t *)NULL) {
+		pth_future_complete (t->future, r);
+	}
+	xfree (t);
+	w->runs++;
+	if (__atomic_sub_fetch (&(exec->pending), 1, __ATOMIC_SEQ_CST) == 0) {
+		pth_exec_notify (&(exec->done_ev));
+		if (__atomic_load_n (&(exec->stop), __ATOMIC_SEQ_CST) != 0) {
+			/* let the parked workers see they are done */
+			__atomic_add_fetch (&(exec->work_ev), 1, __ATOMIC_SEQ_CST);
+			pth_futex_wake (&(exec->work_ev), CAF_PTH_FUTEX_ALL);
+		}
+	}
+}
+
+
+void *
+pth_exec_rtn (void *arg) {
+	pth_exec_t *exec = (pth_exec_t *)arg;
+	pth_exec_worker_t *w;
+	pth_task_t *t;
+	int e, woken = 0;
+	w = &(exec->workers[__atomic_fetch_add (&(exec->next), 1,
+											__ATOMIC_RELAXED)]);
+	pth_exec_self = w;
+	/* first touch from a pinned worker places its deque locally */
+	pth_cpu_local_touch (w->tasks, CAF_PTH_EXEC_TASKS_SZ);
+	for (;;) {
+		t = pth_exec_find (w);
+		if (t == (pth_task_t *)NULL) {
+			/* register as sleeper before the last look, see pth_exec_wake */
+			e = __atomic_load_n (&(exec->work_ev), __ATOMIC_SEQ_CST);
+			__atomic_add_fetch (&(exec->sleepers), 1, __ATOMIC_SEQ_CST);
+			t = pth_exec_find (w);
+			if (t == (pth_task_t *)NULL) {
+				if (__atomic_load_n (&(exec->stop), __ATOMIC_SEQ_CST) != 0
+					&& __atomic_load_n (&(exec->pending),
+										__ATOMIC_SEQ_CST) == 0) {
+					__atomic_sub_fetch (&(exec->sleepers), 1,
+										__ATOMIC_SEQ_CST);
+					break;
+				}
+				pth_futex_wait (&(exec->work_ev), e,
+								(struct timespec *)NULL);
+				__atomic_sub_fetch (&(exec->sleepers), 1, __ATOMIC_SEQ_CST);
+				__atomic_store_n (&(exec->waking), 0, __ATOMIC_SEQ_CST);
+				woken = 1;
+				continue;
+			}
+			/*
+			 * A submission may have picked this sleeper to wake; it
+			 * will not park now, so it takes over passing the wake on,
+			 * otherwise waking stays set and no worker is woken again.
+			 */
+			__atomic_sub_fetch (&(exec->sleepers), 1, __ATOMIC_SEQ_CST);
+			__atomic_store_n (&(exec->waking), 0, __ATOMIC_SEQ_CST);
+			woken = 1;
+		}
+		if (woken != 0) {
+			pth_exec_wake (exec);
+			woken = 0;
+		}
+		pth_exec_run (w, t);
+	}
+	pth_exec_self = (pth_exec_worker_t *)NULL;
+	return (void *)NULL;
+}
+
+/* caf_thread_exec.c ends here */
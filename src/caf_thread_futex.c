@@ -0,0 +1,154 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef LINUX_SYSTEM
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif /* !LINUX_SYSTEM */
+
+#include "caf/caf.h"
+#include "caf/caf_thread_futex.h"
+
+#if !defined(LINUX_SYSTEM) || !defined(SYS_futex)
+/** Poll interval of the portable wait, in nanoseconds */
+#define CAF_PTH_FUTEX_POLL        50000
+#endif /* !LINUX_SYSTEM || !SYS_futex */
+
+
+#if defined(LINUX_SYSTEM) && defined(SYS_futex)
+
+static int
+pth_futex_wait_op (int *addr, int val, const struct timespec *to, int op) {
+	long r;
+	r = syscall (SYS_futex, addr, op | FUTEX_CLOCK_REALTIME, val, to,
+				 (int *)NULL, FUTEX_BITSET_MATCH_ANY);
+	if (r == -1 && errno == ETIMEDOUT) {
+		return CAF_ERROR_SUB;
+	}
+	return CAF_OK;
+}
+
+
+static int
+pth_futex_wake_op (int *addr, int n, int op) {
+	long r;
+	r = syscall (SYS_futex, addr, op, n,
+				 (struct timespec *)NULL, (int *)NULL, 0);
+	return r < 0 ? 0 : (int)r;
+}
+
+
+int
+pth_futex_wait (int *addr, int val, const struct timespec *to) {
+	return pth_futex_wait_op (addr, val, to, FUTEX_WAIT_BITSET_PRIVATE);
+}
+
+
+int
+pth_futex_wake (int *addr, int n) {
+	return pth_futex_wake_op (addr, n, FUTEX_WAKE_PRIVATE);
+}
+
+
+int
+pth_futex_wait_shared (int *addr, int val, const struct timespec *to) {
+	return pth_futex_wait_op (addr, val, to, FUTEX_WAIT_BITSET);
+}
+
+
+int
+pth_futex_wake_shared (int *addr, int n) {
+	return pth_futex_wake_op (addr, n, FUTEX_WAKE);
+}
+
+#else /* !LINUX_SYSTEM || !SYS_futex */
+
+int
+pth_futex_wait (int *addr, int val, const struct timespec *to) {
+	struct timespec now, nap;
+	nap.tv_sec = 0;
+	nap.tv_nsec = CAF_PTH_FUTEX_POLL;
+	while (__atomic_load_n (addr, __ATOMIC_ACQUIRE) == val) {
+		if (to != (const struct timespec *)NULL) {
+			clock_gettime (CLOCK_REALTIME, &now);
+			if (now.tv_sec > to->tv_sec
+				|| (now.tv_sec == to->tv_sec && now.tv_nsec >= to->tv_nsec)) {
+				return CAF_ERROR_SUB;
+			}
+		}
+		nanosleep (&nap, (struct timespec *)NULL);
+	}
+	return CAF_OK;
+}
+
+
+int
+pth_futex_wake (int *addr, int n) {
+	(void)addr;
+	(void)n;
+	return 0;
+}
+
+
+int
+pth_futex_wait_shared (int *addr, int val, const struct timespec *to) {
+	return pth_futex_wait (addr, val, to);
+}
+
+
+int
+pth_futex_wake_shared (int *addr, int n) {
+	return pth_futex_wake (addr, n);
+}
+
+#endif /* !LINUX_SYSTEM || !SYS_futex */
+
+
+int
+pth_futex_spin_max (int want) {
+	static int cpus = 0;
+	int n = __atomic_load_n (&cpus, __ATOMIC_RELAXED);
+	if (n == 0) {
+		n = (int)sysconf (_SC_NPROCESSORS_ONLN);
+		n = n > 0 ? n : 1;
+		__atomic_store_n (&cpus, n, __ATOMIC_RELAXED);
+	}
+	if (n == 1) {
+		return 0;
+	}
+	return want > 0 ? want : CAF_PTH_SPIN_MAX;
+}
+
+/* caf_thread_futex.c ends here */
@@ -29,6 +29,7 @@ static char Id[] = "$Id$";
 #endif /* !HAVE_CONFIG_H */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <pthread.h>
 
@@ -36,6 +37,31 @@ static char Id[] = "$Id$";
 #include "caf/caf_data_mem.h"
 #include "caf/caf_thread_key.h"
 
+/* opt-in: a cache hit costs about as much as pthread_getspecific on
+   glibc, and initial-exec TLS is not available to a dlopen()ed library */
+#if defined(__GNUC__) && defined(CAF_USE_PTH_KEY_TLS)
+#define CAF_PTH_KEY_TLS           __thread \
+	__attribute__ ((tls_model ("initial-exec")))
+#endif /* !__GNUC__ || !CAF_USE_PTH_KEY_TLS */
+
+#ifdef CAF_PTH_KEY_TLS
+typedef struct pth_key_tls_s pth_key_tls_t;
+struct pth_key_tls_s {
+	unsigned long seq;
+	void *ptr;
+};
+
+/* key data of the calling thread, tagged by key sequence, so deleted
+   keys never hit */
+static CAF_PTH_KEY_TLS pth_key_tls_t pth_key_tls[PTH_KEY_TLS_SLOTS];
+#endif /* !CAF_PTH_KEY_TLS */
+
+static unsigned long pth_key_seq = 0;
+
+static pth_key_t *pth_kpool_find (pth_kpool_t *pool, int id);
+static int pth_kpool_slot_set (pth_kpool_t *pool, pth_key_t *key);
+static void pth_kpool_slot_clear (pth_kpool_t *pool, pth_key_t *key);
+
 
 pth_key_t *
 pth_key_new (int id, PTH_KEY_DESTROY_RTN(rtn)) {
@@ -44,6 +70,9 @@ pth_key_new (int id, PTH_KEY_DESTROY_RTN(rtn)) {
 	if (id > 0 && k != (pth_key_t *)NULL) {
 		k->id = id;
 		k->rtn = rtn;
+		k->ptr = (void *)NULL;
+		k->sz = 0;
+		k->seq = __atomic_add_fetch (&pth_key_seq, 1, __ATOMIC_RELAXED);
 		if (pthread_key_create ((pthread_key_t *)&(k->key), rtn) != 0) {
 			xfree (k);
 			k = (pth_key_t *)NULL;
@@ -70,22 +99,46 @@ pth_key_delete (pth_key_t *k) {
 int
 pth_key_set (pth_key_t *key, size_t sz) {
 	int er = CAF_ERROR;
+	void *p;
 	if (key != (pth_key_t *)NULL && sz > 0) {
-		key->ptr = xmalloc (sz);
-		if (key->ptr != (void *)NULL) {
+		p = xmalloc (sz);
+		if (p != (void *)NULL) {
+			key->ptr = p;
 			key->sz = sz;
-			return pthread_setspecific (key->key, key->ptr);
+			er = pthread_setspecific (key->key, p);
+#ifdef CAF_PTH_KEY_TLS
+			if (er == 0) {
+				pth_key_tls[key->seq & (PTH_KEY_TLS_SLOTS - 1)].seq = key->seq;
+				pth_key_tls[key->seq & (PTH_KEY_TLS_SLOTS - 1)].ptr = p;
+			}
+#endif /* !CAF_PTH_KEY_TLS */
+			return er;
 		}
 	}
 	return er;
 }
 
 
+static void *
+pth_key_lookup (pth_key_t *key) {
+#ifdef CAF_PTH_KEY_TLS
+	pth_key_tls_t *c = &(pth_key_tls[key->seq & (PTH_KEY_TLS_SLOTS - 1)]);
+	if (c->seq != key->seq) {
+		c->seq = key->seq;
+		c->ptr = pthread_getspecific (key->key);
+	}
+	return c->ptr;
+#else /* !CAF_PTH_KEY_TLS */
+	return pthread_getspecific (key->key);
+#endif /* !CAF_PTH_KEY_TLS */
+}
+
+
 void *
 pth_key_get (pth_key_t *key) {
 	void *g = (void *)NULL;
 	if (key != (pth_key_t *)NULL) {
-		return pthread_getspecific (key->key);
+		return pth_key_lookup (key);
 	}
 	return g;
 }
@@ -100,6 +153,8 @@ pth_kpool_new (int id, pthread_t *thr) {
 			res->id = id;
 			res->thr = thr;
 			res->keys = deque_create ();
+			res->slots = (pth_key_t **)NULL;
+			res->nslots = 0;
 		}
 	}
 	return res;
@@ -110,6 +165,7 @@ void
 pth_kpool_delete (pth_kpool_t *kpool) {
 	if (kpool != (pth_kpool_t *)NULL) {
 		deque_delete (kpool->keys, pth_kpool_remove_callback);
+		xfree (kpool->slots);
 		xfree (kpool);
 		kpool = (pth_kpool_t *)NULL;
 	}
@@ -120,6 +176,9 @@ void *
 pth_kpool_add (pth_kpool_t *pool, pth_key_t *key) {
 	if (pool != (pth_kpool_t *)NULL
 		&& key != (pth_key_t *)NULL) {
+		if (pth_kpool_slot_set (pool, key) != CAF_OK) {
+			return (void *)NULL;
+		}
 		return deque_push(pool->keys, (void *)key);
 	}
 	return (void *)NULL;
@@ -128,41 +187,23 @@ pth_kpool_add (pth_kpool_t *pool, pth_key_t *key) {
 
 pth_key_t *
 pth_kpool_get_key (pth_kpool_t *pool, int id) {
-	pth_key_t *k = (pth_key_t *)NULL;
-	caf_dequen_t *n;
-	if (pool != (pth_kpool_t *)NULL
-		&& pool->keys != (deque_t *)NULL) {
-		n = pool->keys->head;
-		if (n != (caf_dequen_t *)NULL) {
-			while (n != (caf_dequen_t *)NULL) {
-				k = (pth_key_t *)n->data;
-				if (k->id == id) {
-					return k;
-				}
-				n = n->next;
-			}
+	if (pool != (pth_kpool_t *)NULL && id > 0) {
+		if (id < pool->nslots) {
+			return pool->slots[id];
+		}
+		if (id >= PTH_KPOOL_SLOTS_MAX) {
+			return pth_kpool_find (pool, id);
 		}
 	}
-	return k;
+	return (pth_key_t *)NULL;
 }
 
 
 void *
 pth_kpool_get (pth_kpool_t *pool, int id) {
-	pth_key_t *k = (pth_key_t *)NULL;
-	caf_dequen_t *n;
-	if (pool != (pth_kpool_t *)NULL
-		&& pool->keys != (deque_t *)NULL) {
-		n = pool->keys->head;
-		if (n != (caf_dequen_t *)NULL) {
-			while (n != (caf_dequen_t *)NULL) {
-				k = (pth_key_t *)n->data;
-				if (k->id == id) {
-					return pth_key_get (k);
-				}
-				n = n->next;
-			}
-		}
+	pth_key_t *k = pth_kpool_get_key (pool, id);
+	if (k != (pth_key_t *)NULL) {
+		return pth_key_lookup (k);
 	}
 	return (void *)NULL;
 }
@@ -171,18 +212,20 @@ pth_kpool_get (pth_kpool_t *pool, int id) {
 void
 pth_kpool_remove_by_id (pth_kpool_t *pool, int id) {
 	pth_key_t *k = (pth_key_t *)NULL;
-	caf_dequen_t *n;
+	caf_dequen_t *n, *next;
 	if (pool != (pth_kpool_t *)NULL
 		&& pool->keys != (deque_t *)NULL) {
 		n = pool->keys->head;
 		if (n != (caf_dequen_t *)NULL) {
 			while (n != (caf_dequen_t *)NULL) {
+				next = n->next;
 				k = (pth_key_t *)n->data;
 				if (k->id == id) {
+					pth_kpool_slot_clear (pool, k);
 					deque_node_delete (pool->keys, n,
 									   pth_kpool_remove_callback);
 				}
-				n = n->next;
+				n = next;
 			}
 		}
 	}
@@ -194,6 +237,7 @@ pth_kpool_remove (pth_kpool_t *pool, pth_key_t *key) {
 	if (pool != (pth_kpool_t *)NULL
 		&& key != (pth_key_t *)NULL
 		&& pool->keys != (deque_t *)NULL) {
+		pth_kpool_slot_clear (pool, key);
 		deque_node_delete_by_data (pool->keys, (void *)key,
 								   pth_kpool_remove_callback);
 	}
@@ -209,5 +253,82 @@ pth_kpool_remove_callback (void *k) {
 	return 1;
 }
 
+
+/* first key added with the identifier, for ids out of the slot table */
+static pth_key_t *
+pth_kpool_find (pth_kpool_t *pool, int id) {
+	caf_dequen_t *n;
+	pth_key_t *k;
+	if (pool->keys == (deque_t *)NULL) {
+		return (pth_key_t *)NULL;
+	}
+	for (n = pool->keys->head; n != (caf_dequen_t *)NULL; n = n->next) {
+		k = (pth_key_t *)n->data;
+		if (k->id == id) {
+			return k;
+		}
+	}
+	return (pth_key_t *)NULL;
+}
+
+
+/* the first key added with an identifier owns its slot */
+static int
+pth_kpool_slot_set (pth_kpool_t *pool, pth_key_t *key) {
+	pth_key_t **slots;
+	int n;
+	if (key->id <= 0) {
+		return CAF_ERROR;
+	}
+	if (key->id >= PTH_KPOOL_SLOTS_MAX) {
+		return CAF_OK;
+	}
+	if (key->id >= pool->nslots) {
+		/* bounded by PTH_KPOOL_SLOTS_MAX, so it never overflows */
+		n = pool->nslots > 0 ? pool->nslots : PTH_KPOOL_SLOTS;
+		while (n <= key->id && n < PTH_KPOOL_SLOTS_MAX) {
+			n *= 2;
+		}
+		if (n > PTH_KPOOL_SLOTS_MAX) {
+			n = PTH_KPOOL_SLOTS_MAX;
+		}
+		slots = (pth_key_t **)xrealloc (pool->slots,
+										sizeof (pth_key_t *) * (size_t)n);
+		if (slots == (pth_key_t **)NULL) {
+			return CAF_ERROR;
+		}
+		xempty (slots + pool->nslots,
+				sizeof (pth_key_t *) * (size_t)(n - pool->nslots));
+		pool->slots = slots;
+		pool->nslots = n;
+	}
+	if (pool->slots[key->id] == (pth_key_t *)NULL) {
+		pool->slots[key->id] = key;
+	}
+	return CAF_OK;
+}
+
+
+/* hands the slot to the next key with the same identifier, if any */
+static void
+pth_kpool_slot_clear (pth_kpool_t *pool, pth_key_t *key) {
+	caf_dequen_t *n;
+	pth_key_t *k;
+	if (key->id <= 0 || key->id >= pool->nslots
+		|| pool->slots[key->id] != key) {
+		return;
+	}
+	pool->slots[key->id] = (pth_key_t *)NULL;
+	n = pool->keys->head;
+	while (n != (caf_dequen_t *)NULL) {
+		k = (pth_key_t *)n->data;
+		if (k != key && k->id == key->id) {
+			pool->slots[key->id] = k;
+			break;
+		}
+		n = n->next;
+	}
+}
+
 /* caf_thread_key.c ends here */
 
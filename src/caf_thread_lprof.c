@@ -0,0 +1,291 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_ipc_shm.h"
+#include "caf/caf_thread_lprof.h"
+
+/** Counters of an entry, every field from acq on is a long long */
+#define CAF_PTH_LPROF_CNTS        ((sizeof (pth_lprof_t)                \
+                                    - offsetof (pth_lprof_t, acq))      \
+                                   / sizeof (long long))
+
+
+static pth_lprof_tab_t pth_lprof_tab;
+static int pth_lprof_period = CAF_PTH_LPROF_SAMPLE;
+static pthread_mutex_t pth_lprof_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int pth_lprof_bucket (long long ns);
+static void pth_lprof_max (long long *m, long long v);
+static void pth_lprof_copy (pth_lprof_t *dst, pth_lprof_t *src);
+
+
+pth_lprof_t *
+pth_lprof_get (pth_lprof_kind_t kind, int id) {
+	pth_lprof_t *p = (pth_lprof_t *)NULL;
+	int i, used;
+	pthread_mutex_lock (&pth_lprof_lock);
+	used = __atomic_load_n (&(pth_lprof_tab.used), __ATOMIC_RELAXED);
+	for (i = 0; i < used; i++) {
+		if (pth_lprof_tab.ent[i].kind == (int)kind
+			&& pth_lprof_tab.ent[i].id == id) {
+			p = &(pth_lprof_tab.ent[i]);
+			break;
+		}
+	}
+	if (p == (pth_lprof_t *)NULL && used < CAF_PTH_LPROF_MAX) {
+		p = &(pth_lprof_tab.ent[used]);
+		p->id = id;
+		p->kind = (int)kind;
+		/* readers scan up to used, so publish it last */
+		__atomic_store_n (&(pth_lprof_tab.used), used + 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock (&pth_lprof_lock);
+	return p;
+}
+
+
+void
+pth_lprof_sample (int n) {
+	int s = 1;
+	while (s < n && s < (1 << 30)) {
+		s <<= 1;
+	}
+	__atomic_store_n (&pth_lprof_period, s, __ATOMIC_RELAXED);
+}
+
+
+void
+pth_lprof_reset (void) {
+	long long *c;
+	int i, used;
+	size_t j;
+	used = __atomic_load_n (&(pth_lprof_tab.used), __ATOMIC_ACQUIRE);
+	for (i = 0; i < used; i++) {
+		c = &(pth_lprof_tab.ent[i].acq);
+		for (j = 0; j < CAF_PTH_LPROF_CNTS; j++) {
+			__atomic_store_n (&(c[j]), 0, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+
+int
+pth_lprof_snapshot (pth_lprof_tab_t *dst) {
+	int i;
+	if (dst == (pth_lprof_tab_t *)NULL) {
+		return CAF_ERROR;
+	}
+	dst->magic = CAF_PTH_LPROF_MAGIC;
+	dst->used = __atomic_load_n (&(pth_lprof_tab.used), __ATOMIC_ACQUIRE);
+	dst->sample = __atomic_load_n (&pth_lprof_period, __ATOMIC_RELAXED);
+	for (i = 0; i < CAF_PTH_LPROF_MAX; i++) {
+		if (i < dst->used) {
+			pth_lprof_copy (&(dst->ent[i]), &(pth_lprof_tab.ent[i]));
+		} else {
+			memset (&(dst->ent[i]), 0, sizeof (pth_lprof_t));
+		}
+	}
+	return CAF_OK;
+}
+
+
+int
+pth_lprof_dump (FILE *out) {
+	pth_lprof_tab_t *tab;
+	pth_lprof_t *p;
+	int b, i;
+	if (out == (FILE *)NULL) {
+		return CAF_ERROR;
+	}
+	tab = (pth_lprof_tab_t *)xmalloc (sizeof (pth_lprof_tab_t));
+	if (tab == (pth_lprof_tab_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pth_lprof_snapshot (tab);
+	fprintf (out, "%-6s %6s %10s %10s %10s %8s %8s %10s %10s %10s %10s\n",
+			 "lock", "id", "acq", "rd", "contended", "fails", "cond",
+			 "wait avg", "wait max", "hold avg", "hold max");
+	for (i = 0; i < tab->used; i++) {
+		p = &(tab->ent[i]);
+		fprintf (out, "%-6s %6d %10lld %10lld %10lld %8lld %8lld %10lld "
+				 "%10lld %10lld %10lld\n",
+				 p->kind == PTH_LPROF_MUTEX ? "mutex" : "rwlock", p->id,
+				 p->acq, p->rd_acq, p->contended, p->fails, p->cond_waits,
+				 p->contended > 0 ? p->wait_ns / p->contended : 0LL,
+				 p->wait_max, p->holds > 0 ? p->hold_ns / p->holds : 0LL,
+				 p->hold_max);
+		fprintf (out, "  wait <2^n ns:");
+		for (b = 0; b < CAF_PTH_LPROF_BUCKETS; b++) {
+			if (p->wait_hist[b] != 0) {
+				fprintf (out, " %d:%lld", b, p->wait_hist[b]);
+			}
+		}
+		fprintf (out, "\n  hold <2^n ns:");
+		for (b = 0; b < CAF_PTH_LPROF_BUCKETS; b++) {
+			if (p->hold_hist[b] != 0) {
+				fprintf (out, " %d:%lld", b, p->hold_hist[b]);
+			}
+		}
+		fprintf (out, "\n");
+	}
+	xfree (tab);
+	return CAF_OK;
+}
+
+
+int
+pth_lprof_dump_shm (key_t key) {
+	caf_shm_alloc_t *s;
+	int r = CAF_ERROR;
+	s = caf_shm_seg_new (key, sizeof (pth_lprof_tab_t), IPC_CREAT | 0600);
+	if (s == (caf_shm_alloc_t *)NULL) {
+		return CAF_ERROR;
+	}
+	if (caf_shm_seg_attach (s) != CAF_SHM_BAD_ALLOC) {
+		r = pth_lprof_snapshot ((pth_lprof_tab_t *)s->ptr);
+		caf_shm_seg_detach (s);
+	}
+	/* the segment outlives the descriptor */
+	xfree (s);
+	return r;
+}
+
+
+long long
+pth_lprof_now (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
+}
+
+
+long long
+pth_lprof_acquired (pth_lprof_t *p, int rd, long long t0) {
+	long long n, now = 0, w;
+	int mask;
+	n = __atomic_fetch_add (&(p->acq), 1, __ATOMIC_RELAXED);
+	if (rd) {
+		__atomic_fetch_add (&(p->rd_acq), 1, __ATOMIC_RELAXED);
+	}
+	if (t0 != 0) {
+		now = pth_lprof_now ();
+		w = now - t0;
+		__atomic_fetch_add (&(p->contended), 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add (&(p->wait_ns), w, __ATOMIC_RELAXED);
+		__atomic_fetch_add (&(p->wait_hist[pth_lprof_bucket (w)]), 1,
+							__ATOMIC_RELAXED);
+		pth_lprof_max (&(p->wait_max), w);
+	}
+	if (rd) {
+		return 0;
+	}
+	mask = __atomic_load_n (&pth_lprof_period, __ATOMIC_RELAXED) - 1;
+	if (t0 != 0 || (n & mask) == 0) {
+		return now != 0 ? now : pth_lprof_now ();
+	}
+	return 0;
+}
+
+
+void
+pth_lprof_released (pth_lprof_t *p, long long start) {
+	long long h;
+	if (start == 0) {
+		return;
+	}
+	h = pth_lprof_now () - start;
+	__atomic_fetch_add (&(p->holds), 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&(p->hold_ns), h, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&(p->hold_hist[pth_lprof_bucket (h)]), 1,
+						__ATOMIC_RELAXED);
+	pth_lprof_max (&(p->hold_max), h);
+}
+
+
+void
+pth_lprof_failed (pth_lprof_t *p) {
+	__atomic_fetch_add (&(p->fails), 1, __ATOMIC_RELAXED);
+}
+
+
+void
+pth_lprof_cond (pth_lprof_t *p, long long t0) {
+	__atomic_fetch_add (&(p->cond_waits), 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&(p->cond_ns), pth_lprof_now () - t0,
+						__ATOMIC_RELAXED);
+}
+
+
+static int
+pth_lprof_bucket (long long ns) {
+	int b;
+	if (ns <= 0) {
+		return 0;
+	}
+	b = 64 - __builtin_clzll ((unsigned long long)ns);
+	return b < CAF_PTH_LPROF_BUCKETS ? b : CAF_PTH_LPROF_BUCKETS - 1;
+}
+
+
+static void
+pth_lprof_max (long long *m, long long v) {
+	long long c = __atomic_load_n (m, __ATOMIC_RELAXED);
+	while (v > c && !__atomic_compare_exchange_n (m, &c, v, 1,
+												  __ATOMIC_RELAXED,
+												  __ATOMIC_RELAXED)) {
+		;
+	}
+}
+
+
+static void
+pth_lprof_copy (pth_lprof_t *dst, pth_lprof_t *src) {
+	long long *d = &(dst->acq), *s = &(src->acq);
+	size_t j;
+	dst->id = src->id;
+	dst->kind = src->kind;
+	for (j = 0; j < CAF_PTH_LPROF_CNTS; j++) {
+		d[j] = __atomic_load_n (&(s[j]), __ATOMIC_RELAXED);
+	}
+}
+
+/* caf_thread_lprof.c ends here */
@@ -0,0 +1,230 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "caf/caf.h"
+#include "caf/caf_thread_futex.h"
+#include "caf/caf_thread_mpmc.h"
+
+static void pth_mpmc_notify (int *ev);
+static int pth_mpmc_wait (int *ev, const struct timespec *to, pth_mpmc_t *q,
+						  void *data, void **out);
+
+
+/*
+ * The futex words are event counts: bit 0 flags sleepers and the
+ * count moves in steps of two. A waiter sets the flag before its last
+ * try; after a successful push or pop, the full fence orders our queue
+ * update before the flag load, so either the waiter sees our update or
+ * we see the flag. Only the first notifier after the flag is set pays
+ * for the wake.
+ */
+static void
+pth_mpmc_notify (int *ev) {
+	int e;
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	e = __atomic_load_n (ev, __ATOMIC_RELAXED);
+	if ((e & 1) != 0) {
+		e = __atomic_exchange_n (ev, (e + 2) & ~1, __ATOMIC_SEQ_CST);
+		if ((e & 1) != 0) {
+			pth_futex_wake (ev, CAF_PTH_FUTEX_ALL);
+		}
+	}
+}
+
+
+static int
+pth_mpmc_wait (int *ev, const struct timespec *to, pth_mpmc_t *q,
+			   void *data, void **out) {
+	int e;
+	for (;;) {
+		e = __atomic_or_fetch (ev, 1, __ATOMIC_SEQ_CST);
+		if (out == (void **)NULL) {
+			if (pth_mpmc_trypush (q, data) == CAF_OK) {
+				return CAF_OK;
+			}
+		} else if (pth_mpmc_trypop (q, out) == CAF_OK) {
+			return CAF_OK;
+		}
+		if (pth_futex_wait (ev, e, to) != CAF_OK) {
+			return CAF_ERROR_SUB;
+		}
+	}
+}
+
+
+pth_mpmc_t *
+pth_mpmc_new (size_t size) {
+	pth_mpmc_t *q;
+	void *mem = (void *)NULL;
+	size_t sz, i;
+	for (sz = CAF_PTH_MPMC_MIN; sz < size && sz != 0; sz <<= 1) {
+		;
+	}
+	if (sz == 0) {
+		return (pth_mpmc_t *)NULL;
+	}
+	if (posix_memalign (&mem, CAF_PTH_MPMC_LINE, CAF_PTH_MPMC_SZ) != 0) {
+		return (pth_mpmc_t *)NULL;
+	}
+	q = (pth_mpmc_t *)mem;
+	if (posix_memalign (&mem, CAF_PTH_MPMC_LINE,
+						sz * sizeof (pth_mpmc_cell_t)) != 0) {
+		free (q);
+		return (pth_mpmc_t *)NULL;
+	}
+	q->cells = (pth_mpmc_cell_t *)mem;
+	for (i = 0; i < sz; i++) {
+		q->cells[i].seq = i;
+		q->cells[i].data = (void *)NULL;
+	}
+	q->mask = sz - 1;
+	q->enq = 0;
+	q->deq = 0;
+	q->put_ev = 0;
+	q->get_ev = 0;
+	return q;
+}
+
+
+int
+pth_mpmc_delete (pth_mpmc_t *q) {
+	if (q != (pth_mpmc_t *)NULL) {
+		free (q->cells);
+		free (q);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+pth_mpmc_trypush (pth_mpmc_t *q, void *data) {
+	pth_mpmc_cell_t *c;
+	size_t pos, seq;
+	ptrdiff_t dif;
+	if (q == (pth_mpmc_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pos = __atomic_load_n (&(q->enq), __ATOMIC_RELAXED);
+	for (;;) {
+		c = &(q->cells[pos & q->mask]);
+		seq = __atomic_load_n (&(c->seq), __ATOMIC_ACQUIRE);
+		dif = (ptrdiff_t)(seq - pos);
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n (&(q->enq), &pos, pos + 1, 1,
+											 __ATOMIC_RELAXED,
+											 __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return CAF_ERROR;
+		} else {
+			pos = __atomic_load_n (&(q->enq), __ATOMIC_RELAXED);
+		}
+	}
+	c->data = data;
+	__atomic_store_n (&(c->seq), pos + 1, __ATOMIC_RELEASE);
+	pth_mpmc_notify (&(q->get_ev));
+	return CAF_OK;
+}
+
+
+int
+pth_mpmc_trypop (pth_mpmc_t *q, void **data) {
+	pth_mpmc_cell_t *c;
+	size_t pos, seq;
+	ptrdiff_t dif;
+	if (q == (pth_mpmc_t *)NULL || data == (void **)NULL) {
+		return CAF_ERROR;
+	}
+	pos = __atomic_load_n (&(q->deq), __ATOMIC_RELAXED);
+	for (;;) {
+		c = &(q->cells[pos & q->mask]);
+		seq = __atomic_load_n (&(c->seq), __ATOMIC_ACQUIRE);
+		dif = (ptrdiff_t)(seq - (pos + 1));
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n (&(q->deq), &pos, pos + 1, 1,
+											 __ATOMIC_RELAXED,
+											 __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return CAF_ERROR;
+		} else {
+			pos = __atomic_load_n (&(q->deq), __ATOMIC_RELAXED);
+		}
+	}
+	*data = c->data;
+	__atomic_store_n (&(c->seq), pos + q->mask + 1, __ATOMIC_RELEASE);
+	pth_mpmc_notify (&(q->put_ev));
+	return CAF_OK;
+}
+
+
+int
+pth_mpmc_push (pth_mpmc_t *q, void *data, const struct timespec *to) {
+	if (q == (pth_mpmc_t *)NULL) {
+		return CAF_ERROR_SUB;
+	}
+	if (pth_mpmc_trypush (q, data) == CAF_OK) {
+		return CAF_OK;
+	}
+	return pth_mpmc_wait (&(q->put_ev), to, q, data, (void **)NULL);
+}
+
+
+int
+pth_mpmc_pop (pth_mpmc_t *q, void **data, const struct timespec *to) {
+	if (q == (pth_mpmc_t *)NULL || data == (void **)NULL) {
+		return CAF_ERROR_SUB;
+	}
+	if (pth_mpmc_trypop (q, data) == CAF_OK) {
+		return CAF_OK;
+	}
+	return pth_mpmc_wait (&(q->get_ev), to, q, (void *)NULL, data);
+}
+
+
+size_t
+pth_mpmc_count (pth_mpmc_t *q) {
+	size_t enq, deq;
+	if (q == (pth_mpmc_t *)NULL) {
+		return 0;
+	}
+	deq = __atomic_load_n (&(q->deq), __ATOMIC_ACQUIRE);
+	enq = __atomic_load_n (&(q->enq), __ATOMIC_ACQUIRE);
+	return enq > deq ? enq - deq : 0;
+}
+
+/* caf_thread_mpmc.c ends here */
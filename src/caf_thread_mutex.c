@@ -34,15 +34,31 @@ static char Id[] = "$Id$";
 
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
+#include "caf/caf_thread_futex.h"
 #include "caf/caf_thread_mutex.h"
 
 
+static int pth_mtx_acquire (pth_mutex_t *mtx, int tl);
+static int pth_mtx_futex_lock (pth_mutex_t *mtx);
+static int pth_mtx_futex_trylock (pth_mutex_t *mtx);
+static void pth_mtx_futex_unlock (pth_mutex_t *mtx);
+static void pth_mtx_prof_acquired (pth_mutex_t *mtx, long long t0);
+static void pth_mtx_prof_released (pth_mutex_t *mtx);
+
+
 pth_mutex_t *
 pth_mtx_new (void) {
 	pth_mutex_t *mtx = (pth_mutex_t *)NULL;
 	mtx = (pth_mutex_t *)xmalloc (CAF_PTH_MTX_SZ);
 	if (mtx != (pth_mutex_t *)NULL) {
 		mtx->at = 0;
+		mtx->kind = 0;
+		mtx->futex = 0;
+		mtx->spin = 0;
+		mtx->spin_max = 0;
+		mtx->prof = (pth_lprof_t *)NULL;
+		mtx->hold_start = 0;
+		mtx->hold_depth = 0;
 	}
 	return mtx;
 }
@@ -77,6 +93,8 @@ pth_mtxattr_destroy (pth_mutex_t *mtx) {
 int
 pth_mtx_init (pth_mutex_t *mtx) {
 	if (mtx != (pth_mutex_t *)NULL) {
+		mtx->futex = 0;
+		mtx->spin = 0;
 		return pthread_mutex_init(&(mtx->mutex), &(mtx->attr));
 	}
 	return CAF_ERROR_SUB;
@@ -94,6 +112,7 @@ pth_mtx_destroy (pth_mutex_t *mtx) {
 
 int
 pth_mtxattr_set (pth_mutex_t *mtx, pth_mutexattr_types_t t, int data) {
+	int type;
 	if (mtx != (pth_mutex_t *)NULL) {
 		switch (t) {
 			/* pthread_mutexattr_setprioceiling */
@@ -106,11 +125,47 @@ pth_mtxattr_set (pth_mutex_t *mtx, pth_mutexattr_types_t t, int data) {
 			return pthread_mutexattr_setprotocol (&(mtx->attr), data);
 			/* pthread_mutexattr_settype */
 		case PTHDR_MUTEX_TYPE:
+			/* the futex lock has no owner, so it cannot nest or check */
+			if (mtx->kind == PTHDR_MUTEX_ADAPTIVE
+				&& data != PTHREAD_MUTEX_NORMAL
+				&& data != PTHREAD_MUTEX_DEFAULT) {
+				return CAF_ERROR_SUB;
+			}
 			mtx->at |= t;
 			return pthread_mutexattr_settype (&(mtx->attr), data);
 			/* lock */
 		case PTHDR_MUTEX_LOCK:
-			mtx->at |= PTHDR_MUTEX_LOCK;
+			__atomic_fetch_or (&(mtx->at), PTHDR_MUTEX_LOCK, __ATOMIC_RELAXED);
+			return CAF_OK;
+			/* futex lock */
+		case PTHDR_MUTEX_ADAPTIVE:
+			if (data < 0) {
+				return CAF_ERROR_SUB;
+			}
+			/* a recursive owner would park on itself on its re-lock */
+			if (pthread_mutexattr_gettype (&(mtx->attr), &type) == 0
+				&& type != PTHREAD_MUTEX_NORMAL
+				&& type != PTHREAD_MUTEX_DEFAULT) {
+				return CAF_ERROR_SUB;
+			}
+			mtx->at |= t;
+			mtx->kind = PTHDR_MUTEX_ADAPTIVE;
+			mtx->spin_max = pth_futex_spin_max (data);
+			return CAF_OK;
+			/* contention profiling */
+		case PTHDR_MUTEX_PROFILE:
+			mtx->hold_start = 0;
+			mtx->hold_depth = 0;
+			if (data < 0) {
+				mtx->at &= ~t;
+				mtx->prof = (pth_lprof_t *)NULL;
+				return CAF_OK;
+			}
+			mtx->prof = pth_lprof_get (PTH_LPROF_MUTEX, data);
+			if (mtx->prof == (pth_lprof_t *)NULL) {
+				return CAF_ERROR;
+			}
+			mtx->at |= t;
 			return CAF_OK;
 		default:
 			return CAF_ERROR_SUB;
@@ -135,7 +190,25 @@ pth_mtxattr_get (pth_mutex_t *mtx, pth_mutexattr_types_t t, int *data) {
 			return pthread_mutexattr_gettype (&(mtx->attr), data);
 			/* lock */
 		case PTHDR_MUTEX_LOCK:
-			return (mtx->at & t);
+			return (__atomic_load_n (&(mtx->at), __ATOMIC_RELAXED) & t);
+			/* futex lock */
+		case PTHDR_MUTEX_ADAPTIVE:
+			if (mtx->kind != PTHDR_MUTEX_ADAPTIVE) {
+				return CAF_ERROR_SUB;
+			}
+			if (data != (int *)NULL) {
+				*data = mtx->spin_max;
+			}
+			return CAF_OK;
+			/* contention profiling */
+		case PTHDR_MUTEX_PROFILE:
+			if (mtx->prof == (pth_lprof_t *)NULL) {
+				return CAF_ERROR_SUB;
+			}
+			if (data != (int *)NULL) {
+				*data = mtx->prof->id;
+			}
+			return CAF_OK;
 		default:
 			return CAF_ERROR_SUB;
 		}
@@ -147,9 +220,15 @@ pth_mtxattr_get (pth_mutex_t *mtx, pth_mutexattr_types_t t, int *data) {
 int
 pth_mtx_trylock (pth_mutex_t *mtx) {
 	if (mtx != (pth_mutex_t *)NULL) {
-		if ((pthread_mutex_trylock (&(mtx->mutex))) == 0) {
+		if (pth_mtx_acquire (mtx, 1) == CAF_OK) {
+			if (mtx->prof != (pth_lprof_t *)NULL) {
+				pth_mtx_prof_acquired (mtx, 0);
+			}
 			return pth_mtxattr_set (mtx, PTHDR_MUTEX_LOCK, 0);
 		}
+		if (mtx->prof != (pth_lprof_t *)NULL) {
+			pth_lprof_failed (mtx->prof);
+		}
 	}
 	return CAF_ERROR;
 }
@@ -157,10 +236,23 @@ pth_mtx_trylock (pth_mutex_t *mtx) {
 
 int
 pth_mtx_lock (pth_mutex_t *mtx) {
+	long long t0 = 0;
 	if (mtx != (pth_mutex_t *)NULL) {
-		if ((pthread_mutex_lock (&(mtx->mutex))) == 0) {
-			return pth_mtxattr_set (mtx, PTHDR_MUTEX_LOCK, 0);
+		/* profiled locks only read the clock when they have to wait */
+		if (mtx->prof != (pth_lprof_t *)NULL) {
+			if (pth_mtx_acquire (mtx, 1) != CAF_OK) {
+				t0 = pth_lprof_now ();
+			}
+		}
+		if (t0 != 0 || mtx->prof == (pth_lprof_t *)NULL) {
+			if (pth_mtx_acquire (mtx, 0) != CAF_OK) {
+				return CAF_ERROR;
+			}
+		}
+		if (mtx->prof != (pth_lprof_t *)NULL) {
+			pth_mtx_prof_acquired (mtx, t0);
 		}
+		return pth_mtxattr_set (mtx, PTHDR_MUTEX_LOCK, 0);
 	}
 	return CAF_ERROR;
 }
@@ -169,13 +261,105 @@ pth_mtx_lock (pth_mutex_t *mtx) {
 int
 pth_mtx_unlock (pth_mutex_t *mtx) {
 	if (mtx != (pth_mutex_t *)NULL) {
+		if (mtx->prof != (pth_lprof_t *)NULL) {
+			pth_mtx_prof_released (mtx);
+		}
+		/* the flag is cleared while the lock is still held */
+		__atomic_fetch_and (&(mtx->at), ~PTHDR_MUTEX_LOCK, __ATOMIC_RELAXED);
+		if (mtx->kind == PTHDR_MUTEX_ADAPTIVE) {
+			pth_mtx_futex_unlock (mtx);
+			return CAF_OK;
+		}
 		if (pthread_mutex_unlock (&(mtx->mutex)) == 0) {
-			mtx->at &= ~PTHDR_MUTEX_LOCK;
 			return CAF_OK;
 		}
+		__atomic_fetch_or (&(mtx->at), PTHDR_MUTEX_LOCK, __ATOMIC_RELAXED);
 	}
 	return CAF_ERROR;
 }
 
-/* caf_thread_mutex.c ends here */
 
+static int
+pth_mtx_acquire (pth_mutex_t *mtx, int tl) {
+	if (mtx->kind == PTHDR_MUTEX_ADAPTIVE) {
+		return tl ? pth_mtx_futex_trylock (mtx) : pth_mtx_futex_lock (mtx);
+	}
+	if (tl) {
+		return pthread_mutex_trylock (&(mtx->mutex)) == 0 ? CAF_OK : CAF_ERROR;
+	}
+	return pthread_mutex_lock (&(mtx->mutex)) == 0 ? CAF_OK : CAF_ERROR;
+}
+
+
+static int
+pth_mtx_futex_trylock (pth_mutex_t *mtx) {
+	int c = 0;
+	if (__atomic_compare_exchange_n (&(mtx->futex), &c, 1, 0,
+									 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+static int
+pth_mtx_futex_lock (pth_mutex_t *mtx) {
+	int c, cnt, lim, spin;
+	if (pth_mtx_futex_trylock (mtx) == CAF_OK) {
+		return CAF_OK;
+	}
+	/* the bound tracks recent waits, with some slack to grow back */
+	if (mtx->spin_max > 0) {
+		spin = __atomic_load_n (&(mtx->spin), __ATOMIC_RELAXED);
+		lim = spin * 2 + 10;
+		lim = lim < mtx->spin_max ? lim : mtx->spin_max;
+		for (cnt = 0; cnt < lim; cnt++) {
+			CAF_PTH_RELAX ();
+			if (__atomic_load_n (&(mtx->futex), __ATOMIC_RELAXED) == 0
+				&& pth_mtx_futex_trylock (mtx) == CAF_OK) {
+				__atomic_store_n (&(mtx->spin), spin + (cnt - spin) / 8,
+								  __ATOMIC_RELAXED);
+				return CAF_OK;
+			}
+		}
+		__atomic_store_n (&(mtx->spin), spin + (lim - spin) / 8,
+						  __ATOMIC_RELAXED);
+	}
+	/* park, marking the word so the owner knows to wake us */
+	c = __atomic_exchange_n (&(mtx->futex), 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		pth_futex_wait (&(mtx->futex), 2, (const struct timespec *)NULL);
+		c = __atomic_exchange_n (&(mtx->futex), 2, __ATOMIC_ACQUIRE);
+	}
+	return CAF_OK;
+}
+
+
+static void
+pth_mtx_futex_unlock (pth_mutex_t *mtx) {
+	if (__atomic_fetch_sub (&(mtx->futex), 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&(mtx->futex), 0, __ATOMIC_RELEASE);
+		pth_futex_wake (&(mtx->futex), 1);
+	}
+}
+
+
+/* called with the mutex held, a recursive hold is timed once */
+static void
+pth_mtx_prof_acquired (pth_mutex_t *mtx, long long t0) {
+	long long start = pth_lprof_acquired (mtx->prof, 0, t0);
+	if (mtx->hold_depth++ == 0) {
+		mtx->hold_start = start;
+	}
+}
+
+
+static void
+pth_mtx_prof_released (pth_mutex_t *mtx) {
+	if (mtx->hold_depth > 0 && --(mtx->hold_depth) == 0) {
+		pth_lprof_released (mtx->prof, mtx->hold_start);
+		mtx->hold_start = 0;
+	}
+}
+
+/* caf_thread_mutex.c ends here */
@@ -32,11 +32,19 @@ static char Id[] = "$Id$";
 #include <errno.h>
 #include <pthread.h>
 
+#ifdef LINUX_SYSTEM
+#include <sched.h>
+#endif /* !LINUX_SYSTEM */
+
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
 #include "caf/caf_thread_attr.h"
+#include "caf/caf_thread_cpu.h"
 #include "caf/caf_thread_pool.h"
 
+static int pth_pool_spawn (pth_attri_t *attri, pthread_t *thr,
+						   CAF_PT_PROTOTYPE(rtn), void *arg, int i);
+
 
 pth_pool_t *
 pth_pool_new (pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn), int count) {
@@ -44,9 +52,9 @@ pth_pool_new (pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn), int count) {
 	pthread_t *thr = (pthread_t *)NULL;
 	int rc = 0;
 	int c = 0;
-	if (attrs != (pth_attri_t *)NULL) {
+	if (attrs != (pth_attri_t *)NULL && count >= 0) {
 		ptp = (pth_pool_t *)xmalloc (CAF_PT_POOL_SZ);
-		if (ptp != (pth_pool_t *)NULL && count > 0) {
+		if (ptp != (pth_pool_t *)NULL) {
 			ptp->attri = attrs;
 			ptp->rtn = rtn;
 			ptp->threads = deque_create ();
@@ -85,9 +93,9 @@ pth_pool_delete_callback (void *ptr) {
 		res = pthread_cancel (*pth);
 		xfree (ptr);
 		ptr = (void *)NULL;
-		return CAF_OK;
 	}
-	return CAF_ERROR;
+	/* joined threads were already released by pth_pool_join */
+	return CAF_OK;
 }
 
 
@@ -97,6 +105,7 @@ pth_pool_create (pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn), int cnt, void *arg)
 	int rt = 0;
 	caf_dequen_t *n;
 	pthread_t *thr;
+	int i = 0;
 	if (rtn != NULL && cnt > 0) {
 		pool = pth_pool_new (attrs, rtn, cnt);
 		if (pool != (pth_pool_t *)NULL) {
@@ -105,8 +114,7 @@ pth_pool_create (pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn), int cnt, void *arg)
 				if (n != (caf_dequen_t *)NULL) {
 					while (n != (caf_dequen_t *)NULL) {
 						thr = (pthread_t *)n->data;
-						rt = pthread_create (thr, &(pool->attri->attr), rtn,
-						                     arg);
+						rt = pth_pool_spawn (pool->attri, thr, rtn, arg, i++);
 						n = n->next;
 					}
 				}
@@ -120,7 +128,6 @@ pth_pool_create (pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn), int cnt, void *arg)
 int
 pth_pool_add (pth_pool_t *p, pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn),
               void *arg) {
-	pth_pool_t *pool = (pth_pool_t *)NULL;
 	int rt = CAF_ERROR;
 	pthread_t *thr;
 	if (rtn != NULL
@@ -128,15 +135,12 @@ pth_pool_add (pth_pool_t *p, pth_attri_t *attrs, CAF_PT_PROTOTYPE(rtn),
 		&& p->threads != (deque_t *)NULL) {
 		thr = (pthread_t *)xmalloc (sizeof (pthread_t));
 		if (thr != (pthread_t *)NULL) {
-			if (attrs != (pth_attri_t *)NULL) {
-				rt = pthread_create (thr, &(attrs->attr), rtn,
-									 arg);
-			} else {
-				rt = pthread_create (thr, &(pool->attri->attr), rtn,
-									 arg);
-			}
-			if (rt == 0) {
-				deque_push (pool->threads, thr);
+			rt = pth_pool_spawn (attrs != (pth_attri_t *)NULL
+								 ? attrs : p->attri, thr, rtn, arg, p->count);
+			if (rt == 0 && deque_push (p->threads, thr) != (deque_t *)NULL) {
+				p->count++;
+			} else if (rt != 0) {
+				xfree (thr);
 			}
 		}
 	}
@@ -161,11 +165,20 @@ pth_pool_join (pth_pool_t *pool) {
 				if (n != (caf_dequen_t *)NULL) {
 					while (n != (caf_dequen_t *)NULL) {
 						thr = (pthread_t *)n->data;
+						if (thr == (pthread_t *)NULL) {
+							n = n->next;
+							continue;
+						}
 						thread_stat = (void *)NULL;
 						rt = pthread_join (*thr, (void **)&thread_stat);
 						if (thread_stat != PTHREAD_CANCELED) {
 							final += rt;
 						}
+						if (rt == 0) {
+							/* a joined thread id is no longer valid */
+							xfree (thr);
+							n->data = (void *)NULL;
+						}
 						n = n->next;
 					}
 				}
@@ -192,8 +205,10 @@ pth_pool_detach (pth_pool_t *pool) {
 				if (n != (caf_dequen_t *)NULL) {
 					while (n != (caf_dequen_t *)NULL) {
 						thr = (pthread_t *)n->data;
-						rt = pthread_detach (*thr);
-						final += rt;
+						if (thr != (pthread_t *)NULL) {
+							rt = pthread_detach (*thr);
+							final += rt;
+						}
 						n = n->next;
 					}
 				}
@@ -215,8 +230,10 @@ pth_pool_cancel (pth_pool_t *pool) {
 		if (n != (caf_dequen_t *)NULL) {
 			while (n != (caf_dequen_t *)NULL) {
 				thr = (pthread_t *)n->data;
-				rt = pthread_cancel (*thr);
-				final += rt;
+				if (thr != (pthread_t *)NULL) {
+					rt = pthread_cancel (*thr);
+					final += rt;
+				}
 				n = n->next;
 			}
 		}
@@ -224,5 +241,54 @@ pth_pool_cancel (pth_pool_t *pool) {
 	return final;
 }
 
+
+/*
+ * Creates pool thread i, pinned and named as the attributes say. The
+ * CPU mask is set on a private copy of the attributes, so the thread
+ * starts on its CPU and its first memory writes land on the local
+ * node, while the shared attributes stay untouched.
+ */
+static int
+pth_pool_spawn (pth_attri_t *attri, pthread_t *thr, CAF_PT_PROTOTYPE(rtn),
+				void *arg, int i) {
+	int rt = -1, made = 0;
+#ifdef LINUX_SYSTEM
+	pth_attri_t local;
+	cpu_set_t set;
+	int cpu = -1;
+	if (attri->at & PTH_ATTR_AFFINITY) {
+		cpu = pth_cpuset_cpu (attri->cpus, i);
+	}
+	if (cpu >= CPU_SETSIZE) {
+		cpu = -1;
+	}
+	if (cpu >= 0) {
+		CPU_ZERO (&set);
+		CPU_SET (cpu, &set);
+		if (pth_attri_copy (&local, attri) == CAF_OK) {
+			if (pthread_attr_setaffinity_np (&(local.attr),
+											 sizeof(cpu_set_t), &set) == 0) {
+				rt = pthread_create (thr, &(local.attr), rtn, arg);
+				made = 1;
+			}
+			pth_attr_destroy (&local);
+		}
+	}
+#endif /* !LINUX_SYSTEM */
+	if (!made) {
+		rt = pthread_create (thr, &(attri->attr), rtn, arg);
+#ifdef LINUX_SYSTEM
+		/* could not copy the attributes, pin it once running */
+		if (rt == 0 && cpu >= 0) {
+			pthread_setaffinity_np (*thr, sizeof(cpu_set_t), &set);
+		}
+#endif /* !LINUX_SYSTEM */
+	}
+	if (rt == 0 && (attri->at & PTH_ATTR_NAME)) {
+		pth_cpu_set_name (*thr, attri->name, i);
+	}
+	return rt;
+}
+
 /* caf_thread_pool.c ends here */
 
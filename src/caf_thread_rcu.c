@@ -0,0 +1,271 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_thread_futex.h"
+#include "caf/caf_thread_cpu.h"
+#include "caf/caf_thread_mutex.h"
+#include "caf/caf_thread_rcu.h"
+
+
+static void pth_rcu_reclaim (pth_rcu_t *rcu, pth_rcu_cb_t *cb);
+
+
+pth_rcu_t *
+pth_rcu_new (int id, int readers) {
+	pth_rcu_t *rcu;
+	if (readers <= 0) {
+		return (pth_rcu_t *)NULL;
+	}
+	rcu = (pth_rcu_t *)xmalloc (CAF_PTH_RCU_SZ);
+	if (rcu == (pth_rcu_t *)NULL) {
+		return rcu;
+	}
+	memset (rcu, 0, CAF_PTH_RCU_SZ);
+	rcu->id = id;
+	rcu->max = readers;
+	rcu->epoch = 1;
+	/* page aligned, so each slot owns its cache line */
+	rcu->readers = (pth_rcu_reader_t *)pth_cpu_local_alloc (
+		sizeof (pth_rcu_reader_t) * (size_t)readers);
+	rcu->mtx = pth_mtx_new ();
+	if (rcu->mtx != (pth_mutex_t *)NULL) {
+		pth_mtxattr_init (rcu->mtx);
+		if (pth_mtx_init (rcu->mtx) != 0) {
+			pth_mtxattr_destroy (rcu->mtx);
+			pth_mtx_delete (rcu->mtx);
+			rcu->mtx = (pth_mutex_t *)NULL;
+		}
+	}
+	if (rcu->readers == (pth_rcu_reader_t *)NULL
+		|| rcu->mtx == (pth_mutex_t *)NULL) {
+		pth_rcu_delete (rcu);
+		return (pth_rcu_t *)NULL;
+	}
+	return rcu;
+}
+
+
+void
+pth_rcu_delete (pth_rcu_t *rcu) {
+	if (rcu == (pth_rcu_t *)NULL) {
+		return;
+	}
+	if (rcu->mtx != (pth_mutex_t *)NULL
+		&& rcu->readers != (pth_rcu_reader_t *)NULL) {
+		pth_rcu_barrier (rcu);
+	}
+	if (rcu->mtx != (pth_mutex_t *)NULL) {
+		pth_mtx_destroy (rcu->mtx);
+		pth_mtxattr_destroy (rcu->mtx);
+		pth_mtx_delete (rcu->mtx);
+	}
+	if (rcu->readers != (pth_rcu_reader_t *)NULL) {
+		pth_cpu_local_free (rcu->readers,
+							sizeof (pth_rcu_reader_t) * (size_t)rcu->max);
+	}
+	xfree (rcu);
+}
+
+
+pth_rcu_reader_t *
+pth_rcu_register (pth_rcu_t *rcu) {
+	pth_rcu_reader_t *r;
+	int i, u;
+	if (rcu == (pth_rcu_t *)NULL) {
+		return (pth_rcu_reader_t *)NULL;
+	}
+	for (i = 0; i < rcu->max; i++) {
+		r = &(rcu->readers[i]);
+		u = 0;
+		if (__atomic_load_n (&(r->used), __ATOMIC_RELAXED) == 0
+			&& __atomic_compare_exchange_n (&(r->used), &u, 1, 0,
+											__ATOMIC_ACQUIRE,
+											__ATOMIC_RELAXED)) {
+			r->depth = 0;
+			return r;
+		}
+	}
+	return (pth_rcu_reader_t *)NULL;
+}
+
+
+void
+pth_rcu_unregister (pth_rcu_t *rcu, pth_rcu_reader_t *r) {
+	if (rcu != (pth_rcu_t *)NULL && r != (pth_rcu_reader_t *)NULL) {
+		__atomic_store_n (&(r->epoch), 0, __ATOMIC_RELEASE);
+		__atomic_store_n (&(r->used), 0, __ATOMIC_RELEASE);
+	}
+}
+
+
+void
+pth_rcu_read_lock (pth_rcu_t *rcu, pth_rcu_reader_t *r) {
+	if (r->depth++ == 0) {
+		/* the store is ordered before the loads of the section, so
+		   a grace period either sees it or the section sees the new
+		   pointers */
+		__atomic_store_n (&(r->epoch),
+						  __atomic_load_n (&(rcu->epoch), __ATOMIC_RELAXED),
+						  __ATOMIC_RELAXED);
+		__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	}
+}
+
+
+void
+pth_rcu_read_unlock (pth_rcu_reader_t *r) {
+	if (--r->depth == 0) {
+		__atomic_store_n (&(r->epoch), 0, __ATOMIC_RELEASE);
+	}
+}
+
+
+void *
+pth_rcu_deref (void **pp) {
+	return __atomic_load_n (pp, __ATOMIC_ACQUIRE);
+}
+
+
+void *
+pth_rcu_publish (void **pp, void *nv) {
+	return __atomic_exchange_n (pp, nv, __ATOMIC_SEQ_CST);
+}
+
+
+int
+pth_rcu_synchronize (pth_rcu_t *rcu) {
+	long e, s;
+	int cnt, i, spin;
+	if (rcu == (pth_rcu_t *)NULL) {
+		return CAF_ERROR;
+	}
+	spin = pth_futex_spin_max (0);
+	pth_mtx_lock (rcu->mtx);
+	/* readers entering from now on see the new epoch and the new
+	   pointers, only older epochs are waited for */
+	e = __atomic_add_fetch (&(rcu->epoch), 1, __ATOMIC_SEQ_CST);
+	for (i = 0; i < rcu->max; i++) {
+		cnt = 0;
+		for (;;) {
+			s = __atomic_load_n (&(rcu->readers[i].epoch), __ATOMIC_SEQ_CST);
+			if (s == 0 || s >= e) {
+				break;
+			}
+			if (cnt++ < spin) {
+				CAF_PTH_RELAX ();
+			} else {
+				sched_yield ();
+			}
+		}
+	}
+	rcu->syncs++;
+	pth_mtx_unlock (rcu->mtx);
+	return CAF_OK;
+}
+
+
+int
+pth_rcu_retire (pth_rcu_t *rcu, void *ptr, CAF_RCU_CBFREE(del)) {
+	pth_rcu_cb_t *cb, *batch = (pth_rcu_cb_t *)NULL;
+	if (rcu == (pth_rcu_t *)NULL || ptr == (void *)NULL) {
+		return CAF_ERROR;
+	}
+	cb = (pth_rcu_cb_t *)xmalloc (sizeof (pth_rcu_cb_t));
+	if (cb == (pth_rcu_cb_t *)NULL) {
+		/* no room to defer, wait the grace period here */
+		pth_rcu_synchronize (rcu);
+		if (del != NULL) {
+			del (ptr);
+		} else {
+			xfree (ptr);
+		}
+		return CAF_OK;
+	}
+	cb->ptr = ptr;
+	cb->del = del;
+	pth_mtx_lock (rcu->mtx);
+	cb->next = rcu->pending;
+	rcu->pending = cb;
+	if (++(rcu->npending) >= CAF_PTH_RCU_BATCH) {
+		batch = rcu->pending;
+		rcu->pending = (pth_rcu_cb_t *)NULL;
+		rcu->npending = 0;
+	}
+	pth_mtx_unlock (rcu->mtx);
+	if (batch != (pth_rcu_cb_t *)NULL) {
+		pth_rcu_synchronize (rcu);
+		pth_rcu_reclaim (rcu, batch);
+	}
+	return CAF_OK;
+}
+
+
+int
+pth_rcu_barrier (pth_rcu_t *rcu) {
+	pth_rcu_cb_t *batch;
+	if (rcu == (pth_rcu_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pth_mtx_lock (rcu->mtx);
+	batch = rcu->pending;
+	rcu->pending = (pth_rcu_cb_t *)NULL;
+	rcu->npending = 0;
+	pth_mtx_unlock (rcu->mtx);
+	pth_rcu_synchronize (rcu);
+	pth_rcu_reclaim (rcu, batch);
+	return CAF_OK;
+}
+
+
+static void
+pth_rcu_reclaim (pth_rcu_t *rcu, pth_rcu_cb_t *cb) {
+	pth_rcu_cb_t *next;
+	long n = 0;
+	while (cb != (pth_rcu_cb_t *)NULL) {
+		next = cb->next;
+		if (cb->del != NULL) {
+			cb->del (cb->ptr);
+		} else {
+			xfree (cb->ptr);
+		}
+		xfree (cb);
+		cb = next;
+		n++;
+	}
+	__atomic_add_fetch (&(rcu->reclaimed), n, __ATOMIC_RELAXED);
+}
+
+/* caf_thread_rcu.c ends here */
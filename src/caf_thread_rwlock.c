@@ -34,9 +34,24 @@ static char Id[] = "$Id$";
 
 #include "caf/caf.h"
 #include "caf/caf_data_mem.h"
+#include "caf/caf_thread_futex.h"
 #include "caf/caf_thread_rwlock.h"
 
 
+static int pth_rwl_lock (pth_rwlock_t *rwl, int wr, int tl,
+						 const struct timespec *to);
+static int pth_rwl_acquire (pth_rwlock_t *rwl, int wr, int tl,
+							const struct timespec *to);
+static int pth_rwl_futex_try (pth_rwlock_t *rwl, int wr);
+static int pth_rwl_futex_spin (pth_rwlock_t *rwl, int wr);
+static int pth_rwl_futex_rdlock (pth_rwlock_t *rwl, int tl,
+								 const struct timespec *to);
+static int pth_rwl_futex_wrlock (pth_rwlock_t *rwl, int tl,
+								 const struct timespec *to);
+static void pth_rwl_futex_unlock (pth_rwlock_t *rwl);
+static void pth_rwl_futex_wake (int *seq, int *sleep, int n);
+
+
 pth_rwlock_t *
 pth_rwl_new (int id) {
 	pth_rwlock_t *rwl = (pth_rwlock_t *)NULL;
@@ -44,6 +59,17 @@ pth_rwl_new (int id) {
 	if (rwl != (pth_rwlock_t *)NULL) {
 		rwl->id = id;
 		rwl->at = 0;
+		rwl->kind = 0;
+		rwl->state = 0;
+		rwl->wwant = 0;
+		rwl->rsleep = 0;
+		rwl->wsleep = 0;
+		rwl->rseq = 0;
+		rwl->wseq = 0;
+		rwl->spin = 0;
+		rwl->spin_max = 0;
+		rwl->prof = (pth_lprof_t *)NULL;
+		rwl->hold_start = 0;
 	}
 	return rwl;
 }
@@ -78,6 +104,9 @@ pth_rwlattr_destroy (pth_rwlock_t *rwl) {
 int
 pth_rwl_init (pth_rwlock_t *rwl) {
 	if (rwl != (pth_rwlock_t *)NULL) {
+		rwl->state = 0;
+		rwl->wwant = 0;
+		rwl->spin = 0;
 		return pthread_rwlock_init(&(rwl->rwlock), &(rwl->attr));
 	}
 	return CAF_ERROR_SUB;
@@ -110,6 +139,31 @@ pth_rwlattr_set (pth_rwlock_t *rwl, pth_rwlock_types_t t, int data) {
 		case PTHDR_RWLOCK_WRLOCK:
 		case PTHDR_RWLOCK_TRDLOCK:
 		case PTHDR_RWLOCK_TWRLOCK:
+			__atomic_fetch_or (&(rwl->at), t, __ATOMIC_RELAXED);
+			return CAF_OK;
+			/* futex lock modes */
+		case PTHDR_RWLOCK_READER:
+		case PTHDR_RWLOCK_WRITER:
+			if (data < 0) {
+				return CAF_ERROR_SUB;
+			}
+			rwl->at &= ~(PTHDR_RWLOCK_READER | PTHDR_RWLOCK_WRITER);
+			rwl->at |= t;
+			rwl->kind = t;
+			rwl->spin_max = pth_futex_spin_max (data);
+			return CAF_OK;
+			/* contention profiling */
+		case PTHDR_RWLOCK_PROFILE:
+			rwl->hold_start = 0;
+			if (data < 0) {
+				rwl->at &= ~t;
+				rwl->prof = (pth_lprof_t *)NULL;
+				return CAF_OK;
+			}
+			rwl->prof = pth_lprof_get (PTH_LPROF_RWLOCK, rwl->id);
+			if (rwl->prof == (pth_lprof_t *)NULL) {
+				return CAF_ERROR_SUB;
+			}
 			rwl->at |= t;
 			return CAF_OK;
 		default:
@@ -135,7 +189,20 @@ pth_rwlattr_get (pth_rwlock_t *rwl, pth_rwlock_types_t t, int *data) {
 		case PTHDR_RWLOCK_WRLOCK:
 		case PTHDR_RWLOCK_TRDLOCK:
 		case PTHDR_RWLOCK_TWRLOCK:
-			return (rwl->at & t);
+			return (__atomic_load_n (&(rwl->at), __ATOMIC_RELAXED) & t);
+			/* futex lock modes */
+		case PTHDR_RWLOCK_READER:
+		case PTHDR_RWLOCK_WRITER:
+			if (rwl->kind != (int)t) {
+				return CAF_ERROR_SUB;
+			}
+			if (data != (int *)NULL) {
+				*data = rwl->spin_max;
+			}
+			return CAF_OK;
+			/* contention profiling */
+		case PTHDR_RWLOCK_PROFILE:
+			return rwl->prof != (pth_lprof_t *)NULL ? CAF_OK : CAF_ERROR_SUB;
 		default:
 			return CAF_ERROR_SUB;
 		}
@@ -147,19 +214,7 @@ pth_rwlattr_get (pth_rwlock_t *rwl, pth_rwlock_types_t t, int *data) {
 int
 pth_rwl_wrlock (pth_rwlock_t *rwl, int tl, const struct timespec *to) {
 	if (rwl != (pth_rwlock_t *)NULL) {
-		if (to != (struct timespec *)NULL) {
-			if ((pthread_rwlock_timedwrlock (&(rwl->rwlock), to)) == 0) {
-				return pth_rwlattr_set (rwl, PTHDR_RWLOCK_TWRLOCK, 0);
-			}
-		} else if (tl != 0) {
-			if ((pthread_rwlock_trywrlock (&(rwl->rwlock))) == 0) {
-				return pth_rwlattr_set (rwl, PTHDR_RWLOCK_WRLOCK, 0);
-			}
-		} else {
-			if ((pthread_rwlock_wrlock (&(rwl->rwlock))) == 0) {
-				return pth_rwlattr_set (rwl, PTHDR_RWLOCK_WRLOCK, 0);
-			}
-		}
+		return pth_rwl_lock (rwl, 1, tl, to);
 	}
 	return CAF_ERROR_SUB;
 }
@@ -168,19 +223,7 @@ pth_rwl_wrlock (pth_rwlock_t *rwl, int tl, const struct timespec *to) {
 int
 pth_rwl_rdlock (pth_rwlock_t *rwl, int tl, const struct timespec *to) {
 	if (rwl != (pth_rwlock_t *)NULL) {
-		if (to != (struct timespec *)NULL) {
-			if ((pthread_rwlock_timedrdlock (&(rwl->rwlock), to)) == 0) {
-				return pth_rwlattr_set (rwl, PTHDR_RWLOCK_TRDLOCK, 0);
-			}
-		} else if (tl != 0) {
-			if ((pthread_rwlock_tryrdlock (&(rwl->rwlock))) == 0) {
-				return pth_rwlattr_set (rwl, PTHDR_RWLOCK_RDLOCK, 0);
-			}
-		} else {
-			if ((pthread_rwlock_rdlock (&(rwl->rwlock))) == 0) {
-				return pth_rwlattr_set (rwl, PTHDR_RWLOCK_RDLOCK, 0);
-			}
-		}
+		return pth_rwl_lock (rwl, 0, tl, to);
 	}
 	return CAF_ERROR_SUB;
 }
@@ -188,14 +231,232 @@ pth_rwl_rdlock (pth_rwlock_t *rwl, int tl, const struct timespec *to) {
 
 int
 pth_rwl_unlock (pth_rwlock_t *rwl) {
+	long long t0;
 	if (rwl != (pth_rwlock_t *)NULL) {
+		/* only a writer stores a hold start, readers see zero */
+		if (rwl->prof != (pth_lprof_t *)NULL && rwl->hold_start != 0) {
+			t0 = rwl->hold_start;
+			rwl->hold_start = 0;
+			pth_lprof_released (rwl->prof, t0);
+		}
+		/* the flags are cleared while the lock is still held */
+		__atomic_fetch_and (&(rwl->at), ~CAF_ALL_RWLOCKS, __ATOMIC_RELAXED);
+		if (rwl->kind != 0) {
+			pth_rwl_futex_unlock (rwl);
+			return CAF_OK;
+		}
 		if ((pthread_rwlock_unlock (&(rwl->rwlock))) == 0) {
-			rwl->at &= ~CAF_ALL_RWLOCKS;
 			return CAF_OK;
 		}
 	}
 	return CAF_ERROR_SUB;
 }
 
-/* caf_thread_rwlock.c ends here */
 
+static int
+pth_rwl_lock (pth_rwlock_t *rwl, int wr, int tl, const struct timespec *to) {
+	pth_rwlock_types_t t;
+	long long t0 = 0;
+	int r = CAF_ERROR;
+	/* profiled locks only read the clock when they have to wait */
+	if (rwl->prof != (pth_lprof_t *)NULL) {
+		r = pth_rwl_acquire (rwl, wr, 1, (const struct timespec *)NULL);
+		if (r != CAF_OK && tl == 0) {
+			t0 = pth_lprof_now ();
+		}
+	}
+	if (r != CAF_OK && (t0 != 0 || rwl->prof == (pth_lprof_t *)NULL)) {
+		r = pth_rwl_acquire (rwl, wr, tl, to);
+	}
+	if (r != CAF_OK) {
+		if (rwl->prof != (pth_lprof_t *)NULL) {
+			pth_lprof_failed (rwl->prof);
+		}
+		return CAF_ERROR_SUB;
+	}
+	if (rwl->prof != (pth_lprof_t *)NULL) {
+		t0 = pth_lprof_acquired (rwl->prof, !wr, t0);
+		if (wr) {
+			rwl->hold_start = t0;
+		}
+	}
+	if (to != (const struct timespec *)NULL) {
+		t = wr ? PTHDR_RWLOCK_TWRLOCK : PTHDR_RWLOCK_TRDLOCK;
+	} else {
+		t = wr ? PTHDR_RWLOCK_WRLOCK : PTHDR_RWLOCK_RDLOCK;
+	}
+	return pth_rwlattr_set (rwl, t, 0);
+}
+
+
+static int
+pth_rwl_acquire (pth_rwlock_t *rwl, int wr, int tl,
+				 const struct timespec *to) {
+	int r;
+	if (rwl->kind != 0) {
+		return wr ? pth_rwl_futex_wrlock (rwl, tl, to)
+			: pth_rwl_futex_rdlock (rwl, tl, to);
+	}
+	if (to != (const struct timespec *)NULL) {
+		r = wr ? pthread_rwlock_timedwrlock (&(rwl->rwlock), to)
+			: pthread_rwlock_timedrdlock (&(rwl->rwlock), to);
+	} else if (tl != 0) {
+		r = wr ? pthread_rwlock_trywrlock (&(rwl->rwlock))
+			: pthread_rwlock_tryrdlock (&(rwl->rwlock));
+	} else {
+		r = wr ? pthread_rwlock_wrlock (&(rwl->rwlock))
+			: pthread_rwlock_rdlock (&(rwl->rwlock));
+	}
+	return r == 0 ? CAF_OK : CAF_ERROR;
+}
+
+
+static int
+pth_rwl_futex_try (pth_rwlock_t *rwl, int wr) {
+	int s = 0;
+	if (wr) {
+		return __atomic_compare_exchange_n (&(rwl->state), &s,
+											CAF_PTH_RWLOCK_WRITER, 0,
+											__ATOMIC_SEQ_CST,
+											__ATOMIC_SEQ_CST)
+			? CAF_OK : CAF_ERROR;
+	}
+	s = __atomic_load_n (&(rwl->state), __ATOMIC_SEQ_CST);
+	do {
+		if ((s & CAF_PTH_RWLOCK_WRITER) != 0) {
+			return CAF_ERROR;
+		}
+		/* writer preference: no new readers while a writer waits */
+		if (rwl->kind == PTHDR_RWLOCK_WRITER
+			&& __atomic_load_n (&(rwl->wwant), __ATOMIC_SEQ_CST) > 0) {
+			return CAF_ERROR;
+		}
+	} while (!__atomic_compare_exchange_n (&(rwl->state), &s, s + 1, 0,
+										   __ATOMIC_SEQ_CST,
+										   __ATOMIC_SEQ_CST));
+	return CAF_OK;
+}
+
+
+static int
+pth_rwl_futex_spin (pth_rwlock_t *rwl, int wr) {
+	int cnt, lim, spin;
+	if (rwl->spin_max <= 0) {
+		return CAF_ERROR;
+	}
+	spin = __atomic_load_n (&(rwl->spin), __ATOMIC_RELAXED);
+	lim = spin * 2 + 10;
+	lim = lim < rwl->spin_max ? lim : rwl->spin_max;
+	for (cnt = 0; cnt < lim; cnt++) {
+		CAF_PTH_RELAX ();
+		if (pth_rwl_futex_try (rwl, wr) == CAF_OK) {
+			__atomic_store_n (&(rwl->spin), spin + (cnt - spin) / 8,
+							  __ATOMIC_RELAXED);
+			return CAF_OK;
+		}
+	}
+	__atomic_store_n (&(rwl->spin), spin + (lim - spin) / 8,
+					  __ATOMIC_RELAXED);
+	return CAF_ERROR;
+}
+
+
+static int
+pth_rwl_futex_rdlock (pth_rwlock_t *rwl, int tl, const struct timespec *to) {
+	int r, s;
+	if (pth_rwl_futex_try (rwl, 0) == CAF_OK) {
+		return CAF_OK;
+	}
+	if (tl != 0) {
+		return CAF_ERROR;
+	}
+	if (pth_rwl_futex_spin (rwl, 0) == CAF_OK) {
+		return CAF_OK;
+	}
+	for (;;) {
+		/* announce the sleep before the last look, so an unlock that
+		   misses the announcement is seen by the look */
+		__atomic_fetch_add (&(rwl->rsleep), 1, __ATOMIC_SEQ_CST);
+		s = __atomic_load_n (&(rwl->rseq), __ATOMIC_SEQ_CST);
+		if (pth_rwl_futex_try (rwl, 0) == CAF_OK) {
+			__atomic_fetch_sub (&(rwl->rsleep), 1, __ATOMIC_SEQ_CST);
+			return CAF_OK;
+		}
+		r = pth_futex_wait (&(rwl->rseq), s, to);
+		__atomic_fetch_sub (&(rwl->rsleep), 1, __ATOMIC_SEQ_CST);
+		if (pth_rwl_futex_try (rwl, 0) == CAF_OK) {
+			return CAF_OK;
+		}
+		if (r == CAF_ERROR_SUB) {
+			return CAF_ERROR;
+		}
+	}
+}
+
+
+static int
+pth_rwl_futex_wrlock (pth_rwlock_t *rwl, int tl, const struct timespec *to) {
+	int r, s, w = CAF_OK;
+	if (pth_rwl_futex_try (rwl, 1) == CAF_OK) {
+		return CAF_OK;
+	}
+	if (tl != 0) {
+		return CAF_ERROR;
+	}
+	__atomic_fetch_add (&(rwl->wwant), 1, __ATOMIC_SEQ_CST);
+	r = pth_rwl_futex_spin (rwl, 1);
+	while (r != CAF_OK && w != CAF_ERROR_SUB) {
+		__atomic_fetch_add (&(rwl->wsleep), 1, __ATOMIC_SEQ_CST);
+		s = __atomic_load_n (&(rwl->wseq), __ATOMIC_SEQ_CST);
+		r = pth_rwl_futex_try (rwl, 1);
+		if (r != CAF_OK) {
+			w = pth_futex_wait (&(rwl->wseq), s, to);
+			r = pth_rwl_futex_try (rwl, 1);
+		}
+		__atomic_fetch_sub (&(rwl->wsleep), 1, __ATOMIC_SEQ_CST);
+	}
+	/* the last writer giving up lets the held back readers in */
+	if (__atomic_sub_fetch (&(rwl->wwant), 1, __ATOMIC_SEQ_CST) == 0
+		&& r != CAF_OK && rwl->kind == PTHDR_RWLOCK_WRITER) {
+		pth_rwl_futex_wake (&(rwl->rseq), &(rwl->rsleep), CAF_PTH_FUTEX_ALL);
+	}
+	return r;
+}
+
+
+static void
+pth_rwl_futex_unlock (pth_rwlock_t *rwl) {
+	int s = __atomic_load_n (&(rwl->state), __ATOMIC_RELAXED);
+	if ((s & CAF_PTH_RWLOCK_WRITER) != 0) {
+		s = __atomic_sub_fetch (&(rwl->state), CAF_PTH_RWLOCK_WRITER,
+								__ATOMIC_SEQ_CST);
+	} else {
+		s = __atomic_sub_fetch (&(rwl->state), 1, __ATOMIC_SEQ_CST);
+	}
+	if (s != 0) {
+		return;
+	}
+	if (rwl->kind == PTHDR_RWLOCK_WRITER) {
+		/* hand over to a writer, readers wait for the last one */
+		if (__atomic_load_n (&(rwl->wwant), __ATOMIC_SEQ_CST) > 0) {
+			pth_rwl_futex_wake (&(rwl->wseq), &(rwl->wsleep), 1);
+		} else {
+			pth_rwl_futex_wake (&(rwl->rseq), &(rwl->rsleep),
+								CAF_PTH_FUTEX_ALL);
+		}
+		return;
+	}
+	pth_rwl_futex_wake (&(rwl->rseq), &(rwl->rsleep), CAF_PTH_FUTEX_ALL);
+	pth_rwl_futex_wake (&(rwl->wseq), &(rwl->wsleep), 1);
+}
+
+
+static void
+pth_rwl_futex_wake (int *seq, int *sleep, int n) {
+	if (__atomic_load_n (sleep, __ATOMIC_SEQ_CST) > 0) {
+		__atomic_fetch_add (seq, 1, __ATOMIC_SEQ_CST);
+		pth_futex_wake (seq, n);
+	}
+}
+
+/* caf_thread_rwlock.c ends here */
@@ -0,0 +1,183 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+#ifndef lint
+static char Id[] = "$Id$";
+#endif /* !lint */
+
+#ifdef HAVE_CONFIG_H
+#include "caf/config.h"
+#endif /* !HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <sched.h>
+
+#include "caf/caf.h"
+#include "caf/caf_data_mem.h"
+#include "caf/caf_thread_futex.h"
+#include "caf/caf_thread_seqlock.h"
+
+
+static void pth_seql_pause (pth_seqlock_t *sl, int *cnt);
+static void pth_seql_copy (void *dst, const void *src, size_t sz);
+
+
+pth_seqlock_t *
+pth_seql_new (int id) {
+	pth_seqlock_t *sl = (pth_seqlock_t *)xmalloc (CAF_PTH_SEQLOCK_SZ);
+	if (sl != (pth_seqlock_t *)NULL) {
+		pth_seql_init (sl, id);
+	}
+	return sl;
+}
+
+
+void
+pth_seql_delete (pth_seqlock_t *sl) {
+	if (sl != (pth_seqlock_t *)NULL) {
+		xfree (sl);
+	}
+}
+
+
+int
+pth_seql_init (pth_seqlock_t *sl, int id) {
+	if (sl != (pth_seqlock_t *)NULL) {
+		sl->id = id;
+		sl->seq = 0;
+		sl->spin_max = pth_futex_spin_max (0);
+		return CAF_OK;
+	}
+	return CAF_ERROR;
+}
+
+
+int
+pth_seql_read_begin (pth_seqlock_t *sl) {
+	int cnt = 0, s;
+	while (((s = __atomic_load_n (&(sl->seq), __ATOMIC_ACQUIRE)) & 1) != 0) {
+		pth_seql_pause (sl, &cnt);
+	}
+	return s;
+}
+
+
+int
+pth_seql_read_retry (pth_seqlock_t *sl, int seq) {
+	/* orders the data loads before the second sequence load */
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	return __atomic_load_n (&(sl->seq), __ATOMIC_RELAXED) != seq;
+}
+
+
+int
+pth_seql_wrlock (pth_seqlock_t *sl) {
+	int cnt = 0, s;
+	if (sl == (pth_seqlock_t *)NULL) {
+		return CAF_ERROR;
+	}
+	s = __atomic_load_n (&(sl->seq), __ATOMIC_RELAXED);
+	for (;;) {
+		if ((s & 1) == 0
+			&& __atomic_compare_exchange_n (&(sl->seq), &s, s + 1, 1,
+											__ATOMIC_ACQUIRE,
+											__ATOMIC_RELAXED)) {
+			break;
+		}
+		pth_seql_pause (sl, &cnt);
+		s = __atomic_load_n (&(sl->seq), __ATOMIC_RELAXED);
+	}
+	/* readers that see a data store also see the odd sequence */
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+	return CAF_OK;
+}
+
+
+int
+pth_seql_wrunlock (pth_seqlock_t *sl) {
+	if (sl == (pth_seqlock_t *)NULL) {
+		return CAF_ERROR;
+	}
+	__atomic_fetch_add (&(sl->seq), 1, __ATOMIC_RELEASE);
+	return CAF_OK;
+}
+
+
+int
+pth_seql_read (pth_seqlock_t *sl, void *dst, const void *src, size_t sz) {
+	int s;
+	if (sl == (pth_seqlock_t *)NULL || dst == (void *)NULL
+		|| src == (const void *)NULL) {
+		return CAF_ERROR;
+	}
+	do {
+		s = pth_seql_read_begin (sl);
+		pth_seql_copy (dst, src, sz);
+	} while (pth_seql_read_retry (sl, s));
+	return CAF_OK;
+}
+
+
+int
+pth_seql_write (pth_seqlock_t *sl, void *dst, const void *src, size_t sz) {
+	if (dst == (void *)NULL || src == (const void *)NULL
+		|| pth_seql_wrlock (sl) != CAF_OK) {
+		return CAF_ERROR;
+	}
+	pth_seql_copy (dst, src, sz);
+	return pth_seql_wrunlock (sl);
+}
+
+
+static void
+pth_seql_pause (pth_seqlock_t *sl, int *cnt) {
+	/* writers are short, yield only when the writer may be preempted */
+	if (*cnt < sl->spin_max) {
+		CAF_PTH_RELAX ();
+		(*cnt)++;
+	} else {
+		sched_yield ();
+	}
+}
+
+
+static void
+pth_seql_copy (void *dst, const void *src, size_t sz) {
+	unsigned char *d = (unsigned char *)dst;
+	const unsigned char *s = (const unsigned char *)src;
+	size_t i = 0;
+	if (((size_t)d % sizeof (long)) == 0 && ((size_t)s % sizeof (long)) == 0) {
+		for (; i + sizeof (long) <= sz; i += sizeof (long)) {
+			__atomic_store_n ((long *)(d + i),
+							  __atomic_load_n ((const long *)(s + i),
+											   __ATOMIC_RELAXED),
+							  __ATOMIC_RELAXED);
+		}
+	}
+	for (; i < sz; i++) {
+		__atomic_store_n (d + i, __atomic_load_n (s + i, __ATOMIC_RELAXED),
+						  __ATOMIC_RELAXED);
+	}
+}
+
+/* caf_thread_seqlock.c ends here */
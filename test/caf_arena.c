@@ -0,0 +1,270 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_buffer.h>
+#include <caf/caf_data_packer.h>
+
+
+#define CYCLES              20000
+
+static const char request[] =
+	"GET /catalog/items?id=42&view=full HTTP/1.1\r\n"
+	"Host: shop.example.com\r\n"
+	"User-Agent: caf-bench/1.0\r\n"
+	"Accept: text/html,application/xhtml+xml\r\n"
+	"Accept-Language: en-US,en;q=0.5\r\n"
+	"Accept-Encoding: gzip, deflate\r\n"
+	"Connection: keep-alive\r\n"
+	"Cookie: session=4f2a9c; theme=dark; cart=3\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"X-Request-Id: 7b1e0c55-2f3d-4a7e-9d1b\r\n"
+	"X-Forwarded-For: 10.0.0.17\r\n"
+	"Referer: http://shop.example.com/catalog\r\n"
+	"\r\n";
+
+static const char status[] = "HTTP/1.1 200 OK\r\n";
+
+int value_delete_cb (void *p);
+static double elapsed_ns (struct timespec *t0);
+static size_t respond (caf_arena_t *arena);
+static int check_arena (void);
+static int check_containers (void);
+static double run_cycles (caf_arena_t *arena, size_t *out);
+
+
+int
+main () {
+	caf_arena_t *arena;
+	size_t heap_out = 0, arena_out = 0;
+	double heap_ns, arena_ns;
+	int errors;
+	errors = check_arena ();
+	errors += check_containers ();
+	arena = caf_arena_new (0);
+	heap_ns = run_cycles ((caf_arena_t *)NULL, &heap_out);
+	arena_ns = run_cycles (arena, &arena_out);
+	printf ("parse and respond, ns per request\n");
+	printf ("%8s %10.1f\n", "heap", heap_ns);
+	printf ("%8s %10.1f (%lu blocks)\n", "arena", arena_ns,
+			(unsigned long)arena->blocks);
+	/* both paths build the same response */
+	if (heap_out != arena_out || heap_out == 0) {
+		printf ("response mismatch: %lu != %lu\n", (unsigned long)heap_out,
+				(unsigned long)arena_out);
+		errors++;
+	}
+	caf_arena_delete (arena);
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+int
+value_delete_cb (void *p) {
+	return caf_unit_value_delete ((caf_unit_value_t *)p);
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+static int
+check_arena (void) {
+	caf_arena_t *a = caf_arena_new (256);
+	char *p, *q, *big;
+	size_t blocks;
+	int bad = 0, i;
+	bad += caf_arena_alloc (a, 0) != (void *)NULL;
+	p = (char *)caf_arena_alloc (a, 3);
+	q = (char *)caf_arena_alloc (a, 5);
+	bad += ((size_t)p % CAF_ARENA_ALIGN) != 0;
+	bad += ((size_t)q % CAF_ARENA_ALIGN) != 0;
+	bad += q - p != CAF_ARENA_ALIGN;
+	/* the last allocation grows in place, others move */
+	memcpy (q, "abcd", 5);
+	bad += caf_arena_realloc (a, q, 5, 40) != q;
+	p = (char *)caf_arena_realloc (a, p, 3, 40);
+	bad += p == q || p == (char *)NULL;
+	bad += strcmp (q, "abcd") != 0;
+	/* oversized allocations keep the current block */
+	q = (char *)caf_arena_alloc (a, 8);
+	big = (char *)caf_arena_alloc (a, 1000);
+	bad += big == (char *)NULL;
+	bad += (char *)caf_arena_alloc (a, 8) != q + CAF_ARENA_ALIGN;
+	q += CAF_ARENA_ALIGN;
+	/* sizes that wrap once rounded or given a header are refused */
+	bad += caf_arena_alloc (a, (size_t)-1) != (void *)NULL;
+	bad += caf_arena_alloc (a, (size_t)-1 - CAF_ARENA_ALIGN) != (void *)NULL;
+	bad += caf_arena_realloc (a, q, 8, (size_t)-1 - 2 * CAF_ARENA_ALIGN)
+		!= (void *)NULL;
+	bad += caf_arena_new ((size_t)-1) != (caf_arena_t *)NULL;
+	caf_arena_reset (a);
+	bad += a->used != 0;
+	/* a reset arena serves the same pattern without new blocks */
+	for (i = 0; i < 20; i++) {
+		caf_arena_alloc (a, 100);
+	}
+	caf_arena_reset (a);
+	blocks = a->blocks;
+	for (i = 0; i < 20; i++) {
+		caf_arena_alloc (a, 100);
+	}
+	bad += a->blocks != blocks;
+	bad += caf_arena_delete (a) != CAF_OK;
+	bad += caf_arena_delete ((caf_arena_t *)NULL) != CAF_ERROR;
+	if (bad != 0) {
+		printf ("arena check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_containers (void) {
+	caf_arena_t *a = caf_arena_new (0);
+	cbuffer_t *b, *e;
+	caf_unit_value_t *v;
+	caf_dequen_t *n;
+	deque_t *l;
+	int bad = 0;
+	b = cbuf_create_arena (a, 4);
+	bad += b == (cbuffer_t *)NULL || b->arena != a;
+	bad += cbuf_import (b, "hello world", 11) != 11;
+	bad += memcmp (b->data, "hello world", 11) != 0;
+	e = cbuf_extract (b, 6, 11);
+	bad += e == (cbuffer_t *)NULL || e->arena != a;
+	bad += e->sz != 5 || memcmp (e->data, "world", 5) != 0;
+	l = cbuf_split (b, " ", 1);
+	bad += l == (deque_t *)NULL || l->arena != a || deque_length (l) != 2;
+	deque_delete (l, cbuf_delete_callback);
+	cbuf_delete (e);
+	cbuf_delete (b);
+	l = deque_create_arena (a);
+	v = caf_unit_value_new_arena (a, CAF_UNIT_STRING, 5, "value");
+	bad += v == (caf_unit_value_t *)NULL || v->arena != a;
+	bad += memcmp (v->data, "value", 5) != 0;
+	deque_push (l, v);
+	deque_push (l, v);
+	n = deque_pop (l);
+	deque_node_release (l, n);
+	bad += deque_length (l) != 1;
+	deque_delete (l, value_delete_cb);
+	v = caf_unit_value_new (CAF_UNIT_STRING, 5, "value");
+	bad += v == (caf_unit_value_t *)NULL || memcmp (v->data, "value", 5);
+	caf_unit_value_delete (v);
+	caf_arena_delete (a);
+	if (bad != 0) {
+		printf ("arena container check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+/* splits the request in lines, keeps each header as a unit value and
+   echoes them back after a status line */
+static size_t
+respond (caf_arena_t *arena) {
+	cbuffer_t *req, *resp, *line;
+	caf_unit_value_t *v;
+	caf_dequen_t *n;
+	deque_t *lines, *values;
+	size_t total = sizeof (status) - 1, pos;
+	if (arena != (caf_arena_t *)NULL) {
+		req = cbuf_new_arena (arena);
+		values = deque_create_arena (arena);
+	} else {
+		req = cbuf_new ();
+		values = deque_create ();
+	}
+	cbuf_import (req, request, sizeof (request) - 1);
+	lines = cbuf_split (req, "\r\n", 2);
+	for (n = lines->head; n != (caf_dequen_t *)NULL; n = n->next) {
+		line = (cbuffer_t *)n->data;
+		if (line->sz == 0) {
+			continue;
+		}
+		if (arena != (caf_arena_t *)NULL) {
+			v = caf_unit_value_new_arena (arena, CAF_UNIT_STRING, line->sz,
+										  line->data);
+		} else {
+			v = caf_unit_value_new (CAF_UNIT_STRING, line->sz, line->data);
+		}
+		deque_push (values, v);
+		total += v->sz + 2;
+	}
+	if (arena != (caf_arena_t *)NULL) {
+		resp = cbuf_create_arena (arena, total);
+	} else {
+		resp = cbuf_create (total);
+	}
+	memcpy (resp->data, status, sizeof (status) - 1);
+	pos = sizeof (status) - 1;
+	for (n = values->head; n != (caf_dequen_t *)NULL; n = n->next) {
+		v = (caf_unit_value_t *)n->data;
+		memcpy ((char *)resp->data + pos, v->data, v->sz);
+		memcpy ((char *)resp->data + pos + v->sz, "\r\n", 2);
+		pos += v->sz + 2;
+	}
+	if (arena != (caf_arena_t *)NULL) {
+		caf_arena_reset (arena);
+	} else {
+		deque_delete (lines, cbuf_delete_callback);
+		deque_delete (values, value_delete_cb);
+		cbuf_delete (resp);
+		cbuf_delete (req);
+	}
+	return pos;
+}
+
+
+static double
+run_cycles (caf_arena_t *arena, size_t *out) {
+	struct timespec t0;
+	int i;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < CYCLES; i++) {
+		*out = respond (arena);
+	}
+	return elapsed_ns (&t0) / CYCLES;
+}
+
+/* caf_arena.c ends here */
@@ -0,0 +1,331 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_buffer.h>
+#include <caf/caf_data_chain.h>
+#include <caf/caf_io_file.h>
+#include <caf/caf_io_net.h>
+
+
+#define SEGMENTS            100
+#define ROUNDS              20000
+
+static double elapsed_ns (struct timespec *t0);
+static cbuffer_t *make_buffer (const char *s);
+static int check_chain (void);
+static int check_grow (void);
+static int check_io (void);
+static int check_net (void);
+static int check_fail (void);
+static double run_join (caf_io_file_t *out, cbuffer_t **parts);
+static double run_chain (caf_io_file_t *out, cbuffer_t **parts);
+
+
+int
+main () {
+	static const size_t bodies[] = { 512, 4096, 65536 };
+	cbuffer_t *parts[3];
+	caf_io_file_t out;
+	double join_ns, chain_ns;
+	int errors, i;
+	errors = check_chain ();
+	errors += check_grow ();
+	errors += check_io ();
+	errors += check_net ();
+	errors += check_fail ();
+	memset (&out, 0, sizeof (out));
+	out.fd = open ("/dev/null", O_WRONLY);
+	parts[0] = cbuf_create (220);
+	parts[2] = cbuf_create (48);
+	memset (parts[0]->data, 'h', parts[0]->sz);
+	memset (parts[2]->data, 't', parts[2]->sz);
+	printf ("header, body and trailer to /dev/null, ns per response\n");
+	printf ("%8s %10s %10s\n", "body", "cbuf_join", "chain");
+	for (i = 0; i < (int)(sizeof (bodies) / sizeof (bodies[0])); i++) {
+		parts[1] = cbuf_create (bodies[i]);
+		memset (parts[1]->data, 'b', parts[1]->sz);
+		join_ns = run_join (&out, parts);
+		chain_ns = run_chain (&out, parts);
+		printf ("%8lu %10.1f %10.1f\n", (unsigned long)bodies[i], join_ns,
+				chain_ns);
+		cbuf_delete (parts[1]);
+	}
+	cbuf_delete (parts[0]);
+	cbuf_delete (parts[2]);
+	close (out.fd);
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+static cbuffer_t *
+make_buffer (const char *s) {
+	cbuffer_t *b = cbuf_new ();
+	cbuf_import (b, s, strlen (s));
+	return b;
+}
+
+
+static int
+check_chain (void) {
+	cbuf_chain_t *ch = cbuf_chain_new ();
+	cbuffer_t *flat;
+	struct iovec *iov;
+	int bad = 0, cnt = 0;
+	bad += cbuf_chain_iov (ch, &cnt) != (struct iovec *)NULL || cnt != 0;
+	cbuf_chain_append (ch, make_buffer ("body"));
+	cbuf_chain_append (ch, make_buffer ("trailer"));
+	cbuf_chain_prepend (ch, make_buffer ("head-"));
+	bad += cbuf_chain_length (ch) != 16;
+	iov = cbuf_chain_iov (ch, &cnt);
+	bad += cnt != 3 || iov[0].iov_len != 5 || iov[2].iov_len != 7;
+	bad += memcmp (iov[0].iov_base, "head-", 5) != 0;
+	flat = cbuf_chain_flatten (ch);
+	bad += flat == (cbuffer_t *)NULL || flat->sz != 16
+		|| memcmp (flat->data, "head-bodytrailer", 16) != 0;
+	cbuf_delete (flat);
+	/* consuming releases whole segments and advances into the next */
+	bad += cbuf_chain_consume (ch, 7) != 7;
+	iov = cbuf_chain_iov (ch, &cnt);
+	bad += cnt != 2 || iov[0].iov_len != 2
+		|| memcmp (iov[0].iov_base, "dy", 2) != 0;
+	bad += cbuf_chain_length (ch) != 9;
+	bad += cbuf_chain_consume (ch, 100) != 9;
+	bad += cbuf_chain_length (ch) != 0;
+	bad += cbuf_chain_iov (ch, &cnt) != (struct iovec *)NULL || cnt != 0;
+	cbuf_chain_delete (ch);
+	if (bad != 0) {
+		printf ("check_chain: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_grow (void) {
+	cbuf_chain_t *ch = cbuf_chain_new ();
+	cbuffer_t *src = make_buffer ("0123456789");
+	struct iovec *iov;
+	int bad = 0, cnt = 0, i;
+	/* slices add shared data without copying */
+	for (i = 0; i < SEGMENTS; i++) {
+		cbuf_chain_append (ch, cbuf_slice (src, 5, 10));
+		cbuf_chain_prepend (ch, cbuf_slice (src, 0, 5));
+	}
+	bad += cbuf_chain_length (ch) != SEGMENTS * 10;
+	iov = cbuf_chain_iov (ch, &cnt);
+	bad += cnt != SEGMENTS * 2;
+	for (i = 0; i < cnt; i++) {
+		bad += iov[i].iov_base != (void *)((size_t)src->data
+										   + (i < SEGMENTS ? 0 : 5));
+	}
+	bad += src->store == (cbuf_store_t *)NULL
+		|| src->store->refs != SEGMENTS * 2 + 1;
+	cbuf_chain_delete (ch);
+	bad += src->store->refs != 1;
+	cbuf_delete (src);
+	if (bad != 0) {
+		printf ("check_grow: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_io (void) {
+	caf_io_file_t in, out;
+	cbuf_chain_t *ch = cbuf_chain_new ();
+	cbuffer_t *flat;
+	int bad = 0, fd[2];
+	if (pipe (fd) != 0) {
+		return 1;
+	}
+	memset (&in, 0, sizeof (in));
+	memset (&out, 0, sizeof (out));
+	in.fd = fd[0];
+	out.fd = fd[1];
+	cbuf_chain_append (ch, make_buffer ("GET / HTTP/1.0\r\n"));
+	cbuf_chain_append (ch, make_buffer ("\r\n"));
+	bad += io_writev (&out, ch) != 18;
+	bad += cbuf_chain_length (ch) != 0;
+	/* reads fill the segments in order */
+	cbuf_chain_append (ch, cbuf_create (4));
+	cbuf_chain_append (ch, cbuf_create (32));
+	bad += io_readv (&in, ch) != 18;
+	bad += cbuf_chain_length (ch) != 18;
+	flat = cbuf_chain_flatten (ch);
+	bad += flat == (cbuffer_t *)NULL
+		|| memcmp (flat->data, "GET / HTTP/1.0\r\n\r\n", 18) != 0;
+	bad += ch->segs[ch->first]->iosz != 4;
+	cbuf_delete (flat);
+	cbuf_chain_delete (ch);
+	close (fd[0]);
+	close (fd[1]);
+	if (bad != 0) {
+		printf ("check_io: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_net (void) {
+	caf_conn_t *a, *b;
+	cbuf_chain_t *ch = cbuf_chain_new ();
+	cbuffer_t *flat;
+	int bad = 0, sv[2];
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		return 1;
+	}
+	a = caf_conn_new (sv[0], CAF_CONN_OUTGOING, 1, NULL, NULL);
+	b = caf_conn_new (sv[1], CAF_CONN_INCOMING, 1, NULL, NULL);
+	cbuf_chain_append (ch, make_buffer ("hello "));
+	cbuf_chain_append (ch, make_buffer ("world"));
+	bad += caf_conn_sendv (a, ch, 0) != 11;
+	bad += cbuf_chain_length (ch) != 0;
+	cbuf_chain_append (ch, cbuf_create (6));
+	cbuf_chain_append (ch, cbuf_create (6));
+	bad += caf_conn_recvv (b, ch, 0) != 11;
+	flat = cbuf_chain_flatten (ch);
+	bad += flat == (cbuffer_t *)NULL || flat->sz != 11
+		|| memcmp (flat->data, "hello world", 11) != 0;
+	cbuf_delete (flat);
+	cbuf_chain_delete (ch);
+	caf_conn_delete (a);
+	caf_conn_delete (b);
+	close (sv[0]);
+	close (sv[1]);
+	if (bad != 0) {
+		printf ("check_net: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_fail (void) {
+	caf_io_file_t in, out;
+	cbuf_chain_t *ch = cbuf_chain_new ();
+	cbuffer_t *src, *s;
+	size_t sz;
+	int bad = 0, cnt = 0, fd[2];
+	if (pipe (fd) != 0) {
+		return 1;
+	}
+	memset (&in, 0, sizeof (in));
+	memset (&out, 0, sizeof (out));
+	in.fd = fd[0];
+	out.fd = fd[1];
+	/* a shared segment too large to copy fails instead of reading 0 */
+	src = make_buffer ("shared");
+	s = cbuf_slice (src, 0, 6);
+	cbuf_chain_append (ch, s);
+	sz = s->sz;
+	s->sz = (size_t)-1 / 2;
+	bad += cbuf_chain_iov_in (ch, &cnt) != (struct iovec *)NULL || cnt != -1;
+	bad += io_readv (&in, ch) != -1;
+	s->sz = sz;
+	cbuf_chain_delete (ch);
+	cbuf_delete (src);
+	/* a failed read keeps what the segments already hold */
+	ch = cbuf_chain_new ();
+	cbuf_chain_append (ch, cbuf_create (8));
+	bad += write (fd[1], "abcd", 4) != 4;
+	bad += io_readv (&in, ch) != 4;
+	bad += io_readv (&out, ch) != -1;
+	bad += cbuf_chain_length (ch) != 4 || ch->segs[ch->first]->iosz != 4;
+	cbuf_chain_delete (ch);
+	close (fd[0]);
+	close (fd[1]);
+	if (bad != 0) {
+		printf ("check_fail: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run_join (caf_io_file_t *out, cbuffer_t **parts) {
+	struct timespec t0;
+	cbuffer_t *r;
+	deque_t *lst;
+	int i;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ROUNDS; i++) {
+		lst = deque_create ();
+		deque_push (lst, parts[0]);
+		deque_push (lst, parts[1]);
+		deque_push (lst, parts[2]);
+		r = cbuf_join (lst);
+		io_write (out, r);
+		cbuf_delete (r);
+		deque_delete_nocb (lst);
+	}
+	return elapsed_ns (&t0) / ROUNDS;
+}
+
+
+static double
+run_chain (caf_io_file_t *out, cbuffer_t **parts) {
+	struct timespec t0;
+	cbuf_chain_t *ch;
+	int i, j;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ROUNDS; i++) {
+		ch = cbuf_chain_new ();
+		for (j = 0; j < 3; j++) {
+			cbuf_chain_append (ch, cbuf_slice (parts[j], 0, parts[j]->sz));
+		}
+		io_writev (out, ch);
+		cbuf_chain_delete (ch);
+	}
+	return elapsed_ns (&t0) / ROUNDS;
+}
+
+/* caf_chain.c ends here */
@@ -0,0 +1,330 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef LINUX_SYSTEM
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif /* !LINUX_SYSTEM */
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_cpu.h>
+#include <caf/caf_thread_pool.h>
+
+
+#define BUF_SZ              (8 * 1024 * 1024)
+#define BUF_PASSES          16
+#define MAX_WORKERS         64
+
+typedef enum {
+	MODE_SHARED = 0,
+	MODE_LOCAL
+} mode_t_;
+
+static const char *mode_names[] = {
+	"unpinned, main thread memory", "scatter pinned, local memory"
+};
+
+typedef struct bench_s bench_t;
+struct bench_s {
+	mode_t_ mode;
+	int next;
+	char *bufs[MAX_WORKERS];
+	int nodes[MAX_WORKERS];
+	int migrations[MAX_WORKERS];
+	long long misses[MAX_WORKERS];
+};
+
+typedef struct where_s where_t;
+struct where_s {
+	int cpu;
+	char name[CAF_PTH_NAME_LEN];
+};
+
+void *where_rtn (void *p);
+void *bench_rtn (void *p);
+static int check (void);
+static double run (mode_t_ mode, int workers, bench_t *b);
+static int misses_open (void);
+static long long misses_read (int fd);
+
+
+int
+main () {
+	bench_t b;
+	double secs;
+	long long misses;
+	int errors, m, i, workers, migrations;
+	errors = check ();
+	workers = (int)sysconf (_SC_NPROCESSORS_ONLN);
+	workers = workers < 1 ? 1 : (workers > MAX_WORKERS ? MAX_WORKERS
+								 : workers);
+	printf ("%-30s %8s %10s %10s %14s\n", "placement", "workers", "GB/s",
+			"migrated", "cache misses");
+	for (m = MODE_SHARED; m <= MODE_LOCAL; m++) {
+		secs = run ((mode_t_)m, workers, &b);
+		if (secs < 0) {
+			errors++;
+			continue;
+		}
+		misses = 0;
+		migrations = 0;
+		for (i = 0; i < workers; i++) {
+			misses = b.misses[i] < 0 || misses < 0 ? -1 : misses + b.misses[i];
+			migrations += b.migrations[i];
+		}
+		printf ("%-30s %8d %10.2f %10d ", mode_names[m], workers,
+				(double)BUF_SZ * BUF_PASSES * workers / secs / 1e9,
+				migrations);
+		if (misses < 0) {
+			printf ("%14s\n", "n/a");
+		} else {
+			printf ("%14lld\n", misses);
+		}
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+/* records where the thread runs and its name */
+void *
+where_rtn (void *p) {
+	struct timespec ms = { 0, 1000000 };
+	where_t *w = (where_t *)p;
+	int i;
+	w->cpu = pth_cpu_current ();
+	w->name[0] = '\0';
+#ifdef LINUX_SYSTEM
+	/* the pool names the thread after it starts */
+	for (i = 0; i < 1000; i++) {
+		pthread_getname_np (pthread_self (), w->name, sizeof (w->name));
+		if (strcmp (w->name, "caf-cpu-check/0") == 0) {
+			break;
+		}
+		nanosleep (&ms, (struct timespec *)NULL);
+	}
+#else /* !LINUX_SYSTEM */
+	(void)i;
+	(void)ms;
+#endif /* !LINUX_SYSTEM */
+	return (void *)NULL;
+}
+
+
+/* read-modify-write passes over a private buffer */
+void *
+bench_rtn (void *p) {
+	bench_t *b = (bench_t *)p;
+	volatile long *v;
+	long long m0;
+	int i, j, w, fd, cpu, last;
+	w = __atomic_fetch_add (&(b->next), 1, __ATOMIC_RELAXED);
+	if (b->mode == MODE_LOCAL) {
+		b->bufs[w] = (char *)pth_cpu_local_alloc (BUF_SZ);
+		pth_cpu_local_touch (b->bufs[w], BUF_SZ);
+	}
+	v = (volatile long *)b->bufs[w];
+	fd = misses_open ();
+	m0 = misses_read (fd);
+	last = pth_cpu_current ();
+	b->nodes[w] = pth_cpu_node (last);
+	b->migrations[w] = 0;
+	for (i = 0; i < BUF_PASSES; i++) {
+		for (j = 0; j < (int)(BUF_SZ / sizeof (long)); j += 8) {
+			v[j] += j;
+		}
+		cpu = pth_cpu_current ();
+		b->migrations[w] += cpu != last;
+		last = cpu;
+	}
+	b->misses[w] = m0 < 0 ? -1 : misses_read (fd) - m0;
+	if (fd >= 0) {
+		close (fd);
+	}
+	return (void *)NULL;
+}
+
+
+static int
+check (void) {
+	static const int list[] = { 0, 0 };
+	pth_cpuset_t *compact, *scatter, *lst;
+	pth_attri_t *attri;
+	pth_pool_t *pool;
+	char name[CAF_PTH_NAME_LEN];
+	where_t where;
+	int i, j, found, bad = 0;
+#ifdef LINUX_SYSTEM
+	cpu_set_t mine, after;
+#endif /* !LINUX_SYSTEM */
+	compact = pth_cpuset_new (PTH_CPU_COMPACT, (const int *)NULL, 0);
+	scatter = pth_cpuset_new (PTH_CPU_SCATTER, (const int *)NULL, 0);
+	lst = pth_cpuset_new (PTH_CPU_LIST, list, 2);
+	if (compact == (pth_cpuset_t *)NULL || scatter == (pth_cpuset_t *)NULL
+		|| lst == (pth_cpuset_t *)NULL) {
+		printf ("cannot create cpu sets\n");
+		return 1;
+	}
+	/* both policies order the same allowed CPUs */
+	bad += compact->count != scatter->count || compact->count < 1;
+	for (i = 0; i < compact->count && bad == 0; i++) {
+		bad += compact->nodes[i] != pth_cpu_node (compact->cpus[i]);
+		if (i > 0) {
+			bad += compact->nodes[i] < compact->nodes[i - 1];
+		}
+		/* workers past the set size wrap around */
+		bad += pth_cpuset_cpu (compact, i + compact->count)
+			!= compact->cpus[i];
+		found = 0;
+		for (j = 0; j < scatter->count; j++) {
+			found += scatter->cpus[j] == compact->cpus[i];
+		}
+		bad += found != 1;
+	}
+	bad += pth_cpuset_cpu (lst, 1) != 0 || pth_cpuset_cpu (lst, -1) != -1;
+	bad += pth_cpuset_cpu ((pth_cpuset_t *)NULL, 0) != -1;
+	/* a pinned and named pool thread */
+	attri = pth_attri_init ();
+	pth_attri_set (attri, PTH_ATTR_JOINABLE, (void *)NULL);
+	pth_attri_set (attri, PTH_ATTR_AFFINITY, (void *)lst);
+	pth_attri_set (attri, PTH_ATTR_NAME, (void *)"caf-cpu-check");
+	pth_attri_get (attri, PTH_ATTR_NAME, (void *)name);
+	bad += strcmp (name, "caf-cpu-check") != 0;
+#ifdef LINUX_SYSTEM
+	/* pinning must leave the mask the caller set on the attributes */
+	CPU_ZERO (&mine);
+	CPU_SET (0, &mine);
+	CPU_SET (CPU_SETSIZE - 1, &mine);
+	pthread_attr_setaffinity_np (&(attri->attr), sizeof (cpu_set_t), &mine);
+#endif /* !LINUX_SYSTEM */
+	pool = pth_pool_create (attri, where_rtn, 1, &where);
+	if (pool == (pth_pool_t *)NULL) {
+		bad++;
+	} else {
+		pth_pool_join (pool);
+		pth_pool_delete (pool);
+#ifdef LINUX_SYSTEM
+		bad += where.cpu != 0 || strcmp (where.name, "caf-cpu-check/0") != 0;
+		CPU_ZERO (&after);
+		pthread_attr_getaffinity_np (&(attri->attr), sizeof (cpu_set_t),
+									 &after);
+		bad += !CPU_EQUAL (&mine, &after);
+#endif /* !LINUX_SYSTEM */
+	}
+	pth_attri_destroy (attri);
+	pth_cpuset_delete (compact);
+	pth_cpuset_delete (scatter);
+	pth_cpuset_delete (lst);
+	if (bad != 0) {
+		printf ("cpu check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run (mode_t_ mode, int workers, bench_t *b) {
+	struct timespec t0, t1;
+	pth_cpuset_t *set = (pth_cpuset_t *)NULL;
+	pth_attri_t *attri;
+	pth_pool_t *pool;
+	int i;
+	memset (b, 0, sizeof (bench_t));
+	b->mode = mode;
+	attri = pth_attri_init ();
+	pth_attri_set (attri, PTH_ATTR_JOINABLE, (void *)NULL);
+	pth_attri_set (attri, PTH_ATTR_NAME, (void *)"caf-cpu");
+	if (mode == MODE_LOCAL) {
+		set = pth_cpuset_new (PTH_CPU_SCATTER, (const int *)NULL, 0);
+		pth_attri_set (attri, PTH_ATTR_AFFINITY, (void *)set);
+	} else {
+		/* every page lands on the node of the main thread */
+		for (i = 0; i < workers; i++) {
+			b->bufs[i] = (char *)malloc (BUF_SZ);
+			memset (b->bufs[i], 0, BUF_SZ);
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	pool = pth_pool_create (attri, bench_rtn, workers, b);
+	if (pool == (pth_pool_t *)NULL) {
+		return -1.0;
+	}
+	pth_pool_join (pool);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_pool_delete (pool);
+	for (i = 0; i < workers; i++) {
+		if (mode == MODE_LOCAL) {
+			pth_cpu_local_free (b->bufs[i], BUF_SZ);
+		} else {
+			free (b->bufs[i]);
+		}
+	}
+	pth_attri_destroy (attri);
+	pth_cpuset_delete (set);
+	return (double)(t1.tv_sec - t0.tv_sec)
+		+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+
+/* last level cache misses of the calling thread, -1 when not available */
+static int
+misses_open (void) {
+#if defined(LINUX_SYSTEM) && defined(SYS_perf_event_open)
+	struct perf_event_attr pe;
+	memset (&pe, 0, sizeof (pe));
+	pe.type = PERF_TYPE_HARDWARE;
+	pe.size = sizeof (pe);
+	pe.config = PERF_COUNT_HW_CACHE_MISSES;
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+	return (int)syscall (SYS_perf_event_open, &pe, 0, -1, -1, 0);
+#else /* !LINUX_SYSTEM || !SYS_perf_event_open */
+	return -1;
+#endif /* !LINUX_SYSTEM || !SYS_perf_event_open */
+}
+
+
+static long long
+misses_read (int fd) {
+	long long v;
+	if (fd < 0 || read (fd, &v, sizeof (v)) != (ssize_t)sizeof (v)) {
+		return -1;
+	}
+	return v;
+}
+
+/* caf_cpu.c ends here */
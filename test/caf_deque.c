@@ -122,21 +122,21 @@ test_pop (void) {
 		printf ("pops: %s\n", (char *)n->data);
 		printf ("list length: %d\n", deque_length (lst));
 		xfree (n->data);
-		xfree (n);
+		deque_node_release (lst, n);
 	}
 	n = deque_pop (lst);
 	if (n != (caf_dequen_t *)NULL) {
 		printf ("pops: %s\n", (char *)n->data);
 		printf ("list length: %d\n", deque_length (lst));
 		xfree (n->data);
-		xfree (n);
+		deque_node_release (lst, n);
 	}
 	n = deque_pop (lst);
 	if (n != (caf_dequen_t *)NULL) {
 		printf ("pops: %s\n", (char *)n->data);
 		printf ("list length: %d\n", deque_length (lst));
 		xfree (n->data);
-		xfree (n);
+		deque_node_release (lst, n);
 	}
 	deque_dump (stdout, lst, deque_dump_str_cb);
 	printf ("list length: %d\n", deque_length (lst));
@@ -0,0 +1,217 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_pool.h>
+#include <caf/caf_thread_epool.h>
+
+
+#define BURSTS              10
+#define BURST_TASKS         64
+#define BURST_GAP_MS        50
+#define TASK_MS             1
+
+typedef struct config_s config_t;
+struct config_s {
+	const char *name;
+	int min;
+	int max;
+	long idle_us;
+	long age_us;
+};
+
+static const config_t configs[] = {
+	{ "fixed 2", 2, 2, 0, 0 },
+	{ "fixed 16", 16, 16, 0, 0 },
+	/* retires between bursts, see the grows and retires counters */
+	{ "elastic 20ms", 2, 16, 20000, 1000 },
+	{ "elastic 200ms", 2, 16, 200000, 1000 }
+};
+
+static long done;
+static pth_epool_t *gep;
+
+void *sleep_task (void *p);
+void *count_task (void *p);
+void *spawn_task (void *p);
+static void sleep_ms (long ms);
+static int check (void);
+static int run (const config_t *c);
+
+
+int
+main () {
+	int errors, i;
+	errors = check ();
+	printf ("%-14s %8s %10s %10s %6s %6s %8s %8s\n", "pool", "seconds",
+			"wait avg", "wait max", "peak", "final", "grows", "retires");
+	for (i = 0; i < (int)(sizeof (configs) / sizeof (config_t)); i++) {
+		errors += run (&(configs[i]));
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static void
+sleep_ms (long ms) {
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep (&ts, (struct timespec *)NULL);
+}
+
+
+/* stands for a blocking call */
+void *
+sleep_task (void *p) {
+	sleep_ms ((long)p);
+	__atomic_add_fetch (&done, 1, __ATOMIC_RELAXED);
+	return (void *)NULL;
+}
+
+
+void *
+count_task (void *p) {
+	(void)p;
+	__atomic_add_fetch (&done, 1, __ATOMIC_RELAXED);
+	return (void *)NULL;
+}
+
+
+void *
+spawn_task (void *p) {
+	pth_epool_submit (gep, count_task, p);
+	return count_task (p);
+}
+
+
+static int
+check (void) {
+	pth_epool_stats_t st;
+	pth_attri_t *attrs;
+	int i, bad = 0, ds = -1;
+	/* a backlog older than the growth age adds workers up to max */
+	gep = pth_epool_new ((pth_attri_t *)NULL, 1, 4, 50000, 500);
+	if (gep == (pth_epool_t *)NULL) {
+		printf ("cannot create pool\n");
+		return 1;
+	}
+	done = 0;
+	for (i = 0; i < 100; i++) {
+		pth_epool_submit (gep, sleep_task, (void *)2L);
+	}
+	pth_epool_wait (gep, (struct timespec *)NULL);
+	pth_epool_stats (gep, &st);
+	bad += done != 100 || st.runs != 100 || st.backlog != 0;
+	bad += st.peak != 4 || st.grows != 3 || st.workers > 4;
+	/* idle workers retire down to min */
+	sleep_ms (300);
+	pth_epool_stats (gep, &st);
+	bad += st.workers != 1 || st.retires != 3 || st.idle != 1;
+	pth_epool_delete (gep);
+	/* an empty pool starts a worker on demand */
+	attrs = pth_attri_init ();
+	pth_attri_set (attrs, PTH_ATTR_DETACHED, (void *)NULL);
+	gep = pth_epool_new (attrs, 0, 2, 20000, -1);
+	if (gep == (pth_epool_t *)NULL) {
+		printf ("cannot create pool\n");
+		pth_attri_destroy (attrs);
+		return bad + 1;
+	}
+	/* the caller's attributes stay detached */
+	pth_attri_get (attrs, PTH_ATTR_DETACHED, &ds);
+	bad += ds != PTHREAD_CREATE_DETACHED;
+	done = 0;
+	pth_epool_submit (gep, count_task, (void *)NULL);
+	pth_epool_wait (gep, (struct timespec *)NULL);
+	sleep_ms (100);
+	pth_epool_stats (gep, &st);
+	bad += done != 1 || st.workers != 0 || st.retires != 1;
+	pth_epool_submit (gep, count_task, (void *)NULL);
+	pth_epool_wait (gep, (struct timespec *)NULL);
+	bad += done != 2;
+	/* deletion runs what is queued, including tasks from tasks */
+	for (i = 0; i < 10; i++) {
+		pth_epool_submit (gep, spawn_task, (void *)NULL);
+	}
+	pth_epool_delete (gep);
+	pth_attri_destroy (attrs);
+	bad += done != 22;
+	if (bad != 0) {
+		printf ("elastic pool check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+run (const config_t *c) {
+	struct timespec t0, t1;
+	pth_epool_stats_t st;
+	pth_epool_t *ep;
+	int b, i;
+	ep = pth_epool_new ((pth_attri_t *)NULL, c->min, c->max, c->idle_us,
+						c->age_us);
+	if (ep == (pth_epool_t *)NULL) {
+		printf ("%s: cannot create pool\n", c->name);
+		return 1;
+	}
+	done = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (b = 0; b < BURSTS; b++) {
+		for (i = 0; i < BURST_TASKS; i++) {
+			pth_epool_submit (ep, sleep_task, (void *)(long)TASK_MS);
+		}
+		sleep_ms (BURST_GAP_MS);
+	}
+	pth_epool_wait (ep, (struct timespec *)NULL);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_epool_stats (ep, &st);
+	pth_epool_delete (ep);
+	printf ("%-14s %8.3f %8.2fms %8.2fms %6d %6d %8ld %8ld\n", c->name,
+			(double)(t1.tv_sec - t0.tv_sec)
+			+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9,
+			(double)st.wait_ns / (double)st.runs / 1e6,
+			(double)st.wait_max_ns / 1e6, st.peak, st.workers,
+			st.grows, st.retires);
+	if (done != BURSTS * BURST_TASKS) {
+		printf ("%s: %ld tasks done\n", c->name, done);
+		return 1;
+	}
+	return 0;
+}
+
+/* caf_epool.c ends here */
@@ -0,0 +1,389 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_pool.h>
+#include <caf/caf_thread_mutex.h>
+#include <caf/caf_thread_cond.h>
+#include <caf/caf_thread_exec.h>
+
+
+#define EXEC_TASKS          200000
+#define EXEC_FUTURES        1000
+#define EXEC_DEPTH          17
+#define TASK_SPIN           100
+#define EXEC_FLOOD          (CAF_PTH_EXEC_LOCAL * 4)
+#define EXEC_PARKS          20
+
+typedef enum {
+	MODE_LOCKED = 0,
+	MODE_SUBMIT,
+	MODE_SPAWN
+} mode_t_;
+
+static const char *mode_names[] = {
+	"mutex+deque", "exec submit", "exec spawn"
+};
+
+static const int worker_counts[] = { 1, 4, 16 };
+
+static long done;
+static pth_exec_t *gexec;
+
+/* the hand rolled pool: workers pop routines from a locked deque */
+static pth_mutex_t *lmtx;
+static pth_cond_t *lcond;
+static pth_cond_t *ldone;
+static deque_t *lqueue;
+static int lstop;
+
+void *spin_task (void *p);
+void *double_task (void *p);
+void *spawn_task (void *p);
+void *flood_task (void *p);
+void *locked_rtn (void *p);
+static int check (void);
+static int check_full (void);
+static int check_park (void);
+static void sleep_us (long us);
+static double run (mode_t_ mode, int workers);
+static double run_locked (int workers);
+
+int
+main () {
+	double secs;
+	int errors, i, m;
+	errors = check ();
+	errors += check_full ();
+	errors += check_park ();
+	printf ("%-12s %8s %12s\n", "executor", "workers", "Mtasks/s");
+	for (m = MODE_LOCKED; m <= MODE_SPAWN; m++) {
+		for (i = 0; i < (int)(sizeof (worker_counts) / sizeof (int)); i++) {
+			secs = run ((mode_t_)m, worker_counts[i]);
+			if (secs < 0) {
+				errors++;
+				continue;
+			}
+			printf ("%-12s %8d %12.2f\n", mode_names[m], worker_counts[i],
+					(double)EXEC_TASKS / secs / 1e6);
+		}
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+void *
+spin_task (void *p) {
+	volatile long x = (long)p;
+	int i;
+	for (i = 0; i < TASK_SPIN; i++) {
+		x = x * 31 + i;
+	}
+	__atomic_add_fetch (&done, 1, __ATOMIC_RELAXED);
+	return (void *)NULL;
+}
+
+
+void *
+double_task (void *p) {
+	return (void *)((long)p * 2);
+}
+
+
+/* binary tree of tasks, the leaves do the work */
+void *
+spawn_task (void *p) {
+	long depth = (long)p;
+	if (depth <= 0) {
+		return spin_task (p);
+	}
+	pth_exec_submit (gexec, spawn_task, (void *)(depth - 1));
+	pth_exec_submit (gexec, spawn_task, (void *)(depth - 1));
+	return (void *)NULL;
+}
+
+
+/* more tasks than the worker deque and the shared queue can hold */
+void *
+flood_task (void *p) {
+	long i;
+	for (i = 0; i < EXEC_FLOOD; i++) {
+		if (pth_exec_submit (gexec, spin_task, p) != CAF_OK) {
+			break;
+		}
+	}
+	return (void *)NULL;
+}
+
+
+static int
+check (void) {
+	pth_future_t *f[EXEC_FUTURES];
+	void *r;
+	long i;
+	int bad = 0;
+	gexec = pth_exec_new ((pth_attri_t *)NULL, 4, 0);
+	if (gexec == (pth_exec_t *)NULL) {
+		printf ("cannot create executor\n");
+		return 1;
+	}
+	for (i = 0; i < EXEC_FUTURES; i++) {
+		f[i] = pth_exec_async (gexec, double_task, (void *)i);
+	}
+	for (i = 0; i < EXEC_FUTURES; i++) {
+		if (pth_future_wait (f[i], &r, (struct timespec *)NULL) != CAF_OK
+			|| (long)r != i * 2 || pth_future_done (f[i]) != CAF_OK) {
+			bad++;
+		}
+		pth_future_delete (f[i]);
+	}
+	/* futures released before completion */
+	for (i = 0; i < EXEC_FUTURES; i++) {
+		pth_future_delete (pth_exec_async (gexec, double_task, (void *)i));
+	}
+	done = 0;
+	pth_exec_submit (gexec, spawn_task, (void *)10);
+	pth_exec_wait (gexec, (struct timespec *)NULL);
+	bad += done != 1024;
+	/* deletion runs what is still queued */
+	done = 0;
+	for (i = 0; i < EXEC_TASKS / 10; i++) {
+		pth_exec_submit (gexec, spin_task, (void *)i);
+	}
+	pth_exec_delete (gexec);
+	bad += done != EXEC_TASKS / 10;
+	if (bad != 0) {
+		printf ("executor check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_full (void) {
+	pth_attri_t *attrs;
+	struct timespec to;
+	int bad = 0, ds = -1;
+	attrs = pth_attri_init ();
+	if (attrs == (pth_attri_t *)NULL) {
+		printf ("cannot create attributes\n");
+		return 1;
+	}
+	pth_attri_set (attrs, PTH_ATTR_DETACHED, (void *)NULL);
+	/* one worker and the smallest shared queue fill up at once */
+	gexec = pth_exec_new (attrs, 1, 1);
+	if (gexec == (pth_exec_t *)NULL) {
+		printf ("cannot create executor\n");
+		pth_attri_destroy (attrs);
+		return 1;
+	}
+	pth_attri_get (attrs, PTH_ATTR_DETACHED, &ds);
+	bad += ds != PTHREAD_CREATE_DETACHED;
+	done = 0;
+	pth_exec_submit (gexec, flood_task, (void *)NULL);
+	clock_gettime (CLOCK_REALTIME, &to);
+	to.tv_sec += 30;
+	if (pth_exec_wait (gexec, &to) != CAF_OK) {
+		/* the worker is stuck waiting for itself, it cannot be joined */
+		printf ("full queue check: worker blocked\n");
+		return bad + 1;
+	}
+	bad += done != EXEC_FLOOD;
+	pth_exec_delete (gexec);
+	pth_attri_destroy (attrs);
+	if (bad != 0) {
+		printf ("full queue check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static void
+sleep_us (long us) {
+	struct timespec ts;
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000L;
+	nanosleep (&ts, (struct timespec *)NULL);
+}
+
+
+/* submissions spaced so they land while workers park and wake */
+static int
+check_park (void) {
+	struct timespec to;
+	int bad = 0, r, w;
+	for (w = 1; w <= 4; w *= 2) {
+		gexec = pth_exec_new ((pth_attri_t *)NULL, w, 0);
+		if (gexec == (pth_exec_t *)NULL) {
+			printf ("cannot create executor\n");
+			return bad + 1;
+		}
+		done = 0;
+		for (r = 0; r < EXEC_PARKS; r++) {
+			pth_exec_submit (gexec, spin_task, (void *)NULL);
+			sleep_us (500);
+			pth_exec_submit (gexec, spin_task, (void *)NULL);
+			sleep_us (20000);
+			pth_exec_submit (gexec, spin_task, (void *)NULL);
+			clock_gettime (CLOCK_REALTIME, &to);
+			to.tv_sec += 5;
+			if (pth_exec_wait (gexec, &to) != CAF_OK) {
+				/* a lost wakeup leaves the workers parked for good */
+				printf ("park check: %d workers stuck, pending %ld\n", w,
+						__atomic_load_n (&(gexec->pending),
+										 __ATOMIC_SEQ_CST));
+				return bad + 1;
+			}
+		}
+		bad += done != EXEC_PARKS * 3;
+		pth_exec_delete (gexec);
+	}
+	if (bad != 0) {
+		printf ("park check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run (mode_t_ mode, int workers) {
+	struct timespec t0, t1;
+	long i;
+	if (mode == MODE_LOCKED) {
+		return run_locked (workers);
+	}
+	/* the hand rolled deque is unbounded, do not block the submitter */
+	gexec = pth_exec_new ((pth_attri_t *)NULL, workers, EXEC_TASKS);
+	done = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	if (mode == MODE_SUBMIT) {
+		for (i = 0; i < EXEC_TASKS; i++) {
+			pth_exec_submit (gexec, spin_task, (void *)i);
+		}
+	} else {
+		/* 2^EXEC_DEPTH leaves are slightly more than EXEC_TASKS */
+		pth_exec_submit (gexec, spawn_task, (void *)EXEC_DEPTH);
+	}
+	pth_exec_wait (gexec, (struct timespec *)NULL);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_exec_delete (gexec);
+	if (done != (mode == MODE_SUBMIT ? EXEC_TASKS : 1L << EXEC_DEPTH)) {
+		printf ("%s: %ld tasks done\n", mode_names[mode], done);
+		return -1.0;
+	}
+	return ((double)(t1.tv_sec - t0.tv_sec)
+			+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9)
+		* (mode == MODE_SUBMIT ? 1.0 : (double)EXEC_TASKS
+		   / (double)(1L << EXEC_DEPTH));
+}
+
+
+void *
+locked_rtn (void *p) {
+	caf_dequen_t *n;
+	(void)p;
+	for (;;) {
+		pth_mtx_lock (lmtx);
+		while (deque_empty_list (lqueue) == CAF_OK && lstop == 0) {
+			pth_cond_wait (lcond, lmtx);
+		}
+		if (deque_empty_list (lqueue) == CAF_OK) {
+			pth_mtx_unlock (lmtx);
+			break;
+		}
+		n = deque_first (lqueue);
+		pth_mtx_unlock (lmtx);
+		spin_task (n->data);
+		deque_node_release (lqueue, n);
+		if (__atomic_load_n (&done, __ATOMIC_RELAXED) == EXEC_TASKS) {
+			pth_mtx_lock (lmtx);
+			pth_cond_signal (ldone);
+			pth_mtx_unlock (lmtx);
+		}
+	}
+	pthread_exit (NULL);
+}
+
+
+static double
+run_locked (int workers) {
+	pth_attri_t *attr;
+	pth_pool_t *pool;
+	struct timespec t0, t1;
+	long i;
+	lmtx = pth_mtx_new ();
+	pth_mtxattr_init (lmtx);
+	pth_mtx_init (lmtx);
+	lcond = pth_condi_init ();
+	ldone = pth_condi_init ();
+	lqueue = deque_create ();
+	lstop = 0;
+	done = 0;
+	attr = pth_attri_new ();
+	pth_attr_init (attr);
+	pth_attri_set (attr, PTH_ATTR_JOINABLE, (void *)NULL);
+	pool = pth_pool_create (attr, locked_rtn, workers, (void *)NULL);
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < EXEC_TASKS; i++) {
+		pth_mtx_lock (lmtx);
+		deque_push (lqueue, (void *)i);
+		pth_cond_signal (lcond);
+		pth_mtx_unlock (lmtx);
+	}
+	pth_mtx_lock (lmtx);
+	while (__atomic_load_n (&done, __ATOMIC_RELAXED) != EXEC_TASKS) {
+		pth_cond_wait (ldone, lmtx);
+	}
+	lstop = 1;
+	pth_cond_broadcast (lcond);
+	pth_mtx_unlock (lmtx);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_pool_join (pool);
+	pth_pool_delete (pool);
+	pth_attr_destroy (attr);
+	pth_attri_delete (attr);
+	deque_delete_nocb (lqueue);
+	pth_condi_delete (lcond);
+	pth_condi_delete (ldone);
+	pth_mtx_destroy (lmtx);
+	pth_mtxattr_destroy (lmtx);
+	pth_mtx_delete (lmtx);
+	return (double)(t1.tv_sec - t0.tv_sec)
+		+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* caf_exec.c ends here */
@@ -0,0 +1,253 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <caf/caf.h>
+#include <caf/caf_hash_str.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BENCH_TICKS()       ((double)__rdtsc ())
+#define BENCH_UNIT          "cycle"
+#else /* !x86 */
+#define BENCH_TICKS()       bench_ns ()
+#define BENCH_UNIT          "ns"
+#endif /* !x86 */
+
+#define BENCH_KEYS          200000
+#define BENCH_KEY_SZ        512
+#define BENCH_ROUNDS        200
+/* keys hashed by the timed loop, small enough to stay in cache */
+#define BENCH_HOT           2048
+#define BENCH_BUCKETS       65536
+#define BENCH_CHECK_SZ      2048
+
+typedef struct {
+	const char *name;
+	CAF_HASH_STR_FUNCTION(f);
+	int impl;
+} bench_hash_t;
+
+static u_int32_t hash64_fold (const char *str, const u_int32_t len);
+
+static bench_hash_t hashes[] = {
+	{ "rs", caf_shash_rs, 0 },
+	{ "js", caf_shash_js, 0 },
+	{ "pjw", caf_shash_pjw, 0 },
+	{ "elf", caf_shash_elf, 0 },
+	{ "bkdr", caf_shash_bkdr, 0 },
+	{ "sdbm", caf_shash_sdbm, 0 },
+	{ "djb", caf_shash_djb, 0 },
+	{ "dek", caf_shash_dek, 0 },
+	{ "bp", caf_shash_bp, 0 },
+	{ "fnv", caf_shash_fnv, 0 },
+	{ "blk", caf_shash_blk, CAF_SHASH64_AUTO },
+	{ "blk2", caf_shash_blk2, CAF_SHASH64_AUTO },
+	{ "shash64/c", hash64_fold, CAF_SHASH64_SCALAR },
+	{ "shash64/sse2", hash64_fold, CAF_SHASH64_SSE2 },
+	{ "shash64/avx2", hash64_fold, CAF_SHASH64_AVX2 }
+};
+
+static const char *set_names[] = { "short", "url", "log" };
+
+static char heap[BENCH_KEYS * BENCH_KEY_SZ / 2];
+static char *keys[BENCH_KEYS];
+static u_int32_t lens[BENCH_KEYS];
+static u_int32_t values[BENCH_KEYS];
+static u_int32_t buckets[BENCH_BUCKETS];
+
+static int check_impls (void);
+static void make_keys (int set);
+static void bench (bench_hash_t *h);
+static int cmp_u32 (const void *a, const void *b);
+#ifndef BENCH_UNIT
+static double bench_ns (void);
+#endif /* !BENCH_UNIT */
+
+int
+main () {
+	int set;
+	size_t i;
+	if (check_impls () != 0) {
+		return EXIT_FAILURE;
+	}
+	for (set = 0; set < (int)(sizeof (set_names) / sizeof (char *)); set++) {
+		make_keys (set);
+		printf ("%s keys\n", set_names[set]);
+		printf ("%-14s %12s %10s %10s\n", "hash", "bytes/" BENCH_UNIT,
+		        "dup32", "chi2/df");
+		for (i = 0; i < sizeof (hashes) / sizeof (bench_hash_t); i++) {
+			bench (&(hashes[i]));
+		}
+		printf ("\n");
+	}
+	caf_shash64_impl (CAF_SHASH64_AUTO);
+	return EXIT_SUCCESS;
+}
+
+
+static u_int32_t
+hash64_fold (const char *str, const u_int32_t len) {
+	u_int64_t h = caf_shash64 (str, len, 0);
+	return (u_int32_t)(h ^ (h >> 32));
+}
+
+
+static int
+check_impls (void) {
+	static char buf[BENCH_CHECK_SZ];
+	static const u_int64_t seeds[] = { 0, 1, 0x9E3779B97F4A7C15ULL };
+	u_int64_t ref;
+	u_int32_t len, x = 2463534242u;
+	int impl, s, errors = 0;
+	for (len = 0; len < BENCH_CHECK_SZ; len++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		buf[len] = (char)x;
+	}
+	for (s = 0; s < (int)(sizeof (seeds) / sizeof (u_int64_t)); s++) {
+		for (len = 0; len < BENCH_CHECK_SZ; len++) {
+			caf_shash64_impl (CAF_SHASH64_SCALAR);
+			ref = caf_shash64 (buf, len, seeds[s]);
+			for (impl = CAF_SHASH64_SSE2; impl <= CAF_SHASH64_AVX2; impl++) {
+				if (caf_shash64_impl (impl) == impl
+					&& caf_shash64 (buf, len, seeds[s]) != ref) {
+					printf ("implementation %d differs at length %u\n",
+					        impl, len);
+					errors++;
+				}
+			}
+		}
+	}
+	printf ("implementations checked: %d mismatches\n\n", errors);
+	return errors;
+}
+
+
+static void
+make_keys (int set) {
+	static const char *paths[] = { "catalog", "search", "account", "static" };
+	static const char *words[] = { "sshd", "nginx", "kernel", "cron" };
+	u_int32_t x = 88172645u;
+	char *p = heap;
+	int i, n;
+	for (i = 0; i < BENCH_KEYS; i++) {
+		keys[i] = p;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		switch (set) {
+		case 0:
+			n = snprintf (keys[i], BENCH_KEY_SZ, "session-%d", i);
+			break;
+		case 1:
+			n = snprintf (keys[i], BENCH_KEY_SZ,
+			              "https://www.example.com/%s/%u/items/%d"
+			              "?session=%08x&ref=home&lang=en",
+			              paths[x & 3], x % 1000, i, x);
+			break;
+		default:
+			n = snprintf (keys[i], BENCH_KEY_SZ,
+			              "2024-05-%02u %02u:%02u:%02u web%02u %s[%u]: "
+			              "request id=%d method=GET status=%u bytes=%u "
+			              "agent=\"Mozilla/5.0 (X11; Linux x86_64) "
+			              "AppleWebKit/537.36 (KHTML, like Gecko) "
+			              "Chrome/124.0 Safari/537.36\" upstream=10.0.%u.%u",
+			              x % 28 + 1, x % 24, x % 60, (x >> 8) % 60,
+			              x % 16, words[x & 3], x % 32768, i,
+			              200 + x % 5, x % 65536, (x >> 4) % 256,
+			              (x >> 12) % 256);
+			break;
+		}
+		lens[i] = (u_int32_t)n;
+		p += n + 1;
+	}
+}
+
+
+static void
+bench (bench_hash_t *h) {
+	double t0, t1, bytes = 0.0, chi = 0.0, e;
+	u_int32_t sink = 0;
+	int i, r, dups = 0;
+	if (h->f == hash64_fold || h->impl != 0) {
+		if (caf_shash64_impl (h->impl) != h->impl
+			&& h->impl != CAF_SHASH64_AUTO) {
+			printf ("%-14s %12s\n", h->name, "unsupported");
+			return;
+		}
+	}
+	for (i = 0; i < BENCH_HOT; i++) {
+		bytes += lens[i];
+	}
+	t0 = BENCH_TICKS ();
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (i = 0; i < BENCH_HOT; i++) {
+			sink += h->f (keys[i], lens[i]);
+		}
+	}
+	t1 = BENCH_TICKS ();
+	memset (buckets, 0, sizeof (buckets));
+	for (i = 0; i < BENCH_KEYS; i++) {
+		values[i] = h->f (keys[i], lens[i]);
+		buckets[values[i] % BENCH_BUCKETS]++;
+	}
+	qsort (values, BENCH_KEYS, sizeof (u_int32_t), cmp_u32);
+	for (i = 1; i < BENCH_KEYS; i++) {
+		if (values[i] == values[i - 1]) {
+			dups++;
+		}
+	}
+	e = (double)BENCH_KEYS / BENCH_BUCKETS;
+	for (i = 0; i < BENCH_BUCKETS; i++) {
+		chi += ((double)buckets[i] - e) * ((double)buckets[i] - e) / e;
+	}
+	printf ("%-14s %12.3f %10d %10.3f%s\n", h->name,
+	        bytes * BENCH_ROUNDS / (t1 - t0), dups,
+	        chi / (BENCH_BUCKETS - 1), sink == 1 ? " " : "");
+}
+
+
+static int
+cmp_u32 (const void *a, const void *b) {
+	u_int32_t x = *(const u_int32_t *)a, y = *(const u_int32_t *)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+#ifndef BENCH_UNIT
+static double
+bench_ns (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+#endif /* !BENCH_UNIT */
+
+/* caf_hash_bench.c ends here */
@@ -0,0 +1,331 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+#include <caf/caf_hash_ctable.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_pool.h>
+#include <caf/caf_thread_rwlock.h>
+
+
+#define TABLE_ID            1002
+#define TABLE_KEYS          65536
+#define TABLE_CHURN         4096
+#define TABLE_KEY_SZ        32
+#define TABLE_OPS           2000000
+#define TABLE_SHARDS        64
+#define RECLAIM_KEYS        1024
+#define RECLAIM_GROW        32768
+#define RECLAIM_READERS     4
+
+typedef enum {
+	MODE_GLOBAL = 0,
+	MODE_SHARDED,
+	MODE_LOCKFREE
+} mode_t_;
+
+static const char *mode_names[] = {
+	"global rwlock", "sharded", "sharded lock-free"
+};
+
+static const int thread_counts[] = { 1, 4, 16, 64 };
+
+static char keys[TABLE_KEYS][TABLE_KEY_SZ];
+static char churn[TABLE_CHURN][TABLE_KEY_SZ];
+
+static mode_t_ mode;
+static int threads;
+static int next_thread;
+static int errors;
+static caf_hash_table_t *gtable;
+static pth_rwlock_t *glock;
+static caf_hash_ctable_t *ctable;
+static int reclaim_run;
+
+void *pth_rtn (void *p);
+void *reclaim_reader (void *p);
+void *reclaim_writer (void *p);
+static int run (pth_attri_t *attr);
+static int check_reclaim (void);
+static void *op_get (const char *key);
+static int op_set (const char *key);
+static int op_add (const char *key);
+static int op_remove (const char *key);
+
+int
+main () {
+	pth_attri_t *attr;
+	int i, m, t, rt = 0;
+	for (i = 0; i < TABLE_KEYS; i++) {
+		snprintf (keys[i], TABLE_KEY_SZ, "/user/%d/profile", i);
+	}
+	for (i = 0; i < TABLE_CHURN; i++) {
+		snprintf (churn[i], TABLE_KEY_SZ, "/session/%d", i);
+	}
+	attr = pth_attri_new ();
+	if (attr == (pth_attri_t *)NULL || pth_attr_init (attr) != 0
+		|| pth_attri_set (attr, PTH_ATTR_JOINABLE, (void *)NULL) != 0) {
+		return EXIT_FAILURE;
+	}
+	glock = pth_rwl_new (TABLE_ID);
+	if (glock == (pth_rwlock_t *)NULL || pth_rwlattr_init (glock) != 0
+		|| pth_rwl_init (glock) != 0) {
+		return EXIT_FAILURE;
+	}
+	rt |= check_reclaim ();
+	printf ("%-18s %8s %12s\n", "mode", "threads", "Mops/s");
+	for (m = MODE_GLOBAL; m <= MODE_LOCKFREE; m++) {
+		for (t = 0; t < (int)(sizeof (thread_counts) / sizeof (int)); t++) {
+			mode = (mode_t_)m;
+			threads = thread_counts[t];
+			rt |= run (attr);
+		}
+	}
+	pth_rwl_destroy (glock);
+	pth_rwlattr_destroy (glock);
+	pth_rwl_delete (glock);
+	pth_attri_destroy (attr);
+	printf ("errors: %d\n", errors);
+	return (rt == 0 && errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static int
+run (pth_attri_t *attr) {
+	pth_pool_t *pool;
+	struct timespec t0, t1;
+	double secs;
+	int i;
+	gtable = (caf_hash_table_t *)NULL;
+	ctable = (caf_hash_ctable_t *)NULL;
+	if (mode == MODE_GLOBAL) {
+		gtable = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+	} else {
+		ctable = caf_hash_ctable_new (TABLE_ID, TABLE_SHARDS,
+		                              mode == MODE_LOCKFREE ?
+		                              CAF_HASH_CTABLE_LOCKFREE : 0,
+		                              caf_shash_bp, caf_shash_dek);
+	}
+	if (gtable == (caf_hash_table_t *)NULL
+		&& ctable == (caf_hash_ctable_t *)NULL) {
+		return CAF_ERROR;
+	}
+	for (i = 0; i < TABLE_KEYS; i++) {
+		op_add (keys[i]);
+	}
+	next_thread = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	pool = pth_pool_create (attr, pth_rtn, threads, (void *)NULL);
+	if (pool == (pth_pool_t *)NULL) {
+		return CAF_ERROR;
+	}
+	pth_pool_join (pool);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_pool_delete (pool);
+	pth_attri_set (attr, PTH_ATTR_JOINABLE, (void *)NULL);
+	secs = (double)(t1.tv_sec - t0.tv_sec)
+		+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+	for (i = 0; i < TABLE_KEYS; i++) {
+		if (op_get (keys[i]) != (void *)keys[i]) {
+			errors++;
+		}
+	}
+	printf ("%-18s %8d %12.2f\n", mode_names[mode], threads,
+	        (double)TABLE_OPS / secs / 1e6);
+	if (gtable != (caf_hash_table_t *)NULL) {
+		caf_hash_table_delete (gtable);
+	}
+	if (ctable != (caf_hash_ctable_t *)NULL) {
+		caf_hash_ctable_delete (ctable);
+	}
+	return CAF_OK;
+}
+
+
+void *
+pth_rtn (void *p) {
+	int id = __atomic_fetch_add (&next_thread, 1, __ATOMIC_RELAXED);
+	u_int32_t x = 2463534242u + (u_int32_t)id * 7919u;
+	int i, ops = TABLE_OPS / threads, k, bad = 0;
+	(void)p;
+	for (i = 0; i < ops; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		k = (int)(x >> 8);
+		switch (x & 15) {
+		case 0:
+			op_set (keys[k % TABLE_KEYS]);
+			break;
+		case 1:
+			op_remove (churn[k % TABLE_CHURN]);
+			break;
+		case 2:
+			op_add (churn[k % TABLE_CHURN]);
+			break;
+		default:
+			if (op_get (keys[k % TABLE_KEYS]) != keys[k % TABLE_KEYS]) {
+				bad++;
+			}
+			break;
+		}
+	}
+	if (bad > 0) {
+		__atomic_fetch_add (&errors, bad, __ATOMIC_RELAXED);
+	}
+	pthread_exit (NULL);
+}
+
+
+void *
+reclaim_reader (void *p) {
+	long bad = 0;
+	int i = 0;
+	(void)p;
+	while (__atomic_load_n (&reclaim_run, __ATOMIC_ACQUIRE)) {
+		if (caf_hash_ctable_get (ctable, keys[i], strlen (keys[i]) + 1)
+			!= (void *)keys[i]) {
+			bad++;
+		}
+		i = (i + 1) % RECLAIM_KEYS;
+	}
+	return (void *)bad;
+}
+
+
+void *
+reclaim_writer (void *p) {
+	int i;
+	(void)p;
+	/* every growth of the single shard retires a bucket array */
+	for (i = RECLAIM_KEYS; i < RECLAIM_GROW; i++) {
+		caf_hash_ctable_add (ctable, keys[i], strlen (keys[i]) + 1, keys[i]);
+		if ((i & 255) == 0) {
+			caf_hash_ctable_reclaim (ctable);
+		}
+	}
+	__atomic_store_n (&reclaim_run, 0, __ATOMIC_RELEASE);
+	return (void *)NULL;
+}
+
+
+/* reclaims retired arrays while lock-free readers walk the shard */
+static int
+check_reclaim (void) {
+	pthread_t rd[RECLAIM_READERS], wr;
+	void *r;
+	int bad = 0, i;
+	ctable = caf_hash_ctable_new (TABLE_ID, 1, CAF_HASH_CTABLE_LOCKFREE,
+	                              caf_shash_bp, caf_shash_dek);
+	if (ctable == (caf_hash_ctable_t *)NULL) {
+		return CAF_ERROR;
+	}
+	for (i = 0; i < RECLAIM_KEYS; i++) {
+		caf_hash_ctable_add (ctable, keys[i], strlen (keys[i]) + 1, keys[i]);
+	}
+	reclaim_run = 1;
+	for (i = 0; i < RECLAIM_READERS; i++) {
+		pthread_create (&(rd[i]), (pthread_attr_t *)NULL, reclaim_reader,
+		                (void *)NULL);
+	}
+	pthread_create (&wr, (pthread_attr_t *)NULL, reclaim_writer,
+	                (void *)NULL);
+	pthread_join (wr, (void **)NULL);
+	for (i = 0; i < RECLAIM_READERS; i++) {
+		pthread_join (rd[i], &r);
+		bad += (int)(long)r;
+	}
+	bad += caf_hash_ctable_count (ctable) != RECLAIM_GROW;
+	caf_hash_ctable_reclaim (ctable);
+	bad += ctable->shards[0].table->retired_count != 0;
+	caf_hash_ctable_delete (ctable);
+	ctable = (caf_hash_ctable_t *)NULL;
+	if (bad != 0) {
+		printf ("reclaim check: %d errors\n", bad);
+		errors += bad;
+	}
+	return CAF_OK;
+}
+
+
+static void *
+op_get (const char *key) {
+	void *r;
+	if (mode == MODE_GLOBAL) {
+		pth_rwl_rdlock (glock, 0, (struct timespec *)NULL);
+		r = caf_hash_table_get (gtable, key, strlen (key) + 1);
+		pth_rwl_unlock (glock);
+		return r;
+	}
+	return caf_hash_ctable_get (ctable, key, strlen (key) + 1);
+}
+
+
+static int
+op_set (const char *key) {
+	int r;
+	if (mode == MODE_GLOBAL) {
+		pth_rwl_wrlock (glock, 0, (struct timespec *)NULL);
+		r = caf_hash_table_set (gtable, key, strlen (key) + 1, (void *)key);
+		pth_rwl_unlock (glock);
+		return r;
+	}
+	return caf_hash_ctable_set (ctable, key, strlen (key) + 1, (void *)key);
+}
+
+
+static int
+op_add (const char *key) {
+	int r;
+	if (mode == MODE_GLOBAL) {
+		pth_rwl_wrlock (glock, 0, (struct timespec *)NULL);
+		r = caf_hash_table_add (gtable, key, strlen (key) + 1, key);
+		pth_rwl_unlock (glock);
+		return r;
+	}
+	return caf_hash_ctable_add (ctable, key, strlen (key) + 1, key);
+}
+
+
+static int
+op_remove (const char *key) {
+	int r;
+	if (mode == MODE_GLOBAL) {
+		pth_rwl_wrlock (glock, 0, (struct timespec *)NULL);
+		r = caf_hash_table_remove (gtable, key, strlen (key) + 1);
+		pth_rwl_unlock (glock);
+		return r;
+	}
+	return caf_hash_ctable_remove (ctable, key, strlen (key) + 1);
+}
+
+/* caf_hashctable.c ends here */
@@ -0,0 +1,153 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+
+
+#define TABLE_ID            1004
+#define FLOOD_MIN           1000
+#define FLOOD_MAX           16000
+#define FLOOD_KEY_SZ        32
+
+typedef enum {
+	MODE_BP = 0,
+	MODE_BP_DEK,
+	MODE_KEYED
+} mode_t_;
+
+static const char *mode_names[] = { "bp", "bp+dek", "keyed sip" };
+
+static char keys[FLOOD_MAX][FLOOD_KEY_SZ];
+static int lookup_errors = 0;
+
+static int check_sip (void);
+static double flood (mode_t_ mode, int n);
+
+int
+main () {
+	caf_hash_table_t *a, *b;
+	double t[3][2];
+	int i, m, n, errors = 0;
+	errors += check_sip ();
+	a = caf_hash_table_new_keyed (TABLE_ID, NULL);
+	b = caf_hash_table_new_keyed (TABLE_ID, NULL);
+	if (a == (caf_hash_table_t *)NULL || b == (caf_hash_table_t *)NULL
+		|| (a->seed[0] == b->seed[0] && a->seed[1] == b->seed[1])) {
+		printf ("keyed tables do not get distinct seeds\n");
+		errors++;
+	}
+	caf_hash_table_delete (a);
+	caf_hash_table_delete (b);
+	/*
+	 * caf_shash_bp shifts the hash 7 bits per 32 bit word, so the first
+	 * word is gone after 5 more words: these keys differ only there.
+	 */
+	for (i = 0; i < FLOOD_MAX; i++) {
+		snprintf (keys[i], FLOOD_KEY_SZ, "%04x/session/attack/key", i);
+	}
+	printf ("%-10s %8s %12s\n", "table", "keys", "ns/op");
+	for (m = MODE_BP; m <= MODE_KEYED; m++) {
+		for (n = FLOOD_MIN; n <= FLOOD_MAX; n *= 2) {
+			t[m][n == FLOOD_MIN ? 0 : 1] = flood ((mode_t_)m, n);
+			printf ("%-10s %8d %12.1f\n", mode_names[m], n,
+			        t[m][n == FLOOD_MIN ? 0 : 1]);
+		}
+	}
+	/* quadratic growth for the unkeyed table, flat for the keyed one */
+	if (t[MODE_KEYED][1] * 10.0 > t[MODE_BP][1]) {
+		printf ("keyed table is not faster under the flood\n");
+		errors++;
+	}
+	errors += lookup_errors;
+	printf ("errors: %d\n", errors);
+	return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static int
+check_sip (void) {
+	/* reference vectors, key 00..0f, messages 00..(len - 1) */
+	const u_int64_t k0 = 0x0706050403020100ULL, k1 = 0x0F0E0D0C0B0A0908ULL;
+	const u_int64_t v0 = 0x726FDB47DD0E0E31ULL, v15 = 0xA129CA6149BE45E5ULL;
+	char msg[15];
+	int i;
+	for (i = 0; i < 15; i++) {
+		msg[i] = (char)i;
+	}
+	if (caf_shash_sip (msg, 0, k0, k1) != v0
+		|| caf_shash_sip (msg, 15, k0, k1) != v15) {
+		printf ("caf_shash_sip does not match the reference vectors\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+flood (mode_t_ mode, int n) {
+	caf_hash_table_t *table;
+	struct timespec t0, t1;
+	int i, bad = 0;
+	switch (mode) {
+	case MODE_BP:
+		table = caf_hash_table_new (TABLE_ID, caf_shash_bp, NULL);
+		break;
+	case MODE_BP_DEK:
+		table = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+		break;
+	default:
+		table = caf_hash_table_new_keyed (TABLE_ID, NULL);
+		break;
+	}
+	if (table == (caf_hash_table_t *)NULL) {
+		return 0.0;
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		caf_hash_table_add (table, keys[i], strlen (keys[i]), keys[i]);
+	}
+	for (i = 0; i < n; i++) {
+		if (caf_hash_table_get (table, keys[i], strlen (keys[i]))
+			!= keys[i]) {
+			bad++;
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	caf_hash_table_delete (table);
+	if (bad > 0) {
+		printf ("%s: %d lookups failed\n", mode_names[mode], bad);
+		lookup_errors += bad;
+	}
+	return ((double)(t1.tv_sec - t0.tv_sec) * 1e9
+	        + (double)(t1.tv_nsec - t0.tv_nsec)) / (2.0 * n);
+}
+
+/* caf_hashflood.c ends here */
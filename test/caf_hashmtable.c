@@ -0,0 +1,195 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+#include <caf/caf_hash_mtable.h>
+
+
+#define TABLE_ID            1003
+#define TABLE_SMALL         1000
+#define TABLE_BULK          200000
+#define TABLE_KEY_SZ        32
+#define TABLE_WORKERS       4
+
+static char keys[TABLE_BULK][TABLE_KEY_SZ];
+static char values[TABLE_BULK][TABLE_KEY_SZ];
+
+static int test_table (const char *path, int entries);
+static int test_lookups (caf_hash_mtable_t *mt, int entries);
+static int test_corrupt (const char *path);
+
+int
+main () {
+	char path[256];
+	int i, errors = 0;
+	for (i = 0; i < TABLE_BULK; i++) {
+		snprintf (keys[i], TABLE_KEY_SZ, "key-%d", i);
+		snprintf (values[i], TABLE_KEY_SZ, "value-%d", i);
+	}
+	snprintf (path, sizeof (path), "%s/caf_hashmtable.%ld", P_tmpdir,
+	          (long)getpid ());
+	errors += test_table (path, TABLE_SMALL);
+	errors += test_table (path, TABLE_BULK);
+	errors += test_corrupt (path);
+	unlink (path);
+	printf ("errors: %d\n", errors);
+	return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static int
+test_table (const char *path, int entries) {
+	caf_hash_table_t *table;
+	caf_hash_mtable_t *mt;
+	struct timespec t0, t1;
+	pid_t pid;
+	int i, st, errors = 0;
+	table = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+	if (table == (caf_hash_table_t *)NULL) {
+		return 1;
+	}
+	for (i = 0; i < entries; i++) {
+		caf_hash_table_add (table, keys[i], strlen (keys[i]), values[i]);
+	}
+	if ((caf_hash_mtable_write (table, path, NULL)) != CAF_OK) {
+		printf ("write failed: %s\n", path);
+		caf_hash_table_delete (table);
+		return 1;
+	}
+	caf_hash_table_delete (table);
+	if (caf_hash_mtable_open (TABLE_ID, path, caf_shash_dek, caf_shash_bp)
+		!= (caf_hash_mtable_t *)NULL) {
+		printf ("opened with the wrong callbacks\n");
+		errors++;
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	mt = caf_hash_mtable_open (TABLE_ID, path, caf_shash_bp, caf_shash_dek);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	if (mt == (caf_hash_mtable_t *)NULL) {
+		printf ("open failed: %s\n", path);
+		return errors + 1;
+	}
+	printf ("%d entries: open %.1f us\n", entries,
+	        ((double)(t1.tv_sec - t0.tv_sec) * 1e9
+	         + (double)(t1.tv_nsec - t0.tv_nsec)) / 1e3);
+	errors += test_lookups (mt, entries);
+	/* the workers share the parent mapping */
+	for (i = 0; i < TABLE_WORKERS; i++) {
+		pid = fork ();
+		if (pid == 0) {
+			_exit (test_lookups (mt, entries) == 0 ? 0 : 1);
+		} else if (pid < 0) {
+			errors++;
+		}
+	}
+	while (wait (&st) > 0) {
+		if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+			errors++;
+		}
+	}
+	caf_hash_mtable_close (mt);
+	return errors;
+}
+
+
+static int
+test_lookups (caf_hash_mtable_t *mt, int entries) {
+	const void *data;
+	char miss[TABLE_KEY_SZ];
+	size_t dsz;
+	int i, errors = 0;
+	if (caf_hash_mtable_count (mt) != (size_t)entries) {
+		errors++;
+	}
+	for (i = 0; i < entries; i++) {
+		if (caf_hash_mtable_find (mt, keys[i], strlen (keys[i]), &data, &dsz)
+			!= CAF_OK || dsz != strlen (values[i]) + 1
+			|| strcmp ((const char *)data, values[i]) != 0) {
+			errors++;
+		}
+		snprintf (miss, TABLE_KEY_SZ, "miss-%d", i);
+		if (caf_hash_mtable_get (mt, miss, strlen (miss))
+			!= (const void *)NULL) {
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+/* a slot array placed past the end of the file must be rejected */
+static int
+test_corrupt (const char *path) {
+	caf_hash_table_t *table;
+	caf_hash_mtable_t *mt;
+	caf_hash_mheader_t h;
+	FILE *f;
+	int i, errors = 0;
+	table = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+	if (table == (caf_hash_table_t *)NULL) {
+		return 1;
+	}
+	for (i = 0; i < TABLE_SMALL; i++) {
+		caf_hash_table_add (table, keys[i], strlen (keys[i]), values[i]);
+	}
+	if ((caf_hash_mtable_write (table, path, NULL)) != CAF_OK) {
+		caf_hash_table_delete (table);
+		return 1;
+	}
+	caf_hash_table_delete (table);
+	f = fopen (path, "r+b");
+	if (f == (FILE *)NULL || fread (&h, sizeof (h), 1, f) != 1) {
+		if (f != (FILE *)NULL) {
+			fclose (f);
+		}
+		return 1;
+	}
+	h.slots_off = h.file_sz + CAF_HASH_MTABLE_ALIGN
+		- h.file_sz % CAF_HASH_MTABLE_ALIGN;
+	h.heap_off = h.slots_off + h.size * CAF_HASH_MSLOT_SZ;
+	if (fseek (f, 0, SEEK_SET) != 0 || fwrite (&h, sizeof (h), 1, f) != 1) {
+		errors++;
+	}
+	fclose (f);
+	mt = caf_hash_mtable_open (TABLE_ID, path, caf_shash_bp, caf_shash_dek);
+	if (mt != (caf_hash_mtable_t *)NULL) {
+		printf ("opened a corrupt header\n");
+		caf_hash_mtable_close (mt);
+		errors++;
+	}
+	return errors;
+}
+
+/* caf_hashmtable.c ends here */
@@ -26,11 +26,16 @@
 
 #include <string.h>
 
+#include <caf/caf.h>
 #include <caf/caf_hash_str.h>
 #include <caf/caf_hash_table.h>
 
 
 #define TABLE_ID            1000
+#define TABLE_BULK          200000
+#define TABLE_KEY_SZ        32
+
+int test_bulk (void);
 
 int
 main () {
@@ -50,10 +55,51 @@ main () {
 		printf ("remove: %d\n", caf_hash_table_remove (table, "hello",
 													   strlen("hello") + 1));
 		caf_hash_table_dump (stdout, table);
-		deque_dump_ptr (stdout, table->hashes);
+		printf ("get hola: %s\n", (char *)caf_hash_table_get (table, "hola",
+		        strlen("hola") + 1));
+		printf ("get hello: %p\n", caf_hash_table_get (table, "hello",
+		        strlen("hello") + 1));
 		caf_hash_table_delete (table);
 	}
-	return 0;
+	return test_bulk ();
+}
+
+
+int
+test_bulk (void) {
+	caf_hash_table_t *table = (caf_hash_table_t *)NULL;
+	char *keys;
+	int i, errors = 0;
+	keys = (char *)malloc (TABLE_BULK * TABLE_KEY_SZ);
+	table = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+	if (table == (caf_hash_table_t *)NULL || keys == (char *)NULL) {
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < TABLE_BULK; i++) {
+		snprintf (&(keys[i * TABLE_KEY_SZ]), TABLE_KEY_SZ, "session-%d", i);
+		caf_hash_table_add (table, &(keys[i * TABLE_KEY_SZ]),
+		                    strlen (&(keys[i * TABLE_KEY_SZ])),
+		                    &(keys[i * TABLE_KEY_SZ]));
+	}
+	for (i = 0; i < TABLE_BULK; i += 2) {
+		if (caf_hash_table_remove (table, &(keys[i * TABLE_KEY_SZ]),
+		                           strlen (&(keys[i * TABLE_KEY_SZ])))
+			!= CAF_OK) {
+			errors++;
+		}
+	}
+	for (i = 0; i < TABLE_BULK; i++) {
+		if (caf_hash_table_get (table, &(keys[i * TABLE_KEY_SZ]),
+		                        strlen (&(keys[i * TABLE_KEY_SZ])))
+			!= ((i % 2) ? &(keys[i * TABLE_KEY_SZ]) : NULL)) {
+			errors++;
+		}
+	}
+	printf ("bulk: %d keys, %lu live, %lu buckets, %d errors\n", TABLE_BULK,
+	        (unsigned long)table->count, (unsigned long)table->size, errors);
+	caf_hash_table_delete (table);
+	free (keys);
+	return errors == 0 ? 0 : EXIT_FAILURE;
 }
 
 /* caf_hash_tabel.c ends here */
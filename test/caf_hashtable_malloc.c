@@ -0,0 +1,189 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+
+
+#define TABLE_ID            1001
+#define TABLE_KEYS          100000
+#define TABLE_KEY_SZ        32
+
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t sz);
+extern void *__libc_calloc (size_t n, size_t sz);
+extern void *__libc_realloc (void *ptr, size_t sz);
+extern void __libc_free (void *ptr);
+
+static int counting = 0;
+static unsigned long malloc_calls = 0;
+
+void *
+malloc (size_t sz) {
+	if (counting) {
+		malloc_calls++;
+	}
+	return __libc_malloc (sz);
+}
+
+
+void *
+calloc (size_t n, size_t sz) {
+	if (counting) {
+		malloc_calls++;
+	}
+	return __libc_calloc (n, sz);
+}
+
+
+void *
+realloc (void *ptr, size_t sz) {
+	if (counting) {
+		malloc_calls++;
+	}
+	return __libc_realloc (ptr, sz);
+}
+
+
+void
+free (void *ptr) {
+	__libc_free (ptr);
+}
+#endif /* !__GLIBC__ */
+
+typedef enum {
+	OP_ADD_NEW = 0,
+	OP_ADD_UPDATE,
+	OP_GET_HIT,
+	OP_GET_MISS,
+	OP_SET_HIT,
+	OP_REMOVE_MISS,
+	OP_REMOVE_HIT
+} op_t;
+
+static const char *op_names[] = {
+	"add (new)", "add (update)", "get (hit)", "get (miss)", "set (hit)",
+	"remove (miss)", "remove (hit)"
+};
+
+/* whether the operation is required to run without heap allocations */
+static const int op_zero[] = { 0, 1, 1, 1, 1, 1, 1 };
+
+static char keys[TABLE_KEYS][TABLE_KEY_SZ];
+static char miss[TABLE_KEYS][TABLE_KEY_SZ];
+
+static int run_op (caf_hash_table_t *table, op_t op);
+
+int
+main () {
+	caf_hash_table_t *table;
+	int i, errors = 0;
+#ifndef __GLIBC__
+	printf ("malloc counting is not supported on this platform\n");
+	return EXIT_SUCCESS;
+#endif /* !__GLIBC__ */
+	for (i = 0; i < TABLE_KEYS; i++) {
+		snprintf (keys[i], TABLE_KEY_SZ, "/item/%d/view", i);
+		snprintf (miss[i], TABLE_KEY_SZ, "/item/%d/edit", i);
+	}
+	table = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+	if (table == (caf_hash_table_t *)NULL) {
+		return EXIT_FAILURE;
+	}
+	for (i = OP_ADD_NEW; i <= OP_REMOVE_HIT; i++) {
+		errors += run_op (table, (op_t)i);
+	}
+	caf_hash_table_delete (table);
+	printf ("errors: %d\n", errors);
+	return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static int
+run_op (caf_hash_table_t *table, op_t op) {
+	struct timespec t0, t1;
+	unsigned long calls = 0;
+	double ns;
+	int i, r = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+#ifdef __GLIBC__
+	malloc_calls = 0;
+	counting = 1;
+#endif /* !__GLIBC__ */
+	for (i = 0; i < TABLE_KEYS; i++) {
+		switch (op) {
+		case OP_ADD_NEW:
+		case OP_ADD_UPDATE:
+			r |= caf_hash_table_add (table, keys[i], strlen (keys[i]) + 1,
+			                         keys[i]);
+			break;
+		case OP_GET_HIT:
+			r |= caf_hash_table_get (table, keys[i], strlen (keys[i]) + 1)
+				!= keys[i];
+			break;
+		case OP_GET_MISS:
+			r |= caf_hash_table_get (table, miss[i], strlen (miss[i]) + 1)
+				!= NULL;
+			break;
+		case OP_SET_HIT:
+			r |= caf_hash_table_set (table, keys[i], strlen (keys[i]) + 1,
+			                         keys[i]);
+			break;
+		case OP_REMOVE_MISS:
+			r |= caf_hash_table_remove (table, miss[i],
+			                            strlen (miss[i]) + 1) != CAF_ERROR;
+			break;
+		case OP_REMOVE_HIT:
+			r |= caf_hash_table_remove (table, keys[i],
+			                            strlen (keys[i]) + 1);
+			break;
+		}
+	}
+#ifdef __GLIBC__
+	counting = 0;
+	calls = malloc_calls;
+#endif /* !__GLIBC__ */
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0.tv_nsec);
+	printf ("%-14s %8.2f ns/op %10.6f mallocs/op\n", op_names[op],
+	        ns / TABLE_KEYS, (double)calls / TABLE_KEYS);
+	if (r != 0) {
+		printf ("%s: unexpected result\n", op_names[op]);
+		return 1;
+	}
+	if (op_zero[op] && calls != 0) {
+		printf ("%s: %lu heap allocations\n", op_names[op], calls);
+		return 1;
+	}
+	return 0;
+}
+
+/* caf_hashtable_malloc.c ends here */
@@ -0,0 +1,278 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_thread_key.h>
+
+
+#define LOOKUPS             1000000
+#define MAX_KEYS            64
+#define POOL_ID             1
+
+static const int pool_keys[] = { 1, 4, 16, 64 };
+
+/* keeps the lookups from being optimized away */
+static volatile unsigned long sink;
+
+void free_ptr (void *p);
+void *own_data_thread (void *p);
+static void *list_get (pth_kpool_t *pool, int id);
+static pth_kpool_t *pool_new (int n);
+static double elapsed_ns (struct timespec *t0);
+static int check_slots (void);
+static int check_large_ids (void);
+static int check_threads (void);
+static double run_list (pth_kpool_t *pool, int id);
+static double run_kpool (pth_kpool_t *pool, int id);
+static double run_pthread (pth_kpool_t *pool, int id);
+
+
+int
+main () {
+	pth_kpool_t *pool;
+	int errors, i, n;
+	errors = check_slots ();
+	errors += check_large_ids ();
+	errors += check_threads ();
+	printf ("ns per lookup of the last key\n");
+	printf ("%5s %10s %10s %13s\n", "keys", "list walk", "kpool_get",
+			"getspecific");
+	for (i = 0; i < (int)(sizeof (pool_keys) / sizeof (int)); i++) {
+		n = pool_keys[i];
+		pool = pool_new (n);
+		printf ("%5d %10.2f %10.2f %13.2f\n", n, run_list (pool, n),
+				run_kpool (pool, n), run_pthread (pool, n));
+		pth_kpool_delete (pool);
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+void
+free_ptr (void *p) {
+	xfree (p);
+}
+
+
+/* the lookup pth_kpool_get did before the slot table */
+static void *
+list_get (pth_kpool_t *pool, int id) {
+	caf_dequen_t *n = pool->keys->head;
+	pth_key_t *k;
+	while (n != (caf_dequen_t *)NULL) {
+		k = (pth_key_t *)n->data;
+		if (k->id == id) {
+			return pthread_getspecific (k->key);
+		}
+		n = n->next;
+	}
+	return (void *)NULL;
+}
+
+
+static pth_kpool_t *
+pool_new (int n) {
+	pth_kpool_t *pool = pth_kpool_new (POOL_ID, (pthread_t *)NULL);
+	pth_key_t *k;
+	int i;
+	for (i = 1; i <= n; i++) {
+		k = pth_key_new (i, free_ptr);
+		pth_kpool_add (pool, k);
+		pth_key_set (k, sizeof (int));
+		*((int *)pth_key_get (k)) = i;
+	}
+	return pool;
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+static int
+check_slots (void) {
+	pth_kpool_t *pool = pool_new (MAX_KEYS);
+	pth_key_t *dup;
+	int bad = 0, i;
+	int *v;
+	for (i = 1; i <= MAX_KEYS; i++) {
+		v = (int *)pth_kpool_get (pool, i);
+		bad += v == (int *)NULL || *v != i;
+		bad += pth_kpool_get_key (pool, i) == (pth_key_t *)NULL;
+	}
+	bad += pth_kpool_get (pool, 0) != (void *)NULL;
+	bad += pth_kpool_get (pool, MAX_KEYS + 1) != (void *)NULL;
+	bad += pth_kpool_get (pool, 1 << 20) != (void *)NULL;
+	/* a duplicate identifier takes over when the first key goes */
+	dup = pth_key_new (3, free_ptr);
+	pth_kpool_add (pool, dup);
+	bad += pth_kpool_get_key (pool, 3) == dup;
+	pth_kpool_remove (pool, pth_kpool_get_key (pool, 3));
+	bad += pth_kpool_get_key (pool, 3) != dup;
+	pth_kpool_remove_by_id (pool, 3);
+	bad += pth_kpool_get_key (pool, 3) != (pth_key_t *)NULL;
+	bad += pth_kpool_get (pool, 4) == (void *)NULL;
+	pth_kpool_delete (pool);
+	if (bad != 0) {
+		printf ("kpool slot check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+/* ids past the slot table are kept in the key list only */
+static int
+check_large_ids (void) {
+	static const int ids[] = { PTH_KPOOL_SLOTS_MAX - 1, PTH_KPOOL_SLOTS_MAX,
+							   100000000, INT_MAX };
+	pth_kpool_t *pool = pth_kpool_new (POOL_ID, (pthread_t *)NULL);
+	pth_key_t *k, *dup;
+	int bad = 0, i, n = (int)(sizeof (ids) / sizeof (int));
+	int *v;
+	for (i = 0; i < n; i++) {
+		k = pth_key_new (ids[i], free_ptr);
+		bad += pth_kpool_add (pool, k) == (void *)NULL;
+		pth_key_set (k, sizeof (int));
+		*((int *)pth_key_get (k)) = i;
+	}
+	bad += pool->nslots > PTH_KPOOL_SLOTS_MAX;
+	for (i = 0; i < n; i++) {
+		v = (int *)pth_kpool_get (pool, ids[i]);
+		bad += v == (int *)NULL || *v != i;
+	}
+	bad += pth_kpool_get (pool, INT_MAX - 1) != (void *)NULL;
+	dup = pth_key_new (INT_MAX, free_ptr);
+	pth_kpool_add (pool, dup);
+	bad += pth_kpool_get_key (pool, INT_MAX) == dup;
+	pth_kpool_remove (pool, pth_kpool_get_key (pool, INT_MAX));
+	bad += pth_kpool_get_key (pool, INT_MAX) != dup;
+	pth_kpool_remove_by_id (pool, INT_MAX);
+	bad += pth_kpool_get_key (pool, INT_MAX) != (pth_key_t *)NULL;
+	bad += pth_kpool_get (pool, 100000000) == (void *)NULL;
+	pth_kpool_delete (pool);
+	if (bad != 0) {
+		printf ("kpool large id check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+void *
+own_data_thread (void *p) {
+	pth_kpool_t *pool = (pth_kpool_t *)p;
+	long bad = 0, i;
+	int *v;
+	/* the main thread values must not leak through the cache */
+	bad += pth_kpool_get (pool, 1) != (void *)NULL;
+	pth_key_set (pth_kpool_get_key (pool, 1), sizeof (int));
+	v = (int *)pth_kpool_get (pool, 1);
+	*v = -1;
+	for (i = 0; i < 1000; i++) {
+		bad += *((int *)pth_kpool_get (pool, 1)) != -1;
+	}
+	return (void *)bad;
+}
+
+
+static int
+check_threads (void) {
+	pth_kpool_t *pool = pool_new (2);
+	pthread_t thr[2];
+	void *r;
+	int bad = 0, i;
+	/* one after the other, pth_key_set also records the last data */
+	for (i = 0; i < 2; i++) {
+		pthread_create (&(thr[i]), (pthread_attr_t *)NULL,
+						own_data_thread, pool);
+		pthread_join (thr[i], &r);
+		bad += (int)(long)r;
+	}
+	bad += *((int *)pth_kpool_get (pool, 1)) != 1;
+	/* keys deleted and created again must not hit stale entries */
+	pth_kpool_remove_by_id (pool, 1);
+	pth_kpool_add (pool, pth_key_new (1, free_ptr));
+	bad += pth_kpool_get (pool, 1) != (void *)NULL;
+	pth_kpool_delete (pool);
+	if (bad != 0) {
+		printf ("kpool thread check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run_list (pth_kpool_t *pool, int id) {
+	struct timespec t0;
+	int i;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < LOOKUPS; i++) {
+		sink += (unsigned long)list_get (pool, id);
+	}
+	return elapsed_ns (&t0) / LOOKUPS;
+}
+
+
+static double
+run_kpool (pth_kpool_t *pool, int id) {
+	struct timespec t0;
+	int i;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < LOOKUPS; i++) {
+		sink += (unsigned long)pth_kpool_get (pool, id);
+	}
+	return elapsed_ns (&t0) / LOOKUPS;
+}
+
+
+static double
+run_pthread (pth_kpool_t *pool, int id) {
+	pthread_key_t key = pth_kpool_get_key (pool, id)->key;
+	struct timespec t0;
+	int i;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < LOOKUPS; i++) {
+		sink += (unsigned long)pthread_getspecific (key);
+	}
+	return elapsed_ns (&t0) / LOOKUPS;
+}
+
+/* caf_kpool.c ends here */
@@ -0,0 +1,417 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_thread_futex.h>
+#include <caf/caf_thread_mutex.h>
+#include <caf/caf_thread_rwlock.h>
+#include <caf/caf_thread_cond.h>
+
+
+#define OPS                 20000
+#define MAX_THREADS         8
+#define OUTSIDE_WORK        50
+
+typedef enum {
+	LOCK_MUTEX = 0,
+	LOCK_ADAPTIVE,
+	LOCK_RWLOCK,
+	LOCK_READER,
+	LOCK_WRITER,
+	LOCK_KINDS
+} lock_kind_t;
+
+static const char *kind_names[LOCK_KINDS] = {
+	"mutex", "adaptive", "rwlock", "rw-reader", "rw-writer"
+};
+
+static const int threads[] = { 1, 2, 4, 8 };
+static const int cs_lens[] = { 0, 50, 500 };
+static const int read_pcts[] = { 0, 50, 90, 100 };
+
+typedef struct bench_s bench_t;
+struct bench_s {
+	lock_kind_t kind;
+	pth_mutex_t *mtx;
+	pth_rwlock_t *rwl;
+	int threads;
+	int cs;
+	int read_pct;
+	long counter;
+	long writes;
+};
+
+static pth_mutex_t *cmtx;
+static pth_cond_t *ccond;
+static int cflag;
+
+void *bench_thread (void *p);
+void *hold_thread (void *p);
+void *wait_thread (void *p);
+void *cond_thread (void *p);
+static void work (int n);
+static void deadline (struct timespec *ts, long ms);
+static pth_mutex_t *mutex_new (int adaptive);
+static void mutex_delete (pth_mutex_t *mtx);
+static pth_rwlock_t *rwlock_new (pth_rwlock_types_t mode);
+static void rwlock_delete (pth_rwlock_t *rwl);
+static int check_mutex (void);
+static int check_rwlock (pth_rwlock_types_t mode);
+static int check_cond (void);
+static double run (bench_t *b);
+
+
+int
+main () {
+	bench_t b;
+	int errors, i, j, k, m;
+	errors = check_mutex ();
+	errors += check_rwlock ((pth_rwlock_types_t)0);
+	errors += check_rwlock (PTHDR_RWLOCK_READER);
+	errors += check_rwlock (PTHDR_RWLOCK_WRITER);
+	errors += check_cond ();
+	printf ("spin bound %d, Mops/s, mutexes take every operation "
+			"exclusively\n", pth_futex_spin_max (0));
+	printf ("%3s %4s %5s", "thr", "cs", "read");
+	for (m = 0; m < LOCK_KINDS; m++) {
+		printf (" %10s", kind_names[m]);
+	}
+	printf ("\n");
+	for (i = 0; i < (int)(sizeof (threads) / sizeof (int)); i++) {
+		for (j = 0; j < (int)(sizeof (cs_lens) / sizeof (int)); j++) {
+			for (k = 0; k < (int)(sizeof (read_pcts) / sizeof (int)); k++) {
+				printf ("%3d %4d %4d%%", threads[i], cs_lens[j],
+						read_pcts[k]);
+				for (m = 0; m < LOCK_KINDS; m++) {
+					memset (&b, 0, sizeof (b));
+					b.kind = (lock_kind_t)m;
+					b.threads = threads[i];
+					b.cs = cs_lens[j];
+					b.read_pct = read_pcts[k];
+					printf (" %10.3f", run (&b));
+					/* every write is counted under the lock */
+					if (b.counter != b.writes) {
+						printf ("\n%s: counter %ld, writes %ld\n",
+								kind_names[m], b.counter, b.writes);
+						errors++;
+					}
+				}
+				printf ("\n");
+			}
+		}
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static void
+work (int n) {
+	volatile int x = 0;
+	int i;
+	for (i = 0; i < n; i++) {
+		x += i;
+	}
+}
+
+
+static pth_mutex_t *
+mutex_new (int adaptive) {
+	pth_mutex_t *mtx = pth_mtx_new ();
+	pth_mtxattr_init (mtx);
+	pth_mtx_init (mtx);
+	if (adaptive) {
+		pth_mtxattr_set (mtx, PTHDR_MUTEX_ADAPTIVE, 0);
+	}
+	return mtx;
+}
+
+
+static void
+mutex_delete (pth_mutex_t *mtx) {
+	pth_mtx_destroy (mtx);
+	pth_mtxattr_destroy (mtx);
+	pth_mtx_delete (mtx);
+}
+
+
+static pth_rwlock_t *
+rwlock_new (pth_rwlock_types_t mode) {
+	pth_rwlock_t *rwl = pth_rwl_new (1);
+	pth_rwlattr_init (rwl);
+	pth_rwl_init (rwl);
+	if (mode != 0) {
+		pth_rwlattr_set (rwl, mode, 0);
+	}
+	return rwl;
+}
+
+
+static void
+rwlock_delete (pth_rwlock_t *rwl) {
+	pth_rwl_destroy (rwl);
+	pth_rwlattr_destroy (rwl);
+	pth_rwl_delete (rwl);
+}
+
+
+static void
+deadline (struct timespec *ts, long ms) {
+	clock_gettime (CLOCK_REALTIME, ts);
+	ts->tv_nsec += ms * 1000000L;
+	ts->tv_sec += ts->tv_nsec / 1000000000L;
+	ts->tv_nsec %= 1000000000L;
+}
+
+
+static int
+check_mutex (void) {
+	pth_mutex_t *mtx = mutex_new (1);
+	int bad = 0, spin = -1;
+	bad += pth_mtxattr_get (mtx, PTHDR_MUTEX_ADAPTIVE, &spin) != CAF_OK;
+	bad += spin != pth_futex_spin_max (0);
+	bad += pth_mtx_lock (mtx) != CAF_OK;
+	bad += pth_mtxattr_get (mtx, PTHDR_MUTEX_LOCK, (int *)NULL) == 0;
+	bad += pth_mtx_trylock (mtx) == CAF_OK;
+	bad += pth_mtx_unlock (mtx) != CAF_OK;
+	bad += pth_mtxattr_get (mtx, PTHDR_MUTEX_LOCK, (int *)NULL) != 0;
+	bad += pth_mtx_trylock (mtx) != CAF_OK;
+	bad += pth_mtx_unlock (mtx) != CAF_OK;
+	bad += pth_mtxattr_set (mtx, PTHDR_MUTEX_ADAPTIVE, -1) == CAF_OK;
+	mutex_delete (mtx);
+	mtx = mutex_new (0);
+	bad += pth_mtxattr_get (mtx, PTHDR_MUTEX_ADAPTIVE, &spin) == CAF_OK;
+	mutex_delete (mtx);
+	/* owner checking types stay on the pthread lock */
+	mtx = pth_mtx_new ();
+	pth_mtxattr_init (mtx);
+	pth_mtxattr_set (mtx, PTHDR_MUTEX_TYPE, PTHREAD_MUTEX_RECURSIVE);
+	pth_mtx_init (mtx);
+	bad += pth_mtxattr_set (mtx, PTHDR_MUTEX_ADAPTIVE, 0) != CAF_ERROR_SUB;
+	bad += pth_mtxattr_get (mtx, PTHDR_MUTEX_ADAPTIVE, &spin) == CAF_OK;
+	bad += pth_mtx_lock (mtx) != CAF_OK;
+	bad += pth_mtx_lock (mtx) != CAF_OK;
+	bad += pth_mtx_unlock (mtx) != CAF_OK;
+	bad += pth_mtx_unlock (mtx) != CAF_OK;
+	pth_mtxattr_set (mtx, PTHDR_MUTEX_TYPE, PTHREAD_MUTEX_ERRORCHECK);
+	bad += pth_mtxattr_set (mtx, PTHDR_MUTEX_ADAPTIVE, 0) != CAF_ERROR_SUB;
+	mutex_delete (mtx);
+	mtx = mutex_new (1);
+	bad += pth_mtxattr_set (mtx, PTHDR_MUTEX_TYPE, PTHREAD_MUTEX_RECURSIVE)
+		!= CAF_ERROR_SUB;
+	bad += pth_mtxattr_set (mtx, PTHDR_MUTEX_TYPE, PTHREAD_MUTEX_NORMAL)
+		!= CAF_OK;
+	mutex_delete (mtx);
+	if (bad != 0) {
+		printf ("adaptive mutex check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+void *
+hold_thread (void *p) {
+	pth_rwlock_t *rwl = (pth_rwlock_t *)p;
+	pth_rwl_rdlock (rwl, 0, (struct timespec *)NULL);
+	return (void *)NULL;
+}
+
+
+void *
+wait_thread (void *p) {
+	pth_rwlock_t *rwl = (pth_rwlock_t *)p;
+	pth_rwl_wrlock (rwl, 0, (struct timespec *)NULL);
+	pth_rwl_unlock (rwl);
+	return (void *)NULL;
+}
+
+
+static int
+check_rwlock (pth_rwlock_types_t mode) {
+	pth_rwlock_t *rwl = rwlock_new (mode);
+	struct timespec ts;
+	pthread_t thr;
+	int bad = 0;
+	bad += pth_rwl_rdlock (rwl, 0, (struct timespec *)NULL) != CAF_OK;
+	bad += pth_rwl_rdlock (rwl, 1, (struct timespec *)NULL) != CAF_OK;
+	bad += pth_rwl_wrlock (rwl, 1, (struct timespec *)NULL) == CAF_OK;
+	deadline (&ts, 20);
+	bad += pth_rwl_wrlock (rwl, 0, &ts) != CAF_ERROR_SUB;
+	pth_rwl_unlock (rwl);
+	pth_rwl_unlock (rwl);
+	bad += pth_rwl_wrlock (rwl, 0, (struct timespec *)NULL) != CAF_OK;
+	bad += pth_rwl_rdlock (rwl, 1, (struct timespec *)NULL) == CAF_OK;
+	deadline (&ts, 20);
+	bad += pth_rwl_rdlock (rwl, 0, &ts) != CAF_ERROR_SUB;
+	pth_rwl_unlock (rwl);
+	if (mode != 0) {
+		/* a reader from another thread holds while a writer waits */
+		pthread_create (&thr, (pthread_attr_t *)NULL, hold_thread, rwl);
+		pthread_join (thr, (void **)NULL);
+		pthread_create (&thr, (pthread_attr_t *)NULL, wait_thread, rwl);
+		while (__atomic_load_n (&(rwl->wwant), __ATOMIC_SEQ_CST) == 0) {
+			sched_yield ();
+		}
+		if (mode == PTHDR_RWLOCK_WRITER) {
+			bad += pth_rwl_rdlock (rwl, 1, (struct timespec *)NULL)
+				== CAF_OK;
+		} else {
+			bad += pth_rwl_rdlock (rwl, 1, (struct timespec *)NULL)
+				!= CAF_OK;
+			pth_rwl_unlock (rwl);
+		}
+		pth_rwl_unlock (rwl);
+		pthread_join (thr, (void **)NULL);
+		bad += rwl->state != 0 || rwl->wwant != 0;
+	}
+	rwlock_delete (rwl);
+	if (bad != 0) {
+		printf ("rwlock mode %d check: %d errors\n", (int)mode, bad);
+	}
+	return bad;
+}
+
+
+void *
+cond_thread (void *p) {
+	(void)p;
+	pth_mtx_lock (cmtx);
+	cflag = 1;
+	pth_cond_signal (ccond);
+	pth_mtx_unlock (cmtx);
+	return (void *)NULL;
+}
+
+
+static int
+check_cond (void) {
+	struct timespec ts;
+	pthread_t thr;
+	int bad = 0;
+	cmtx = mutex_new (1);
+	ccond = pth_condi_init ();
+	cflag = 0;
+	pth_mtx_lock (cmtx);
+	deadline (&ts, 20);
+	bad += pth_cond_timedwait (ccond, cmtx, &ts) != CAF_ERROR_SUB;
+	pthread_create (&thr, (pthread_attr_t *)NULL, cond_thread, NULL);
+	while (cflag == 0) {
+		bad += pth_cond_wait (ccond, cmtx) != CAF_OK;
+	}
+	pth_mtx_unlock (cmtx);
+	pthread_join (thr, (void **)NULL);
+	pth_condi_delete (ccond);
+	mutex_delete (cmtx);
+	if (bad != 0) {
+		printf ("adaptive cond check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+void *
+bench_thread (void *p) {
+	bench_t *b = (bench_t *)p;
+	unsigned int r = (unsigned int)(size_t)&r;
+	long writes = 0, seen = 0;
+	int i, rd;
+	for (i = 0; i < OPS / b->threads; i++) {
+		r = r * 1103515245u + 12345u;
+		rd = (int)((r >> 16) % 100) < b->read_pct;
+		if (b->mtx != (pth_mutex_t *)NULL) {
+			pth_mtx_lock (b->mtx);
+		} else if (rd) {
+			pth_rwl_rdlock (b->rwl, 0, (struct timespec *)NULL);
+		} else {
+			pth_rwl_wrlock (b->rwl, 0, (struct timespec *)NULL);
+		}
+		if (rd) {
+			seen += b->counter;
+		} else {
+			b->counter++;
+			writes++;
+		}
+		work (b->cs);
+		if (b->mtx != (pth_mutex_t *)NULL) {
+			pth_mtx_unlock (b->mtx);
+		} else {
+			pth_rwl_unlock (b->rwl);
+		}
+		work (OUTSIDE_WORK);
+	}
+	__atomic_add_fetch (&(b->writes), writes, __ATOMIC_RELAXED);
+	return (void *)seen;
+}
+
+
+static double
+run (bench_t *b) {
+	pthread_t thr[MAX_THREADS];
+	struct timespec t0, t1;
+	int i;
+	switch (b->kind) {
+	case LOCK_MUTEX:
+	case LOCK_ADAPTIVE:
+		b->mtx = mutex_new (b->kind == LOCK_ADAPTIVE);
+		break;
+	case LOCK_READER:
+		b->rwl = rwlock_new (PTHDR_RWLOCK_READER);
+		break;
+	case LOCK_WRITER:
+		b->rwl = rwlock_new (PTHDR_RWLOCK_WRITER);
+		break;
+	default:
+		b->rwl = rwlock_new ((pth_rwlock_types_t)0);
+		break;
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < b->threads; i++) {
+		pthread_create (&(thr[i]), (pthread_attr_t *)NULL, bench_thread, b);
+	}
+	for (i = 0; i < b->threads; i++) {
+		pthread_join (thr[i], (void **)NULL);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	if (b->mtx != (pth_mutex_t *)NULL) {
+		mutex_delete (b->mtx);
+	} else {
+		rwlock_delete (b->rwl);
+	}
+	return (double)(OPS / b->threads * b->threads)
+		/ ((double)(t1.tv_sec - t0.tv_sec) * 1e6
+		   + (double)(t1.tv_nsec - t0.tv_nsec) / 1e3);
+}
+
+/* caf_locks.c ends here */
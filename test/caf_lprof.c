@@ -0,0 +1,321 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include <caf/caf.h>
+#include <caf/caf_ipc_shm.h>
+#include <caf/caf_thread_mutex.h>
+#include <caf/caf_thread_rwlock.h>
+#include <caf/caf_thread_cond.h>
+#include <caf/caf_thread_lprof.h>
+
+
+#define OPS                 1000000
+#define HOLD_MS             20
+
+static pth_mutex_t *gmtx;
+
+void *lock_thread (void *p);
+static void sleep_ms (long ms);
+static void deadline (struct timespec *ts, long ms);
+static pth_mutex_t *mutex_new (int adaptive);
+static void mutex_delete (pth_mutex_t *mtx);
+static int check_mutex (int adaptive);
+static int check_rwlock (void);
+static int check_dump (void);
+static int check_holds (void);
+static double overhead (int adaptive, int id);
+
+
+int
+main () {
+	int errors;
+	pth_lprof_sample (1);
+	errors = check_mutex (0);
+	errors += check_mutex (1);
+	errors += check_rwlock ();
+	errors += check_dump ();
+	errors += check_holds ();
+	pth_lprof_dump (stdout);
+	pth_lprof_sample (CAF_PTH_LPROF_SAMPLE);
+	printf ("%-10s %10s %10s\n", "lock", "plain ns", "profiled");
+	printf ("%-10s %10.1f %10.1f\n", "mutex", overhead (0, -1),
+			overhead (0, 100));
+	printf ("%-10s %10.1f %10.1f\n", "adaptive", overhead (1, -1),
+			overhead (1, 101));
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static void
+sleep_ms (long ms) {
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep (&ts, (struct timespec *)NULL);
+}
+
+
+static void
+deadline (struct timespec *ts, long ms) {
+	clock_gettime (CLOCK_REALTIME, ts);
+	ts->tv_nsec += ms * 1000000L;
+	ts->tv_sec += ts->tv_nsec / 1000000000L;
+	ts->tv_nsec %= 1000000000L;
+}
+
+
+static pth_mutex_t *
+mutex_new (int adaptive) {
+	pth_mutex_t *mtx = pth_mtx_new ();
+	pth_mtxattr_init (mtx);
+	pth_mtx_init (mtx);
+	if (adaptive) {
+		pth_mtxattr_set (mtx, PTHDR_MUTEX_ADAPTIVE, 0);
+	}
+	return mtx;
+}
+
+
+static void
+mutex_delete (pth_mutex_t *mtx) {
+	pth_mtx_destroy (mtx);
+	pth_mtxattr_destroy (mtx);
+	pth_mtx_delete (mtx);
+}
+
+
+void *
+lock_thread (void *p) {
+	(void)p;
+	pth_mtx_lock (gmtx);
+	pth_mtx_unlock (gmtx);
+	return (void *)NULL;
+}
+
+
+static int
+check_mutex (int adaptive) {
+	pth_lprof_t *p;
+	pth_cond_t *c;
+	struct timespec ts;
+	pthread_t thr;
+	int bad = 0, i, id = -1;
+	gmtx = mutex_new (adaptive);
+	bad += pth_mtxattr_get (gmtx, PTHDR_MUTEX_PROFILE, &id) == CAF_OK;
+	bad += pth_mtxattr_set (gmtx, PTHDR_MUTEX_PROFILE, 10 + adaptive)
+		!= CAF_OK;
+	bad += pth_mtxattr_get (gmtx, PTHDR_MUTEX_PROFILE, &id) != CAF_OK;
+	bad += id != 10 + adaptive;
+	p = pth_lprof_get (PTH_LPROF_MUTEX, 10 + adaptive);
+	for (i = 0; i < 100; i++) {
+		pth_mtx_lock (gmtx);
+		pth_mtx_unlock (gmtx);
+	}
+	bad += p->acq != 100 || p->contended != 0 || p->holds != 100;
+	/* a waiter queued behind a held lock is contended */
+	pth_mtx_lock (gmtx);
+	bad += pth_mtx_trylock (gmtx) == CAF_OK;
+	pthread_create (&thr, (pthread_attr_t *)NULL, lock_thread, NULL);
+	sleep_ms (HOLD_MS);
+	pth_mtx_unlock (gmtx);
+	pthread_join (thr, (void **)NULL);
+	bad += p->acq != 102 || p->contended != 1 || p->fails != 1;
+	bad += p->wait_max < HOLD_MS * 500000LL;
+	bad += p->hold_max < HOLD_MS * 1000000LL;
+	bad += p->wait_hist[0] != 0;
+	/* condition waits count apart from lock waits */
+	c = pth_condi_init ();
+	pth_mtx_lock (gmtx);
+	deadline (&ts, HOLD_MS);
+	bad += pth_cond_timedwait (c, gmtx, &ts) != CAF_ERROR_SUB;
+	pth_mtx_unlock (gmtx);
+	pth_condi_delete (c);
+	bad += p->cond_waits != 1 || p->cond_ns < HOLD_MS * 500000LL;
+	bad += p->acq != 104;
+	bad += pth_mtxattr_set (gmtx, PTHDR_MUTEX_PROFILE, -1) != CAF_OK;
+	pth_mtx_lock (gmtx);
+	pth_mtx_unlock (gmtx);
+	bad += p->acq != 104;
+	mutex_delete (gmtx);
+	if (bad != 0) {
+		printf ("mutex %d profile check: %d errors\n", adaptive, bad);
+	}
+	return bad;
+}
+
+
+static int
+check_rwlock (void) {
+	pth_rwlock_t *rwl = pth_rwl_new (20);
+	struct timespec ts;
+	pth_lprof_t *p;
+	int bad = 0;
+	pth_rwlattr_init (rwl);
+	pth_rwl_init (rwl);
+	pth_rwlattr_set (rwl, PTHDR_RWLOCK_WRITER, 0);
+	bad += pth_rwlattr_set (rwl, PTHDR_RWLOCK_PROFILE, 1) != CAF_OK;
+	p = pth_lprof_get (PTH_LPROF_RWLOCK, 20);
+	bad += rwl->prof != p;
+	pth_rwl_rdlock (rwl, 0, (struct timespec *)NULL);
+	pth_rwl_rdlock (rwl, 0, (struct timespec *)NULL);
+	bad += pth_rwl_wrlock (rwl, 1, (struct timespec *)NULL) == CAF_OK;
+	deadline (&ts, HOLD_MS);
+	bad += pth_rwl_wrlock (rwl, 0, &ts) == CAF_OK;
+	pth_rwl_unlock (rwl);
+	pth_rwl_unlock (rwl);
+	pth_rwl_wrlock (rwl, 0, (struct timespec *)NULL);
+	pth_rwl_unlock (rwl);
+	bad += p->acq != 3 || p->rd_acq != 2 || p->fails != 2;
+	bad += p->holds != 1 || p->contended != 0;
+	/* zero is a valid setting, a negative one stops profiling */
+	bad += pth_rwlattr_set (rwl, PTHDR_RWLOCK_PROFILE, 0) != CAF_OK;
+	bad += rwl->prof != p;
+	bad += pth_rwlattr_set (rwl, PTHDR_RWLOCK_PROFILE, -1) != CAF_OK;
+	bad += pth_rwlattr_get (rwl, PTHDR_RWLOCK_PROFILE, (int *)NULL) == CAF_OK;
+	pth_rwl_wrlock (rwl, 0, (struct timespec *)NULL);
+	pth_rwl_unlock (rwl);
+	bad += p->acq != 3;
+	pth_rwl_destroy (rwl);
+	pth_rwlattr_destroy (rwl);
+	pth_rwl_delete (rwl);
+	if (bad != 0) {
+		printf ("rwlock profile check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_dump (void) {
+	pth_lprof_tab_t *tab;
+	caf_shm_alloc_t *s;
+	char line[256];
+	FILE *f;
+	int bad = 0, lines = 0;
+	key_t key = (key_t)(0x4c500000 | (getpid () & 0xffff));
+	f = tmpfile ();
+	bad += pth_lprof_dump (f) != CAF_OK;
+	rewind (f);
+	while (fgets (line, sizeof (line), f) != (char *)NULL) {
+		lines += strncmp (line, "mutex", 5) == 0
+			|| strncmp (line, "rwlock", 6) == 0;
+	}
+	fclose (f);
+	bad += lines != 3;
+	/* another process would attach the segment the same way */
+	if (pth_lprof_dump_shm (key) != CAF_OK) {
+		printf ("no shared memory, skipping the segment check\n");
+		return bad;
+	}
+	s = caf_shm_seg_new (key, sizeof (pth_lprof_tab_t), 0600);
+	if (s == (caf_shm_alloc_t *)NULL) {
+		return bad + 1;
+	}
+	tab = (pth_lprof_tab_t *)caf_shm_seg_attach (s);
+	bad += tab == (pth_lprof_tab_t *)NULL;
+	if (tab != (pth_lprof_tab_t *)NULL) {
+		bad += tab->magic != CAF_PTH_LPROF_MAGIC || tab->used != 3;
+		bad += tab->ent[2].kind != PTH_LPROF_RWLOCK || tab->ent[2].id != 20;
+	}
+	caf_shm_seg_delete (s);
+	if (bad != 0) {
+		printf ("profile dump check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+/* overlapping holds of locks sharing an entry, and recursive holds */
+static int
+check_holds (void) {
+	pth_mutex_t *a = mutex_new (0), *b = mutex_new (1), *r = pth_mtx_new ();
+	pth_lprof_t *p, *q;
+	int bad = 0;
+	pth_mtxattr_set (a, PTHDR_MUTEX_PROFILE, 30);
+	pth_mtxattr_set (b, PTHDR_MUTEX_PROFILE, 30);
+	p = pth_lprof_get (PTH_LPROF_MUTEX, 30);
+	pth_mtx_lock (a);
+	sleep_ms (HOLD_MS);
+	pth_mtx_lock (b);
+	pth_mtx_unlock (a);
+	pth_mtx_unlock (b);
+	bad += p->acq != 2 || p->holds != 2;
+	bad += p->hold_max < HOLD_MS * 1000000LL;
+	bad += p->hold_ns > 3 * HOLD_MS * 1000000LL;
+	pth_mtxattr_init (r);
+	pth_mtxattr_set (r, PTHDR_MUTEX_TYPE, PTHREAD_MUTEX_RECURSIVE);
+	pth_mtx_init (r);
+	pth_mtxattr_set (r, PTHDR_MUTEX_PROFILE, 31);
+	q = pth_lprof_get (PTH_LPROF_MUTEX, 31);
+	pth_mtx_lock (r);
+	bad += pth_mtx_lock (r) != CAF_OK;
+	pth_mtx_unlock (r);
+	sleep_ms (HOLD_MS);
+	pth_mtx_unlock (r);
+	bad += q->acq != 2 || q->holds != 1;
+	bad += q->hold_max < HOLD_MS * 1000000LL;
+	mutex_delete (a);
+	mutex_delete (b);
+	mutex_delete (r);
+	if (bad != 0) {
+		printf ("hold check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+overhead (int adaptive, int id) {
+	pth_mutex_t *mtx = mutex_new (adaptive);
+	struct timespec t0, t1;
+	int i;
+	if (id >= 0) {
+		pth_mtxattr_set (mtx, PTHDR_MUTEX_PROFILE, id);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < OPS; i++) {
+		pth_mtx_lock (mtx);
+		pth_mtx_unlock (mtx);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	mutex_delete (mtx);
+	return ((double)(t1.tv_sec - t0.tv_sec) * 1e9
+			+ (double)(t1.tv_nsec - t0.tv_nsec)) / (double)OPS;
+}
+
+/* caf_lprof.c ends here */
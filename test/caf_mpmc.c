@@ -0,0 +1,315 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_thread_attr.h>
+#include <caf/caf_thread_pool.h>
+#include <caf/caf_thread_mutex.h>
+#include <caf/caf_thread_cond.h>
+#include <caf/caf_thread_mpmc.h>
+
+
+#define QUEUE_SIZE          1024
+#define QUEUE_ITEMS         400000
+#define PING_ROUNDS         20000
+
+typedef enum {
+	MODE_LOCKED = 0,
+	MODE_MPMC
+} mode_t_;
+
+static const char *mode_names[] = { "mutex+deque", "mpmc" };
+
+static const int thread_counts[] = { 2, 4, 16, 32 };
+
+/* the mutex, condition and deque pattern used before the mpmc queue */
+typedef struct {
+	pth_mutex_t *m;
+	pth_cond_t *not_empty;
+	pth_cond_t *not_full;
+	deque_t *d;
+	int size;
+} locked_t;
+
+static mode_t_ mode;
+static int threads;
+static int next_thread;
+static int claimed;
+static int errors;
+static unsigned long sum;
+static pth_mpmc_t *mq[2];
+static locked_t *lq[2];
+
+void *pth_rtn (void *p);
+void *ping_rtn (void *p);
+static locked_t *locked_new (void);
+static void locked_delete (locked_t *q);
+static void q_push (int i, void *data);
+static void *q_pop (int i);
+static int check_api (void);
+static double run (pth_attri_t *attr, int n, void *(*rtn)(void *));
+
+int
+main () {
+	pth_attri_t *attr;
+	double secs;
+	int i, m;
+	errors = check_api ();
+	attr = pth_attri_new ();
+	pth_attr_init (attr);
+	pth_attri_set (attr, PTH_ATTR_JOINABLE, (void *)NULL);
+	printf ("%-12s %8s %12s\n", "queue", "threads", "Mops/s");
+	for (m = MODE_LOCKED; m <= MODE_MPMC; m++) {
+		mode = (mode_t_)m;
+		for (i = 0; i < (int)(sizeof (thread_counts) / sizeof (int)); i++) {
+			threads = thread_counts[i];
+			secs = run (attr, threads, pth_rtn);
+			printf ("%-12s %8d %12.2f\n", mode_names[m], threads,
+					(double)QUEUE_ITEMS / secs / 1e6);
+		}
+	}
+	printf ("%-12s %8s %12s\n", "queue", "", "ping-pong ns");
+	for (m = MODE_LOCKED; m <= MODE_MPMC; m++) {
+		mode = (mode_t_)m;
+		secs = run (attr, 2, ping_rtn);
+		printf ("%-12s %8s %12.1f\n", mode_names[m], "",
+				secs * 1e9 / PING_ROUNDS);
+	}
+	pth_attr_destroy (attr);
+	pth_attri_delete (attr);
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static int
+check_api (void) {
+	pth_mpmc_t *q;
+	struct timespec to;
+	void *data;
+	long i;
+	int bad = 0;
+	q = pth_mpmc_new (3);
+	bad += q == (pth_mpmc_t *)NULL || q->mask != 3;
+	for (i = 1; i <= 4; i++) {
+		bad += pth_mpmc_trypush (q, (void *)i) != CAF_OK;
+	}
+	bad += pth_mpmc_trypush (q, (void *)i) != CAF_ERROR;
+	bad += pth_mpmc_count (q) != 4;
+	clock_gettime (CLOCK_REALTIME, &to);
+	to.tv_nsec += 10000000;
+	if (to.tv_nsec >= 1000000000) {
+		to.tv_sec++;
+		to.tv_nsec -= 1000000000;
+	}
+	bad += pth_mpmc_push (q, (void *)i, &to) != CAF_ERROR_SUB;
+	for (i = 1; i <= 4; i++) {
+		bad += pth_mpmc_trypop (q, &data) != CAF_OK || (long)data != i;
+	}
+	bad += pth_mpmc_trypop (q, &data) != CAF_ERROR;
+	bad += pth_mpmc_pop (q, &data, &to) != CAF_ERROR_SUB;
+	pth_mpmc_delete (q);
+	if (bad != 0) {
+		printf ("api check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run (pth_attri_t *attr, int n, void *(*rtn)(void *)) {
+	pth_pool_t *pool;
+	struct timespec t0, t1;
+	unsigned long producers = (unsigned long)n / 2, per, expect;
+	int i;
+	for (i = 0; i < 2; i++) {
+		mq[i] = pth_mpmc_new (QUEUE_SIZE);
+		lq[i] = locked_new ();
+	}
+	next_thread = 0;
+	claimed = 0;
+	sum = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	pool = pth_pool_create (attr, rtn, n, (void *)NULL);
+	if (pool == (pth_pool_t *)NULL) {
+		errors++;
+		return 1.0;
+	}
+	pth_pool_join (pool);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_pool_delete (pool);
+	if (rtn == pth_rtn) {
+		/* producer p pushes 1 .. per tagged with p, see pth_rtn */
+		per = QUEUE_ITEMS / producers;
+		expect = producers * per * (per + 1) / 2
+			+ (producers * (producers - 1) / 2) * per * 0x1000000UL;
+		if (sum != expect) {
+			printf ("%s, %d threads: checksum %lu, expected %lu\n",
+					mode_names[mode], n, sum, expect);
+			errors++;
+		}
+	}
+	for (i = 0; i < 2; i++) {
+		pth_mpmc_delete (mq[i]);
+		locked_delete (lq[i]);
+	}
+	return (double)(t1.tv_sec - t0.tv_sec)
+		+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+
+/*
+ * Half the threads produce, half consume. Each consumer checks that
+ * the items of every producer arrive in order.
+ */
+void *
+pth_rtn (void *p) {
+	int id = __atomic_fetch_add (&next_thread, 1, __ATOMIC_RELAXED);
+	int producers = threads / 2, total, i, bad = 0;
+	unsigned long v, local = 0, last[64];
+	(void)p;
+	total = (QUEUE_ITEMS / producers) * producers;
+	if (id < producers) {
+		for (i = 1; i <= QUEUE_ITEMS / producers; i++) {
+			q_push (0, (void *)(((unsigned long)id << 24) | (unsigned long)i));
+		}
+	} else {
+		memset (last, 0, sizeof (last));
+		while (__atomic_fetch_add (&claimed, 1, __ATOMIC_RELAXED) < total) {
+			v = (unsigned long)q_pop (0);
+			if ((v & 0xffffff) <= last[v >> 24]) {
+				bad++;
+			}
+			last[v >> 24] = v & 0xffffff;
+			local += v;
+		}
+		__atomic_fetch_add (&sum, local, __ATOMIC_RELAXED);
+	}
+	if (bad > 0) {
+		__atomic_fetch_add (&errors, bad, __ATOMIC_RELAXED);
+	}
+	pthread_exit (NULL);
+}
+
+
+/* two threads bounce a token through two queues */
+void *
+ping_rtn (void *p) {
+	int id = __atomic_fetch_add (&next_thread, 1, __ATOMIC_RELAXED);
+	long i;
+	(void)p;
+	for (i = 1; i <= PING_ROUNDS; i++) {
+		if (id == 0) {
+			q_push (0, (void *)i);
+			if ((long)q_pop (1) != i) {
+				__atomic_fetch_add (&errors, 1, __ATOMIC_RELAXED);
+			}
+		} else {
+			q_push (1, q_pop (0));
+		}
+	}
+	pthread_exit (NULL);
+}
+
+
+static void
+q_push (int i, void *data) {
+	locked_t *q;
+	if (mode == MODE_MPMC) {
+		pth_mpmc_push (mq[i], data, (struct timespec *)NULL);
+		return;
+	}
+	q = lq[i];
+	pth_mtx_lock (q->m);
+	while (q->size >= QUEUE_SIZE) {
+		pth_cond_wait (q->not_full, q->m);
+	}
+	deque_push (q->d, data);
+	q->size++;
+	pth_cond_signal (q->not_empty);
+	pth_mtx_unlock (q->m);
+}
+
+
+static void *
+q_pop (int i) {
+	locked_t *q;
+	caf_dequen_t *n;
+	void *data = (void *)NULL;
+	if (mode == MODE_MPMC) {
+		pth_mpmc_pop (mq[i], &data, (struct timespec *)NULL);
+		return data;
+	}
+	q = lq[i];
+	pth_mtx_lock (q->m);
+	while (q->size == 0) {
+		pth_cond_wait (q->not_empty, q->m);
+	}
+	n = deque_first (q->d);
+	q->size--;
+	pth_cond_signal (q->not_full);
+	pth_mtx_unlock (q->m);
+	data = n->data;
+	deque_node_release (q->d, n);
+	return data;
+}
+
+
+static locked_t *
+locked_new (void) {
+	locked_t *q = (locked_t *)xmalloc (sizeof (locked_t));
+	q->m = pth_mtx_new ();
+	pth_mtxattr_init (q->m);
+	pth_mtx_init (q->m);
+	q->not_empty = pth_condi_init ();
+	q->not_full = pth_condi_init ();
+	q->d = deque_create ();
+	q->size = 0;
+	return q;
+}
+
+
+static void
+locked_delete (locked_t *q) {
+	deque_delete_nocb (q->d);
+	pth_condi_delete (q->not_empty);
+	pth_condi_delete (q->not_full);
+	pth_mtx_destroy (q->m);
+	pth_mtxattr_destroy (q->m);
+	pth_mtx_delete (q->m);
+	xfree (q);
+}
+
+/* caf_mpmc.c ends here */
@@ -0,0 +1,188 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+
+
+#define BLOCKS              100
+#define BLOCK_SZ            48
+
+#ifdef CAFFEINE_MEMTRACE
+
+static int check_sites (void);
+static int check_realloc (void);
+static int check_report (void);
+
+
+int
+main () {
+	int errors;
+	errors = check_sites ();
+	errors += check_realloc ();
+	errors += check_report ();
+	caf_mtrace_dump (1, 5);
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static int
+check_sites (void) {
+	caf_mtrace_site_t *s, total;
+	void *p[BLOCKS];
+	deque_t *lst;
+	size_t bytes;
+	int bad = 0, i, line = 0;
+	caf_mtrace_stats (&total);
+	bytes = total.bytes;
+	for (i = 0; i < BLOCKS; i++) {
+		line = __LINE__; p[i] = xmalloc (BLOCK_SZ);
+	}
+	s = caf_mtrace_find (__FILE__, line);
+	bad += s == (caf_mtrace_site_t *)NULL;
+	if (s == (caf_mtrace_site_t *)NULL) {
+		return bad;
+	}
+	bad += s->allocs != BLOCKS || s->live != BLOCKS;
+	bad += s->bytes != BLOCKS * BLOCK_SZ || s->peak != BLOCKS * BLOCK_SZ;
+	for (i = 0; i < BLOCKS / 2; i++) {
+		xfree (p[i]);
+	}
+	bad += s->live != BLOCKS / 2 || s->frees != BLOCKS / 2;
+	bad += s->bytes != (BLOCKS / 2) * BLOCK_SZ;
+	bad += s->peak != BLOCKS * BLOCK_SZ;
+	/* library allocations are accounted to library sites */
+	lst = deque_create ();
+	deque_push (lst, (void *)NULL);
+	caf_mtrace_stats (&total);
+	bad += total.bytes < bytes + (BLOCKS / 2) * BLOCK_SZ + CAF_DEQUE_SZ;
+	deque_delete_nocb (lst);
+	for (i = BLOCKS / 2; i < BLOCKS; i++) {
+		xfree (p[i]);
+	}
+	caf_mtrace_stats (&total);
+	bad += total.bytes != bytes || s->bytes != 0 || s->live != 0;
+	/* blocks from plain malloc are released without accounting */
+	xfree (malloc (BLOCK_SZ));
+	caf_mtrace_stats (&total);
+	bad += total.bytes != bytes;
+	if (bad != 0) {
+		printf ("check_sites: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_realloc (void) {
+	caf_mtrace_site_t *a, *b;
+	char *p;
+	int bad = 0, la, lb;
+	la = __LINE__; p = (char *)xmalloc (16);
+	lb = __LINE__; p = (char *)xrealloc (p, 4096);
+	a = caf_mtrace_find (__FILE__, la);
+	b = caf_mtrace_find (__FILE__, lb);
+	bad += a == (caf_mtrace_site_t *)NULL || b == (caf_mtrace_site_t *)NULL;
+	if (bad != 0) {
+		return bad;
+	}
+	bad += a->bytes != 0 || a->live != 0 || a->frees != 1;
+	bad += b->bytes != 4096 || b->live != 1;
+	xfree (p);
+	bad += b->bytes != 0 || b->frees != 1;
+	/* without a block it allocates */
+	la = __LINE__; p = (char *)xrealloc ((void *)NULL, 8);
+	a = caf_mtrace_find (__FILE__, la);
+	bad += a == (caf_mtrace_site_t *)NULL || a->bytes != 8;
+	xfree (p);
+	/* a failed realloc leaves the block traced at its site */
+	la = __LINE__; p = (char *)xmalloc (16);
+	a = caf_mtrace_find (__FILE__, la);
+	bad += xrealloc (p, (size_t)-1 / 2) != (void *)NULL;
+	bad += a == (caf_mtrace_site_t *)NULL || a->bytes != 16 || a->live != 1;
+	xfree (p);
+	bad += a == (caf_mtrace_site_t *)NULL || a->bytes != 0 || a->frees != 1;
+	if (bad != 0) {
+		printf ("check_realloc: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_report (void) {
+	char name[] = "/tmp/caf_mtraceXXXXXX", buf[4096], site[64];
+	void *p;
+	int bad = 0, fd, line;
+	ssize_t n;
+	fd = mkstemp (name);
+	if (fd < 0) {
+		return 1;
+	}
+	unlink (name);
+	line = __LINE__; p = xmalloc (1 << 20);
+	bad += caf_mtrace_report (fd, 3, SIGUSR1) != CAF_OK;
+	raise (SIGUSR1);
+	n = pread (fd, buf, sizeof (buf) - 1, 0);
+	bad += n <= 0;
+	if (n > 0) {
+		buf[n] = '\0';
+		/* the biggest site leads the report */
+		snprintf (site, sizeof (site), "%s:%d\n", __FILE__, line);
+		bad += strstr (buf, "caf_mtrace:") != buf;
+		bad += strstr (buf, site) == (char *)NULL;
+		bad += strstr (buf, "1048576") == (char *)NULL;
+	}
+	xfree (p);
+	/* the exit report goes to stdout */
+	caf_mtrace_report (1, 5, 0);
+	close (fd);
+	if (bad != 0) {
+		printf ("check_report: %d errors\n", bad);
+	}
+	return bad;
+}
+
+#else /* !CAFFEINE_MEMTRACE */
+
+int
+main () {
+	printf ("built without CAFFEINE_MEMTRACE, nothing to check\n");
+	return 0;
+}
+
+#endif /* !CAFFEINE_MEMTRACE */
+
+/* caf_mtrace.c ends here */
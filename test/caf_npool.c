@@ -0,0 +1,200 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_cdeque.h>
+#include <caf/caf_data_lstc.h>
+
+
+#define CHURN_ELEMENTS          1000
+#define CHURN_ROUNDS            1000
+#define SMALL_CAP               16
+
+static int check (const char *name, caf_npool_t *pool, size_t allocs);
+static double churn_deque (deque_t *lst);
+static double churn_cdeque (cdeque_t *lst);
+static double churn_lstc (lstcn_t *lst);
+
+int
+main () {
+	caf_npool_t *pool;
+	deque_t *dq;
+	cdeque_t *cdq;
+	lstcn_t *lc;
+	double tp, th;
+	size_t allocs;
+	int errors = 0;
+
+	printf ("%-8s %12s %12s %10s\n", "list", "heap ns/op", "pool ns/op",
+			"mallocs");
+
+	pool = caf_npool_new (CAF_CAF_DEQUENODE_SZ, CAF_NPOOL_CAP);
+	dq = deque_create ();
+	th = churn_deque (dq);
+	deque_delete_nocb (dq);
+	dq = deque_create_pool (pool);
+	churn_deque (dq);
+	allocs = pool->allocs;
+	tp = churn_deque (dq);
+	printf ("%-8s %12.2f %12.2f %10lu\n", "deque", th, tp,
+			(unsigned long)(pool->allocs - allocs));
+	errors += check ("deque", pool, allocs);
+	deque_delete_nocb (dq);
+	caf_npool_delete (pool);
+
+	pool = caf_npool_new (CAF_LSTDLCNODE_SZ, CAF_NPOOL_CAP);
+	cdq = cdeque_create ();
+	th = churn_cdeque (cdq);
+	cdeque_delete_nocb (cdq);
+	cdq = cdeque_create_pool (pool);
+	churn_cdeque (cdq);
+	allocs = pool->allocs;
+	tp = churn_cdeque (cdq);
+	printf ("%-8s %12.2f %12.2f %10lu\n", "cdeque", th, tp,
+			(unsigned long)(pool->allocs - allocs));
+	errors += check ("cdeque", pool, allocs);
+	cdeque_delete_nocb (cdq);
+	caf_npool_delete (pool);
+
+	pool = caf_npool_new (CAF_LSTC_SZ, CAF_NPOOL_CAP);
+	lc = lstc_new ((void *)NULL);
+	th = churn_lstc (lc);
+	lstc_pool_set (pool);
+	churn_lstc (lc);
+	allocs = pool->allocs;
+	tp = churn_lstc (lc);
+	printf ("%-8s %12.2f %12.2f %10lu\n", "lstc", th, tp,
+			(unsigned long)(pool->allocs - allocs));
+	errors += check ("lstc", pool, allocs);
+	lstc_pool_set ((caf_npool_t *)NULL);
+	xfree (lc);
+	caf_npool_delete (pool);
+
+	/* the cap bounds the cached nodes, the rest go back to the heap */
+	pool = caf_npool_new (CAF_CAF_DEQUENODE_SZ, SMALL_CAP);
+	dq = deque_create_pool (pool);
+	churn_deque (dq);
+	if (pool->cached != SMALL_CAP
+		|| pool->frees != pool->allocs - SMALL_CAP) {
+		printf ("cap: cached %lu, allocs %lu, frees %lu\n",
+				(unsigned long)pool->cached, (unsigned long)pool->allocs,
+				(unsigned long)pool->frees);
+		errors++;
+	}
+	caf_npool_set_cap (pool, 0);
+	if (pool->cached != 0 || pool->free != NULL) {
+		printf ("cap: trim left %lu nodes\n", (unsigned long)pool->cached);
+		errors++;
+	}
+	deque_delete_nocb (dq);
+	caf_npool_delete (pool);
+
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static int
+check (const char *name, caf_npool_t *pool, size_t allocs) {
+	if (pool->allocs != allocs || pool->allocs > CHURN_ELEMENTS + 1
+		|| pool->hits < CHURN_ELEMENTS * CHURN_ROUNDS) {
+		printf ("%s: steady state allocated %lu nodes\n", name,
+				(unsigned long)(pool->allocs - allocs));
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+elapsed (struct timespec *t0, struct timespec *t1) {
+	return (double)(t1->tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+
+static double
+churn_deque (deque_t *lst) {
+	struct timespec t0, t1;
+	long i, r;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < CHURN_ROUNDS; r++) {
+		for (i = 0; i < CHURN_ELEMENTS; i++) {
+			deque_push (lst, (void *)i);
+		}
+		for (i = 0; i < CHURN_ELEMENTS; i++) {
+			deque_node_release (lst, deque_first (lst));
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return elapsed (&t0, &t1) / (CHURN_ROUNDS * CHURN_ELEMENTS);
+}
+
+
+static double
+churn_cdeque (cdeque_t *lst) {
+	struct timespec t0, t1;
+	long i, r;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < CHURN_ROUNDS; r++) {
+		for (i = 0; i < CHURN_ELEMENTS; i++) {
+			cdeque_push (lst, (void *)i);
+		}
+		for (i = 0; i < CHURN_ELEMENTS; i++) {
+			cdeque_node_release (lst, cdeque_pop (lst));
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return elapsed (&t0, &t1) / (CHURN_ROUNDS * CHURN_ELEMENTS);
+}
+
+
+/* the list node itself holds the first element and is never popped */
+static double
+churn_lstc (lstcn_t *lst) {
+	struct timespec t0, t1;
+	long i, r;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < CHURN_ROUNDS; r++) {
+		for (i = 0; i < CHURN_ELEMENTS; i++) {
+			lstc_push (lst, (void *)i);
+		}
+		for (i = 0; i < CHURN_ELEMENTS; i++) {
+			lstc_node_release (lstc_pop (lst));
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return elapsed (&t0, &t1) / (CHURN_ROUNDS * CHURN_ELEMENTS);
+}
+
+/* caf_npool.c ends here */
@@ -0,0 +1,294 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_cdeque.h>
+#include <caf/caf_data_lstc.h>
+#include <caf/caf_thread_exec.h>
+#include <caf/caf_data_par.h>
+
+
+#define PMAP_ITEMS          100000
+#define PMAP_CHECK          10007
+#define ITEM_SPIN           200
+
+static const int worker_counts[] = { 1, 2, 4, 8, 32 };
+
+static long mapped;
+
+int map_item (void *p);
+int spin_item (void *p);
+int match_item (void *ndata, void *data);
+int keep_item (void *p);
+int match_mod (void *ndata, void *data);
+void *sum_item (void *acc, void *data);
+void *sum_comb (void *acc1, void *acc2);
+static int check (void);
+static int check_results (const char *name, caf_par_t *p, int n, int m,
+						  void *first, deque_t *all, void *sum);
+static double bench (int workers, caf_par_t **last);
+
+
+int
+main () {
+	caf_par_t *p = (caf_par_t *)NULL;
+	double base, secs;
+	int errors, i;
+	errors = check ();
+	base = bench (0, (caf_par_t **)NULL);
+	printf ("%-10s %8s %12s %8s\n", "map", "workers", "Mitems/s", "speedup");
+	printf ("%-10s %8d %12.2f %8.2f\n", "serial", 1,
+			(double)PMAP_ITEMS / base / 1e6, 1.0);
+	for (i = 0; i < (int)(sizeof (worker_counts) / sizeof (int)); i++) {
+		/* keep the 4 worker context for its chunk timings */
+		secs = bench (worker_counts[i], worker_counts[i] == 4
+					  ? &p : (caf_par_t **)NULL);
+		if (secs < 0) {
+			errors++;
+			continue;
+		}
+		printf ("%-10s %8d %12.2f %8.2f\n", "parallel", worker_counts[i],
+				(double)PMAP_ITEMS / secs / 1e6, base / secs);
+	}
+	if (p != (caf_par_t *)NULL) {
+		caf_par_dump (stdout, p);
+		pth_exec_delete (p->exec);
+		caf_par_delete (p);
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+int
+map_item (void *p) {
+	__atomic_add_fetch (&mapped, (long)p, __ATOMIC_RELAXED);
+	return CAF_OK;
+}
+
+
+int
+spin_item (void *p) {
+	volatile long x = (long)p;
+	int i;
+	for (i = 0; i < ITEM_SPIN; i++) {
+		x = x * 31 + i;
+	}
+	return CAF_OK;
+}
+
+
+int
+match_item (void *ndata, void *data) {
+	return ndata == data ? CAF_OK : CAF_ERROR;
+}
+
+
+int
+keep_item (void *p) {
+	(void)p;
+	return CAF_OK;
+}
+
+
+/* matches the items above data which are multiples of 1000 */
+int
+match_mod (void *ndata, void *data) {
+	long v = (long)ndata;
+	return (v > (long)data && v % 1000 == 0) ? CAF_OK : CAF_ERROR;
+}
+
+
+void *
+sum_item (void *acc, void *data) {
+	return (void *)((long)acc + (long)data);
+}
+
+
+void *
+sum_comb (void *acc1, void *acc2) {
+	return (void *)((long)acc1 + (long)acc2);
+}
+
+
+static int
+check_results (const char *name, caf_par_t *p, int n, int m, void *first,
+			   deque_t *all, void *sum) {
+	caf_dequen_t *dn;
+	long v = 0, expect = (long)n * (n - 1) / 2;
+	int bad = 0, c = 0;
+	bad += mapped != expect;
+	bad += m != n;
+	bad += (long)sum != expect;
+	/* items 1..n-1, so the first item above 500 matching is 1000 */
+	bad += n > 1000 ? (long)first != 1000 : first != NULL;
+	if (all == (deque_t *)NULL) {
+		bad++;
+	} else {
+		for (dn = all->head; dn != (caf_dequen_t *)NULL; dn = dn->next) {
+			v += 1000;
+			bad += (long)dn->data != v;
+			c++;
+		}
+		bad += c != (n - 1) / 1000 || all->size != c;
+		deque_delete_nocb (all);
+	}
+	if (p->used > p->chunks) {
+		bad++;
+	}
+	if (bad != 0) {
+		printf ("%s check, %d items: %d errors\n", name, n, bad);
+	}
+	return bad;
+}
+
+
+static int
+check (void) {
+	static const int sizes[] = { 0, 1, 3, 2048, PMAP_CHECK };
+	pth_exec_t *exec;
+	caf_par_t *p;
+	deque_t *dq, *all;
+	cdeque_t *cq;
+	lstcn_t *lc;
+	void *first, *sum;
+	long i;
+	int bad = 0, k, m;
+	exec = pth_exec_new ((pth_attri_t *)NULL, 4, 0);
+	p = caf_par_new (exec, 0);
+	if (exec == (pth_exec_t *)NULL || p == (caf_par_t *)NULL) {
+		printf ("cannot create executor\n");
+		return 1;
+	}
+	for (k = 0; k < (int)(sizeof (sizes) / sizeof (int)); k++) {
+		dq = deque_create ();
+		cq = cdeque_create ();
+		lc = lstc_create ();
+		for (i = 0; i < sizes[k]; i++) {
+			deque_push (dq, (void *)i);
+			cdeque_push (cq, (void *)i);
+			lstc_push (lc, (void *)i);
+		}
+		mapped = 0;
+		m = deque_pmap (p, dq, map_item);
+		first = deque_psearch (p, dq, (void *)500, match_mod);
+		all = deque_psearch_all (p, dq, (void *)0, match_mod);
+		sum = deque_preduce (p, dq, (void *)0, sum_item, sum_comb);
+		bad += check_results ("deque", p, sizes[k], m, first, all, sum);
+		mapped = 0;
+		m = cdeque_pmap (p, cq, map_item);
+		first = cdeque_psearch (p, cq, (void *)500, match_mod);
+		all = cdeque_psearch_all (p, cq, (void *)0, match_mod);
+		sum = cdeque_preduce (p, cq, (void *)0, sum_item, sum_comb);
+		bad += check_results ("cdeque", p, sizes[k], m, first, all, sum);
+		mapped = 0;
+		m = lstc_pmap (p, lc, map_item);
+		first = lstc_psearch (p, lc, (void *)500, match_mod);
+		all = lstc_psearch_all (p, lc, (void *)0, match_mod);
+		sum = lstc_preduce (p, lc, (void *)0, sum_item, sum_comb);
+		bad += check_results ("lstc", p, sizes[k], m, first, all, sum);
+		if (sizes[k] > 0) {
+			/* the last item is found even when earlier chunks miss */
+			i = sizes[k] - 1;
+			bad += deque_psearch (p, dq, (void *)i, match_item) != (void *)i;
+			bad += lstc_psearch (p, lc, (void *)-1, match_item) != NULL;
+		}
+		deque_delete_nocb (dq);
+		cdeque_delete_nocb (cq);
+		if (lstc_empty_list (lc) == CAF_OK) {
+			lstc_node_release (lc);
+		} else {
+			lstc_delete (lc, keep_item);
+		}
+	}
+	caf_par_delete (p);
+	pth_exec_delete (exec);
+	if (bad != 0) {
+		printf ("parallel check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+/* zero workers runs the serial deque_map */
+static double
+bench (int workers, caf_par_t **last) {
+	struct timespec t0, t1;
+	pth_exec_t *exec = (pth_exec_t *)NULL;
+	caf_par_t *p = (caf_par_t *)NULL;
+	deque_t *dq;
+	long i;
+	int m;
+	dq = deque_create ();
+	for (i = 0; i < PMAP_ITEMS; i++) {
+		deque_push (dq, (void *)i);
+	}
+	if (workers > 0) {
+		exec = pth_exec_new ((pth_attri_t *)NULL, workers, 0);
+		p = caf_par_new (exec, 0);
+		if (p == (caf_par_t *)NULL) {
+			printf ("cannot create executor\n");
+			return -1.0;
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	if (workers > 0) {
+		m = deque_pmap (p, dq, spin_item);
+	} else {
+		deque_map (dq, spin_item);
+		m = PMAP_ITEMS;
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	deque_delete_nocb (dq);
+	if (p != (caf_par_t *)NULL) {
+		if (last != (caf_par_t **)NULL) {
+			if (*last != (caf_par_t *)NULL) {
+				pth_exec_delete ((*last)->exec);
+				caf_par_delete (*last);
+			}
+			*last = p;
+		} else {
+			caf_par_delete (p);
+			pth_exec_delete (exec);
+		}
+	}
+	if (m != PMAP_ITEMS) {
+		printf ("%d workers: %d items mapped\n", workers, m);
+		return -1.0;
+	}
+	return (double)(t1.tv_sec - t0.tv_sec)
+		+ (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* caf_pmap.c ends here */
@@ -0,0 +1,393 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_hash_str.h>
+#include <caf/caf_hash_table.h>
+#include <caf/caf_thread_rwlock.h>
+#include <caf/caf_thread_seqlock.h>
+#include <caf/caf_thread_rcu.h>
+
+
+#define MAX_READERS         64
+#define RUN_MS              50
+#define WRITE_US            1000
+#define LIMITS              6
+#define TABLE_ID            17
+#define TABLE_KEYS          64
+
+typedef enum {
+	SYNC_RWLOCK = 0,
+	SYNC_SEQLOCK,
+	SYNC_RCU,
+	SYNC_KINDS
+} sync_kind_t;
+
+static const char *sync_names[SYNC_KINDS] = {
+	"rwlock", "seqlock", "rcu"
+};
+
+static const int readers[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+/* tables keep pointers to their keys */
+static char keys[TABLE_KEYS][16];
+
+/* a read-mostly configuration snapshot */
+typedef struct config_s config_t;
+struct config_s {
+	long version;
+	long limits[LIMITS];
+};
+
+typedef struct bench_s bench_t;
+struct bench_s {
+	sync_kind_t kind;
+	pth_rwlock_t *rwl;
+	pth_seqlock_t *sl;
+	pth_rcu_t *rcu;
+	config_t plain;
+	config_t *shared;
+	caf_hash_table_t *table;
+	int stop;
+	long reads;
+	long torn;
+};
+
+void *reader_thread (void *p);
+void *table_thread (void *p);
+void poison_config (void *p);
+void delete_table (void *p);
+static void sleep_us (long us);
+static void fill (config_t *c, long v);
+static int consistent (const config_t *c);
+static caf_hash_table_t *table_new (long v);
+static void update (bench_t *b, long v);
+static int check_register (void);
+static int check_table (void);
+static double run (sync_kind_t kind, int n, long *torn);
+
+
+int
+main () {
+	long torn = 0;
+	int errors, i, k;
+	errors = check_register ();
+	errors += check_table ();
+	printf ("Mreads/s with one writer every %dus\n", WRITE_US);
+	printf ("%7s", "readers");
+	for (k = 0; k < SYNC_KINDS; k++) {
+		printf (" %10s", sync_names[k]);
+	}
+	printf ("\n");
+	for (i = 0; i < (int)(sizeof (readers) / sizeof (int)); i++) {
+		printf ("%7d", readers[i]);
+		for (k = 0; k < SYNC_KINDS; k++) {
+			printf (" %10.3f", run ((sync_kind_t)k, readers[i], &torn));
+		}
+		printf ("\n");
+	}
+	/* readers never see a torn or reclaimed snapshot */
+	if (torn != 0) {
+		printf ("%ld inconsistent reads\n", torn);
+		errors++;
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static void
+sleep_us (long us) {
+	struct timespec ts;
+	ts.tv_sec = us / 1000000L;
+	ts.tv_nsec = (us % 1000000L) * 1000L;
+	nanosleep (&ts, (struct timespec *)NULL);
+}
+
+
+static void
+fill (config_t *c, long v) {
+	int i;
+	c->version = v;
+	for (i = 0; i < LIMITS; i++) {
+		c->limits[i] = v;
+	}
+}
+
+
+static int
+consistent (const config_t *c) {
+	int i;
+	for (i = 0; i < LIMITS; i++) {
+		if (c->limits[i] != c->version || c->version < 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/* freed snapshots are overwritten first, so late readers notice */
+void
+poison_config (void *p) {
+	fill ((config_t *)p, -1);
+	xfree (p);
+}
+
+
+static int
+check_register (void) {
+	pth_rcu_t *rcu = pth_rcu_new (1, 2);
+	pth_rcu_reader_t *a, *b;
+	config_t *c;
+	int bad = 0, i;
+	a = pth_rcu_register (rcu);
+	b = pth_rcu_register (rcu);
+	bad += a == (pth_rcu_reader_t *)NULL || b == (pth_rcu_reader_t *)NULL;
+	bad += pth_rcu_register (rcu) != (pth_rcu_reader_t *)NULL;
+	pth_rcu_unregister (rcu, b);
+	bad += pth_rcu_register (rcu) != b;
+	/* nested sections keep the slot epoch */
+	pth_rcu_read_lock (rcu, a);
+	pth_rcu_read_lock (rcu, a);
+	pth_rcu_read_unlock (a);
+	bad += a->epoch == 0;
+	pth_rcu_read_unlock (a);
+	bad += a->epoch != 0;
+	for (i = 0; i < CAF_PTH_RCU_BATCH + 1; i++) {
+		c = (config_t *)xmalloc (sizeof (config_t));
+		pth_rcu_retire (rcu, c, poison_config);
+	}
+	bad += rcu->reclaimed != CAF_PTH_RCU_BATCH || rcu->npending != 1;
+	pth_rcu_barrier (rcu);
+	bad += rcu->reclaimed != CAF_PTH_RCU_BATCH + 1;
+	pth_rcu_delete (rcu);
+	if (bad != 0) {
+		printf ("rcu register check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static caf_hash_table_t *
+table_new (long v) {
+	caf_hash_table_t *t;
+	int i;
+	t = caf_hash_table_new (TABLE_ID, caf_shash_bp, caf_shash_dek);
+	for (i = 0; i < TABLE_KEYS; i++) {
+		caf_hash_table_add (t, keys[i], strlen (keys[i]) + 1,
+							(void *)(v + i));
+	}
+	return t;
+}
+
+
+void
+delete_table (void *p) {
+	caf_hash_table_delete ((caf_hash_table_t *)p);
+}
+
+
+void *
+table_thread (void *p) {
+	bench_t *b = (bench_t *)p;
+	pth_rcu_reader_t *r = pth_rcu_register (b->rcu);
+	caf_hash_table_t *t;
+	char key[16];
+	long v;
+	int i = 0;
+	while (!__atomic_load_n (&(b->stop), __ATOMIC_ACQUIRE)) {
+		sprintf (key, "route-%d", i);
+		pth_rcu_read_lock (b->rcu, r);
+		t = (caf_hash_table_t *)pth_rcu_deref ((void **)&(b->table));
+		v = (long)caf_hash_table_get (t, key, strlen (key) + 1);
+		pth_rcu_read_unlock (r);
+		/* every table maps route-i to a multiple of 1000 plus i */
+		if (v % 1000 != i) {
+			__atomic_add_fetch (&(b->torn), 1, __ATOMIC_RELAXED);
+		}
+		i = (i + 1) % TABLE_KEYS;
+	}
+	pth_rcu_unregister (b->rcu, r);
+	return (void *)NULL;
+}
+
+
+static int
+check_table (void) {
+	pthread_t thr[4];
+	caf_hash_table_t *old;
+	bench_t b;
+	int bad = 0, i;
+	memset (&b, 0, sizeof (b));
+	for (i = 0; i < TABLE_KEYS; i++) {
+		sprintf (keys[i], "route-%d", i);
+	}
+	b.rcu = pth_rcu_new (TABLE_ID, 4);
+	b.table = table_new (1000);
+	for (i = 0; i < 4; i++) {
+		pthread_create (&(thr[i]), (pthread_attr_t *)NULL, table_thread, &b);
+	}
+	/* whole tables are swapped in and the old ones retired */
+	for (i = 2; i < 200; i++) {
+		old = (caf_hash_table_t *)pth_rcu_publish ((void **)&(b.table),
+												   table_new (i * 1000L));
+		pth_rcu_retire (b.rcu, old, delete_table);
+		sleep_us (100);
+	}
+	__atomic_store_n (&(b.stop), 1, __ATOMIC_RELEASE);
+	for (i = 0; i < 4; i++) {
+		pthread_join (thr[i], (void **)NULL);
+	}
+	pth_rcu_delete (b.rcu);
+	bad += b.torn != 0;
+	bad += caf_hash_table_get (b.table, "route-5", 8) != (void *)199005L;
+	caf_hash_table_delete (b.table);
+	if (bad != 0) {
+		printf ("rcu table check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+void *
+reader_thread (void *p) {
+	bench_t *b = (bench_t *)p;
+	pth_rcu_reader_t *r = (pth_rcu_reader_t *)NULL;
+	config_t c, *cp;
+	long reads = 0, torn = 0;
+	if (b->kind == SYNC_RCU) {
+		r = pth_rcu_register (b->rcu);
+	}
+	while (!__atomic_load_n (&(b->stop), __ATOMIC_RELAXED)) {
+		switch (b->kind) {
+		case SYNC_RWLOCK:
+			pth_rwl_rdlock (b->rwl, 0, (struct timespec *)NULL);
+			c = b->plain;
+			pth_rwl_unlock (b->rwl);
+			torn += !consistent (&c);
+			break;
+		case SYNC_SEQLOCK:
+			pth_seql_read (b->sl, &c, &(b->plain), sizeof (c));
+			torn += !consistent (&c);
+			break;
+		default:
+			pth_rcu_read_lock (b->rcu, r);
+			cp = (config_t *)pth_rcu_deref ((void **)&(b->shared));
+			torn += !consistent (cp);
+			pth_rcu_read_unlock (r);
+			break;
+		}
+		reads++;
+	}
+	if (r != (pth_rcu_reader_t *)NULL) {
+		pth_rcu_unregister (b->rcu, r);
+	}
+	__atomic_add_fetch (&(b->reads), reads, __ATOMIC_RELAXED);
+	__atomic_add_fetch (&(b->torn), torn, __ATOMIC_RELAXED);
+	return (void *)NULL;
+}
+
+
+static void
+update (bench_t *b, long v) {
+	config_t c, *n;
+	switch (b->kind) {
+	case SYNC_RWLOCK:
+		pth_rwl_wrlock (b->rwl, 0, (struct timespec *)NULL);
+		fill (&(b->plain), v);
+		pth_rwl_unlock (b->rwl);
+		break;
+	case SYNC_SEQLOCK:
+		fill (&c, v);
+		pth_seql_write (b->sl, &(b->plain), &c, sizeof (c));
+		break;
+	default:
+		n = (config_t *)xmalloc (sizeof (config_t));
+		fill (n, v);
+		pth_rcu_retire (b->rcu, pth_rcu_publish ((void **)&(b->shared), n),
+						poison_config);
+		break;
+	}
+}
+
+
+static double
+run (sync_kind_t kind, int n, long *torn) {
+	pthread_t thr[MAX_READERS];
+	struct timespec t0, t1;
+	bench_t b;
+	long v = 1;
+	int i;
+	memset (&b, 0, sizeof (b));
+	b.kind = kind;
+	b.rwl = pth_rwl_new (1);
+	pth_rwlattr_init (b.rwl);
+	pth_rwl_init (b.rwl);
+	/* the pthread default lets a steady stream of readers starve the
+	   writer for good */
+	pth_rwlattr_set (b.rwl, PTHDR_RWLOCK_WRITER, 0);
+	b.sl = pth_seql_new (1);
+	b.rcu = pth_rcu_new (1, MAX_READERS);
+	fill (&(b.plain), 0);
+	b.shared = (config_t *)xmalloc (sizeof (config_t));
+	fill (b.shared, 0);
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		pthread_create (&(thr[i]), (pthread_attr_t *)NULL, reader_thread, &b);
+	}
+	do {
+		sleep_us (WRITE_US);
+		update (&b, v++);
+		clock_gettime (CLOCK_MONOTONIC, &t1);
+	} while ((t1.tv_sec - t0.tv_sec) * 1000L
+			 + (t1.tv_nsec - t0.tv_nsec) / 1000000L < RUN_MS);
+	__atomic_store_n (&(b.stop), 1, __ATOMIC_RELAXED);
+	for (i = 0; i < n; i++) {
+		pthread_join (thr[i], (void **)NULL);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	pth_rcu_delete (b.rcu);
+	xfree (b.shared);
+	pth_seql_delete (b.sl);
+	pth_rwl_destroy (b.rwl);
+	pth_rwlattr_destroy (b.rwl);
+	pth_rwl_delete (b.rwl);
+	*torn += b.torn;
+	return (double)b.reads / ((double)(t1.tv_sec - t0.tv_sec) * 1e6
+							  + (double)(t1.tv_nsec - t0.tv_nsec) / 1e3);
+}
+
+/* caf_rcu.c ends here */
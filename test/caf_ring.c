@@ -0,0 +1,187 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_ring.h>
+
+
+#define FIFO_DEPTH              1000
+#define FIFO_ROUNDS             1000
+#define CHECK_ROUNDS            100000
+
+static long map_sum = 0;
+
+static int check_model (void);
+static int map_cb (void *ptr);
+static int srch_cb (void *ndata, void *data);
+static double elapsed (struct timespec *t0, struct timespec *t1);
+static double fifo_deque (void);
+static double fifo_ring (void);
+
+int
+main () {
+	double td, tr;
+	int errors;
+	errors = check_model ();
+	td = fifo_deque ();
+	tr = fifo_ring ();
+	printf ("%-8s %12s\n", "fifo", "ns/op");
+	printf ("%-8s %12.2f\n", "deque", td);
+	printf ("%-8s %12.2f\n", "ring", tr);
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+/*
+ * Runs a random mix of operations against both ends, checking every
+ * result against a plain array; the ring starts small so it grows
+ * while wrapped around.
+ */
+static int
+check_model (void) {
+	ring_t *r;
+	long *model, head = CHECK_ROUNDS, tail = CHECK_ROUNDS, v, x;
+	int i, pos, errors = 0;
+	model = (long *)xmalloc (sizeof (long) * CHECK_ROUNDS * 2);
+	r = ring_create (1);
+	srand (1);
+	for (i = 0; i < CHECK_ROUNDS; i++) {
+		x = rand () % 7;
+		v = (long)i + 1;
+		if (x < 2) {
+			errors += ring_push_back (r, (void *)v) != r;
+			model[tail++] = v;
+		} else if (x < 4) {
+			errors += ring_push_front (r, (void *)v) != r;
+			model[--head] = v;
+		} else if (x == 4) {
+			v = (long)ring_pop_back (r);
+			errors += v != (tail > head ? model[--tail] : 0);
+		} else if (x == 5) {
+			v = (long)ring_pop_front (r);
+			errors += v != (tail > head ? model[head++] : 0);
+		} else if (tail > head) {
+			pos = rand () % (int)(tail - head);
+			errors += (long)ring_get (r, pos) != model[head + pos];
+			errors += ring_set (r, pos, (void *)v) != pos;
+			model[head + pos] = v;
+		}
+		errors += ring_length (r) != (int)(tail - head);
+	}
+	if (ring_get (r, -1) != NULL || ring_get (r, ring_length (r)) != NULL
+		|| ring_set (r, ring_length (r), NULL) != CAF_ERROR_SUB) {
+		errors++;
+	}
+	map_sum = 0;
+	errors += ring_map (r, map_cb) != (int)(tail - head);
+	for (v = 0, i = (int)head; i < (int)tail; i++) {
+		v += model[i];
+	}
+	errors += map_sum != v;
+	if (tail > head) {
+		v = model[tail - 1];
+		errors += (long)ring_search (r, (void *)v, srch_cb) != v;
+	}
+	errors += ring_search (r, (void *)-1L, srch_cb) != NULL;
+	errors += ring_delete_nocb (r) != CAF_OK;
+	xfree (model);
+	if (errors != 0) {
+		printf ("ring model check: %d errors\n", errors);
+	}
+	return errors;
+}
+
+
+static int
+map_cb (void *ptr) {
+	map_sum += (long)ptr;
+	return CAF_OK;
+}
+
+
+static int
+srch_cb (void *ndata, void *data) {
+	return ndata == data ? CAF_OK : CAF_ERROR;
+}
+
+
+static double
+elapsed (struct timespec *t0, struct timespec *t1) {
+	return (double)(t1->tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+
+static double
+fifo_deque (void) {
+	struct timespec t0, t1;
+	deque_t *q;
+	long i, r;
+	q = deque_create ();
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < FIFO_ROUNDS; r++) {
+		for (i = 0; i < FIFO_DEPTH; i++) {
+			deque_push (q, (void *)i);
+		}
+		for (i = 0; i < FIFO_DEPTH; i++) {
+			deque_node_release (q, deque_first (q));
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	deque_delete_nocb (q);
+	return elapsed (&t0, &t1) / (FIFO_ROUNDS * FIFO_DEPTH);
+}
+
+
+static double
+fifo_ring (void) {
+	struct timespec t0, t1;
+	ring_t *q;
+	long i, r;
+	q = ring_create (0);
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < FIFO_ROUNDS; r++) {
+		for (i = 0; i < FIFO_DEPTH; i++) {
+			ring_push_back (q, (void *)i);
+		}
+		for (i = 0; i < FIFO_DEPTH; i++) {
+			ring_pop_front (q);
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	ring_delete_nocb (q);
+	return elapsed (&t0, &t1) / (FIFO_ROUNDS * FIFO_DEPTH);
+}
+
+/* caf_ring.c ends here */
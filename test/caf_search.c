@@ -0,0 +1,368 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_buffer.h>
+
+
+#define INPUT_SZ            (4 << 20)
+#define CHECK_SZ            4096
+#define RECORD_SZ           160
+#define MAX_PATTERN         64
+#define ROUNDS              5
+
+static double elapsed_ns (struct timespec *t0);
+static size_t naive_count (const cbuffer_t *b, const char *p, size_t m);
+static int naive_split (const cbuffer_t *b, const char *p, size_t m,
+						deque_t *lst);
+static int naive_replace (const cbuffer_t *b, const char *p, size_t m,
+						  const char *rep, size_t rlen, cbuffer_t *r);
+static cbuffer_t *make_check (unsigned int seed);
+static void make_pattern (const cbuffer_t *b, char *p, size_t m);
+static int check_search (void);
+static int check_split (void);
+static int check_replace (void);
+static cbuffer_t *make_log (const char *delim, size_t m);
+static double run_naive (cbuffer_t *in, const char *p, size_t m);
+static double run_search (cbuffer_t *in, const char *p, size_t m,
+						  size_t *found);
+
+
+int
+main () {
+	static const size_t lens[] = { 1, 2, 3, 4, 8, 16, 17, 24, 32, 48, 64 };
+	char delim[MAX_PATTERN];
+	cbuffer_t *in;
+	deque_t *lst;
+	struct timespec t0;
+	double naive_ns, search_ns, split_ns, replace_ns;
+	size_t found;
+	int errors, i, j;
+	errors = check_search ();
+	errors += check_split ();
+	errors += check_replace ();
+	printf ("%d bytes, ns per KB\n", INPUT_SZ);
+	printf ("%8s %8s %10s %10s %10s %10s\n", "pattern", "matches", "memcmp",
+			"search", "split", "replace");
+	for (i = 0; i < (int)(sizeof (lens) / sizeof (lens[0])); i++) {
+		for (j = 0; j < (int)lens[i]; j++) {
+			delim[j] = (char)('A' + (j * 7) % 26);
+		}
+		in = make_log (delim, lens[i]);
+		naive_ns = run_naive (in, delim, lens[i]);
+		search_ns = run_search (in, delim, lens[i], &found);
+		clock_gettime (CLOCK_MONOTONIC, &t0);
+		lst = cbuf_split_slice (in, delim, lens[i]);
+		split_ns = elapsed_ns (&t0);
+		deque_delete (lst, cbuf_delete_callback);
+		clock_gettime (CLOCK_MONOTONIC, &t0);
+		cbuf_delete (cbuf_replace (in, delim, "\n", lens[i], 1));
+		replace_ns = elapsed_ns (&t0);
+		printf ("%8lu %8lu %10.1f %10.1f %10.1f %10.1f\n",
+				(unsigned long)lens[i], (unsigned long)found,
+				naive_ns * 1024 / INPUT_SZ, search_ns * 1024 / INPUT_SZ,
+				split_ns * 1024 / INPUT_SZ, replace_ns * 1024 / INPUT_SZ);
+		errors += found != naive_count (in, delim, lens[i]);
+		cbuf_delete (in);
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+/* non overlapping occurrences, by a memcmp at every offset */
+static size_t
+naive_count (const cbuffer_t *b, const char *p, size_t m) {
+	const char *d = (const char *)b->data;
+	size_t i = 0, n = 0;
+	while (i + m <= b->sz) {
+		if (memcmp (d + i, p, m) == 0) {
+			n++;
+			i += m;
+		} else {
+			i++;
+		}
+	}
+	return n;
+}
+
+
+/* compares the pieces of a split with the gaps between naive matches */
+static int
+naive_split (const cbuffer_t *b, const char *p, size_t m, deque_t *lst) {
+	const char *d = (const char *)b->data;
+	caf_dequen_t *n = lst->head;
+	cbuffer_t *x;
+	size_t i = 0, start = 0, end;
+	int bad = 0, pieces = 0;
+	while (start < b->sz) {
+		while (i + m <= b->sz && memcmp (d + i, p, m) != 0) {
+			i++;
+		}
+		end = i + m <= b->sz ? i : b->sz;
+		/* empty pieces are left out */
+		if (end > start) {
+			pieces++;
+			if (n == (caf_dequen_t *)NULL) {
+				return bad + 1;
+			}
+			x = (cbuffer_t *)n->data;
+			bad += x->sz != end - start
+				|| memcmp (x->data, d + start, x->sz) != 0;
+			n = n->next;
+		}
+		i = end + m;
+		start = i;
+	}
+	return bad + (pieces != deque_length (lst));
+}
+
+
+/* compares a replacement with a copy made around naive matches */
+static int
+naive_replace (const cbuffer_t *b, const char *p, size_t m,
+			   const char *rep, size_t rlen, cbuffer_t *r) {
+	const char *d = (const char *)b->data;
+	char *e;
+	size_t i = 0, sz = 0;
+	int bad;
+	e = (char *)xmalloc (b->sz + naive_count (b, p, m) * rlen + 1);
+	if (e == (char *)NULL || r == (cbuffer_t *)NULL) {
+		xfree (e);
+		return 1;
+	}
+	while (i < b->sz) {
+		if (i + m <= b->sz && memcmp (d + i, p, m) == 0) {
+			memcpy (e + sz, rep, rlen);
+			sz += rlen;
+			i += m;
+		} else {
+			e[sz++] = d[i++];
+		}
+	}
+	bad = r->sz != sz || memcmp (r->data, e, sz) != 0;
+	xfree (e);
+	return bad;
+}
+
+
+/* a two letter alphabet gives many partial matches */
+static cbuffer_t *
+make_check (unsigned int seed) {
+	cbuffer_t *b = cbuf_create (CHECK_SZ);
+	char *d = (char *)b->data;
+	int i;
+	srand (seed);
+	for (i = 0; i < CHECK_SZ; i++) {
+		d[i] = (char)('a' + (rand () % 2));
+	}
+	return b;
+}
+
+
+/* patterns taken from the data, some at the very end */
+static void
+make_pattern (const cbuffer_t *b, char *p, size_t m) {
+	const char *d = (const char *)b->data;
+	memcpy (p, d + (m % 2 ? b->sz - m : (m * 37) % (b->sz - m)), m);
+}
+
+
+static int
+check_search (void) {
+	cbuffer_t *b = make_check (7);
+	char *d = (char *)b->data, p[MAX_PATTERN];
+	deque_t *lst;
+	caf_dequen_t *n;
+	size_t m, prev;
+	int bad = 0;
+	for (m = 1; m <= MAX_PATTERN; m++) {
+		make_pattern (b, p, m);
+		lst = cbuf_search (b, p, m);
+		bad += (size_t)deque_length (lst) != naive_count (b, p, m);
+		prev = 0;
+		for (n = lst->head; n != (caf_dequen_t *)NULL; n = n->next) {
+			bad += memcmp (n->data, p, m) != 0;
+			bad += (size_t)n->data < prev;
+			prev = (size_t)n->data + m;
+		}
+		deque_delete_nocb (lst);
+	}
+	/* patterns longer than the data are never found */
+	lst = cbuf_search (b, d, CHECK_SZ + 1);
+	bad += deque_length (lst) != 0;
+	deque_delete_nocb (lst);
+	cbuf_delete (b);
+	if (bad != 0) {
+		printf ("check_search: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_split (void) {
+	static const char *expect[] = { "a", "bc", "d" };
+	cbuffer_t *b = cbuf_new (), *x;
+	char p[MAX_PATTERN];
+	deque_t *lst;
+	caf_dequen_t *n;
+	size_t m;
+	int bad = 0, i = 0;
+	/* adjacent and trailing delimiters leave no empty pieces */
+	cbuf_import (b, "--a--bc----d--", 14);
+	lst = cbuf_split (b, "--", 2);
+	bad += deque_length (lst) != 3;
+	for (n = lst->head; n != (caf_dequen_t *)NULL && i < 3; n = n->next) {
+		x = (cbuffer_t *)n->data;
+		bad += x->sz != strlen (expect[i])
+			|| memcmp (x->data, expect[i], x->sz) != 0;
+		i++;
+	}
+	deque_delete (lst, cbuf_delete_callback);
+	lst = cbuf_split (b, "xyz", 3);
+	bad += deque_length (lst) != 1;
+	bad += ((cbuffer_t *)lst->head->data)->sz != 14;
+	deque_delete (lst, cbuf_delete_callback);
+	cbuf_delete (b);
+	/* both search paths against the naive matches */
+	b = make_check (11);
+	for (m = 1; m <= MAX_PATTERN; m++) {
+		make_pattern (b, p, m);
+		lst = cbuf_split (b, p, m);
+		bad += naive_split (b, p, m, lst);
+		deque_delete (lst, cbuf_delete_callback);
+	}
+	cbuf_delete (b);
+	if (bad != 0) {
+		printf ("check_split: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_replace (void) {
+	cbuffer_t *b = cbuf_new (), *r;
+	char p[MAX_PATTERN];
+	size_t m, rlen;
+	int bad = 0;
+	cbuf_import (b, "\x01\x01x\x01yz\x01", 7);
+	r = cbuf_replace (b, "\x01", ", ", 1, 2);
+	bad += r == (cbuffer_t *)NULL || r->sz != 11
+		|| memcmp (r->data, ", , x, yz, ", 11) != 0;
+	cbuf_delete (r);
+	/* shrinking, growing past the first allocation, and no match */
+	r = cbuf_replace (b, "\x01", "", 1, 0);
+	bad += r == (cbuffer_t *)NULL || r->sz != 3
+		|| memcmp (r->data, "xyz", 3) != 0;
+	cbuf_delete (r);
+	r = cbuf_replace (b, "\x01", "<-------->", 1, 10);
+	bad += r == (cbuffer_t *)NULL || r->sz != 43
+		|| memcmp ((char *)r->data + 20, "x<-------->yz", 13) != 0;
+	cbuf_delete (r);
+	r = cbuf_replace (b, "q", "", 1, 0);
+	bad += r == (cbuffer_t *)NULL || r->sz != 7
+		|| memcmp (r->data, b->data, 7) != 0;
+	cbuf_delete (r);
+	cbuf_delete (b);
+	/* both search paths, shrinking, keeping and growing the matches */
+	b = make_check (13);
+	for (m = 1; m <= MAX_PATTERN; m++) {
+		make_pattern (b, p, m);
+		rlen = (m * 3) % 7;
+		r = cbuf_replace (b, p, "<----->", m, rlen);
+		bad += naive_replace (b, p, m, "<----->", rlen, r);
+		cbuf_delete (r);
+	}
+	cbuf_delete (b);
+	if (bad != 0) {
+		printf ("check_replace: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+/* log records of printable text, each ended by the delimiter */
+static cbuffer_t *
+make_log (const char *delim, size_t m) {
+	cbuffer_t *b = cbuf_create (INPUT_SZ);
+	char *d = (char *)b->data;
+	size_t i;
+	for (i = 0; i < INPUT_SZ; i++) {
+		d[i] = (char)('a' + (i * 13 + i / 97) % 26);
+	}
+	for (i = RECORD_SZ; i + m <= INPUT_SZ; i += RECORD_SZ + m) {
+		memcpy (d + i, delim, m);
+	}
+	return b;
+}
+
+
+static double
+run_naive (cbuffer_t *in, const char *p, size_t m) {
+	struct timespec t0;
+	int r;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < ROUNDS; r++) {
+		naive_count (in, p, m);
+	}
+	return elapsed_ns (&t0) / ROUNDS;
+}
+
+
+static double
+run_search (cbuffer_t *in, const char *p, size_t m, size_t *found) {
+	struct timespec t0;
+	deque_t *lst;
+	int r;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (r = 0; r < ROUNDS; r++) {
+		lst = cbuf_search (in, (void *)p, m);
+		*found = (size_t)deque_length (lst);
+		deque_delete_nocb (lst);
+	}
+	return elapsed_ns (&t0) / ROUNDS;
+}
+
+/* caf_search.c ends here */
@@ -0,0 +1,404 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_ipc_shm.h>
+#include <caf/caf_process_pool.h>
+#include <caf/caf_sem_posix.h>
+#include <caf/caf_sem_svr4.h>
+#include <caf/caf_sem_futex.h>
+
+
+#define ROUNDS              20000
+#define PRODUCERS           4
+#define CONSUMERS           4
+#define ITEMS               10000
+
+typedef enum {
+	SEM_FUTEX = 0,
+	SEM_POSIX,
+	SEM_SVR4,
+	SEM_KINDS
+} sem_kind_t;
+
+static const char *sem_names[SEM_KINDS] = {
+	"futex", "posix", "svr4"
+};
+
+/* a ping and a pong semaphore, placed in shm for the process runs */
+typedef struct pair_s pair_t;
+struct pair_s {
+	sem_kind_t kind;
+	int rounds;
+	caf_sem_futex_t futex[2];
+	caf_sem_posix_t *posix[2];
+	caf_sem_svr4_t *svr4[2];
+};
+
+void *pong_thread (void *p);
+int pong_process (void *p);
+void *count_producer (void *p);
+void *count_consumer (void *p);
+static double elapsed_ns (struct timespec *t0);
+static int pair_init (pair_t *pp, sem_kind_t kind, int flag);
+static void pair_destroy (pair_t *pp);
+static void pair_post (pair_t *pp, int n);
+static void pair_wait (pair_t *pp, int n);
+static int check_basic (void);
+static int check_counting (void);
+static double run_uncontended (sem_kind_t kind);
+static double run_threads (sem_kind_t kind);
+static double run_processes (sem_kind_t kind, int *bad);
+
+
+int
+main () {
+	int errors, k, bad = 0;
+	errors = check_basic ();
+	errors += check_counting ();
+	printf ("%6s %14s %14s %14s\n", "sem", "uncontended", "threads", "processes");
+	for (k = 0; k < SEM_KINDS; k++) {
+		printf ("%6s %11.1f ns %11.1f ns", sem_names[k],
+				run_uncontended ((sem_kind_t)k),
+				run_threads ((sem_kind_t)k));
+		if (k == SEM_POSIX) {
+			/* caf_sem_posix_t is heap allocated, not shareable */
+			printf (" %14s\n", "-");
+		} else {
+			printf (" %11.1f ns\n", run_processes ((sem_kind_t)k, &bad));
+		}
+	}
+	if (bad != 0) {
+		printf ("process ping-pong: %d errors\n", bad);
+		errors += bad;
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+static int
+pair_init (pair_t *pp, sem_kind_t kind, int flag) {
+	sem_t key;
+	int i;
+	memset (pp, 0, sizeof (pair_t));
+	memset (&key, 0, sizeof (sem_t));
+	pp->kind = kind;
+	for (i = 0; i < 2; i++) {
+		switch (kind) {
+		case SEM_FUTEX:
+			if (caf_sem_futex_init (&(pp->futex[i]), flag, 0) != CAF_OK) {
+				return CAF_ERROR;
+			}
+			break;
+		case SEM_POSIX:
+			pp->posix[i] = caf_sem_posix_new (key, 0, 0);
+			if (pp->posix[i] == (caf_sem_posix_t *)NULL) {
+				return CAF_ERROR;
+			}
+			break;
+		default:
+			pp->svr4[i] = caf_sem_svr4_new (IPC_PRIVATE, 1, 0600);
+			if (pp->svr4[i] == (caf_sem_svr4_t *)NULL) {
+				return CAF_ERROR;
+			}
+			break;
+		}
+	}
+	return CAF_OK;
+}
+
+
+static void
+pair_destroy (pair_t *pp) {
+	int i;
+	for (i = 0; i < 2; i++) {
+		if (pp->posix[i] != (caf_sem_posix_t *)NULL) {
+			caf_sem_posix_delete (pp->posix[i]);
+		}
+		if (pp->svr4[i] != (caf_sem_svr4_t *)NULL) {
+			caf_sem_svr4_delete (pp->svr4[i]);
+		}
+	}
+}
+
+
+static void
+pair_post (pair_t *pp, int n) {
+	switch (pp->kind) {
+	case SEM_FUTEX:
+		caf_sem_futex_post (&(pp->futex[n]));
+		break;
+	case SEM_POSIX:
+		caf_sem_posix_post (pp->posix[n]);
+		break;
+	default:
+		caf_sem_svr4_unlock (pp->svr4[n]);
+		break;
+	}
+}
+
+
+static void
+pair_wait (pair_t *pp, int n) {
+	switch (pp->kind) {
+	case SEM_FUTEX:
+		caf_sem_futex_wait (&(pp->futex[n]));
+		break;
+	case SEM_POSIX:
+		caf_sem_posix_wait (pp->posix[n]);
+		break;
+	default:
+		caf_sem_svr4_lock (pp->svr4[n]);
+		break;
+	}
+}
+
+
+void *
+pong_thread (void *p) {
+	pair_t *pp = (pair_t *)p;
+	int i;
+	for (i = 0; i < ROUNDS; i++) {
+		pair_wait (pp, 0);
+		pair_post (pp, 1);
+	}
+	return (void *)NULL;
+}
+
+
+/* runs in the ppm_pool_create child, must not return into the pool */
+int
+pong_process (void *p) {
+	deque_t *plst = (deque_t *)p;
+	pair_t *pp = (pair_t *)plst->head->data;
+	int i;
+	for (i = 0; i < ROUNDS; i++) {
+		pair_wait (pp, 0);
+		pp->rounds++;
+		pair_post (pp, 1);
+	}
+	_exit (0);
+	return 0;
+}
+
+
+static int
+check_basic (void) {
+	caf_sem_futex_t st = CAF_SEM_FUTEX_INITIALIZER (1);
+	caf_sem_futex_t *s = caf_sem_futex_new (CAF_SEM_FUTEX_PRIVATE, 0);
+	struct timespec to;
+	int bad = 0;
+	bad += s == (caf_sem_futex_t *)NULL;
+	bad += caf_sem_futex_new (CAF_SEM_FUTEX_PRIVATE, -1)
+		!= (caf_sem_futex_t *)NULL;
+	bad += caf_sem_futex_init (&st, 2, 0) != CAF_ERROR;
+	bad += caf_sem_futex_trywait (s) != CAF_ERROR;
+	caf_sem_futex_post (s);
+	caf_sem_futex_unlock (s);
+	bad += caf_sem_futex_getvalue (s) != 2;
+	bad += caf_sem_futex_wait (s) != CAF_OK;
+	bad += caf_sem_futex_trylock (s) != CAF_OK;
+	bad += caf_sem_futex_trywait (s) != CAF_ERROR;
+	clock_gettime (CLOCK_REALTIME, &to);
+	to.tv_nsec += 10000000L;
+	if (to.tv_nsec >= 1000000000L) {
+		to.tv_sec++;
+		to.tv_nsec -= 1000000000L;
+	}
+	bad += caf_sem_futex_timedwait (s, &to) != CAF_ERROR_SUB;
+	bad += s->waiters != 0;
+	bad += caf_sem_futex_lock (&st) != CAF_OK;
+	bad += caf_sem_futex_post ((caf_sem_futex_t *)NULL) != CAF_ERROR;
+	bad += caf_sem_futex_wait ((caf_sem_futex_t *)NULL) != CAF_ERROR;
+	bad += caf_sem_futex_delete (s) != CAF_OK;
+	if (bad != 0) {
+		printf ("futex semaphore basic check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+void *
+count_producer (void *p) {
+	caf_sem_futex_t *s = (caf_sem_futex_t *)p;
+	int i;
+	for (i = 0; i < ITEMS; i++) {
+		caf_sem_futex_post (s);
+	}
+	return (void *)NULL;
+}
+
+
+void *
+count_consumer (void *p) {
+	caf_sem_futex_t *s = (caf_sem_futex_t *)p;
+	int i;
+	for (i = 0; i < ITEMS * PRODUCERS / CONSUMERS; i++) {
+		caf_sem_futex_wait (s);
+	}
+	return (void *)NULL;
+}
+
+
+static int
+check_counting (void) {
+	caf_sem_futex_t *s = caf_sem_futex_new (CAF_SEM_FUTEX_PRIVATE, 0);
+	pthread_t prod[PRODUCERS], cons[CONSUMERS];
+	int bad = 0, i;
+	for (i = 0; i < CONSUMERS; i++) {
+		pthread_create (&(cons[i]), (pthread_attr_t *)NULL,
+						count_consumer, s);
+	}
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_create (&(prod[i]), (pthread_attr_t *)NULL,
+						count_producer, s);
+	}
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_join (prod[i], (void **)NULL);
+	}
+	for (i = 0; i < CONSUMERS; i++) {
+		pthread_join (cons[i], (void **)NULL);
+	}
+	/* every post was consumed exactly once */
+	bad += caf_sem_futex_getvalue (s) != 0;
+	bad += s->waiters != 0;
+	caf_sem_futex_delete (s);
+	if (bad != 0) {
+		printf ("futex semaphore counting check: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run_uncontended (sem_kind_t kind) {
+	struct timespec t0;
+	pair_t pp;
+	double ns;
+	int i;
+	if (pair_init (&pp, kind, CAF_SEM_FUTEX_PRIVATE) != CAF_OK) {
+		return 0.0;
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ROUNDS; i++) {
+		pair_post (&pp, 0);
+		pair_wait (&pp, 0);
+	}
+	ns = elapsed_ns (&t0) / ROUNDS;
+	pair_destroy (&pp);
+	return ns;
+}
+
+
+static double
+run_threads (sem_kind_t kind) {
+	struct timespec t0;
+	pthread_t thr;
+	pair_t pp;
+	double ns;
+	int i;
+	if (pair_init (&pp, kind, CAF_SEM_FUTEX_PRIVATE) != CAF_OK) {
+		return 0.0;
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	pthread_create (&thr, (pthread_attr_t *)NULL, pong_thread, &pp);
+	for (i = 0; i < ROUNDS; i++) {
+		pair_post (&pp, 0);
+		pair_wait (&pp, 1);
+	}
+	pthread_join (thr, (void **)NULL);
+	ns = elapsed_ns (&t0) / ROUNDS;
+	pair_destroy (&pp);
+	return ns;
+}
+
+
+static double
+run_processes (sem_kind_t kind, int *bad) {
+	struct timespec t0;
+	caf_shm_alloc_t *seg;
+	deque_t *plst, *pool;
+	proc_info_t *nfo;
+	pair_t *pp;
+	double ns = 0.0;
+	int i, st;
+	seg = caf_shm_seg_new (IPC_PRIVATE, sizeof (pair_t), IPC_CREAT | 0600);
+	if (seg == (caf_shm_alloc_t *)NULL) {
+		return ns;
+	}
+	pp = (pair_t *)caf_shm_seg_attach (seg);
+	if (pp != (pair_t *)CAF_SHM_BAD_ALLOC
+		&& pair_init (pp, kind, CAF_SEM_FUTEX_SHARED) == CAF_OK) {
+		plst = deque_create ();
+		deque_push (plst, pp);
+		/* children close stdout, flush before it is duplicated */
+		fflush (stdout);
+		clock_gettime (CLOCK_MONOTONIC, &t0);
+		pool = ppm_pool_create (1, plst, pong_process);
+		for (i = 0; i < ROUNDS; i++) {
+			pair_post (pp, 0);
+			pair_wait (pp, 1);
+		}
+		ns = elapsed_ns (&t0) / ROUNDS;
+		nfo = (proc_info_t *)pool->head->data;
+		waitpid (nfo->pid, &st, 0);
+		*bad += pp->rounds != ROUNDS;
+		deque_delete (pool, deque_delete_cb);
+		deque_delete_nocb (plst);
+		pair_destroy (pp);
+	}
+	caf_shm_seg_delete (seg);
+	return ns;
+}
+
+/* caf_sem.c ends here */
@@ -0,0 +1,286 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_buffer.h>
+
+
+#define OBJECTS             1000
+#define BATCH               64
+#define ROUNDS              20000
+#define MAX_THREADS         8
+
+typedef struct bench_s bench_t;
+struct bench_s {
+	int slab;
+	size_t sz;
+	void *obj[BATCH];
+};
+
+static double elapsed_ns (struct timespec *t0);
+static int check_classes (void);
+static int check_objects (void);
+static int check_poison (void);
+static int check_threads (void);
+static void *alloc_thread (void *arg);
+static void *exit_thread (void *arg);
+static void *bench_thread (void *arg);
+static double run_bench (int slab, size_t sz, int threads);
+
+
+int
+main () {
+	static const int threads[] = { 1, 2, 4, MAX_THREADS };
+	size_t sizes[2];
+	const char *names[2];
+	double heap, slab;
+	int errors, i, j;
+	caf_slab_debug (1);
+	errors = check_classes ();
+	errors += check_objects ();
+	errors += check_poison ();
+	errors += check_threads ();
+	caf_slab_debug (0);
+	sizes[0] = CAF_CAF_DEQUENODE_SZ;
+	names[0] = "caf_dequen_t";
+	sizes[1] = CAF_BUFF_SZ;
+	names[1] = "cbuffer_t";
+	printf ("alloc and free, millions of pairs per second\n");
+	printf ("%-14s %8s %10s %10s\n", "object", "threads", "xmalloc", "slab");
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < (int)(sizeof (threads) / sizeof (threads[0])); j++) {
+			heap = run_bench (0, sizes[i], threads[j]);
+			slab = run_bench (1, sizes[i], threads[j]);
+			printf ("%-14s %8d %10.2f %10.2f\n", names[i], threads[j],
+					heap, slab);
+		}
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+static int
+check_classes (void) {
+	int bad = 0;
+	bad += caf_slab_class (0) != (caf_slab_class_t *)NULL;
+	bad += caf_slab_class (CAF_SLAB_MAX + 1) != (caf_slab_class_t *)NULL;
+	bad += caf_slab_class (1)->sz != 16;
+	bad += caf_slab_class (16)->sz != 16;
+	bad += caf_slab_class (17)->sz != 32;
+	bad += caf_slab_class (100)->sz != 128;
+	bad += caf_slab_class (200)->sz != 256;
+	bad += caf_slab_class (CAF_SLAB_MAX)->sz != CAF_SLAB_MAX;
+	bad += caf_slab_class (CAF_CAF_DEQUENODE_SZ)->sz < CAF_CAF_DEQUENODE_SZ;
+	bad += caf_slab_class (CAF_BUFF_SZ)->sz < CAF_BUFF_SZ;
+	if (bad != 0) {
+		printf ("check_classes: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_objects (void) {
+	char *obj[OBJECTS], *big;
+	int bad = 0, i;
+	for (i = 0; i < OBJECTS; i++) {
+		obj[i] = (char *)caf_slab_alloc (40);
+		if (obj[i] == (char *)NULL) {
+			return 1;
+		}
+		bad += ((size_t)obj[i] % 16) != 0;
+		memset (obj[i], i & 0xff, 40);
+	}
+	for (i = 0; i < OBJECTS; i++) {
+		bad += (unsigned char)obj[i][0] != (i & 0xff);
+		bad += (unsigned char)obj[i][39] != (i & 0xff);
+	}
+	for (i = 0; i < OBJECTS; i++) {
+		caf_slab_free (obj[i], 40);
+	}
+	/* released objects are handed out again, last in first out */
+	bad += caf_slab_alloc (40) != obj[OBJECTS - 1];
+	caf_slab_free (obj[OBJECTS - 1], 40);
+	big = (char *)caf_slab_alloc (CAF_SLAB_MAX * 4);
+	bad += big == (char *)NULL;
+	memset (big, 0, CAF_SLAB_MAX * 4);
+	caf_slab_free (big, CAF_SLAB_MAX * 4);
+	caf_slab_free ((void *)NULL, 40);
+	if (bad != 0) {
+		printf ("check_objects: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_poison (void) {
+	caf_slab_class_t *c = caf_slab_class (64);
+	size_t corrupt = c->corrupt;
+	char *p, *q;
+	int bad = 0;
+	p = (char *)caf_slab_alloc (64);
+	caf_slab_free (p, 64);
+	bad += (unsigned char)p[8] != CAF_SLAB_POISON;
+	q = (char *)caf_slab_alloc (64);
+	bad += q != p || c->corrupt != corrupt;
+	caf_slab_free (q, 64);
+	/* a write after release is reported on the next allocation */
+	printf ("check_poison: a modified object report follows\n");
+	fflush (stdout);
+	p[8] = 0;
+	q = (char *)caf_slab_alloc (64);
+	bad += q != p || c->corrupt != corrupt + 1;
+	caf_slab_free (q, 64);
+	if (bad != 0) {
+		printf ("check_poison: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static void *
+alloc_thread (void *arg) {
+	void **obj = (void **)arg;
+	int i;
+	for (i = 0; i < OBJECTS; i++) {
+		obj[i] = caf_slab_alloc (96);
+	}
+	return (void *)NULL;
+}
+
+
+static void *
+exit_thread (void *arg) {
+	void *obj[BATCH];
+	int i;
+	(void)arg;
+	for (i = 0; i < BATCH; i++) {
+		obj[i] = caf_slab_alloc (160);
+	}
+	for (i = 0; i < BATCH; i++) {
+		caf_slab_free (obj[i], 160);
+	}
+	return (void *)NULL;
+}
+
+
+static int
+check_threads (void) {
+	caf_slab_class_t *c;
+	pthread_t thr;
+	void *obj[OBJECTS];
+	int bad = 0, i, j;
+	/* objects allocated by one thread are released by another */
+	pthread_create (&thr, (pthread_attr_t *)NULL, alloc_thread, obj);
+	pthread_join (thr, (void **)NULL);
+	for (i = 0; i < OBJECTS; i++) {
+		bad += obj[i] == (void *)NULL;
+		for (j = i + 1; j < OBJECTS && j < i + 8; j++) {
+			bad += obj[i] == obj[j];
+		}
+		caf_slab_free (obj[i], 96);
+	}
+	/* an exiting thread leaves its magazines to the class */
+	c = caf_slab_class (160);
+	pthread_create (&thr, (pthread_attr_t *)NULL, exit_thread, NULL);
+	pthread_join (thr, (void **)NULL);
+	pthread_mutex_lock (&(c->lock));
+	bad += c->full == (caf_slab_mag_t *)NULL && c->free == (void *)NULL;
+	pthread_mutex_unlock (&(c->lock));
+	if (bad != 0) {
+		printf ("check_threads: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static void *
+bench_thread (void *arg) {
+	bench_t *b = (bench_t *)arg;
+	void **obj = b->obj;
+	int i, r;
+	for (r = 0; r < ROUNDS; r++) {
+		if (b->slab) {
+			for (i = 0; i < BATCH; i++) {
+				obj[i] = caf_slab_alloc (b->sz);
+			}
+			for (i = 0; i < BATCH; i++) {
+				caf_slab_free (obj[i], b->sz);
+			}
+		} else {
+			for (i = 0; i < BATCH; i++) {
+				obj[i] = xmalloc (b->sz);
+			}
+			for (i = 0; i < BATCH; i++) {
+				xfree (obj[i]);
+			}
+		}
+	}
+	return (void *)NULL;
+}
+
+
+static double
+run_bench (int slab, size_t sz, int threads) {
+	pthread_t thr[MAX_THREADS];
+	bench_t b[MAX_THREADS];
+	struct timespec t0;
+	int i;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < threads; i++) {
+		b[i].slab = slab;
+		b[i].sz = sz;
+		pthread_create (&(thr[i]), (pthread_attr_t *)NULL, bench_thread,
+						&(b[i]));
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join (thr[i], (void **)NULL);
+	}
+	/* millions of alloc and free pairs per second, all threads */
+	return ((double)threads * ROUNDS * BATCH * 1e3) / elapsed_ns (&t0);
+}
+
+/* caf_slab.c ends here */
@@ -0,0 +1,330 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_buffer.h>
+#include <caf/caf_io_file.h>
+#include <caf/caf_io_net.h>
+
+
+#define INPUT_SZ            (1 << 20)
+#define LINE_SZ             72
+#define ROUNDS              20
+
+static double elapsed_ns (struct timespec *t0);
+static cbuffer_t *make_input (size_t sz);
+static int check_slice (void);
+static int check_own (void);
+static int check_split (void);
+static int check_read (void);
+static int check_arena (void);
+static double run_split (cbuffer_t *in, int view, int *lines);
+static double run_halves (cbuffer_t *in, int view);
+
+
+int
+main () {
+	cbuffer_t *in;
+	double copy_ns, view_ns;
+	int errors, copy_lines = 0, view_lines = 0;
+	errors = check_slice ();
+	errors += check_own ();
+	errors += check_split ();
+	errors += check_read ();
+	errors += check_arena ();
+	in = make_input (INPUT_SZ);
+	copy_ns = run_split (in, 0, &copy_lines);
+	view_ns = run_split (in, 1, &view_lines);
+	printf ("split of %d bytes into %d lines, us per split\n", INPUT_SZ,
+			copy_lines);
+	printf ("%12s %10.1f\n", "cbuf_split", copy_ns / 1e3);
+	printf ("%12s %10.1f\n", "slices", view_ns / 1e3);
+	errors += copy_lines != view_lines || copy_lines == 0;
+	copy_ns = run_halves (in, 0);
+	view_ns = run_halves (in, 1);
+	printf ("head and tail halves, us per pair\n");
+	printf ("%12s %10.1f\n", "cbuf_head", copy_ns / 1e3);
+	printf ("%12s %10.1f\n", "slices", view_ns / 1e3);
+	cbuf_delete (in);
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+static double
+elapsed_ns (struct timespec *t0) {
+	struct timespec t1;
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	return (double)(t1.tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1.tv_nsec - t0->tv_nsec);
+}
+
+
+static cbuffer_t *
+make_input (size_t sz) {
+	cbuffer_t *buf = cbuf_create (sz);
+	char *p = (char *)buf->data;
+	size_t i;
+	for (i = 0; i < sz; i++) {
+		p[i] = (i % LINE_SZ) == LINE_SZ - 1 ? '\n' : (char)('a' + i % 26);
+	}
+	return buf;
+}
+
+
+static int
+check_slice (void) {
+	cbuffer_t *buf, *a, *b, *c;
+	int bad = 0;
+	buf = cbuf_new ();
+	cbuf_import (buf, "hello slices", 12);
+	a = cbuf_slice (buf, 0, 5);
+	b = cbuf_slice (buf, 6, 12);
+	bad += a == (cbuffer_t *)NULL || b == (cbuffer_t *)NULL;
+	if (bad != 0) {
+		return bad;
+	}
+	/* views point into the source data */
+	bad += a->data != buf->data || a->sz != 5;
+	bad += memcmp (b->data, "slices", 6) != 0;
+	bad += buf->store == (cbuf_store_t *)NULL || buf->store->refs != 3;
+	c = cbuf_slice (b, 1, 3);
+	bad += c == (cbuffer_t *)NULL || memcmp (c->data, "li", 2) != 0;
+	bad += cbuf_slice (buf, 3, 3) != (cbuffer_t *)NULL;
+	bad += cbuf_slice (buf, 0, 13) != (cbuffer_t *)NULL;
+	/* the data outlives the source buffer */
+	cbuf_delete (buf);
+	bad += memcmp (a->data, "hello", 5) != 0;
+	bad += a->store->refs != 3;
+	cbuf_delete (a);
+	cbuf_delete (b);
+	bad += memcmp (c->data, "li", 2) != 0 || c->store->refs != 1;
+	cbuf_delete (c);
+	if (bad != 0) {
+		printf ("check_slice: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_own (void) {
+	cbuffer_t *buf, *a, *b, *all, *h;
+	deque_t *lst;
+	int bad = 0;
+	buf = cbuf_new ();
+	cbuf_import (buf, "abcdef", 6);
+	a = cbuf_slice (buf, 0, 3);
+	b = cbuf_slice (buf, 3, 6);
+	/* writes give the written buffer its own copy */
+	cbuf_import (a, "xyz", 3);
+	bad += a->store != (cbuf_store_t *)NULL;
+	bad += memcmp (buf->data, "abcdef", 6) != 0;
+	cbuf_clean (b);
+	bad += memcmp (buf->data, "abcdef", 6) != 0;
+	bad += memcmp (a->data, "xyz", 3) != 0;
+	/* the last reference takes the data back without copying */
+	cbuf_delete (b);
+	bad += cbuf_own (buf) != CAF_OK || buf->store != (cbuf_store_t *)NULL;
+	cbuf_delete (a);
+	/* read operations accept slices */
+	a = cbuf_slice (buf, 1, 5);
+	h = cbuf_head (a, 2);
+	bad += h == (cbuffer_t *)NULL || memcmp (h->data, "bc", 2) != 0;
+	cbuf_delete (h);
+	lst = deque_create ();
+	deque_push (lst, a);
+	deque_push (lst, buf);
+	all = cbuf_join (lst);
+	bad += all == (cbuffer_t *)NULL || all->sz != 10;
+	bad += all != (cbuffer_t *)NULL && memcmp (all->data, "bcdeabcdef", 10);
+	deque_delete_nocb (lst);
+	cbuf_delete (all);
+	cbuf_paste (buf, a, 0, 0, 4);
+	bad += memcmp (buf->data, "bcdeef", 6) != 0;
+	bad += memcmp (a->data, "bcde", 4) != 0;
+	cbuf_delete (a);
+	cbuf_delete (buf);
+	if (bad != 0) {
+		printf ("check_own: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_split (void) {
+	cbuffer_t *buf, *x, *y;
+	deque_t *copies, *views;
+	caf_dequen_t *n, *m;
+	int bad = 0;
+	buf = cbuf_new ();
+	cbuf_import (buf, "one\ntwo\nthree\nfour", 18);
+	copies = cbuf_split (buf, "\n", 1);
+	views = cbuf_split_slice (buf, "\n", 1);
+	bad += deque_length (copies) != deque_length (views);
+	for (n = copies->head, m = views->head; n != (caf_dequen_t *)NULL
+			 && m != (caf_dequen_t *)NULL; n = n->next, m = m->next) {
+		x = (cbuffer_t *)n->data;
+		y = (cbuffer_t *)m->data;
+		bad += x->sz != y->sz || memcmp (x->data, y->data, x->sz) != 0;
+		bad += y->store != buf->store;
+	}
+	deque_delete (copies, cbuf_delete_callback);
+	deque_delete (views, cbuf_delete_callback);
+	bad += buf->store != (cbuf_store_t *)NULL && buf->store->refs != 1;
+	cbuf_delete (buf);
+	if (bad != 0) {
+		printf ("check_split: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+/* reading into a split buffer leaves its lines alone */
+static int
+check_read (void) {
+	caf_io_file_t in;
+	caf_conn_t conn;
+	cbuffer_t *buf;
+	deque_t *lst;
+	int bad = 0, fd[2], sv[2];
+	if (pipe (fd) != 0) {
+		return 1;
+	}
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		close (fd[0]);
+		close (fd[1]);
+		return 1;
+	}
+	memset (&in, 0, sizeof (in));
+	memset (&conn, 0, sizeof (conn));
+	in.fd = fd[0];
+	conn.sock = sv[0];
+	buf = cbuf_new ();
+	cbuf_import (buf, "ab\ncd\n", 6);
+	lst = cbuf_split_slice (buf, "\n", 1);
+	bad += write (fd[1], "xxxxxx", 6) != 6;
+	bad += io_read (&in, buf) != 6;
+	bad += memcmp (buf->data, "xxxxxx", 6) != 0;
+	bad += buf->store != (cbuf_store_t *)NULL;
+	bad += memcmp (((cbuffer_t *)lst->head->data)->data, "ab", 2) != 0;
+	bad += memcmp (((cbuffer_t *)lst->tail->data)->data, "cd", 2) != 0;
+	deque_delete (lst, cbuf_delete_callback);
+	cbuf_import (buf, "ef\ngh\n", 6);
+	lst = cbuf_split_slice (buf, "\n", 1);
+	bad += write (sv[1], "yyyyyy", 6) != 6;
+	bad += caf_conn_recv (&conn, buf, 0) != 6;
+	bad += memcmp (buf->data, "yyyyyy", 6) != 0;
+	bad += memcmp (((cbuffer_t *)lst->head->data)->data, "ef", 2) != 0;
+	bad += memcmp (((cbuffer_t *)lst->tail->data)->data, "gh", 2) != 0;
+	deque_delete (lst, cbuf_delete_callback);
+	cbuf_delete (buf);
+	close (fd[0]);
+	close (fd[1]);
+	close (sv[0]);
+	close (sv[1]);
+	if (bad != 0) {
+		printf ("check_read: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static int
+check_arena (void) {
+	caf_arena_t *arena = caf_arena_new (0);
+	cbuffer_t *buf, *a;
+	int bad = 0;
+	buf = cbuf_create_arena (arena, 8);
+	memcpy (buf->data, "arenabuf", 8);
+	a = cbuf_slice (buf, 5, 8);
+	bad += a == (cbuffer_t *)NULL || a->arena != arena;
+	if (a != (cbuffer_t *)NULL) {
+		bad += memcmp (a->data, "buf", 3) != 0;
+		cbuf_import (a, "BUF", 3);
+		bad += memcmp (buf->data, "arenabuf", 8) != 0;
+	}
+	caf_arena_delete (arena);
+	if (bad != 0) {
+		printf ("check_arena: %d errors\n", bad);
+	}
+	return bad;
+}
+
+
+static double
+run_split (cbuffer_t *in, int view, int *lines) {
+	struct timespec t0;
+	deque_t *lst;
+	double ns = 0.0;
+	int r;
+	for (r = 0; r < ROUNDS; r++) {
+		clock_gettime (CLOCK_MONOTONIC, &t0);
+		lst = view ? cbuf_split_slice (in, "\n", 1) : cbuf_split (in, "\n", 1);
+		*lines = deque_length (lst);
+		deque_delete (lst, cbuf_delete_callback);
+		ns += elapsed_ns (&t0);
+	}
+	return ns / ROUNDS;
+}
+
+
+static double
+run_halves (cbuffer_t *in, int view) {
+	struct timespec t0;
+	cbuffer_t *h, *t;
+	double ns = 0.0;
+	int r;
+	for (r = 0; r < ROUNDS; r++) {
+		clock_gettime (CLOCK_MONOTONIC, &t0);
+		if (view) {
+			h = cbuf_slice (in, 0, in->sz / 2);
+			t = cbuf_slice (in, in->sz / 2, in->sz);
+		} else {
+			h = cbuf_head (in, in->sz / 2);
+			t = cbuf_tail (in, in->sz - in->sz / 2);
+		}
+		cbuf_delete (h);
+		cbuf_delete (t);
+		ns += elapsed_ns (&t0);
+	}
+	return ns / ROUNDS;
+}
+
+/* caf_slice.c ends here */
@@ -0,0 +1,249 @@
+/* -*- mode: c; indent-tabs-mode: t; tab-width: 4; c-file-style: "caf" -*- */
+/* vim:set ft=c ff=unix ts=4 sw=4 enc=latin1 noexpandtab: */
+/* kate: space-indent off; indent-width 4; mixedindent off; indent-mode cstyle; */
+/*
+  Caffeine - C Application Framework
+  Copyright (C) 2006 Daniel Molina Wegener <dmw@coder.cl>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+  MA 02110-1301 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <caf/caf.h>
+#include <caf/caf_data_mem.h>
+#include <caf/caf_data_deque.h>
+#include <caf/caf_data_udeque.h>
+
+
+#define BENCH_ELEMENTS          200000
+#define BENCH_GETS              2000
+#define CHECK_ROUNDS            100000
+
+static long map_sum = 0;
+
+static int check_model (void);
+static int map_cb (void *ptr);
+static int map_stop_cb (void *ptr);
+static int srch_cb (void *ndata, void *data);
+static int del_cb (void *ptr);
+static double elapsed (struct timespec *t0, struct timespec *t1);
+static void bench_deque (double *t);
+static void bench_udeque (double *t);
+
+int
+main () {
+	double td[4], tu[4];
+	const char *ops[] = { "push", "pop", "get", "map" };
+	int i, errors = 0;
+	errors += check_model ();
+	bench_deque (td);
+	bench_udeque (tu);
+	printf ("%-6s %14s %14s %8s\n", "op", "deque ns/op", "udeque ns/op",
+			"speedup");
+	for (i = 0; i < 4; i++) {
+		printf ("%-6s %14.2f %14.2f %7.1fx\n", ops[i], td[i], tu[i],
+				td[i] / tu[i]);
+	}
+	if (errors != 0) {
+		printf ("%d errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
+
+
+/*
+ * Runs a random mix of operations against both ends, checking every
+ * result against a plain array used as a ring.
+ */
+static int
+check_model (void) {
+	udeque_t *lst;
+	long *model, head = CHECK_ROUNDS, tail = CHECK_ROUNDS, v, r;
+	int i, pos, errors = 0;
+	model = (long *)xmalloc (sizeof (long) * CHECK_ROUNDS * 2);
+	lst = udeque_create ();
+	srand (1);
+	for (i = 0; i < CHECK_ROUNDS; i++) {
+		r = rand () % 7;
+		v = (long)i + 1;
+		if (r < 2) {
+			udeque_push (lst, (void *)v);
+			model[tail++] = v;
+		} else if (r < 4) {
+			udeque_push_front (lst, (void *)v);
+			model[--head] = v;
+		} else if (r == 4) {
+			v = (long)udeque_pop (lst);
+			if (tail > head) {
+				errors += v != model[--tail];
+			} else {
+				errors += v != 0;
+			}
+		} else if (r == 5) {
+			v = (long)udeque_first (lst);
+			if (tail > head) {
+				errors += v != model[head++];
+			} else {
+				errors += v != 0;
+			}
+		} else if (tail > head) {
+			pos = rand () % (int)(tail - head);
+			errors += (long)udeque_get (lst, pos) != model[head + pos];
+			errors += udeque_set (lst, pos, (void *)v) != pos;
+			model[head + pos] = v;
+		}
+		errors += udeque_length (lst) != (int)(tail - head);
+	}
+	if (udeque_get (lst, -1) != NULL
+		|| udeque_get (lst, udeque_length (lst)) != NULL
+		|| udeque_set (lst, udeque_length (lst), NULL) != CAF_ERROR_SUB) {
+		errors++;
+	}
+	for (pos = 0; pos < (int)(tail - head); pos++) {
+		errors += (long)udeque_get (lst, pos) != model[head + pos];
+	}
+	map_sum = 0;
+	errors += udeque_map (lst, map_cb) != (int)(tail - head);
+	for (v = 0, i = (int)head; i < (int)tail; i++) {
+		v += model[i];
+	}
+	errors += map_sum != v;
+	errors += udeque_map_checked (lst, map_stop_cb) != 10;
+	if (tail > head) {
+		v = model[tail - 1];
+		errors += (long)udeque_search (lst, (void *)v, srch_cb) != v;
+	}
+	errors += udeque_search (lst, (void *)-1L, srch_cb) != NULL;
+	map_sum = 0;
+	errors += udeque_delete (lst, del_cb) != CAF_OK;
+	errors += map_sum != (long)(tail - head);
+	xfree (model);
+	if (errors != 0) {
+		printf ("udeque model check: %d errors\n", errors);
+	}
+	return errors;
+}
+
+
+static int
+map_cb (void *ptr) {
+	map_sum += (long)ptr;
+	return CAF_OK;
+}
+
+
+static int
+map_stop_cb (void *ptr) {
+	static int c = 0;
+	(void)ptr;
+	return c++ < 10 ? CAF_OK : CAF_ERROR;
+}
+
+
+static int
+srch_cb (void *ndata, void *data) {
+	return ndata == data ? CAF_OK : CAF_ERROR;
+}
+
+
+static int
+del_cb (void *ptr) {
+	(void)ptr;
+	map_sum++;
+	return CAF_OK;
+}
+
+
+static double
+elapsed (struct timespec *t0, struct timespec *t1) {
+	return (double)(t1->tv_sec - t0->tv_sec) * 1e9
+		+ (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+
+static void
+bench_deque (double *t) {
+	struct timespec t0, t1;
+	caf_dequen_t *n;
+	deque_t *lst;
+	long i;
+	lst = deque_create ();
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_ELEMENTS; i++) {
+		deque_push (lst, (void *)i);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[0] = elapsed (&t0, &t1) / BENCH_ELEMENTS;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_GETS; i++) {
+		deque_get (lst, (int)((i * 7919) % BENCH_ELEMENTS));
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[2] = elapsed (&t0, &t1) / BENCH_GETS;
+	map_sum = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	deque_map (lst, map_cb);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[3] = elapsed (&t0, &t1) / BENCH_ELEMENTS;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_ELEMENTS; i++) {
+		n = deque_pop (lst);
+		deque_node_release (lst, n);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[1] = elapsed (&t0, &t1) / BENCH_ELEMENTS;
+	deque_delete_nocb (lst);
+}
+
+
+static void
+bench_udeque (double *t) {
+	struct timespec t0, t1;
+	udeque_t *lst;
+	long i;
+	lst = udeque_create ();
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_ELEMENTS; i++) {
+		udeque_push (lst, (void *)i);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[0] = elapsed (&t0, &t1) / BENCH_ELEMENTS;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_GETS; i++) {
+		udeque_get (lst, (int)((i * 7919) % BENCH_ELEMENTS));
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[2] = elapsed (&t0, &t1) / BENCH_GETS;
+	map_sum = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	udeque_map (lst, map_cb);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[3] = elapsed (&t0, &t1) / BENCH_ELEMENTS;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_ELEMENTS; i++) {
+		udeque_pop (lst);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	t[1] = elapsed (&t0, &t1) / BENCH_ELEMENTS;
+	udeque_delete_nocb (lst);
+}
+
+/* caf_udeque.c ends here */